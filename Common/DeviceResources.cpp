@@ -230,6 +230,7 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	m_d2dContext->SetTarget(nullptr);
 	m_d2dTargetBitmap = nullptr;
 	m_d3dDepthStencilView = nullptr;
+	m_d3dDepthStencilShaderResourceView = nullptr;
 	m_d3dContext->Flush1(D3D11_CONTEXT_TYPE_ALL, nullptr);
 
 	UpdateRenderTargetSize();
@@ -380,14 +381,15 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 			)
 		);
 
-	// Create a depth stencil view for use with 3D rendering if needed.
+	// Create a depth stencil view for use with 3D rendering if needed. The texture is
+	// typeless so that the depth can also be read by shaders, e.g. for Hi-Z culling.
 	CD3D11_TEXTURE2D_DESC1 depthStencilDesc(
-		DXGI_FORMAT_D24_UNORM_S8_UINT, 
+		DXGI_FORMAT_R24G8_TYPELESS, 
 		lround(m_d3dRenderTargetSize.Width),
 		lround(m_d3dRenderTargetSize.Height),
 		1, // This depth stencil view has only one texture.
 		1, // Use a single mipmap level.
-		D3D11_BIND_DEPTH_STENCIL
+		D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE
 		);
 
 	ComPtr<ID3D11Texture2D1> depthStencil;
@@ -399,7 +401,7 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 			)
 		);
 
-	CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2D);
+	CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2D, DXGI_FORMAT_D24_UNORM_S8_UINT);
 	DX::ThrowIfFailed(
 		m_d3dDevice->CreateDepthStencilView(
 			depthStencil.Get(),
@@ -407,6 +409,15 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 			&m_d3dDepthStencilView
 			)
 		);
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC depthShaderResourceViewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R24_UNORM_X8_TYPELESS);
+	DX::ThrowIfFailed(
+		m_d3dDevice->CreateShaderResourceView(
+			depthStencil.Get(),
+			&depthShaderResourceViewDesc,
+			&m_d3dDepthStencilShaderResourceView
+			)
+		);
 	
 	// Set the 3D rendering viewport to target the entire window.
 	m_screenViewport = CD3D11_VIEWPORT(
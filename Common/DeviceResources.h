@@ -38,6 +38,7 @@ namespace DX
 		D3D_FEATURE_LEVEL			GetDeviceFeatureLevel() const			{ return m_d3dFeatureLevel; }
 		ID3D11RenderTargetView1*	GetBackBufferRenderTargetView() const	{ return m_d3dRenderTargetView.Get(); }
 		ID3D11DepthStencilView*		GetDepthStencilView() const				{ return m_d3dDepthStencilView.Get(); }
+		ID3D11ShaderResourceView*	GetDepthStencilShaderResourceView() const	{ return m_d3dDepthStencilShaderResourceView.Get(); }
 		D3D11_VIEWPORT				GetScreenViewport() const				{ return m_screenViewport; }
 		DirectX::XMFLOAT4X4			GetOrientationTransform3D() const		{ return m_orientationTransform3D; }
 
@@ -65,6 +66,7 @@ namespace DX
 		// Direct3D rendering objects. Required for 3D.
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView1>	m_d3dRenderTargetView;
 		Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	m_d3dDepthStencilView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_d3dDepthStencilShaderResourceView;
 		D3D11_VIEWPORT									m_screenViewport;
 
 		// Direct2D drawing components.
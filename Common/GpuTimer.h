@@ -0,0 +1,104 @@
+#pragma once
+
+#include <wrl.h>
+
+#include "DirectXHelper.h"
+
+namespace DX
+{
+	// Helper class for measuring GPU time with timestamp queries.
+	// Queries are read back a few frames late so the CPU never waits on the GPU.
+	class GpuTimer
+	{
+	public:
+		GpuTimer() :
+			m_current(0),
+			m_milliseconds(0.0),
+			m_pending()
+		{
+		}
+
+		void CreateDeviceDependentResources(ID3D11Device* device)
+		{
+			D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+			D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+			for (UINT i = 0; i < QueryLatency; i++)
+			{
+				DX::ThrowIfFailed(device->CreateQuery(&disjointDesc, &m_disjointQuery[i]));
+				DX::ThrowIfFailed(device->CreateQuery(&timestampDesc, &m_startQuery[i]));
+				DX::ThrowIfFailed(device->CreateQuery(&timestampDesc, &m_stopQuery[i]));
+				m_pending[i] = false;
+			}
+			m_current = 0;
+		}
+
+		void ReleaseDeviceDependentResources()
+		{
+			for (UINT i = 0; i < QueryLatency; i++)
+			{
+				m_disjointQuery[i].Reset();
+				m_startQuery[i].Reset();
+				m_stopQuery[i].Reset();
+				m_pending[i] = false;
+			}
+		}
+
+		// Brackets the GPU work to be measured. A result that has not been read
+		// back by the time its query slot comes round again is dropped.
+		void Start(ID3D11DeviceContext* context)
+		{
+			if (!m_disjointQuery[m_current]) return;
+
+			context->Begin(m_disjointQuery[m_current].Get());
+			context->End(m_startQuery[m_current].Get());
+		}
+
+		void Stop(ID3D11DeviceContext* context)
+		{
+			if (!m_disjointQuery[m_current]) return;
+
+			context->End(m_stopQuery[m_current].Get());
+			context->End(m_disjointQuery[m_current].Get());
+			m_pending[m_current] = true;
+			m_current = (m_current + 1) % QueryLatency;
+		}
+
+		// Reads back every finished query without flushing. Call once per frame.
+		void Resolve(ID3D11DeviceContext* context)
+		{
+			for (UINT n = 0; n < QueryLatency; n++)
+			{
+				UINT i = (m_current + n) % QueryLatency;
+				if (!m_pending[i]) continue;
+
+				D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+				if (context->GetData(m_disjointQuery[i].Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) continue;
+
+				UINT64 start = 0;
+				UINT64 stop = 0;
+				if (context->GetData(m_startQuery[i].Get(), &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) continue;
+				if (context->GetData(m_stopQuery[i].Get(), &stop, sizeof(stop), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) continue;
+
+				if (!disjoint.Disjoint && disjoint.Frequency > 0)
+				{
+					m_milliseconds = static_cast<double>(stop - start) * 1000.0 / static_cast<double>(disjoint.Frequency);
+				}
+				m_pending[i] = false;
+			}
+		}
+
+		// Most recent measurement in milliseconds.
+		double GetMilliseconds() const						{ return m_milliseconds; }
+
+	private:
+		static const UINT QueryLatency = 4;
+
+		Microsoft::WRL::ComPtr<ID3D11Query>	m_disjointQuery[QueryLatency];
+		Microsoft::WRL::ComPtr<ID3D11Query>	m_startQuery[QueryLatency];
+		Microsoft::WRL::ComPtr<ID3D11Query>	m_stopQuery[QueryLatency];
+		bool								m_pending[QueryLatency];
+		UINT								m_current;
+		double								m_milliseconds;
+	};
+}
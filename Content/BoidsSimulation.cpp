@@ -0,0 +1,263 @@
+#include "pch.h"
+#include "BoidsSimulation.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	BoidVector Add(const BoidVector& a, const BoidVector& b)		{ return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	BoidVector Subtract(const BoidVector& a, const BoidVector& b)	{ return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	BoidVector Scale(const BoidVector& a, float s)					{ return { a.x * s, a.y * s, a.z * s }; }
+	float Dot(const BoidVector& a, const BoidVector& b)				{ return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	BoidVector ClampLength(const BoidVector& a, float minLength, float maxLength)
+	{
+		float length = sqrtf(Dot(a, a));
+		if (length <= 0.0f) return a;
+		if (length > maxLength) return Scale(a, maxLength / length);
+		if (length < minLength) return Scale(a, minLength / length);
+		return a;
+	}
+
+	// Pushes back towards the box once a fish is within margin of a face.
+	float BoundsSteer(float p, float minBound, float maxBound, float margin)
+	{
+		if (p < minBound + margin) return (minBound + margin - p) / margin;
+		if (p > maxBound - margin) return (maxBound - margin - p) / margin;
+		return 0.0f;
+	}
+
+	int32_t CellCoordinate(float p, float cellSize)
+	{
+		return static_cast<int32_t>(floorf(p / cellSize));
+	}
+}
+
+BoidsSimulation::BoidsSimulation(const BoidsSettings& settings, uint32_t seed) :
+	m_settings(settings),
+	m_random(seed),
+	m_cellSize(settings.neighbourRadius),
+	m_tableMask(0)
+{
+}
+
+BoidsSettings BoidsSimulation::GetDefaultSettings()
+{
+	BoidsSettings settings;
+	settings.neighbourRadius = 2.0f;
+	settings.separationRadius = 0.75f;
+	settings.separationWeight = 1.5f;
+	settings.alignmentWeight = 1.0f;
+	settings.cohesionWeight = 0.6f;
+	settings.avoidanceWeight = 8.0f;
+	settings.boundsWeight = 4.0f;
+	settings.minSpeed = 2.0f;
+	settings.maxSpeed = 6.0f;
+	settings.maxAcceleration = 12.0f;
+	settings.maxNeighbours = 24;
+	settings.boundsMin = { -20.0f, -10.0f, -20.0f };
+	settings.boundsMax = { 20.0f, 10.0f, 20.0f };
+	return settings;
+}
+
+void BoidsSimulation::Resize(size_t count)
+{
+	size_t previousCount = m_positions.size();
+
+	m_positions.resize(count);
+	m_velocities.resize(count);
+
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const BoidVector& minBound = m_settings.boundsMin;
+	const BoidVector& maxBound = m_settings.boundsMax;
+	float speed = 0.5f * (m_settings.minSpeed + m_settings.maxSpeed);
+
+	for (size_t i = previousCount; i < count; i++)
+	{
+		m_positions[i] = {
+			minBound.x + (maxBound.x - minBound.x) * unit(m_random),
+			minBound.y + (maxBound.y - minBound.y) * unit(m_random),
+			minBound.z + (maxBound.z - minBound.z) * unit(m_random) };
+
+		// Mostly horizontal headings, as a shoal would swim.
+		float heading = 6.28318530718f * unit(m_random);
+		m_velocities[i] = { cosf(heading) * speed, (unit(m_random) - 0.5f) * 0.2f * speed, sinf(heading) * speed };
+	}
+
+	m_nextPositions.resize(count);
+	m_nextVelocities.resize(count);
+	m_cellKeys.resize(count);
+	m_sortedPositions.resize(count);
+	m_sortedVelocities.resize(count);
+
+	// Roughly two table entries per fish keeps hash collisions rare.
+	uint32_t tableSize = 1;
+	while (tableSize < 2 * count) tableSize <<= 1;
+	m_tableMask = tableSize - 1;
+	m_cellStart.resize(static_cast<size_t>(tableSize) + 1);
+}
+
+uint32_t BoidsSimulation::GetCellKey(int32_t x, int32_t y, int32_t z) const
+{
+	uint32_t hash = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^ static_cast<uint32_t>(z) * 83492791u;
+	return hash & m_tableMask;
+}
+
+void BoidsSimulation::BuildGrid()
+{
+	size_t count = m_positions.size();
+
+	std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		const BoidVector& p = m_positions[i];
+		uint32_t key = GetCellKey(CellCoordinate(p.x, m_cellSize), CellCoordinate(p.y, m_cellSize), CellCoordinate(p.z, m_cellSize));
+		m_cellKeys[i] = key;
+		m_cellStart[key + 1]++;
+	}
+
+	for (size_t c = 1; c < m_cellStart.size(); c++)
+	{
+		m_cellStart[c] += m_cellStart[c - 1];
+	}
+
+	// Scatter each fish into its slot, in cell order.
+	std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t slot = cursor[m_cellKeys[i]]++;
+		m_sortedPositions[slot] = m_positions[i];
+		m_sortedVelocities[slot] = m_velocities[i];
+	}
+}
+
+void BoidsSimulation::UpdateRange(size_t begin, size_t end, float dt)
+{
+	const BoidsSettings& s = m_settings;
+	float neighbourRadius2 = s.neighbourRadius * s.neighbourRadius;
+	float separationRadius2 = s.separationRadius * s.separationRadius;
+	float boundsMargin = 2.0f * s.neighbourRadius;
+
+	for (size_t i = begin; i < end; i++)
+	{
+		BoidVector p = m_positions[i];
+		BoidVector v = m_velocities[i];
+
+		int32_t cx = CellCoordinate(p.x, m_cellSize);
+		int32_t cy = CellCoordinate(p.y, m_cellSize);
+		int32_t cz = CellCoordinate(p.z, m_cellSize);
+
+		BoidVector separation = { 0.0f, 0.0f, 0.0f };
+		BoidVector averageVelocity = { 0.0f, 0.0f, 0.0f };
+		BoidVector averagePosition = { 0.0f, 0.0f, 0.0f };
+		uint32_t neighbours = 0;
+
+		// Neighbouring cells can hash to the same entry, so each entry is visited once.
+		uint32_t visited[27];
+		uint32_t visitedCount = 0;
+
+		for (int32_t dz = -1; dz <= 1 && neighbours < s.maxNeighbours; dz++)
+		{
+			for (int32_t dy = -1; dy <= 1 && neighbours < s.maxNeighbours; dy++)
+			{
+				for (int32_t dx = -1; dx <= 1 && neighbours < s.maxNeighbours; dx++)
+				{
+					uint32_t key = GetCellKey(cx + dx, cy + dy, cz + dz);
+					if (std::find(visited, visited + visitedCount, key) != visited + visitedCount) continue;
+					visited[visitedCount++] = key;
+
+					for (uint32_t j = m_cellStart[key]; j < m_cellStart[key + 1] && neighbours < s.maxNeighbours; j++)
+					{
+						BoidVector offset = Subtract(m_sortedPositions[j], p);
+						float distance2 = Dot(offset, offset);
+						if (distance2 >= neighbourRadius2 || distance2 <= 0.0f) continue;
+
+						if (distance2 < separationRadius2)
+						{
+							separation = Subtract(separation, Scale(offset, 1.0f / distance2));
+						}
+						averageVelocity = Add(averageVelocity, m_sortedVelocities[j]);
+						averagePosition = Add(averagePosition, offset);
+						neighbours++;
+					}
+				}
+			}
+		}
+
+		BoidVector acceleration = Scale(separation, s.separationWeight);
+		if (neighbours > 0)
+		{
+			float inverseCount = 1.0f / neighbours;
+			acceleration = Add(acceleration, Scale(Subtract(Scale(averageVelocity, inverseCount), v), s.alignmentWeight));
+			acceleration = Add(acceleration, Scale(averagePosition, inverseCount * s.cohesionWeight));
+		}
+
+		for (const BoidSphere& obstacle : m_obstacles)
+		{
+			BoidVector away = Subtract(p, obstacle.center);
+			float distance = sqrtf(Dot(away, away));
+			float margin = obstacle.radius + boundsMargin;
+			if (distance < margin && distance > 0.0f)
+			{
+				float strength = (margin - distance) / boundsMargin;
+				acceleration = Add(acceleration, Scale(away, s.avoidanceWeight * strength / distance));
+			}
+		}
+
+		BoidVector bounds = {
+			BoundsSteer(p.x, s.boundsMin.x, s.boundsMax.x, boundsMargin),
+			BoundsSteer(p.y, s.boundsMin.y, s.boundsMax.y, boundsMargin),
+			BoundsSteer(p.z, s.boundsMin.z, s.boundsMax.z, boundsMargin) };
+		acceleration = Add(acceleration, Scale(bounds, s.boundsWeight));
+
+		acceleration = ClampLength(acceleration, 0.0f, s.maxAcceleration);
+		v = ClampLength(Add(v, Scale(acceleration, dt)), s.minSpeed, s.maxSpeed);
+
+		m_nextVelocities[i] = v;
+		m_nextPositions[i] = Add(p, Scale(v, dt));
+	}
+}
+
+void BoidsSimulation::Step(float dt)
+{
+	if (m_positions.empty()) return;
+
+	BuildGrid();
+
+	ParallelFor(m_positions.size(), [this, dt](size_t begin, size_t end) {
+		UpdateRange(begin, end, dt);
+	});
+
+	m_positions.swap(m_nextPositions);
+	m_velocities.swap(m_nextVelocities);
+}
+
+double BoidsSimulation::Benchmark(size_t count, uint32_t steps)
+{
+	BoidsSettings settings = GetDefaultSettings();
+
+	// Keep the density of the default shoal so neighbour counts stay comparable.
+	float scale = cbrtf(static_cast<float>(count) / 10000.0f);
+	settings.boundsMin = Scale(settings.boundsMin, scale);
+	settings.boundsMax = Scale(settings.boundsMax, scale);
+
+	BoidsSimulation simulation(settings, 1);
+	simulation.Resize(count);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i < steps; i++)
+	{
+		simulation.Step(1.0f / 60.0f);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return (milliseconds > 0.0) ? static_cast<double>(count) * steps / milliseconds : 0.0;
+}
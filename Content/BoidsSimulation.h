@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Flocking simulation for the P05 fish shoal.
+	//
+	// Classic boids (separation, alignment, cohesion) plus steering away from
+	// spherical obstacles and the edges of a bounding box. Neighbours are found
+	// through a uniform grid hashed into a table and filled with a counting sort;
+	// the per-fish update then runs on every core.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	struct BoidVector
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	struct BoidSphere
+	{
+		BoidVector	center;
+		float		radius;
+	};
+
+	struct BoidsSettings
+	{
+		float		neighbourRadius;
+		float		separationRadius;
+		float		separationWeight;
+		float		alignmentWeight;
+		float		cohesionWeight;
+		float		avoidanceWeight;
+		float		boundsWeight;
+		float		minSpeed;
+		float		maxSpeed;
+		float		maxAcceleration;
+		uint32_t	maxNeighbours;		// Neighbours considered per fish, bounds the cost in dense areas.
+		BoidVector	boundsMin;
+		BoidVector	boundsMax;
+	};
+
+	class BoidsSimulation
+	{
+	public:
+		BoidsSimulation(const BoidsSettings& settings, uint32_t seed);
+
+		// Adds fish at random positions in the bounds, or removes fish from the end.
+		void Resize(size_t count);
+		void SetObstacles(const std::vector<BoidSphere>& obstacles)		{ m_obstacles = obstacles; }
+
+		// Advances every fish by dt seconds.
+		void Step(float dt);
+
+		size_t GetCount() const											{ return m_positions.size(); }
+		const std::vector<BoidVector>& GetPositions() const				{ return m_positions; }
+		const std::vector<BoidVector>& GetVelocities() const			{ return m_velocities; }
+		const BoidsSettings& GetSettings() const						{ return m_settings; }
+
+		static BoidsSettings GetDefaultSettings();
+
+		// Runs the given number of fixed steps over count fish and returns fish updated per millisecond.
+		static double Benchmark(size_t count, uint32_t steps);
+
+	private:
+		void BuildGrid();
+		uint32_t GetCellKey(int32_t x, int32_t y, int32_t z) const;
+		void UpdateRange(size_t begin, size_t end, float dt);
+
+	private:
+		BoidsSettings				m_settings;
+		std::vector<BoidSphere>		m_obstacles;
+		std::mt19937				m_random;
+
+		// Fish state, double buffered so the update can run in parallel.
+		std::vector<BoidVector>		m_positions;
+		std::vector<BoidVector>		m_velocities;
+		std::vector<BoidVector>		m_nextPositions;
+		std::vector<BoidVector>		m_nextVelocities;
+
+		// Spatial hash grid. Fish are copied out in cell order so each
+		// neighbour query reads contiguous memory.
+		float						m_cellSize;
+		uint32_t					m_tableMask;
+		std::vector<uint32_t>		m_cellKeys;
+		std::vector<uint32_t>		m_cellStart;
+		std::vector<BoidVector>		m_sortedPositions;
+		std::vector<BoidVector>		m_sortedVelocities;
+	};
+}
@@ -0,0 +1,294 @@
+#include "pch.h"
+#include "BubbleField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float BubbleField::VentY = -3.0f;
+const float BubbleField::PopY = -0.45f;
+const float BubbleField::MinRadius = 0.01f;
+const float BubbleField::MaxRadius = 0.09f;
+const float BubbleField::Epsilon = 0.003f;
+
+namespace
+{
+	// Vents on the sea floor in front of the marcher's eye, on xz, and how far
+	// from them bubbles leave.
+	const float BUBBLE_VENTS[][2] = {
+		{ -1.5f, -1.0f }, { 0.5f, -2.5f }, { -3.5f, -3.0f }, { 1.8f, 0.5f },
+		{ -4.5f, 0.0f }, { -0.5f, -5.0f }, { 2.5f, -4.0f }, { -2.8f, -6.5f },
+		{ -6.0f, -4.5f }, { 4.0f, -1.5f }, { 1.0f, -8.0f }, { -5.5f, -9.0f },
+		{ 3.5f, -7.0f }, { -7.5f, -1.5f }, { -1.0f, -11.0f }, { 5.5f, -10.0f }
+	};
+	const uint32_t BUBBLE_VENT_COUNT = 16;
+	const float BUBBLE_VENT_RADIUS = 0.5f;
+
+	// Largest radius a bubble leaves a vent with, rise speed at radius zero and
+	// its gain with the radius, and the sway: amplitude at radius zero, its gain,
+	// and the range of its frequency in radians per second.
+	const float BUBBLE_SPAWN_RADIUS = 0.05f;
+	const float BUBBLE_RISE_SPEED = 0.2f;
+	const float BUBBLE_RISE_GAIN = 5.0f;
+	const float BUBBLE_SWAY = 0.02f;
+	const float BUBBLE_SWAY_GAIN = 0.6f;
+	const float BUBBLE_SWAY_FREQUENCIES[2] = { 2.0f, 5.0f };
+
+	// Longest step of Update, so a stall does not throw the bubbles through each other.
+	const float BUBBLE_MAX_STEP = 0.1f;
+
+	const float BUBBLE_HALF_PI = 1.5707963f;
+	const float BUBBLE_UNBOUNDED = 1e30f;
+
+	// Extent on the canvas, at distance one, of a circle of radius r centred at
+	// offset a and depth d, seen from the origin. The ends are unbounded where the
+	// circle reaches beside or behind the eye; false if it lies all behind.
+	bool CanvasRange(float a, float d, float r, float& low, float& high)
+	{
+		float lengthSquared = a * a + d * d;
+		if (lengthSquared <= r * r)
+		{
+			low = -BUBBLE_UNBOUNDED;
+			high = BUBBLE_UNBOUNDED;
+			return true;
+		}
+
+		float centre = atan2f(a, d);
+		float spread = asinf(r / sqrtf(lengthSquared));
+		float lowAngle = centre - spread;
+		float highAngle = centre + spread;
+		if (highAngle <= -BUBBLE_HALF_PI || lowAngle >= BUBBLE_HALF_PI) return false;
+
+		low = lowAngle <= -BUBBLE_HALF_PI ? -BUBBLE_UNBOUNDED : tanf(lowAngle);
+		high = highAngle >= BUBBLE_HALF_PI ? BUBBLE_UNBOUNDED : tanf(highAngle);
+		return true;
+	}
+
+	// Tile of a position along one axis of the canvas, from 0 to 1, kept within
+	// [-1, count] so that off-canvas ends can be told apart.
+	int TileOf(float position, uint32_t count)
+	{
+		float tile = floorf(position * count);
+		return static_cast<int>(std::min(std::max(tile, -1.0f), static_cast<float>(count)));
+	}
+}
+
+BubbleField::BubbleField() :
+	m_canvasWidth(1.0f),
+	m_canvasHeight(1.0f),
+	m_columns(0),
+	m_rows(0),
+	m_spawned(0),
+	m_merges(0),
+	m_pops(0),
+	m_maxMergeError(0.0f)
+{
+}
+
+void BubbleField::Reset(uint32_t count, uint32_t seed)
+{
+	m_generator.seed(seed);
+	m_bubbles.assign(count, Bubble());
+	m_motions.assign(count, Motion());
+	m_spawned = 0;
+	m_merges = 0;
+	m_pops = 0;
+	m_maxMergeError = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		Spawn(i, true);
+	}
+}
+
+void BubbleField::Spawn(size_t index, bool isAnywhere)
+{
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_int_distribution<uint32_t> vent(0, BUBBLE_VENT_COUNT - 1);
+
+	// Most bubbles are small
+	float size = unit(m_generator);
+	Bubble& bubble = m_bubbles[index];
+	bubble.radius = MinRadius + (BUBBLE_SPAWN_RADIUS - MinRadius) * size * size;
+	bubble.y = isAnywhere ? VentY + unit(m_generator) * (PopY - bubble.radius - VentY) : VentY;
+
+	uint32_t v = vent(m_generator);
+	float angle = unit(m_generator) * 6.2831853f;
+	float distance = BUBBLE_VENT_RADIUS * sqrtf(unit(m_generator));
+
+	Motion& motion = m_motions[index];
+	motion.anchorX = BUBBLE_VENTS[v][0] + distance * cosf(angle);
+	motion.anchorZ = BUBBLE_VENTS[v][1] + distance * sinf(angle);
+	motion.amplitude = BUBBLE_SWAY + BUBBLE_SWAY_GAIN * bubble.radius;
+	motion.frequency = BUBBLE_SWAY_FREQUENCIES[0] + unit(m_generator) * (BUBBLE_SWAY_FREQUENCIES[1] - BUBBLE_SWAY_FREQUENCIES[0]);
+	motion.phase = unit(m_generator) * 6.2831853f;
+	motion.age = 0.0f;
+	Place(index);
+
+	m_spawned++;
+}
+
+void BubbleField::Place(size_t index)
+{
+	const Motion& motion = m_motions[index];
+	float swing = motion.frequency * motion.age + motion.phase;
+	m_bubbles[index].x = motion.anchorX + motion.amplitude * sinf(swing);
+	m_bubbles[index].z = motion.anchorZ + motion.amplitude * cosf(swing * 0.8f);
+}
+
+void BubbleField::Update(float seconds)
+{
+	float step = std::min(seconds, BUBBLE_MAX_STEP);
+	for (size_t i = 0; i < m_bubbles.size(); i++)
+	{
+		m_motions[i].age += step;
+		m_bubbles[i].y += (BUBBLE_RISE_SPEED + BUBBLE_RISE_GAIN * m_bubbles[i].radius) * step;
+		Place(i);
+	}
+
+	Merge();
+
+	for (size_t i = 0; i < m_bubbles.size(); i++)
+	{
+		if (m_bubbles[i].y + m_bubbles[i].radius >= PopY || m_bubbles[i].radius > MaxRadius)
+		{
+			m_pops++;
+			Spawn(i, false);
+		}
+	}
+}
+
+void BubbleField::Merge()
+{
+	// Sweep along x: only bubbles closer on x than the largest pair of radii
+	// can touch.
+	std::vector<uint32_t> order(m_bubbles.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_bubbles[a].x < m_bubbles[b].x; });
+
+	std::vector<bool> isMerged(m_bubbles.size(), false);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		uint32_t a = order[i];
+		if (isMerged[a]) continue;
+
+		for (size_t j = i + 1; j < order.size(); j++)
+		{
+			uint32_t b = order[j];
+			if (m_bubbles[b].x - m_bubbles[a].x > m_bubbles[a].radius + MaxRadius) break;
+			if (isMerged[b]) continue;
+
+			Bubble& first = m_bubbles[a];
+			const Bubble& second = m_bubbles[b];
+			float dx = second.x - first.x, dy = second.y - first.y, dz = second.z - first.z;
+			float reach = first.radius + second.radius;
+			if (dx * dx + dy * dy + dz * dz >= reach * reach) continue;
+
+			// The bubble of both volumes at their centre of volume, swaying about
+			// the columns of both in the same way
+			float firstVolume = first.radius * first.radius * first.radius;
+			float secondVolume = second.radius * second.radius * second.radius;
+			float volume = firstVolume + secondVolume;
+			float w = secondVolume / volume;
+
+			Motion& motion = m_motions[a];
+			const Motion& other = m_motions[b];
+			motion.anchorX += (other.anchorX - motion.anchorX) * w;
+			motion.anchorZ += (other.anchorZ - motion.anchorZ) * w;
+			first.y += dy * w;
+			first.radius = cbrtf(volume);
+			motion.amplitude = BUBBLE_SWAY + BUBBLE_SWAY_GAIN * first.radius;
+			Place(a);
+
+			float merged = first.radius * first.radius * first.radius;
+			m_maxMergeError = std::max(m_maxMergeError, fabsf(merged - volume) / volume);
+			m_merges++;
+
+			isMerged[b] = true;
+			Spawn(b, false);
+		}
+	}
+}
+
+void BubbleField::Bin(const float eye[3], const float rotation[16], float canvasWidth, float canvasHeight,
+	uint32_t columns, uint32_t rows, float pixelRadius)
+{
+	m_canvasWidth = canvasWidth;
+	m_canvasHeight = canvasHeight;
+	m_columns = columns;
+	m_rows = rows;
+	m_tiles.assign(static_cast<size_t>(columns) * rows, BubbleTile());
+
+	// The tiles each bubble covers, counted first to place the lists
+	std::vector<int> ranges(m_bubbles.size() * 4);
+	for (size_t i = 0; i < m_bubbles.size(); i++)
+	{
+		const Bubble& bubble = m_bubbles[i];
+		float dx = bubble.x - eye[0], dy = bubble.y - eye[1], dz = bubble.z - eye[2];
+		float vx = dx * rotation[0] + dy * rotation[4] + dz * rotation[8];
+		float vy = dx * rotation[1] + dy * rotation[5] + dz * rotation[9];
+		float depth = -(dx * rotation[2] + dy * rotation[6] + dz * rotation[10]);
+
+		int* range = &ranges[i * 4];
+		range[0] = 0;
+		range[1] = -1;
+		range[2] = 0;
+		range[3] = -1;
+
+		// A ray stops within Epsilon plus its distance times pixelRadius of the
+		// surface, and rays that come that close are no farther than the bubble
+		// and its threshold, so the sphere is widened by the threshold there.
+		float reach = sqrtf(dx * dx + dy * dy + dz * dz) + bubble.radius + Epsilon;
+		float radius = bubble.radius + Epsilon + pixelRadius * reach / (1.0f - pixelRadius);
+		float left, right, bottom, top;
+		if (!CanvasRange(vx, depth, radius, left, right) || !CanvasRange(vy, depth, radius, bottom, top)) continue;
+
+		// Columns run right along x, rows down along y
+		int column0 = TileOf(left / canvasWidth * 0.5f + 0.5f, columns);
+		int column1 = TileOf(right / canvasWidth * 0.5f + 0.5f, columns);
+		int row0 = TileOf(0.5f - top / canvasHeight * 0.5f, rows);
+		int row1 = TileOf(0.5f - bottom / canvasHeight * 0.5f, rows);
+		range[0] = std::max(column0, 0);
+		range[1] = std::min(column1, static_cast<int>(columns) - 1);
+		range[2] = std::max(row0, 0);
+		range[3] = std::min(row1, static_cast<int>(rows) - 1);
+
+		for (int row = range[2]; row <= range[3]; row++)
+		{
+			for (int column = range[0]; column <= range[1]; column++)
+			{
+				m_tiles[static_cast<size_t>(row) * columns + column].count++;
+			}
+		}
+	}
+
+	uint32_t total = 0;
+	for (auto& tile : m_tiles)
+	{
+		tile.first = total;
+		total += tile.count;
+		tile.count = 0;
+	}
+
+	m_tileBubbles.resize(total);
+	for (size_t i = 0; i < m_bubbles.size(); i++)
+	{
+		const int* range = &ranges[i * 4];
+		for (int row = range[2]; row <= range[3]; row++)
+		{
+			for (int column = range[0]; column <= range[1]; column++)
+			{
+				BubbleTile& tile = m_tiles[static_cast<size_t>(row) * columns + column];
+				m_tileBubbles[tile.first + tile.count++] = m_bubbles[i];
+			}
+		}
+	}
+}
+
+uint32_t BubbleField::GetTileIndex(float canvasX, float canvasY) const
+{
+	int column = std::min(std::max(TileOf(canvasX / m_canvasWidth * 0.5f + 0.5f, m_columns), 0), static_cast<int>(m_columns) - 1);
+	int row = std::min(std::max(TileOf(0.5f - canvasY / m_canvasHeight * 0.5f, m_rows), 0), static_cast<int>(m_rows) - 1);
+	return static_cast<uint32_t>(row) * m_columns + column;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Field of bubbles for the P01 ray marcher, in place of the two BubbleSDF of
+	// ObjectsSDF.
+	//
+	// Bubbles leave vents on the sea floor and rise, faster the larger they are,
+	// swaying about a column over the vent. Two that touch merge into one of
+	// their combined volume, and a bubble pops at the surface or when it has
+	// grown past MaxRadius. A popped or merged slot is given to a new bubble at a
+	// vent, so the field always holds the same count.
+	//
+	// Each frame the bubbles are binned into tiles of the screen, TileSize pixels
+	// wide, as seen from the fixed eye of the marcher. A bubble is listed in
+	// every tile its sphere covers, widened by the hit threshold: EPSILON on the
+	// radius, and the radius of a pixel's cone on the canvas. A ray can then only
+	// meet the bubbles of its own tile, and a pixel tests those alone, which are
+	// few wherever the bubbles are spread over the screen, however many there
+	// are. Rays a bubble bends away from their pixel only see the bubbles of that
+	// pixel's tile, as do the shadow, normal and occlusion samples.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	// One bubble, laid out as Bubble of P01_Scene.hlsli.
+	struct Bubble
+	{
+		float	x;
+		float	y;
+		float	z;
+		float	radius;
+	};
+
+	// The bubbles of one tile in the tile bubbles, laid out as BubbleTile of P01_Scene.hlsli.
+	struct BubbleTile
+	{
+		uint32_t	first;
+		uint32_t	count;
+	};
+
+	class BubbleField
+	{
+	public:
+		// Side of a tile in pixels.
+		static const uint32_t TileSize = 16;
+
+		// Height of the vents and of the surface where bubbles pop, and the sizes
+		// of bubbles.
+		static const float VentY;
+		static const float PopY;
+		static const float MinRadius;
+		static const float MaxRadius;
+
+		// Widening of the radius for the hit threshold, as EPSILON of the marcher.
+		static const float Epsilon;
+
+		BubbleField();
+
+		// Starts count bubbles spread over their whole rise.
+		void Reset(uint32_t count, uint32_t seed);
+
+		// Moves the bubbles on by seconds, then merges and pops them.
+		void Update(float seconds);
+
+		// Bins the bubbles into columns x rows tiles of a canvas reaching
+		// +-canvasWidth and +-canvasHeight at the edges, seen from eye with a
+		// view rotation (16 floats, row-vector order). pixelRadius is the radius
+		// of a pixel's cone at distance one, 0 for a fixed Epsilon.
+		void Bin(const float eye[3], const float rotation[16], float canvasWidth, float canvasHeight,
+			uint32_t columns, uint32_t rows, float pixelRadius);
+
+		// Tile of a point of the canvas, as SelectBubbleTile of P01_Scene.hlsli.
+		uint32_t GetTileIndex(float canvasX, float canvasY) const;
+
+		const std::vector<Bubble>& GetBubbles() const			{ return m_bubbles; }
+		const std::vector<BubbleTile>& GetTiles() const			{ return m_tiles; }
+		const std::vector<Bubble>& GetTileBubbles() const		{ return m_tileBubbles; }
+		uint32_t GetColumns() const								{ return m_columns; }
+		uint32_t GetRows() const								{ return m_rows; }
+		uint32_t GetSpawned() const								{ return m_spawned; }
+		uint32_t GetMerges() const								{ return m_merges; }
+		uint32_t GetPops() const								{ return m_pops; }
+		float GetMaxMergeError() const							{ return m_maxMergeError; }
+
+	private:
+		// How a bubble moves: the column it sways about, and the sway.
+		struct Motion
+		{
+			float	anchorX;
+			float	anchorZ;
+			float	amplitude;
+			float	frequency;
+			float	phase;
+			float	age;
+		};
+
+		void Spawn(size_t index, bool isAnywhere);
+		void Place(size_t index);
+		void Merge();
+
+		std::vector<Bubble>			m_bubbles;
+		std::vector<Motion>			m_motions;
+		std::mt19937				m_generator;
+
+		std::vector<BubbleTile>		m_tiles;
+		std::vector<Bubble>			m_tileBubbles;
+		float						m_canvasWidth;
+		float						m_canvasHeight;
+		uint32_t					m_columns;
+		uint32_t					m_rows;
+
+		uint32_t					m_spawned;
+		uint32_t					m_merges;
+		uint32_t					m_pops;
+		float						m_maxMergeError;
+	};
+}
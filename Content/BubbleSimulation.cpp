@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "BubbleSimulation.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Emitters as in P05_Particles.hlsli: position and spread.
+	const float BUBBLE_EMITTERS[4][4] =
+	{
+		{ 20.0f, -5.0f, -10.0f, 2.0f },
+		{ -20.0f, -7.0f, -20.0f, 1.5f },
+		{ 0.0f, -8.0f, -45.0f, 6.0f },
+		{ -25.0f, -8.0f, -65.0f, 4.0f },
+	};
+
+	const float BUBBLE_SURFACE_HEIGHT = 12.0f;
+
+	uint32_t Hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	float Random(uint32_t& state)
+	{
+		state = Hash(state);
+		return (state & 0x00FFFFFFu) / 16777216.0f;
+	}
+}
+
+BubbleSimulation::BubbleSimulation(size_t capacity) :
+	m_capacity(capacity)
+{
+	m_particles.Reserve(capacity);
+}
+
+void BubbleSimulation::Reset()
+{
+	m_particles.Clear();
+}
+
+void BubbleSimulation::Step(float deltaTime, uint32_t emitCount, uint32_t frameIndex)
+{
+	// Emission is capped by the free slots, as the GPU is by the dead list.
+	size_t freeCount = m_capacity - m_particles.GetCount();
+	for (uint32_t slot = 0; slot < emitCount && slot < freeCount; slot++)
+	{
+		Particle particle = EmitParticle(slot, frameIndex);
+		m_particles.Add(particle.position.x, particle.position.y, particle.position.z,
+			particle.velocity.x, particle.velocity.y, particle.velocity.z, particle.lifetime);
+	}
+
+	// The forces of UpdateParticle, evaluated at the age the particle is about to reach.
+	size_t count = m_particles.GetCount();
+	const float* age = m_particles.GetAge();
+	const float* lifetime = m_particles.GetLifetime();
+	float* vx = m_particles.GetVelocityX();
+	float* vy = m_particles.GetVelocityY();
+	float* vz = m_particles.GetVelocityZ();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float nextAge = age[i] + deltaTime;
+		vy[i] += (2.5f - vy[i]) * 0.5f * deltaTime;
+		vx[i] += sinf(nextAge * 4.0f + lifetime[i] * 10.0f) * 0.8f * deltaTime;
+		vz[i] += cosf(nextAge * 3.0f + lifetime[i] * 10.0f) * 0.8f * deltaTime;
+	}
+
+	m_particles.Integrate(deltaTime);
+
+	// Swap-remove keeps the live particles packed.
+	size_t i = 0;
+	while (i < m_particles.GetCount())
+	{
+		if (m_particles.GetAge()[i] < m_particles.GetLifetime()[i] && m_particles.GetY()[i] < BUBBLE_SURFACE_HEIGHT)
+		{
+			i++;
+		}
+		else
+		{
+			m_particles.Remove(i);
+		}
+	}
+}
+
+Particle BubbleSimulation::EmitParticle(uint32_t slot, uint32_t frameIndex)
+{
+	uint32_t state = Hash(frameIndex) ^ slot;
+
+	const float* emitter = BUBBLE_EMITTERS[Hash(state) & 3];
+
+	float offsetX = Random(state) - 0.5f;
+	float offsetZ = Random(state) - 0.5f;
+	float driftX = Random(state) - 0.5f;
+	float rise = Random(state);
+	float driftZ = Random(state) - 0.5f;
+	float lifetime = Random(state);
+
+	Particle particle;
+	particle.position = DirectX::XMFLOAT3(
+		emitter[0] + offsetX * 2.0f * emitter[3],
+		emitter[1],
+		emitter[2] + offsetZ * 2.0f * emitter[3]);
+	particle.velocity = DirectX::XMFLOAT3(driftX * 0.4f, 1.5f + rise, driftZ * 0.4f);
+	particle.age = 0.0f;
+	particle.lifetime = 6.0f + lifetime * 4.0f;
+	return particle;
+}
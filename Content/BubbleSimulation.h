@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ShaderStructures.h"
+#include "ParticleStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// CPU reference of the P05 GPU bubble particles.
+	//
+	// Mirrors EmitParticle and UpdateParticle in P05_Particles.hlsli with the same
+	// hash, so given the same emit counts and frame indices it holds the same set
+	// of particles as the compute shaders. Only the order differs, since the GPU
+	// lists are filled with atomic appends. Particles are kept in a ParticleStore,
+	// so the integration step runs on its SIMD kernels.
+
+	class BubbleSimulation
+	{
+	public:
+		explicit BubbleSimulation(size_t capacity);
+
+		void Reset();
+
+		// Emits up to emitCount particles while the pool has room, then advances every particle.
+		void Step(float deltaTime, uint32_t emitCount, uint32_t frameIndex);
+
+		size_t GetCount() const								{ return m_particles.GetCount(); }
+		size_t GetCapacity() const							{ return m_capacity; }
+		const ParticleStore& GetParticles() const			{ return m_particles; }
+
+		static Particle EmitParticle(uint32_t slot, uint32_t frameIndex);
+
+	private:
+		size_t					m_capacity;
+		ParticleStore			m_particles;
+	};
+}
@@ -0,0 +1,225 @@
+#include "pch.h"
+#include "CheckerboardReconstruction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float CheckerboardReconstruction::DistanceTolerance = 0.05f;
+const float CheckerboardReconstruction::ColorMargin = 0.02f;
+const float CheckerboardReconstruction::MaxMotion = 0.5f;
+const float CheckerboardReconstruction::StillMotion = 0.2f;
+
+namespace
+{
+	// Unit direction in view space of the ray through a point of the image.
+	void ViewDirection(const CheckerboardView& view, uint32_t width, uint32_t height, float x, float y, float viewDirection[3])
+	{
+		viewDirection[0] = (x / width * 2.0f - 1.0f) * view.canvasWidth;
+		viewDirection[1] = (1.0f - y / height * 2.0f) * view.canvasHeight;
+		viewDirection[2] = -1.0f;
+		float length = std::sqrt(viewDirection[0] * viewDirection[0] + viewDirection[1] * viewDirection[1] + 1.0f);
+		for (int c = 0; c < 3; c++) viewDirection[c] /= length;
+	}
+}
+
+uint32_t CheckerboardReconstruction::Reconstruct(const CheckerboardImage& traced, uint32_t parity, const CheckerboardView& view,
+	const std::vector<float>& ends, const CheckerboardImage& history, const CheckerboardView& previousView,
+	CheckerboardImage& resolved)
+{
+	const uint32_t width = traced.width;
+	const uint32_t height = traced.height;
+	const bool hasHistory = !history.covered.empty();
+
+	// Left, right, up and down: two pairs across the pixel.
+	const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	uint32_t rejected = 0;
+
+	resolved = traced;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = (y + parity + 1) & 1; x < width; x += 2)
+		{
+			uint32_t pixel = y * width + x;
+
+			// The four neighbours are all of the traced parity.
+			int neighbours[4];
+			uint32_t count = 0;
+			float colorMin[3] = { 1e30f, 1e30f, 1e30f };
+			float colorMax[3] = { -1e30f, -1e30f, -1e30f };
+			float nearest = std::numeric_limits<float>::infinity();
+			float farthest = 0.0f;
+			for (int n = 0; n < 4; n++)
+			{
+				int nx = static_cast<int>(x) + offsets[n][0];
+				int ny = static_cast<int>(y) + offsets[n][1];
+				neighbours[n] = -1;
+				if (nx < 0 || ny < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height)) continue;
+				int neighbour = ny * width + nx;
+				if (traced.covered[neighbour]) continue;
+
+				neighbours[n] = neighbour;
+				for (int ch = 0; ch < 3; ch++)
+				{
+					colorMin[ch] = std::min(colorMin[ch], traced.colors[neighbour * 3 + ch]);
+					colorMax[ch] = std::max(colorMax[ch], traced.colors[neighbour * 3 + ch]);
+				}
+				nearest = std::min(nearest, traced.distances[neighbour]);
+				farthest = std::max(farthest, traced.distances[neighbour]);
+				count++;
+			}
+
+			// Where the ray through the pixel met the previous image, and how far
+			// that is from the pixel.
+			bool isHistory = false;
+			float historyColor[3] = { 0.0f, 0.0f, 0.0f };
+			float historyDistance = 0.0f;
+			float motion = std::numeric_limits<float>::infinity();
+			if (hasHistory)
+			{
+				float viewDirection[3];
+				ViewDirection(view, width, height, x + 0.5f, y + 0.5f, viewDirection);
+				float previousDirection[3];
+				for (int i = 0; i < 3; i++)
+				{
+					previousDirection[i] = 0.0f;
+					for (int j = 0; j < 3; j++)
+					{
+						float world = view.rotation[j] * viewDirection[0] + view.rotation[3 + j] * viewDirection[1] + view.rotation[6 + j] * viewDirection[2];
+						previousDirection[i] += previousView.rotation[i * 3 + j] * world;
+					}
+				}
+				if (previousDirection[2] < 0.0f)
+				{
+					float px = (previousDirection[0] / -previousDirection[2] / previousView.canvasWidth + 1.0f) * 0.5f * history.width - 0.5f;
+					float py = (1.0f - previousDirection[1] / -previousDirection[2] / previousView.canvasHeight) * 0.5f * history.height - 0.5f;
+					motion = std::sqrt((px - x) * (px - x) + (py - y) * (py - y));
+
+					// Bilinear filtering blurs the history a little every frame, which
+					// adds up once the image moves by more than a fraction of a pixel;
+					// the neighbours do better then. The texel nearest to the point
+					// decides the surface, and only the texels on that surface are
+					// filtered, so edges are not mixed.
+					int baseX = static_cast<int>(std::floor(px));
+					int baseY = static_cast<int>(std::floor(py));
+					int nearestX = static_cast<int>(std::floor(px + 0.5f));
+					int nearestY = static_cast<int>(std::floor(py + 0.5f));
+					if (motion <= MaxMotion && nearestX >= 0 && nearestY >= 0 &&
+						nearestX < static_cast<int>(history.width) && nearestY < static_cast<int>(history.height) &&
+						!history.covered[nearestY * history.width + nearestX])
+					{
+						float surface = history.distances[nearestY * history.width + nearestX];
+						float fx = px - baseX;
+						float fy = py - baseY;
+						float weightSum = 0.0f;
+						for (int corner = 0; corner < 4; corner++)
+						{
+							int hx = baseX + (corner & 1);
+							int hy = baseY + (corner >> 1);
+							if (hx < 0 || hy < 0 || hx >= static_cast<int>(history.width) || hy >= static_cast<int>(history.height)) continue;
+							uint32_t previous = hy * history.width + hx;
+							if (history.covered[previous] || std::abs(history.distances[previous] - surface) > surface * DistanceTolerance) continue;
+
+							float weight = ((corner & 1) ? fx : 1.0f - fx) * ((corner >> 1) ? fy : 1.0f - fy);
+							for (int ch = 0; ch < 3; ch++) historyColor[ch] += weight * history.colors[previous * 3 + ch];
+							historyDistance += weight * history.distances[previous];
+							weightSum += weight;
+						}
+						if (weightSum > 0.0f)
+						{
+							for (int ch = 0; ch < 3; ch++) historyColor[ch] /= weightSum;
+							historyDistance /= weightSum;
+							isHistory = true;
+						}
+					}
+				}
+			}
+
+			// The pair of opposite neighbours whose distances differ least, which
+			// runs along an edge rather than across it.
+			int pair = -1;
+			float pairSpread = std::numeric_limits<float>::infinity();
+			for (int p = 0; p < 2; p++)
+			{
+				int a = neighbours[p * 2];
+				int b = neighbours[p * 2 + 1];
+				if (a < 0 || b < 0) continue;
+				float spread = std::abs(traced.distances[a] - traced.distances[b]) / std::min(traced.distances[a], traced.distances[b]);
+				if (spread < pairSpread)
+				{
+					pairSpread = spread;
+					pair = p;
+				}
+			}
+
+			if (isHistory)
+			{
+				// A raster object has come in front.
+				if (historyDistance >= ends[pixel])
+				{
+					resolved.covered[pixel] = 1;
+					continue;
+				}
+
+				// Within a surface, or while the camera is still, the history has to lie
+				// between the neighbours. On an edge of a moving image the pixel may
+				// belong to either side, so the history has to match the pair along it.
+				bool isFitting;
+				if (count == 0)
+				{
+					isFitting = true;
+				}
+				else if (farthest <= nearest * (1.0f + DistanceTolerance) || motion <= StillMotion)
+				{
+					isFitting = historyDistance >= nearest * (1.0f - DistanceTolerance) && historyDistance <= farthest * (1.0f + DistanceTolerance);
+				}
+				else
+				{
+					float pairDistance = pair < 0 ? 0.0f : std::min(traced.distances[neighbours[pair * 2]], traced.distances[neighbours[pair * 2 + 1]]);
+					isFitting = pair >= 0 && pairSpread <= DistanceTolerance &&
+						std::abs(historyDistance - pairDistance) <= pairDistance * DistanceTolerance;
+				}
+				if (isFitting)
+				{
+					for (int ch = 0; ch < 3; ch++)
+					{
+						resolved.colors[pixel * 3 + ch] = count == 0 ? historyColor[ch] :
+							std::min(std::max(historyColor[ch], colorMin[ch] - ColorMargin), colorMax[ch] + ColorMargin);
+					}
+					resolved.distances[pixel] = historyDistance;
+					resolved.covered[pixel] = 0;
+					continue;
+				}
+				rejected++;
+			}
+
+			// Hidden if the raster object is in front of all the neighbours.
+			if (count == 0 || nearest >= ends[pixel])
+			{
+				resolved.covered[pixel] = 1;
+				continue;
+			}
+
+			// Otherwise interpolated along the pair chosen above.
+			float colorSum[3] = { 0.0f, 0.0f, 0.0f };
+			float distance = std::numeric_limits<float>::infinity();
+			uint32_t used = 0;
+			for (int n = 0; n < 4; n++)
+			{
+				if (neighbours[n] < 0 || (pair >= 0 && n / 2 != pair)) continue;
+				for (int ch = 0; ch < 3; ch++) colorSum[ch] += traced.colors[neighbours[n] * 3 + ch];
+				distance = std::min(distance, traced.distances[neighbours[n]]);
+				used++;
+			}
+			for (int ch = 0; ch < 3; ch++)
+			{
+				resolved.colors[pixel * 3 + ch] = colorSum[ch] / used;
+			}
+			resolved.distances[pixel] = distance;
+			resolved.covered[pixel] = 0;
+		}
+	}
+	return rejected;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Checkerboard rendering of the P01 ray marcher.
+	//
+	// Each frame only the pixels with (x + y) % 2 == parity are marched, and the
+	// parity flips every frame. A pixel of the other parity is reprojected into
+	// the previous frame: the eye of the marcher is fixed, so only the rotation of
+	// the camera moves the image, and the ray through the pixel lands on the same
+	// point of the previous image whatever its distance. That point is taken if it
+	// fits the four marched neighbours, which are always of the traced parity:
+	// its distance has to lie within their range, or the scene has moved there
+	// (a bubble rising, a disocclusion), and its colour is clamped to theirs so
+	// the waves do not ghost. Where the neighbours straddle an edge the range says
+	// little, so while the camera turns the history has to match the pair of
+	// neighbours along the edge. And the filtered history blurs a little every
+	// frame, so once the camera turns by more than MaxMotion pixels per frame it
+	// is not used at all. Rejected pixels are interpolated along the edge instead.
+	// A raster object now in front of the history hides the pixel.
+	//
+	// P01_CS02.hlsl runs the same reconstruction on the GPU.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	// One marched image: colour, distance along the ray, and coverage by the
+	// raster objects, with pixels in rows.
+	struct CheckerboardImage
+	{
+		uint32_t				width;
+		uint32_t				height;
+		std::vector<float>		colors;		// Three per pixel.
+		std::vector<float>		distances;
+		std::vector<uint8_t>	covered;
+	};
+
+	// World to view rotation of a frame, in rows, and the canvas extents at the
+	// edges of the image.
+	struct CheckerboardView
+	{
+		float	rotation[9];
+		float	canvasWidth;
+		float	canvasHeight;
+	};
+
+	class CheckerboardReconstruction
+	{
+	public:
+		// Relative slack on the distance range of the neighbours, and on the
+		// colour range the history is clamped to.
+		static const float DistanceTolerance;
+		static const float ColorMargin;
+
+		// Camera motion in pixels per frame above which the history is not used,
+		// and below which it is trusted across edges.
+		static const float MaxMotion;
+		static const float StillMotion;
+
+		// Fills the pixels of the other parity of traced from history, through
+		// the rotation from previousView to view. ends holds the distance of the
+		// raster objects along each ray, infinite where there are none. Without
+		// history, pass an empty image. Returns the pixels whose history was rejected.
+		static uint32_t Reconstruct(const CheckerboardImage& traced, uint32_t parity, const CheckerboardView& view,
+			const std::vector<float>& ends, const CheckerboardImage& history, const CheckerboardView& previousView,
+			CheckerboardImage& resolved);
+	};
+}
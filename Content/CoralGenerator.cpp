@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "CoralGenerator.h"
+#include "ParallelFor.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+using namespace DirectX;
+
+namespace
+{
+	// Extrusion varies by +/- this fraction around one unit at the first level.
+	const float CORAL_EXTRUSION_JITTER = 0.4f;
+
+	// Subtrees handed to each thread, so uneven thread speeds still balance out.
+	const size_t CORAL_SUBTREES_PER_THREAD = 16;
+
+	uint64_t Mix(uint64_t x)
+	{
+		// SplitMix64 finaliser.
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	struct CoralNode
+	{
+		CoralTriangle	triangle;
+		uint64_t		index;
+	};
+}
+
+float CoralGenerator::GetExtrusion(uint32_t randomSeed, uint32_t level, uint64_t index)
+{
+	uint64_t hash = Mix(Mix((static_cast<uint64_t>(randomSeed) << 32) | level) ^ index);
+	float random = static_cast<float>(hash >> 40) / static_cast<float>(1 << 24);
+
+	float extrusion = 1.0f + CORAL_EXTRUSION_JITTER * (2.0f * random - 1.0f);
+	for (uint32_t i = 0; i < level; i++)
+	{
+		extrusion *= 0.5f;
+	}
+	return extrusion;
+}
+
+void CoralGenerator::Recurse(const CoralTriangle& input, const XMFLOAT4X4& world, uint32_t level, uint32_t levels, uint64_t index,
+	uint32_t randomSeed, CoralTriangle* output)
+{
+	if (level == levels)
+	{
+		*output = input;
+		return;
+	}
+
+	CoralTriangle children[3];
+	CoralSubdivision::SubdivideTriangle(input, world, children, GetExtrusion(randomSeed, level, index));
+
+	size_t childSize = CoralSubdivision::GetTriangleCount(1, levels - level - 1);
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		Recurse(children[c], world, level + 1, levels, index * 3 + c, randomSeed, output + c * childSize);
+	}
+}
+
+CoralGeneratorStatistics CoralGenerator::Generate(const std::vector<CoralTriangle>& seed, const XMFLOAT4X4& world, uint32_t levels,
+	uint32_t randomSeed, std::vector<CoralTriangle>& output)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	output.resize(CoralSubdivision::GetTriangleCount(seed.size(), levels));
+
+	// Expand breadth first until there are enough independent subtrees to share out.
+	size_t targetSubtrees = CORAL_SUBTREES_PER_THREAD * std::max<size_t>(1, std::thread::hardware_concurrency());
+
+	std::vector<CoralNode> nodes(seed.size());
+	for (size_t i = 0; i < seed.size(); i++)
+	{
+		nodes[i].triangle = seed[i];
+		nodes[i].index = i;
+	}
+
+	uint32_t level = 0;
+	std::vector<CoralNode> next;
+	while (level < levels && nodes.size() < targetSubtrees)
+	{
+		next.resize(nodes.size() * 3);
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			CoralTriangle children[3];
+			CoralSubdivision::SubdivideTriangle(nodes[i].triangle, world, children, GetExtrusion(randomSeed, level, nodes[i].index));
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				next[i * 3 + c].triangle = children[c];
+				next[i * 3 + c].index = nodes[i].index * 3 + c;
+			}
+		}
+		nodes.swap(next);
+		level++;
+	}
+
+	// Each subtree fills its own slice of the output, depth first.
+	size_t subtreeSize = CoralSubdivision::GetTriangleCount(1, levels - level);
+	ParallelFor(nodes.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			Recurse(nodes[i].triangle, world, level, levels, nodes[i].index, randomSeed, output.data() + nodes[i].index * subtreeSize);
+		}
+	});
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	CoralGeneratorStatistics statistics;
+	statistics.triangleCount = output.size();
+	statistics.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	statistics.trianglesPerSecond = (statistics.milliseconds > 0.0) ? output.size() * 1000.0 / statistics.milliseconds : 0.0;
+	statistics.checksum = Checksum(output);
+	return statistics;
+}
+
+uint64_t CoralGenerator::Checksum(const std::vector<CoralTriangle>& triangles)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(triangles.data());
+	size_t size = triangles.size() * sizeof(CoralTriangle);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
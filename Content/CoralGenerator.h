@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoralSubdivision.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// CPU coral generator (P04).
+	//
+	// Recursively applies the CoralSubdivision split to a configurable depth.
+	// Each triangle's extrusion is jittered by a hash of the seed, its level and
+	// its index, and halves with every level so deep corals stay compact. A
+	// triangle's index at the last level is also its slot in the output, so the
+	// subtrees are generated in parallel and the result does not depend on the
+	// number of threads.
+
+	struct CoralGeneratorStatistics
+	{
+		size_t		triangleCount;
+		double		milliseconds;
+		double		trianglesPerSecond;
+		uint64_t	checksum;
+	};
+
+	class CoralGenerator
+	{
+	public:
+		// Generates seed.size() * 3^levels triangles into output, coloured by
+		// their place in world (see CoralSubdivision.h).
+		static CoralGeneratorStatistics Generate(const std::vector<CoralTriangle>& seed, const DirectX::XMFLOAT4X4& world, uint32_t levels,
+			uint32_t randomSeed, std::vector<CoralTriangle>& output);
+
+		// FNV-1a hash of the triangle data, used to confirm a seed reproduces the same coral.
+		static uint64_t Checksum(const std::vector<CoralTriangle>& triangles);
+
+	private:
+		static float GetExtrusion(uint32_t randomSeed, uint32_t level, uint64_t index);
+		static void Recurse(const CoralTriangle& input, const DirectX::XMFLOAT4X4& world, uint32_t level, uint32_t levels, uint64_t index,
+			uint32_t randomSeed, CoralTriangle* output);
+	};
+}
@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "CoralSubdivision.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b)		{ return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)	{ return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	XMFLOAT3 Negate(const XMFLOAT3& a)							{ return XMFLOAT3(-a.x, -a.y, -a.z); }
+	XMFLOAT3 Scale(const XMFLOAT3& a, float s)					{ return XMFLOAT3(a.x * s, a.y * s, a.z * s); }
+	XMFLOAT3 Midpoint(const XMFLOAT3& a, const XMFLOAT3& b)	{ return XMFLOAT3((a.x + b.x) / 2.0f, (a.y + b.y) / 2.0f, (a.z + b.z) / 2.0f); }
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	XMFLOAT3 Normalize(const XMFLOAT3& a)
+	{
+		float length = sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+		if (length <= 0.0f)
+		{
+			return XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+		return XMFLOAT3(a.x / length, a.y / length, a.z / length);
+	}
+
+	float Sign(float a)
+	{
+		return (a > 0.0f) ? 1.0f : ((a < 0.0f) ? -1.0f : 0.0f);
+	}
+
+	// Colour of the three triangles split from one, from the sign of its first
+	// corner in world space, as P04_GS.hlsl and P04_CS.hlsl find it.
+	XMFLOAT4 FaceColor(const XMFLOAT3& p, const XMFLOAT4X4& world)
+	{
+		float x = p.x * world._11 + p.y * world._21 + p.z * world._31 + world._41;
+		float y = p.x * world._12 + p.y * world._22 + p.z * world._32 + world._42;
+		return XMFLOAT4((Sign(x) + 1.0f) / 2.0f, (Sign(y) + 1.0f) / 2.0f, 1.0f, 1.0f);
+	}
+
+	CoralVertex MakeVertex(const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT4& color)
+	{
+		CoralVertex v;
+		v.pos = pos;
+		v.normal = normal;
+		v.color = color;
+		return v;
+	}
+}
+
+size_t CoralSubdivision::GetTriangleCount(size_t seedCount, uint32_t levels)
+{
+	size_t count = seedCount;
+	for (uint32_t i = 0; i < levels; i++)
+	{
+		count *= 3;
+	}
+	return count;
+}
+
+void CoralSubdivision::BuildSeedTriangles(const VertexPositionColorNormal* vertices, const unsigned short* indices, size_t indexCount,
+	const XMFLOAT3& offset, std::vector<CoralTriangle>& triangles)
+{
+	triangles.resize(indexCount / 3);
+
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		for (size_t c = 0; c < 3; c++)
+		{
+			const VertexPositionColorNormal& v = vertices[indices[t * 3 + c]];
+			triangles[t].vertices[c] = MakeVertex(Add(v.pos, offset), v.normal, XMFLOAT4(v.color.x, v.color.y, v.color.z, 1.0f));
+		}
+	}
+}
+
+void CoralSubdivision::SubdivideTriangle(const CoralTriangle& input, const XMFLOAT4X4& world, CoralTriangle output[3], float extrusion)
+{
+	const XMFLOAT3& p0 = input.vertices[0].pos;
+	const XMFLOAT3& p1 = input.vertices[1].pos;
+	const XMFLOAT3& p2 = input.vertices[2].pos;
+
+	XMFLOAT3 m0 = Midpoint(p0, p1);
+	XMFLOAT3 m1 = Midpoint(p1, p2);
+	XMFLOAT3 m2 = Midpoint(p2, p0);
+
+	XMFLOAT4 color = FaceColor(p0, world);
+
+	// Triangle 1
+	XMFLOAT3 faceNormal = Normalize(Cross(Subtract(m0, p0), Subtract(m2, p0)));
+	output[0].vertices[0] = MakeVertex(Add(p0, Scale(faceNormal, extrusion)), Negate(faceNormal), color);
+	output[0].vertices[1] = MakeVertex(m0, faceNormal, color);
+	output[0].vertices[2] = MakeVertex(m2, faceNormal, color);
+
+	// Triangle 2
+	faceNormal = Normalize(Cross(Subtract(p1, m0), Subtract(m1, m0)));
+	output[1].vertices[0] = MakeVertex(m0, faceNormal, color);
+	output[1].vertices[1] = MakeVertex(Add(p1, Scale(faceNormal, extrusion)), faceNormal, color);
+	output[1].vertices[2] = MakeVertex(m1, Negate(faceNormal), color);
+
+	// Triangle 3
+	faceNormal = Normalize(Cross(Subtract(m1, m2), Subtract(p2, m2)));
+	output[2].vertices[0] = MakeVertex(m2, Negate(faceNormal), color);
+	output[2].vertices[1] = MakeVertex(m1, faceNormal, color);
+	output[2].vertices[2] = MakeVertex(Add(p2, Scale(faceNormal, extrusion)), faceNormal, color);
+}
+
+void CoralSubdivision::Subdivide(const std::vector<CoralTriangle>& seed, const XMFLOAT4X4& world, uint32_t levels, std::vector<CoralTriangle>& output)
+{
+	output = seed;
+
+	std::vector<CoralTriangle> next;
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		next.resize(output.size() * 3);
+		for (size_t t = 0; t < output.size(); t++)
+		{
+			SubdivideTriangle(output[t], world, &next[t * 3]);
+		}
+		output.swap(next);
+	}
+}
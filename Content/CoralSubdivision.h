@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ShaderStructures.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Reference implementation of the coral amplification (P04).
+	//
+	// Every level splits each triangle at its edge midpoints into three
+	// triangles and pushes their outer corners along the face normal, the same
+	// construction as P04_GS.hlsl. One level reproduces the geometry shader;
+	// further levels feed the output back in, as the compute passes do.
+	//
+	// The triangles stay in the coral's own space, but their colour follows the
+	// sign of the first corner in world space, so world is the coral's world
+	// matrix (row-vector order, not transposed), as the shaders have it.
+
+	class CoralSubdivision
+	{
+	public:
+		// Triangles produced from seedCount triangles after the given number of levels.
+		static size_t GetTriangleCount(size_t seedCount, uint32_t levels);
+
+		// Expands an indexed triangle list into standalone triangles, moved by offset.
+		static void BuildSeedTriangles(const VertexPositionColorNormal* vertices, const unsigned short* indices, size_t indexCount,
+			const DirectX::XMFLOAT3& offset, std::vector<CoralTriangle>& triangles);
+
+		// One level of amplification for a single triangle. The geometry shader extrudes by one unit.
+		static void SubdivideTriangle(const CoralTriangle& input, const DirectX::XMFLOAT4X4& world, CoralTriangle output[3], float extrusion = 1.0f);
+
+		// Applies the given number of levels to the seed triangles.
+		static void Subdivide(const std::vector<CoralTriangle>& seed, const DirectX::XMFLOAT4X4& world, uint32_t levels, std::vector<CoralTriangle>& output);
+	};
+}
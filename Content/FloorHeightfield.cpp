@@ -0,0 +1,343 @@
+#include "pch.h"
+#include "FloorHeightfield.h"
+#include "NoiseKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Square region baked into the heightfield, centred under the P01 eye. The
+	// fog hides everything beyond MAX_DIST, so the floor outside is never seen.
+	const float FLOOR_REGION_SIZE = 128.0f;
+	const float FLOOR_ORIGIN_X = -2.0f - FLOOR_REGION_SIZE * 0.5f;
+	const float FLOOR_ORIGIN_Z = 5.0f - FLOOR_REGION_SIZE * 0.5f;
+
+	// Depth at which the 3D noise is taken, in the middle of the floor's range.
+	const float FLOOR_REFERENCE_Y = -3.0f;
+
+	// surface y = -(height * FLOOR_HEIGHT_SCALE + FLOOR_HEIGHT_OFFSET), as in FloorSDF.
+	const float FLOOR_HEIGHT_SCALE = 1.13f;
+	const float FLOOR_HEIGHT_OFFSET = 2.5f;
+
+	// Constants of the ray marcher in P01_Scene.hlsli.
+	const uint32_t FLOOR_MAX_MARCHING_STEPS = 255;
+	const float FLOOR_EPSILON = 0.003f;
+
+	// Bisection steps of a step that ends below the surface, which narrow the
+	// crossing to about a sixtieth of the step.
+	const uint32_t FLOOR_BISECTION_STEPS = 6;
+
+	// Iteration limit of the walk, and the nudge that moves a ray into the next cell.
+	// The cell is also looked up a hundredth of a cell ahead in the direction of
+	// travel, as a ray that barely moves across an edge stays on it in floats.
+	const uint32_t FLOOR_MAX_WALK_STEPS = 512;
+	const float FLOOR_CELL_NUDGE = 1.0e-4f;
+	const float FLOOR_CELL_BIAS = 1.0e-2f;
+
+	// Points at which the bilinear heights are checked against the exact octaves.
+	const uint32_t FLOOR_INTERPOLATION_SAMPLES = 16384;
+
+	FbmParameters BakedOctaves()
+	{
+		FbmParameters parameters = NoiseKernels::FloorFbm();
+		parameters.octaves = FloorHeightfield::LowOctaves;
+		return parameters;
+	}
+
+	FbmParameters DetailOctaves()
+	{
+		FbmParameters parameters = NoiseKernels::FloorFbm();
+		for (uint32_t i = 0; i < FloorHeightfield::LowOctaves; i++)
+		{
+			parameters.amplitude *= parameters.gain;
+			parameters.frequency *= parameters.lacunarity;
+		}
+		parameters.octaves -= FloorHeightfield::LowOctaves;
+		return parameters;
+	}
+
+	// noise() lies in [0, 1], so the detail octaves add at most their amplitudes.
+	float DetailRange()
+	{
+		FbmParameters parameters = DetailOctaves();
+		float range = 0.0f;
+		for (uint32_t i = 0; i < parameters.octaves; i++)
+		{
+			range += parameters.amplitude;
+			parameters.amplitude *= parameters.gain;
+		}
+		return range;
+	}
+
+	float SurfaceFromHeight(float height)
+	{
+		return -(height * FLOOR_HEIGHT_SCALE + FLOOR_HEIGHT_OFFSET);
+	}
+
+	void Point(const FloorRay& ray, float t, float p[3])
+	{
+		for (int i = 0; i < 3; i++) p[i] = ray.origin[i] + ray.direction[i] * t;
+	}
+}
+
+FloorHeightfield::FloorHeightfield() :
+	m_interpolationError(0.0f)
+{
+}
+
+float FloorHeightfield::GetOriginX() const
+{
+	return FLOOR_ORIGIN_X;
+}
+
+float FloorHeightfield::GetOriginZ() const
+{
+	return FLOOR_ORIGIN_Z;
+}
+
+float FloorHeightfield::GetRegionSize() const
+{
+	return FLOOR_REGION_SIZE;
+}
+
+float FloorHeightfield::GetCellSize() const
+{
+	return FLOOR_REGION_SIZE / Resolution;
+}
+
+float FloorHeightfield::GetReferenceY() const
+{
+	return FLOOR_REFERENCE_Y;
+}
+
+float FloorHeightfield::GetDetailRange() const
+{
+	return DetailRange();
+}
+
+double FloorHeightfield::Build()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const uint32_t vertices = Resolution + 1;
+	const float cellSize = GetCellSize();
+	const FbmParameters baked = BakedOctaves();
+	const NoiseVariant variant = NoiseKernels::GetBestVariant();
+
+	// One row of vertices per batch.
+	m_heights.resize(static_cast<size_t>(vertices) * vertices);
+	std::vector<float> x(vertices), y(vertices, FLOOR_REFERENCE_Y), z(vertices);
+	for (uint32_t i = 0; i < vertices; i++) x[i] = FLOOR_ORIGIN_X + i * cellSize;
+	for (uint32_t row = 0; row < vertices; row++)
+	{
+		std::fill(z.begin(), z.end(), FLOOR_ORIGIN_Z + row * cellSize);
+		NoiseKernels::Fbm(x.data(), y.data(), z.data(), &m_heights[static_cast<size_t>(row) * vertices], vertices, baked, variant);
+	}
+
+	// Level 0 takes the corners of each cell, every further level the four cells below.
+	m_levels.clear();
+	m_levels.emplace_back(static_cast<size_t>(Resolution) * Resolution * 2);
+	std::vector<float>& finest = m_levels.back();
+	for (uint32_t row = 0; row < Resolution; row++)
+	{
+		for (uint32_t column = 0; column < Resolution; column++)
+		{
+			size_t corner = static_cast<size_t>(row) * vertices + column;
+			float a = m_heights[corner], b = m_heights[corner + 1];
+			float c = m_heights[corner + vertices], d = m_heights[corner + vertices + 1];
+			size_t cell = (static_cast<size_t>(row) * Resolution + column) * 2;
+			finest[cell] = std::min(std::min(a, b), std::min(c, d));
+			finest[cell + 1] = std::max(std::max(a, b), std::max(c, d));
+		}
+	}
+	for (uint32_t cells = Resolution / 2; cells > 0; cells /= 2)
+	{
+		const std::vector<float>& below = m_levels.back();
+		std::vector<float> level(static_cast<size_t>(cells) * cells * 2);
+		for (uint32_t row = 0; row < cells; row++)
+		{
+			for (uint32_t column = 0; column < cells; column++)
+			{
+				size_t a = ((static_cast<size_t>(row) * 2) * cells * 2 + column * 2) * 2;
+				size_t c = a + cells * 2 * 2;
+				size_t cell = (static_cast<size_t>(row) * cells + column) * 2;
+				level[cell] = std::min(std::min(below[a], below[a + 2]), std::min(below[c], below[c + 2]));
+				level[cell + 1] = std::max(std::max(below[a + 1], below[a + 3]), std::max(below[c + 1], below[c + 3]));
+			}
+		}
+		m_levels.push_back(std::move(level));
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> offset(0.0f, FLOOR_REGION_SIZE);
+	m_interpolationError = 0.0f;
+	for (uint32_t i = 0; i < FLOOR_INTERPOLATION_SAMPLES; i++)
+	{
+		float px = FLOOR_ORIGIN_X + offset(random), pz = FLOOR_ORIGIN_Z + offset(random);
+		float exact = NoiseKernels::Fbm(px, FLOOR_REFERENCE_Y, pz, baked);
+		m_interpolationError = std::max(m_interpolationError, fabsf(BakedHeight(px, pz) - exact));
+	}
+
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+float FloorHeightfield::BakedHeight(float x, float z) const
+{
+	const uint32_t vertices = Resolution + 1;
+	const float last = static_cast<float>(Resolution) - 1.0e-3f;
+	float gx = std::min(std::max((x - FLOOR_ORIGIN_X) / GetCellSize(), 0.0f), last);
+	float gz = std::min(std::max((z - FLOOR_ORIGIN_Z) / GetCellSize(), 0.0f), last);
+	float fx = floorf(gx), fz = floorf(gz);
+	float kx = gx - fx, kz = gz - fz;
+
+	size_t corner = static_cast<size_t>(fz) * vertices + static_cast<size_t>(fx);
+	float a = m_heights[corner], b = m_heights[corner + 1];
+	float c = m_heights[corner + vertices], d = m_heights[corner + vertices + 1];
+	float front = a + (b - a) * kx;
+	float back = c + (d - c) * kx;
+	return front + (back - front) * kz;
+}
+
+float FloorHeightfield::DetailHeight(float x, float z) const
+{
+	return NoiseKernels::Fbm(x, FLOOR_REFERENCE_Y, z, DetailOctaves());
+}
+
+void FloorHeightfield::GetSurfaceBounds(uint32_t level, uint32_t column, uint32_t row, float& lowest, float& highest) const
+{
+	const float* bounds = &m_levels[level][(static_cast<size_t>(row) * (Resolution >> level) + column) * 2];
+	lowest = SurfaceFromHeight(bounds[1] + DetailRange());
+	highest = SurfaceFromHeight(bounds[0]);
+}
+
+float FloorHeightfield::SurfaceY(float x, float z) const
+{
+	return SurfaceFromHeight(BakedHeight(x, z) + DetailHeight(x, z));
+}
+
+float FloorHeightfield::Bisect(const FloorRay& ray, float above, float below, FloorHit& hit) const
+{
+	for (uint32_t i = 0; i < FLOOR_BISECTION_STEPS; i++)
+	{
+		float middle = (above + below) * 0.5f;
+		float p[3];
+		Point(ray, middle, p);
+		hit.steps++;
+		hit.evaluations++;
+		if (p[1] > SurfaceY(p[0], p[2])) above = middle;
+		else below = middle;
+	}
+	return (above + below) * 0.5f;
+}
+
+FloorHit FloorHeightfield::Intersect(const FloorRay& ray, float start, float end) const
+{
+	FloorHit hit = { false, end, 0, 0 };
+	if (m_levels.empty()) return hit;
+
+	const int top = static_cast<int>(m_levels.size()) - 1;
+	const float dx = ray.direction[0], dz = ray.direction[2];
+
+	float t = start;
+	int level = top;
+	while (t < end && hit.steps < FLOOR_MAX_WALK_STEPS)
+	{
+		hit.steps++;
+
+		float p[3];
+		Point(ray, t, p);
+		float gx = (p[0] - FLOOR_ORIGIN_X) / GetCellSize() + (dx > 0.0f ? FLOOR_CELL_BIAS : dx < 0.0f ? -FLOOR_CELL_BIAS : 0.0f);
+		float gz = (p[2] - FLOOR_ORIGIN_Z) / GetCellSize() + (dz > 0.0f ? FLOOR_CELL_BIAS : dz < 0.0f ? -FLOOR_CELL_BIAS : 0.0f);
+		if (gx < 0.0f || gz < 0.0f || gx >= Resolution || gz >= Resolution) break;
+
+		// The cell of this level that holds the ray, and where the ray leaves it.
+		uint32_t cells = Resolution >> level;
+		uint32_t column = static_cast<uint32_t>(gx) >> level;
+		uint32_t row = static_cast<uint32_t>(gz) >> level;
+		float size = GetCellSize() * static_cast<float>(1u << level);
+		float minX = FLOOR_ORIGIN_X + column * size, minZ = FLOOR_ORIGIN_Z + row * size;
+		float exitX = dx > 0.0f ? (minX + size - ray.origin[0]) / dx : dx < 0.0f ? (minX - ray.origin[0]) / dx : end;
+		float exitZ = dz > 0.0f ? (minZ + size - ray.origin[2]) / dz : dz < 0.0f ? (minZ - ray.origin[2]) / dz : end;
+		float leave = std::min(std::min(exitX, exitZ), end);
+
+		// The lowest baked height gives the highest surface, as the detail only deepens it.
+		const float* bounds = &m_levels[level][(static_cast<size_t>(row) * cells + column) * 2];
+		float highest = SurfaceFromHeight(bounds[0]);
+		float entryY = p[1];
+		float exitY = ray.origin[1] + ray.direction[1] * leave;
+
+		if (std::min(entryY, exitY) > highest)
+		{
+			t = leave + FLOOR_CELL_NUDGE;
+			level = std::min(level + 1, top);
+			continue;
+		}
+		if (level > 0)
+		{
+			level--;
+			continue;
+		}
+
+		// Inside the cell the ray steps by its height above the surface, as sphere
+		// tracing FloorSDF does, and a step that ends below the surface is bisected.
+		float above = t;
+		float gap = entryY - SurfaceY(p[0], p[2]);
+		hit.steps++;
+		hit.evaluations++;
+		while (gap >= FLOOR_EPSILON && above < leave && hit.steps < FLOOR_MAX_WALK_STEPS)
+		{
+			// The last step ends on the cell edge, so the next cell is entered above.
+			float sample = std::min(above + gap, leave);
+			float q[3];
+			Point(ray, sample, q);
+			gap = q[1] - SurfaceY(q[0], q[2]);
+			hit.steps++;
+			hit.evaluations++;
+			if (gap < 0.0f)
+			{
+				hit.isHit = true;
+				hit.distance = Bisect(ray, above, sample, hit);
+				return hit;
+			}
+			above = sample;
+		}
+		if (gap < FLOOR_EPSILON)
+		{
+			hit.isHit = true;
+			hit.distance = above;
+			return hit;
+		}
+		t = leave + FLOOR_CELL_NUDGE;
+	}
+	return hit;
+}
+
+FloorHit FloorHeightfield::SphereTrace(const FloorRay& ray, float start, float end) const
+{
+	FloorHit hit = { false, end, 0, 0 };
+	float t = start;
+	while (hit.steps < FLOOR_MAX_MARCHING_STEPS)
+	{
+		float p[3];
+		Point(ray, t, p);
+		hit.steps++;
+		hit.evaluations++;
+		float distance = p[1] - SurfaceY(p[0], p[2]);
+		if (distance < FLOOR_EPSILON)
+		{
+			hit.isHit = true;
+			hit.distance = t;
+			return hit;
+		}
+		t += distance;
+		if (t >= end) return hit;
+	}
+	return hit;
+}
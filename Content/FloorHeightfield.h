@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Heightfield version of the sea floor of P01_Scene.hlsli, for a dedicated ray
+	// intersector instead of sphere tracing.
+	//
+	// FloorSDF sums eight octaves of 3D noise, so strictly it is not a heightfield.
+	// Here the noise is taken at a fixed reference depth inside the floor's range,
+	// which makes the height a function of x and z only. The LowOctaves broadest
+	// octaves are baked into a grid of vertex heights over the region the P01
+	// camera can see, and the remaining octaves are added analytically on top.
+	// The baked part is bilinear between vertices, so its extremes inside a cell
+	// are at the corners. The detail octaves only deepen the floor, and only by a
+	// known amount. So the min/max pyramid over the cells bounds the surface
+	// exactly, which keeps the empty-space skipping conservative.
+	//
+	// Intersect walks the pyramid like a quadtree: a cell whose highest possible
+	// surface lies below the ray is skipped whole, otherwise it is split, and only
+	// in a finest cell is the exact surface evaluated: the ray steps by its height
+	// above it, like sphere tracing, and a step that ends below it is bisected.
+	// P01_Scene.hlsli runs the same walk on the GPU, and SphereTrace keeps the
+	// method it replaces for comparison.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	struct FloorRay
+	{
+		float	origin[3];
+		float	direction[3];	// Normalised.
+	};
+
+	struct FloorHit
+	{
+		bool		isHit;
+		float		distance;
+		uint32_t	steps;			// Loop iterations plus surface evaluations.
+		uint32_t	evaluations;	// Surface evaluations alone, the costly part.
+	};
+
+	class FloorHeightfield
+	{
+	public:
+		// Cells along each side of the baked region, and octaves baked into it.
+		static const uint32_t Resolution = 512;
+		static const uint32_t LowOctaves = 3;
+
+		FloorHeightfield();
+
+		// Bakes the vertex heights and builds the pyramid. Returns the time taken in milliseconds.
+		double Build();
+
+		// (Resolution + 1)^2 vertex heights of the baked octaves, x fastest.
+		const std::vector<float>& GetHeights() const				{ return m_heights; }
+
+		// Minimum and maximum baked height per cell, (Resolution >> level)^2 pairs.
+		const std::vector<float>& GetLevel(uint32_t level) const	{ return m_levels[level]; }
+		uint32_t GetLevelCount() const								{ return static_cast<uint32_t>(m_levels.size()); }
+
+		float GetOriginX() const;
+		float GetOriginZ() const;
+		float GetRegionSize() const;
+		float GetCellSize() const;
+		float GetReferenceY() const;
+
+		// Largest depth the detail octaves add to the baked height.
+		float GetDetailRange() const;
+
+		// Largest difference between the bilinear baked octaves and the same octaves
+		// evaluated exactly, which is what the floor loses against FloorSDF.
+		float GetInterpolationError() const							{ return m_interpolationError; }
+
+		// Lowest and highest y the surface reaches over one cell of a pyramid level,
+		// detail octaves included.
+		void GetSurfaceBounds(uint32_t level, uint32_t column, uint32_t row, float& lowest, float& highest) const;
+
+		// Height of the floor surface. Points outside the region use the edge.
+		float SurfaceY(float x, float z) const;
+
+		FloorHit Intersect(const FloorRay& ray, float start, float end) const;
+
+		// Sphere tracing of the same surface, as P01_Scene.hlsli does for FloorSDF.
+		FloorHit SphereTrace(const FloorRay& ray, float start, float end) const;
+
+	private:
+		float BakedHeight(float x, float z) const;
+		float DetailHeight(float x, float z) const;
+		float Bisect(const FloorRay& ray, float above, float below, FloorHit& hit) const;
+
+		std::vector<float>				m_heights;
+		std::vector<std::vector<float>>	m_levels;
+		float							m_interpolationError;
+	};
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "GridGenerator.h"
+#include "MeshOptimizer.h"
+
+#include <chrono>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const float GRID_PI = 3.14159265358979323846f;
+
+	// Forsyth ordering keeps a full adjacency table in memory, so very large
+	// grids are uploaded in generation order instead.
+	const size_t GRID_MAX_OPTIMIZED_INDICES = 6 * 1024 * 1024;
+}
+
+void GridGenerator::BuildSphereGrid(uint32_t resolution, GridMesh& mesh)
+{
+	if (resolution < 2)
+	{
+		resolution = 2;
+	}
+
+	float dx = 2.0f * GRID_PI / (resolution - 1);
+	float dy = GRID_PI / (resolution - 1);
+
+	mesh.vertices.resize(static_cast<size_t>(resolution) * resolution);
+	mesh.indices.resize(static_cast<size_t>(resolution - 1) * (resolution - 1) * 6);
+
+	for (uint32_t i = 0; i < resolution; i++)
+	{
+		float y = i * dy;
+		for (uint32_t j = 0; j < resolution; j++)
+		{
+			VertexPositionColor& v = mesh.vertices[static_cast<size_t>(i) * resolution + j];
+			v.pos = DirectX::XMFLOAT3(j * dx, y, 0.0f);
+			v.color = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+		}
+	}
+
+	size_t k = 0;
+	for (uint32_t i = 0; i < resolution - 1; i++)
+	{
+		for (uint32_t j = 0; j < resolution - 1; j++)
+		{
+			uint32_t index0 = i * resolution + j;
+			uint32_t index1 = index0 + 1;
+			uint32_t index2 = index0 + resolution;
+			uint32_t index3 = index2 + 1;
+
+			mesh.indices[k] = index0;
+			mesh.indices[k + 1] = index2;
+			mesh.indices[k + 2] = index1;
+			mesh.indices[k + 3] = index1;
+			mesh.indices[k + 4] = index2;
+			mesh.indices[k + 5] = index3;
+
+			k += 6;
+		}
+	}
+}
+
+void GridGenerator::OptimizeSphereGrid(GridMesh& mesh)
+{
+	if (mesh.indices.size() > GRID_MAX_OPTIMIZED_INDICES)
+	{
+		return;
+	}
+
+	// Overdraw ordering works on the sphere the vertex shader produces, not on the parameter grid.
+	std::vector<MeshPosition> positions(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		float x = mesh.vertices[i].pos.x;
+		float y = mesh.vertices[i].pos.y;
+		positions[i] = { sinf(y) * cosf(x), sinf(y) * sinf(x), cosf(y) };
+	}
+
+	MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	MeshOptimizer::OptimizeOverdraw(mesh.indices, positions);
+	auto remap = MeshOptimizer::OptimizeVertexFetch(mesh.indices, mesh.vertices.size());
+	MeshOptimizer::RemapVertexBuffer(mesh.vertices, remap);
+}
+
+size_t GridGenerator::GetMemoryFootprint(const GridMesh& mesh)
+{
+	return mesh.vertices.size() * sizeof(VertexPositionColor) + mesh.indices.size() * GetIndexSize(mesh.vertices.size());
+}
+
+std::vector<uint16_t> GridGenerator::NarrowIndices(const std::vector<uint32_t>& indices)
+{
+	std::vector<uint16_t> narrow(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		narrow[i] = static_cast<uint16_t>(indices[i]);
+	}
+	return narrow;
+}
+
+GridBenchmarkResult GridGenerator::Benchmark(uint32_t resolution)
+{
+	GridBenchmarkResult result = { resolution, 0.0, 0 };
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	GridMesh mesh;
+	BuildSphereGrid(resolution, mesh);
+
+	// Include the narrowing pass the 16-bit upload path pays for.
+	size_t indexBytes = mesh.indices.size() * sizeof(uint32_t);
+	if (!RequiresWideIndices(mesh.vertices.size()))
+	{
+		indexBytes = NarrowIndices(mesh.indices).size() * sizeof(uint16_t);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	result.bytes = mesh.vertices.size() * sizeof(VertexPositionColor) + indexBytes;
+	return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ShaderStructures.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Procedural parameter grid used by the vertex shader coral (P02).
+	//
+	// The grid stores (longitude, latitude) in pos.xy and is turned into
+	// a sphere-like surface in P02_VS.hlsl. Storage is sized at runtime, and
+	// 16-bit indices are only used while every vertex can be addressed by them.
+
+	struct GridMesh
+	{
+		std::vector<VertexPositionColor>	vertices;
+		std::vector<uint32_t>				indices;
+	};
+
+	struct GridBenchmarkResult
+	{
+		uint32_t	resolution;
+		double		milliseconds;
+		size_t		bytes;
+	};
+
+	class GridGenerator
+	{
+	public:
+		// Builds a resolution x resolution vertex grid over [0, 2pi] x [0, pi].
+		static void BuildSphereGrid(uint32_t resolution, GridMesh& mesh);
+
+		// Cache, overdraw and vertex fetch optimisation of a built grid, taken as
+		// the triangle list its indices describe.
+		static void OptimizeSphereGrid(GridMesh& mesh);
+
+		// 16-bit indices can address at most 65536 vertices.
+		static bool RequiresWideIndices(size_t vertexCount)		{ return vertexCount > 0x10000; }
+		static size_t GetIndexSize(size_t vertexCount)			{ return RequiresWideIndices(vertexCount) ? sizeof(uint32_t) : sizeof(uint16_t); }
+		static size_t GetMemoryFootprint(const GridMesh& mesh);
+
+		static std::vector<uint16_t> NarrowIndices(const std::vector<uint32_t>& indices);
+
+		// Times grid generation at the given resolution and reports the buffer memory it needs.
+		static GridBenchmarkResult Benchmark(uint32_t resolution);
+	};
+}
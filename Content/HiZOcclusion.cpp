@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "HiZOcclusion.h"
+
+#include "..\Common\DirectXHelper.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+using namespace DirectX;
+
+HiZOcclusion::HiZOcclusion(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+	m_deviceResources(deviceResources),
+	m_constantBufferData(),
+	m_pendingViewProjection(),
+	m_isReadbackPending(false),
+	m_loadingComplete(false)
+{
+	CreateDeviceDependentResources();
+}
+
+Concurrency::task<void> HiZOcclusion::CreateDeviceDependentResources()
+{
+	// Nothing is captured against a restored device until its buffers exist.
+	m_loadingComplete = false;
+	m_isReadbackPending = false;
+
+	auto loadCSTask = DX::ReadDataAsync(L"HiZ_CS.cso");
+
+	return loadCSTask.then([this](const std::vector<byte>& fileData) {
+		auto device = m_deviceResources->GetD3DDevice();
+
+		DX::ThrowIfFailed(
+			device->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_computeShader
+			)
+		);
+
+		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(HiZConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(device->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer));
+
+		CD3D11_BUFFER_DESC gridBufferDesc(
+			GridWidth * GridHeight * sizeof(float),
+			D3D11_BIND_UNORDERED_ACCESS,
+			D3D11_USAGE_DEFAULT,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(float)
+		);
+		DX::ThrowIfFailed(device->CreateBuffer(&gridBufferDesc, nullptr, &m_gridBuffer));
+
+		CD3D11_UNORDERED_ACCESS_VIEW_DESC gridViewDesc(m_gridBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, GridWidth * GridHeight);
+		DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_gridBuffer.Get(), &gridViewDesc, &m_gridView));
+
+		CD3D11_BUFFER_DESC readbackDesc(GridWidth * GridHeight * sizeof(float), 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+		DX::ThrowIfFailed(device->CreateBuffer(&readbackDesc, nullptr, &m_readbackBuffer));
+
+		m_isReadbackPending = false;
+		m_pyramid.Clear();
+		m_loadingComplete = true;
+		});
+}
+
+void HiZOcclusion::ReleaseDeviceDependentResources()
+{
+	m_loadingComplete = false;
+	m_isReadbackPending = false;
+	m_pyramid.Clear();
+	m_computeShader.Reset();
+	m_constantBuffer.Reset();
+	m_gridBuffer.Reset();
+	m_gridView.Reset();
+	m_readbackBuffer.Reset();
+}
+
+void HiZOcclusion::Capture(const XMFLOAT4X4& viewProjection)
+{
+	if (!m_loadingComplete || m_isReadbackPending) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// The screen viewport covers the whole depth buffer.
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	m_constantBufferData.depthSize = XMUINT2(static_cast<uint32>(viewport.Width), static_cast<uint32>(viewport.Height));
+	m_constantBufferData.gridSize = XMUINT2(GridWidth, GridHeight);
+	context->UpdateSubresource1(m_constantBuffer.Get(), 0, NULL, &m_constantBufferData, 0, 0, 0);
+
+	// The depth buffer cannot be read while it is bound for output.
+	ID3D11RenderTargetView* const targets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, targets, nullptr);
+
+	ID3D11ShaderResourceView* depthView = m_deviceResources->GetDepthStencilShaderResourceView();
+	ID3D11ShaderResourceView* nullView = nullptr;
+	ID3D11UnorderedAccessView* nullAccessView = nullptr;
+
+	context->CSSetShader(m_computeShader.Get(), nullptr, 0);
+	context->CSSetConstantBuffers1(0, 1, m_constantBuffer.GetAddressOf(), nullptr, nullptr);
+	context->CSSetShaderResources(0, 1, &depthView);
+	context->CSSetUnorderedAccessViews(0, 1, m_gridView.GetAddressOf(), nullptr);
+	context->Dispatch((GridWidth + 7) / 8, (GridHeight + 7) / 8, 1);
+	context->CSSetShaderResources(0, 1, &nullView);
+	context->CSSetUnorderedAccessViews(0, 1, &nullAccessView, nullptr);
+
+	context->OMSetRenderTargets(1, targets, m_deviceResources->GetDepthStencilView());
+
+	context->CopyResource(m_readbackBuffer.Get(), m_gridBuffer.Get());
+	m_pendingViewProjection = viewProjection;
+	m_isReadbackPending = true;
+}
+
+void HiZOcclusion::Update()
+{
+	if (!m_isReadbackPending) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	D3D11_MAPPED_SUBRESOURCE mappedGrid;
+	if (context->Map(m_readbackBuffer.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedGrid) == S_OK)
+	{
+		m_pyramid.Build(static_cast<const float*>(mappedGrid.pData), GridWidth, GridHeight, &m_pendingViewProjection._11);
+		context->Unmap(m_readbackBuffer.Get(), 0);
+		m_isReadbackPending = false;
+	}
+}
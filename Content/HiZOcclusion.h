@@ -0,0 +1,51 @@
+#pragma once
+
+#include "..\Common\DeviceResources.h"
+#include "ShaderStructures.h"
+#include "SceneCuller.h"
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// GPU side of the Hi-Z occlusion test (see SceneCuller).
+	//
+	// After the scene has been drawn, HiZ_CS.hlsl reduces the depth buffer to a
+	// GridWidth x GridHeight grid of farthest depths, which is copied to a staging
+	// buffer. A later frame maps the copy without waiting and builds the pyramid
+	// from it, so occlusion is always tested against a frame or two old depth.
+
+	class HiZOcclusion
+	{
+	public:
+		static const UINT GridWidth = 128;
+		static const UINT GridHeight = 64;
+
+		HiZOcclusion(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		Concurrency::task<void> CreateDeviceDependentResources();
+		void ReleaseDeviceDependentResources();
+
+		// Reduces the depth drawn so far. viewProjection is the matrix it was drawn
+		// with, not transposed. Skipped while an earlier capture is still in flight.
+		void Capture(const DirectX::XMFLOAT4X4& viewProjection);
+
+		// Rebuilds the pyramid once the last capture has reached the CPU.
+		void Update();
+
+		void Clear()									{ m_pyramid.Clear(); }
+		const HiZBuffer& GetPyramid() const				{ return m_pyramid; }
+
+	private:
+		std::shared_ptr<DX::DeviceResources>			m_deviceResources;
+
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_computeShader;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_constantBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_gridBuffer;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_gridView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_readbackBuffer;
+
+		HiZConstantBuffer								m_constantBufferData;
+		DirectX::XMFLOAT4X4								m_pendingViewProjection;
+		HiZBuffer										m_pyramid;
+		bool											m_isReadbackPending;
+		bool											m_loadingComplete;
+	};
+}
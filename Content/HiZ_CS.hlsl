@@ -0,0 +1,32 @@
+// Reduces the scene depth buffer to a small grid holding the farthest depth under
+// each cell, read back by HiZOcclusion to build the Hi-Z pyramid. Cells reach one
+// texel past their edges so that rounding never leaves a pixel uncovered.
+
+cbuffer HiZConstantBuffer : register(b0)
+{
+    uint2 depthSize;
+    uint2 gridSize;
+};
+
+Texture2D<float> depthTexture : register(t0);
+RWStructuredBuffer<float> farthestDepth : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= gridSize.x || id.y >= gridSize.y) return;
+
+    uint2 start = id.xy * depthSize / gridSize;
+    uint2 end = min((id.xy + 1) * depthSize / gridSize + 1, depthSize);
+
+    float farthest = 0.0f;
+    for (uint y = start.y; y < end.y; y++)
+    {
+        for (uint x = start.x; x < end.x; x++)
+        {
+            farthest = max(farthest, depthTexture.Load(int3(x, y, 0)));
+        }
+    }
+
+    farthestDepth[id.y * gridSize.x + id.x] = farthest;
+}
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "ImpostorAtlas.h"
+
+#include "..\Common\DirectXHelper.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+using namespace DirectX;
+
+ImpostorAtlas::ImpostorAtlas(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+	m_deviceResources(deviceResources),
+	m_constantBufferData(),
+	m_isBaked(false)
+{
+}
+
+Concurrency::task<void> ImpostorAtlas::CreateDeviceDependentResources()
+{
+	auto loadVSTask = DX::ReadDataAsync(L"Impostor_VS.cso");
+	auto loadPSTask = DX::ReadDataAsync(L"Impostor_PS.cso");
+
+	// Impostors use the same per-instance layout as the P05 fish.
+	auto createVSTask = loadVSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_vertexShader
+			)
+		);
+
+		static const D3D11_INPUT_ELEMENT_DESC instanceDesc[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		};
+
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateInputLayout(
+				instanceDesc,
+				ARRAYSIZE(instanceDesc),
+				&fileData[0],
+				fileData.size(),
+				&m_inputLayout
+			)
+		);
+
+		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ImpostorConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&constantBufferDesc,
+				nullptr,
+				&m_constantBuffer
+			)
+		);
+		});
+
+	auto createPSTask = loadPSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_pixelShader
+			)
+		);
+		});
+
+	return (createVSTask && createPSTask).then([this]() {
+		auto device = m_deviceResources->GetD3DDevice();
+
+		// One row of cells, cleared to transparent so the pixel shader can cut the outline.
+		CD3D11_TEXTURE2D_DESC atlasDesc(DXGI_FORMAT_R8G8B8A8_UNORM, ViewCount * CellSize, CellSize, 1, 1,
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+		DX::ThrowIfFailed(device->CreateTexture2D(&atlasDesc, nullptr, &m_atlasTexture));
+		DX::ThrowIfFailed(device->CreateRenderTargetView(m_atlasTexture.Get(), nullptr, &m_atlasTargetView));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_atlasTexture.Get(), nullptr, &m_atlasView));
+
+		CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_D24_UNORM_S8_UINT, ViewCount * CellSize, CellSize, 1, 1,
+			D3D11_BIND_DEPTH_STENCIL);
+		DX::ThrowIfFailed(device->CreateTexture2D(&depthDesc, nullptr, &m_depthTexture));
+
+		CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2D);
+		DX::ThrowIfFailed(device->CreateDepthStencilView(m_depthTexture.Get(), &depthStencilViewDesc, &m_depthStencilView));
+
+		CD3D11_SAMPLER_DESC samplerDesc = CD3D11_SAMPLER_DESC(D3D11_DEFAULT);
+		DX::ThrowIfFailed(device->CreateSamplerState(&samplerDesc, &m_samplerState));
+
+		// Both sides of the object are baked, whatever its winding.
+		D3D11_RASTERIZER_DESC rasterizerDesc = CD3D11_RASTERIZER_DESC(D3D11_DEFAULT);
+		rasterizerDesc.CullMode = D3D11_CULL_NONE;
+		DX::ThrowIfFailed(device->CreateRasterizerState(&rasterizerDesc, &m_bakeRasterizerState));
+
+		m_isBaked = false;
+		});
+}
+
+void ImpostorAtlas::ReleaseDeviceDependentResources()
+{
+	m_isBaked = false;
+	m_vertexShader.Reset();
+	m_pixelShader.Reset();
+	m_inputLayout.Reset();
+	m_constantBuffer.Reset();
+	m_samplerState.Reset();
+	m_bakeRasterizerState.Reset();
+	m_atlasTexture.Reset();
+	m_atlasTargetView.Reset();
+	m_atlasView.Reset();
+	m_depthTexture.Reset();
+	m_depthStencilView.Reset();
+}
+
+void ImpostorAtlas::Bake(const XMFLOAT3& center, float radius, const DrawFunction& draw)
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	static const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->ClearRenderTargetView(m_atlasTargetView.Get(), clearColor);
+	context->ClearDepthStencilView(m_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	ID3D11RenderTargetView* const atlasTargets[1] = { m_atlasTargetView.Get() };
+	context->OMSetRenderTargets(1, atlasTargets, m_depthStencilView.Get());
+	context->RSSetState(m_bakeRasterizerState.Get());
+
+	// The scene pairs a left-handed view with a right-handed projection, so its cameras
+	// see what lies behind their look vector, mirrored. Each cell is set up the same
+	// way: the camera sits on the cell's side of the object and looks away from it.
+	XMMATRIX projection = XMMatrixOrthographicRH(2.0f * radius, 2.0f * radius, 0.01f * radius, 4.0f * radius);
+	XMVECTOR target = XMLoadFloat3(&center);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	for (UINT cell = 0; cell < ViewCount; cell++)
+	{
+		CD3D11_VIEWPORT viewport(static_cast<float>(cell * CellSize), 0.0f, static_cast<float>(CellSize), static_cast<float>(CellSize));
+		context->RSSetViewports(1, &viewport);
+
+		float angle = XM_2PI * cell / ViewCount;
+		XMVECTOR direction = XMVectorSet(cosf(angle), 0.0f, sinf(angle), 0.0f);
+		XMVECTOR eye = XMVectorAdd(target, XMVectorScale(direction, 2.0f * radius));
+
+		XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorAdd(eye, direction), up);
+		draw(view, projection);
+	}
+
+	ID3D11RenderTargetView* const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, backBufferTargets, m_deviceResources->GetDepthStencilView());
+
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	context->RSSetViewports(1, &screenViewport);
+	context->RSSetState(nullptr);
+
+	m_isBaked = true;
+}
+
+void ImpostorAtlas::Draw(ID3D11Buffer* instanceBuffer, UINT firstInstance, UINT instanceCount, float radius,
+	ID3D11Buffer* mvpBuffer, const XMFLOAT3& cameraPosition)
+{
+	if (instanceCount == 0) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	m_constantBufferData.cameraPosition = cameraPosition;
+	m_constantBufferData.radius = radius;
+	m_constantBufferData.cellCount = ViewCount;
+	context->UpdateSubresource1(m_constantBuffer.Get(), 0, NULL, &m_constantBufferData, 0, 0, 0);
+
+	UINT stride = sizeof(VertexPositionColorNormal);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &instanceBuffer, &stride, &offset);
+	context->IASetInputLayout(m_inputLayout.Get());
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+	ID3D11Buffer* constantBuffers[2] = { mvpBuffer, m_constantBuffer.Get() };
+	context->VSSetShader(m_vertexShader.Get(), nullptr, 0);
+	context->VSSetConstantBuffers(0, 2, constantBuffers);
+	context->HSSetShader(nullptr, nullptr, 0);
+	context->DSSetShader(nullptr, nullptr, 0);
+	context->GSSetShader(nullptr, nullptr, 0);
+
+	context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+	context->PSSetShaderResources(0, 1, m_atlasView.GetAddressOf());
+	context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
+
+	context->DrawInstanced(4, instanceCount, 0, firstInstance);
+
+	ID3D11ShaderResourceView* nullView = nullptr;
+	context->PSSetShaderResources(0, 1, &nullView);
+}
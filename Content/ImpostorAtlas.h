@@ -0,0 +1,62 @@
+#pragma once
+
+#include "..\Common\DeviceResources.h"
+#include "ShaderStructures.h"
+
+#include <functional>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Billboard impostors for the coarsest level of detail (see LodSelector).
+	//
+	// At startup the owner draws its object once per cell of the atlas, each time
+	// seen from a different direction around the vertical axis. Impostors are then
+	// drawn as camera facing quads from per-instance VertexPositionColorNormal data
+	// (centre, tint, heading), and Impostor_VS.hlsl picks the cell baked closest to
+	// the direction the camera sees the object from.
+
+	class ImpostorAtlas
+	{
+	public:
+		// Baked views around the object, and the size of one cell in pixels.
+		static const UINT ViewCount = 8;
+		static const UINT CellSize = 128;
+
+		// Receives the view and projection of one atlas cell, not transposed.
+		typedef std::function<void(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection)> DrawFunction;
+
+		ImpostorAtlas(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		Concurrency::task<void> CreateDeviceDependentResources();
+		void ReleaseDeviceDependentResources();
+
+		// Renders every cell of the atlas with the object's heading along +x, then
+		// restores the back buffer and viewport. Needs the render thread.
+		void Bake(const DirectX::XMFLOAT3& center, float radius, const DrawFunction& draw);
+
+		// Draws instanceCount impostors of the given radius from the instance buffer.
+		// mvpBuffer is the owner's ModelViewProjectionConstantBuffer.
+		void Draw(ID3D11Buffer* instanceBuffer, UINT firstInstance, UINT instanceCount, float radius,
+			ID3D11Buffer* mvpBuffer, const DirectX::XMFLOAT3& cameraPosition);
+
+		bool IsBaked() const							{ return m_isBaked; }
+
+	private:
+		std::shared_ptr<DX::DeviceResources>			m_deviceResources;
+
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>		m_vertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_pixelShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout>		m_inputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_constantBuffer;
+		Microsoft::WRL::ComPtr<ID3D11SamplerState>		m_samplerState;
+		Microsoft::WRL::ComPtr<ID3D11RasterizerState>	m_bakeRasterizerState;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_atlasTexture;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>	m_atlasTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_atlasView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_depthTexture;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	m_depthStencilView;
+
+		ImpostorConstantBuffer							m_constantBufferData;
+		bool											m_isBaked;
+	};
+}
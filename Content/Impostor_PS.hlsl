@@ -0,0 +1,24 @@
+// Impostor pixels come straight from the baked atlas, tinted per instance.
+
+Texture2D atlas : register(t0);
+SamplerState atlasSampler : register(s0);
+
+struct PS_INPUT
+{
+    float4 pos      : SV_POSITION;
+    float3 color    : COLOR0;
+    float2 uv       : TEXCOORD0;
+};
+
+float4 main(PS_INPUT input) : SV_TARGET
+{
+    float4 texel = atlas.Sample(atlasSampler, input.uv);
+
+    // Cells are cleared to transparent around the baked object.
+    if (texel.a < 0.5)
+    {
+        discard;
+    }
+
+    return float4(texel.rgb * input.color, 1.0);
+}
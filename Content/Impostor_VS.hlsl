@@ -0,0 +1,75 @@
+// Camera facing impostor quads (ImpostorAtlas.cpp).
+// One instance per object, drawn as a four vertex strip. The atlas cell is the
+// baked view whose direction around the object is closest to the camera's.
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+    matrix model;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
+};
+
+cbuffer ImpostorConstantBuffer : register(b1)
+{
+    float3 cameraPosition;
+    float radius;
+    uint cellCount;
+    float3 padding;
+};
+
+struct VS_INPUT
+{
+    float3 pos      : POSITION;
+    float3 color    : COLOR0;
+    float3 heading  : NORMAL;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos      : SV_POSITION;
+    float3 color    : COLOR0;
+    float2 uv       : TEXCOORD0;
+};
+
+static const float PI = 3.14159265;
+
+// Triangle strip of a unit quad.
+static const float2 g_corners[4] =
+{
+    float2(-1, -1),
+    float2(-1, 1),
+    float2(1, -1),
+    float2(1, 1),
+};
+
+VS_OUTPUT main(VS_INPUT input, uint vertexID : SV_VertexID)
+{
+    VS_OUTPUT output;
+
+    float2 corner = g_corners[vertexID];
+
+    // The atlas was baked with the heading along +x, so the camera direction is
+    // measured in the object's own frame around the vertical axis.
+    float3 up = float3(0.0, 1.0, 0.0);
+    float3 heading = float3(input.heading.x, 0.0, input.heading.z);
+    heading = dot(heading, heading) > 1e-6 ? normalize(heading) : float3(1.0, 0.0, 0.0);
+    float3 side = cross(heading, up);
+
+    float3 toCamera = cameraPosition - input.pos;
+    float angle = atan2(dot(toCamera, side), dot(toCamera, heading));
+    float cell = fmod(floor(angle / (2.0 * PI) * cellCount + 0.5) + cellCount, cellCount);
+
+    // Camera right and up are the first two columns of the view matrix.
+    float3 right = float3(view._11, view._21, view._31);
+    float3 viewUp = float3(view._12, view._22, view._32);
+
+    float3 position = input.pos + (right * corner.x + viewUp * corner.y) * radius;
+
+    output.pos = mul(float4(position, 1.0), viewProjection);
+    output.color = input.color;
+    output.uv = float2((cell + corner.x * 0.5 + 0.5) / cellCount, 0.5 - 0.5 * corner.y);
+
+    return output;
+}
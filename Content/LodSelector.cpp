@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const float LOD_PI = 3.14159265358979323846f;
+
+	// The start camera of SceneRenderer, where the standard path begins and ends.
+	const float LOD_PATH_START_X = 0.0f;
+	const float LOD_PATH_START_Y = -2.5f;
+	const float LOD_PATH_START_Z = -15.5f;
+
+	float Threshold(const LodThresholds& thresholds, size_t level)
+	{
+		return (level == 0) ? thresholds.simplifiedBelow : thresholds.impostorBelow;
+	}
+}
+
+LodSelector::LodSelector(const LodThresholds& thresholds) :
+	m_thresholds(thresholds),
+	m_counts(),
+	m_switchCount(0)
+{
+}
+
+void LodSelector::Resize(size_t count)
+{
+	m_levels.resize(count, LodLevel::Full);
+}
+
+void LodSelector::BeginFrame()
+{
+	std::fill(m_counts, m_counts + LOD_LEVEL_COUNT, 0);
+	m_switchCount = 0;
+}
+
+LodLevel LodSelector::Update(size_t index, float projectedSize)
+{
+	LodLevel current = m_levels[index];
+	LodLevel level = Select(projectedSize, current, m_thresholds);
+
+	if (level != current)
+	{
+		m_levels[index] = level;
+		m_switchCount++;
+	}
+
+	m_counts[static_cast<size_t>(level)]++;
+	return level;
+}
+
+void LodSelector::UpdateAll(const LodView& view, const std::vector<LodSphere>& spheres)
+{
+	Resize(spheres.size());
+	BeginFrame();
+
+	for (size_t i = 0; i < spheres.size(); i++)
+	{
+		const LodSphere& s = spheres[i];
+		Update(i, ProjectedSize(view, s.x, s.y, s.z, s.radius));
+	}
+}
+
+float LodSelector::ProjectedSize(const LodView& view, float x, float y, float z, float radius)
+{
+	float dx = x - view.cameraX;
+	float dy = y - view.cameraY;
+	float dz = z - view.cameraZ;
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	return 2.0f * radius * view.pixelScale / std::max(distance, radius);
+}
+
+LodLevel LodSelector::Select(float projectedSize, LodLevel current, const LodThresholds& thresholds)
+{
+	size_t level = static_cast<size_t>(current);
+
+	// Coarser once the size is clearly below the threshold under the current level,
+	// finer once it is clearly above the threshold of the level above.
+	while (level + 1 < LOD_LEVEL_COUNT && projectedSize < Threshold(thresholds, level) * (1.0f - thresholds.hysteresis))
+	{
+		level++;
+	}
+
+	while (level > 0 && projectedSize > Threshold(thresholds, level - 1) * (1.0f + thresholds.hysteresis))
+	{
+		level--;
+	}
+
+	return static_cast<LodLevel>(level);
+}
+
+void LodReport::StandardCameraPath(float t, float& x, float& y, float& z)
+{
+	float angle = 2.0f * LOD_PI * t;
+
+	x = LOD_PATH_START_X + 45.0f * sinf(angle);
+	y = LOD_PATH_START_Y + 3.0f * sinf(2.0f * angle);
+	z = LOD_PATH_START_Z - 35.0f * (1.0f - cosf(angle));
+}
+
+std::vector<LodReportRow> LodReport::Run(const std::vector<LodObjectSet>& sets, float pixelScale, uint32_t frames)
+{
+	std::vector<LodSelector> selectors;
+	for (const LodObjectSet& set : sets)
+	{
+		selectors.push_back(LodSelector(set.thresholds));
+	}
+
+	std::vector<LodReportRow> rows(frames);
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		LodReportRow& row = rows[frame];
+		row = LodReportRow();
+		row.frame = frame;
+
+		StandardCameraPath(static_cast<float>(frame) / frames, row.cameraX, row.cameraY, row.cameraZ);
+		LodView view = { row.cameraX, row.cameraY, row.cameraZ, pixelScale };
+
+		for (size_t s = 0; s < sets.size(); s++)
+		{
+			const LodObjectSet& set = sets[s];
+			LodSelector& selector = selectors[s];
+
+			selector.UpdateAll(view, set.spheres);
+			row.switches += selector.GetSwitchCount();
+
+			for (size_t level = 0; level < LOD_LEVEL_COUNT; level++)
+			{
+				size_t count = selector.GetCount(static_cast<LodLevel>(level));
+				row.counts[level] += count;
+				row.triangles += static_cast<uint64_t>(count) * set.triangles[level];
+
+				if (count > 0)
+				{
+					row.draws += set.isInstanced ? 1 : static_cast<uint32_t>(count);
+				}
+			}
+
+			if (!set.spheres.empty())
+			{
+				row.fullTriangles += static_cast<uint64_t>(set.spheres.size()) * set.triangles[0];
+				row.fullDraws += set.isInstanced ? 1 : static_cast<uint32_t>(set.spheres.size());
+			}
+		}
+	}
+
+	return rows;
+}
+
+void LodReport::WriteCsv(std::ostream& stream, const std::vector<LodReportRow>& rows)
+{
+	stream << "frame,camera_x,camera_y,camera_z,full,simplified,impostor,triangles,draws,full_triangles,full_draws,switches\n";
+
+	for (const LodReportRow& row : rows)
+	{
+		stream << row.frame << ',' << row.cameraX << ',' << row.cameraY << ',' << row.cameraZ << ','
+			<< row.counts[0] << ',' << row.counts[1] << ',' << row.counts[2] << ','
+			<< row.triangles << ',' << row.draws << ',' << row.fullTriangles << ',' << row.fullDraws << ','
+			<< row.switches << '\n';
+	}
+}
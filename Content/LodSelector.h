@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Level of detail selection by projected size, shared by the fish (P05) and the
+	// corals (P03, P04).
+	//
+	// Every object is a bounding sphere whose projected diameter in pixels picks
+	// full geometry, simplified geometry or a billboard impostor. A level only
+	// changes once the size has moved past its threshold by the hysteresis margin,
+	// so objects sitting on a threshold do not pop back and forth.
+	//
+	// LodReport replays the selection along the standard camera path and counts
+	// the triangles and draw calls it leads to, with and without LOD.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	enum class LodLevel : uint8_t
+	{
+		Full,
+		Simplified,
+		Impostor
+	};
+
+	const size_t LOD_LEVEL_COUNT = 3;
+
+	// Projected diameters in pixels below which the coarser levels are used.
+	struct LodThresholds
+	{
+		float	simplifiedBelow;
+		float	impostorBelow;
+		float	hysteresis;			// Fraction of a threshold the size must cross it by.
+	};
+
+	struct LodView
+	{
+		float	cameraX;
+		float	cameraY;
+		float	cameraZ;
+		float	pixelScale;			// Pixels covered by one unit at distance one: viewport height / (2 tan(fovY / 2)).
+	};
+
+	struct LodSphere
+	{
+		float	x;
+		float	y;
+		float	z;
+		float	radius;
+	};
+
+	class LodSelector
+	{
+	public:
+		explicit LodSelector(const LodThresholds& thresholds);
+
+		// New objects start at full detail.
+		void Resize(size_t count);
+
+		// Clears the per-frame level counts and switch count.
+		void BeginFrame();
+
+		// Picks the level of one object from its projected size and returns it.
+		LodLevel Update(size_t index, float projectedSize);
+
+		// BeginFrame followed by Update for every sphere.
+		void UpdateAll(const LodView& view, const std::vector<LodSphere>& spheres);
+
+		LodLevel GetLevel(size_t index) const				{ return m_levels[index]; }
+		size_t GetCount(LodLevel level) const				{ return m_counts[static_cast<size_t>(level)]; }
+		size_t GetSwitchCount() const						{ return m_switchCount; }
+		size_t GetObjectCount() const						{ return m_levels.size(); }
+		const LodThresholds& GetThresholds() const			{ return m_thresholds; }
+
+		// Projected diameter in pixels of a sphere. Spheres around the camera count as filling the view.
+		static float ProjectedSize(const LodView& view, float x, float y, float z, float radius);
+
+		// The level a single object moves to from its current one.
+		static LodLevel Select(float projectedSize, LodLevel current, const LodThresholds& thresholds);
+
+	private:
+		LodThresholds			m_thresholds;
+		std::vector<LodLevel>	m_levels;
+		size_t					m_counts[LOD_LEVEL_COUNT];
+		size_t					m_switchCount;
+	};
+
+	// A group of objects that share thresholds and per-level costs.
+	struct LodObjectSet
+	{
+		std::string				name;
+		std::vector<LodSphere>	spheres;
+		LodThresholds			thresholds;
+		uint32_t				triangles[LOD_LEVEL_COUNT];		// Per object at each level.
+		bool					isInstanced;					// One draw per level in use rather than one per object.
+	};
+
+	struct LodReportRow
+	{
+		uint32_t	frame;
+		float		cameraX;
+		float		cameraY;
+		float		cameraZ;
+		size_t		counts[LOD_LEVEL_COUNT];
+		uint64_t	triangles;
+		uint32_t	draws;
+		uint64_t	fullTriangles;		// Everything at full detail.
+		uint32_t	fullDraws;
+		size_t		switches;
+	};
+
+	class LodReport
+	{
+	public:
+		// Camera position at t in [0, 1) along the standard path: a loop that starts at
+		// the start camera, pulls back past the shoal and swings across the reef.
+		static void StandardCameraPath(float t, float& x, float& y, float& z);
+
+		// Replays the selection over the given number of frames of the standard path.
+		static std::vector<LodReportRow> Run(const std::vector<LodObjectSet>& sets, float pixelScale, uint32_t frames);
+
+		static void WriteCsv(std::ostream& stream, const std::vector<LodReportRow>& rows);
+	};
+}
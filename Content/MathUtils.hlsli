@@ -64,6 +64,27 @@ float noise(in float3 x)
     return res;
 }
 
+#ifdef NOISE_VOLUME
+/**
+ * Texture path of noise(): the lattice of one tile is hashed on the CPU at
+ * startup (NoiseVolume) and read back with a single trilinear fetch. The
+ * smoothstep is folded into the coordinate, so the linear filter blends the
+ * same eight corners as noise(), within the filter's 8 bit weight precision.
+ * The texture repeats every 1 / inverseSize lattice cells.
+ */
+Texture3D<float> noiseVolume : register(t0);
+SamplerState noiseSampler : register(s0);
+
+float noiseLookup(in float3 x, in float inverseSize)
+{
+    float3 p = floor(x);
+    float3 k = frac(x);
+    k = k * k * (3.0 - 2.0 * k);
+
+    return noiseVolume.SampleLevel(noiseSampler, (p + k + 0.5) * inverseSize, 0);
+}
+#endif
+
 float hash2(float2 grid) {
     float h = dot(grid, float2 (127.1, 311.7));
     return hash(h);
@@ -0,0 +1,391 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Tuning values from Forsyth's reference implementation.
+	const uint32_t	FORSYTH_CACHE_SIZE = 32;
+	const float		FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	const float		FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float		FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	const float		FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	float VertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+	{
+		// Vertices with no triangles left can never be used again.
+		if (remainingTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// The vertices of the last triangle get a fixed score, so the
+				// triangle just drawn does not bias the choice of strip direction.
+				score = FORSYTH_LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+			}
+		}
+
+		// Boost vertices with few triangles left so lone triangles get drawn early.
+		score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	// Returns the number of cache misses caused by one triangle in a FIFO cache.
+	uint32_t UpdateCache(const uint32_t* triangle, std::vector<uint32_t>& cacheTime, uint32_t& timestamp, uint32_t cacheSize)
+	{
+		uint32_t misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			if (timestamp - cacheTime[v] > cacheSize)
+			{
+				cacheTime[v] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStatistics statistics = { 0.0f, 0.0f };
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return statistics;
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		misses += UpdateCache(&indices[i * 3], cacheTime, timestamp, cacheSize);
+	}
+
+	for (uint32_t index : indices)
+	{
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	statistics.acmr = static_cast<float>(misses) / triangleCount;
+	statistics.atvr = static_cast<float>(misses) / uniqueVertices;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Build the vertex to triangle adjacency. The live part of each vertex range
+	// shrinks as its triangles are emitted.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::vector<uint32_t> adjacency(indices.size());
+
+	for (uint32_t index : indices)
+	{
+		remaining[index]++;
+	}
+
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int64_t bestTriangle = -1;
+	float bestScore = -1.0f;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = static_cast<int64_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t cursor = 0;
+
+	for (size_t n = 0; n < triangleCount; n++)
+	{
+		// No candidate in the cache: restart from the next triangle in input order.
+		if (bestTriangle < 0)
+		{
+			while (emitted[cursor])
+			{
+				cursor++;
+			}
+			bestTriangle = static_cast<int64_t>(cursor);
+		}
+
+		const uint32_t* triangle = &indices[static_cast<size_t>(bestTriangle) * 3];
+		emitted[static_cast<size_t>(bestTriangle)] = true;
+
+		nextCache.clear();
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			output.push_back(v);
+			nextCache.push_back(v);
+
+			// Remove the emitted triangle from the live adjacency of the vertex.
+			uint32_t* begin = &adjacency[offsets[v]];
+			uint32_t* end = begin + remaining[v];
+			uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			std::swap(*found, *(end - 1));
+			remaining[v]--;
+		}
+
+		for (uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				nextCache.push_back(v);
+			}
+		}
+
+		// Rescore every vertex that is in, or has just dropped out of, the cache.
+		for (size_t i = 0; i < nextCache.size(); i++)
+		{
+			uint32_t v = nextCache[i];
+			cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int32_t>(i) : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (uint32_t v : nextCache)
+		{
+			for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+			{
+				uint32_t t = adjacency[a];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (nextCache.size() > FORSYTH_CACHE_SIZE)
+		{
+			nextCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshPosition>& positions, float threshold, uint32_t cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> cacheTime(positions.size(), 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	// Hard boundaries: triangles where the cache starts over with three misses.
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (UpdateCache(&indices[t * 3], cacheTime, timestamp, cacheSize) == 3 || t == 0)
+		{
+			hardBoundaries.push_back(t);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries: split hard clusters wherever the running miss ratio is
+	// already within the threshold of the whole cluster's miss ratio.
+	std::vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		size_t start = hardBoundaries[h];
+		size_t end = hardBoundaries[h + 1];
+
+		timestamp += cacheSize + 1;
+		size_t clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += UpdateCache(&indices[t * 3], cacheTime, timestamp, cacheSize);
+		}
+		float clusterThreshold = threshold * static_cast<float>(clusterMisses) / (end - start);
+
+		clusters.push_back(start);
+		timestamp += cacheSize + 1;
+		size_t runningMisses = 0;
+		size_t runningStart = start;
+		for (size_t t = start; t < end; t++)
+		{
+			runningMisses += UpdateCache(&indices[t * 3], cacheTime, timestamp, cacheSize);
+			if (t + 1 < end && static_cast<float>(runningMisses) / (t - runningStart + 1) <= clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				timestamp += cacheSize + 1;
+				runningMisses = 0;
+				runningStart = t + 1;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Area weighted centroid of the whole mesh.
+	double meshX = 0.0, meshY = 0.0, meshZ = 0.0, meshArea = 0.0;
+	size_t clusterCount = clusters.size() - 1;
+	std::vector<float> sortKey(clusterCount);
+
+	std::vector<double> clusterData(clusterCount * 7, 0.0);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		double* data = &clusterData[c * 7];
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const MeshPosition& p0 = positions[indices[t * 3]];
+			const MeshPosition& p1 = positions[indices[t * 3 + 1]];
+			const MeshPosition& p2 = positions[indices[t * 3 + 2]];
+
+			double e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+			double e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+			double nx = e1y * e2z - e1z * e2y;
+			double ny = e1z * e2x - e1x * e2z;
+			double nz = e1x * e2y - e1y * e2x;
+			double area = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+			data[0] += (p0.x + p1.x + p2.x) / 3.0 * area;
+			data[1] += (p0.y + p1.y + p2.y) / 3.0 * area;
+			data[2] += (p0.z + p1.z + p2.z) / 3.0 * area;
+			data[3] += nx;
+			data[4] += ny;
+			data[5] += nz;
+			data[6] += area;
+		}
+
+		meshX += data[0];
+		meshY += data[1];
+		meshZ += data[2];
+		meshArea += data[6];
+	}
+
+	if (meshArea > 0.0)
+	{
+		meshX /= meshArea;
+		meshY /= meshArea;
+		meshZ /= meshArea;
+	}
+
+	// Clusters facing away from the mesh centre are most likely to occlude the rest.
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const double* data = &clusterData[c * 7];
+		double area = data[6] > 0.0 ? data[6] : 1.0;
+		double normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+		if (normalLength <= 0.0)
+		{
+			sortKey[c] = 0.0f;
+			continue;
+		}
+
+		double dx = data[0] / area - meshX;
+		double dy = data[1] / area - meshY;
+		double dz = data[2] / area - meshZ;
+		sortKey[c] = static_cast<float>((dx * data[3] + dy * data[4] + dz * data[5]) / normalLength);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (size_t c : order)
+	{
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	indices.swap(output);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const uint32_t unused = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(vertexCount, unused);
+	uint32_t next = 0;
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+
+	for (uint32_t& entry : remap)
+	{
+		if (entry == unused)
+		{
+			entry = next++;
+		}
+	}
+
+	return remap;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Mesh optimisation stage for procedurally generated triangle lists.
+	//
+	// Vertex cache ordering follows Tom Forsyth's "Linear-Speed Vertex Cache
+	// Optimisation", overdraw ordering follows the cluster sort of Sander et al.
+	// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Tipsify)
+	// and the vertex fetch remap orders vertices by first use.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	struct MeshPosition
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	struct VertexCacheStatistics
+	{
+		float acmr;			// Average cache miss ratio: transformed vertices per triangle.
+		float atvr;			// Average transform to vertex ratio: transformed vertices per unique vertex.
+	};
+
+	class MeshOptimizer
+	{
+	public:
+		// Simulates a FIFO post-transform cache of the given size over the index list.
+		static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+		// Reorders triangles to maximise post-transform vertex cache hits.
+		static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+		// Reorders clusters of a cache optimised index list so outward facing clusters are drawn first.
+		// The threshold bounds the cache miss ratio increase allowed when splitting clusters.
+		static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshPosition>& positions, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+		// Builds a table mapping old vertex indices to new ones in order of first use,
+		// and rewrites the index list to use it. Unreferenced vertices are moved to the end.
+		static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+		// Reorders a vertex array with a table produced by OptimizeVertexFetch.
+		template <typename T>
+		static void RemapVertexBuffer(std::vector<T>& vertices, const std::vector<uint32_t>& remap)
+		{
+			std::vector<T> remapped(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				remapped[remap[i]] = vertices[i];
+			}
+			vertices.swap(remapped);
+		}
+	};
+}
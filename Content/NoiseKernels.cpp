@@ -0,0 +1,557 @@
+#include "pch.h"
+#include "NoiseKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NOISE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define NOISE_KERNELS_AVX2
+#else
+#define NOISE_KERNELS_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Cephes' single precision sine: x is reduced by multiples of pi / 4, split into
+	// three parts so the reduction stays exact, then the sine or cosine series of
+	// the remainder is picked by the octant.
+	const float NOISE_FOUR_OVER_PI = 1.27323954473516f;
+	const float NOISE_PI_4_A = 0.78515625f;
+	const float NOISE_PI_4_B = 2.4187564849853515625e-4f;
+	const float NOISE_PI_4_C = 3.77489497744594108e-8f;
+	const float NOISE_SIN_P0 = -1.9515295891e-4f;
+	const float NOISE_SIN_P1 = 8.3321608736e-3f;
+	const float NOISE_SIN_P2 = -1.6666654611e-1f;
+	const float NOISE_COS_P0 = 2.443315711809948e-5f;
+	const float NOISE_COS_P1 = -1.388731625493765e-3f;
+	const float NOISE_COS_P2 = 4.166664568298827e-2f;
+
+	const float NOISE_HASH_SCALE = 43758.5453f;
+
+	// Lattice strides of noise() and the dot product of hash2().
+	const float NOISE_STRIDE_Y = 57.0f;
+	const float NOISE_STRIDE_Z = 113.0f;
+	const float NOISE_HASH2_X = 127.1f;
+	const float NOISE_HASH2_Y = 311.7f;
+
+	// Points the batch Fbm scales per octave at a time.
+	const size_t NOISE_FBM_CHUNK = 256;
+
+	// Benchmark points lie in a cube of this half size, about the lattice range
+	// the floor's lower octaves cover.
+	const float NOISE_BENCHMARK_EXTENT = 64.0f;
+
+	// Roughly this many noise evaluations are timed per path, whatever the count.
+	const size_t NOISE_BENCHMARK_EVALUATIONS = 2000000;
+
+	// Difference from the C library's sine above which a sample counts as a mismatch.
+	const float NOISE_LIBRARY_TOLERANCE = 0.01f;
+
+	bool DetectAvx2()
+	{
+#if defined(NOISE_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// The OS must save the YMM registers as well as the CPU supporting AVX2.
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#elif defined(NOISE_KERNELS_X86)
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+
+	const bool g_hasAvx2 = DetectAvx2();
+
+	// HLSL's lerp(a, b, t) and the smoothstep weight of noise() and perlin().
+	float Lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+
+	float Smooth(float k)
+	{
+		return k * k * (3.0f - 2.0f * k);
+	}
+
+	// noise() with the C library's sine, for the mismatch rate of the benchmark.
+	float LibraryHash(float n)
+	{
+		float s = sinf(n) * NOISE_HASH_SCALE;
+		return s - floorf(s);
+	}
+
+	float LibraryNoise(float x, float y, float z)
+	{
+		float px = floorf(x), py = floorf(y), pz = floorf(z);
+		float kx = Smooth(x - px), ky = Smooth(y - py), kz = Smooth(z - pz);
+
+		float n = px + py * NOISE_STRIDE_Y + pz * NOISE_STRIDE_Z;
+		return Lerp(Lerp(Lerp(LibraryHash(n), LibraryHash(n + 1.0f), kx), Lerp(LibraryHash(n + 57.0f), LibraryHash(n + 58.0f), kx), ky),
+			Lerp(Lerp(LibraryHash(n + 113.0f), LibraryHash(n + 114.0f), kx), Lerp(LibraryHash(n + 170.0f), LibraryHash(n + 171.0f), kx), ky),
+			kz);
+	}
+
+	void NoiseScalarRange(const float* x, const float* y, const float* z, float* result, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			result[i] = NoiseKernels::Noise(x[i], y[i], z[i]);
+		}
+	}
+
+	void PerlinScalarRange(const float* x, const float* y, float* result, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			result[i] = NoiseKernels::Perlin(x[i], y[i]);
+		}
+	}
+
+#if defined(NOISE_KERNELS_X86)
+	// The kernels return how many points they handled; the caller finishes the tail
+	// in scalar code. Multiplies and adds stay separate, in the scalar order, so the
+	// results match the scalar path bit for bit.
+
+	inline __m128 FloorSse(__m128 x)
+	{
+		// Truncation rounds negative fractions up, so those step down by one.
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+	}
+
+	inline __m128 SelectSse(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	inline __m128 LerpSse(__m128 a, __m128 b, __m128 t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+	}
+
+	inline __m128 SmoothSse(__m128 k)
+	{
+		return _mm_mul_ps(_mm_mul_ps(k, k), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_set1_ps(2.0f), k)));
+	}
+
+	inline __m128 SinSse(__m128 x)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 sign = _mm_and_ps(x, signMask);
+		__m128 a = _mm_andnot_ps(signMask, x);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(a, _mm_set1_ps(NOISE_FOUR_OVER_PI)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+
+		sign = _mm_xor_ps(sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+		__m128 useSin = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+		a = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(a, _mm_mul_ps(y, _mm_set1_ps(NOISE_PI_4_A))), _mm_mul_ps(y, _mm_set1_ps(NOISE_PI_4_B))),
+			_mm_mul_ps(y, _mm_set1_ps(NOISE_PI_4_C)));
+		__m128 z = _mm_mul_ps(a, a);
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(NOISE_COS_P0), z), _mm_set1_ps(NOISE_COS_P1)), z), _mm_set1_ps(NOISE_COS_P2));
+		c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+		c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+		__m128 s = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(NOISE_SIN_P0), z), _mm_set1_ps(NOISE_SIN_P1)), z), _mm_set1_ps(NOISE_SIN_P2));
+		s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), a), a);
+
+		return _mm_xor_ps(SelectSse(useSin, s, c), sign);
+	}
+
+	inline __m128 HashSse(__m128 n)
+	{
+		__m128 s = _mm_mul_ps(SinSse(n), _mm_set1_ps(NOISE_HASH_SCALE));
+		return _mm_sub_ps(s, FloorSse(s));
+	}
+
+	size_t NoiseSse(const float* x, const float* y, const float* z, float* result, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sx = _mm_loadu_ps(x + i), sy = _mm_loadu_ps(y + i), sz = _mm_loadu_ps(z + i);
+			__m128 px = FloorSse(sx), py = FloorSse(sy), pz = FloorSse(sz);
+			__m128 kx = SmoothSse(_mm_sub_ps(sx, px)), ky = SmoothSse(_mm_sub_ps(sy, py)), kz = SmoothSse(_mm_sub_ps(sz, pz));
+
+			__m128 n = _mm_add_ps(_mm_add_ps(px, _mm_mul_ps(py, _mm_set1_ps(NOISE_STRIDE_Y))), _mm_mul_ps(pz, _mm_set1_ps(NOISE_STRIDE_Z)));
+			__m128 a = HashSse(n), b = HashSse(_mm_add_ps(n, _mm_set1_ps(1.0f)));
+			__m128 c = HashSse(_mm_add_ps(n, _mm_set1_ps(57.0f))), d = HashSse(_mm_add_ps(n, _mm_set1_ps(58.0f)));
+			__m128 e = HashSse(_mm_add_ps(n, _mm_set1_ps(113.0f))), f = HashSse(_mm_add_ps(n, _mm_set1_ps(114.0f)));
+			__m128 g = HashSse(_mm_add_ps(n, _mm_set1_ps(170.0f))), h = HashSse(_mm_add_ps(n, _mm_set1_ps(171.0f)));
+
+			_mm_storeu_ps(result + i, LerpSse(LerpSse(LerpSse(a, b, kx), LerpSse(c, d, kx), ky),
+				LerpSse(LerpSse(e, f, kx), LerpSse(g, h, kx), ky), kz));
+		}
+		return i;
+	}
+
+	inline __m128 Hash2Sse(__m128 x, __m128 y)
+	{
+		return HashSse(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(NOISE_HASH2_X)), _mm_mul_ps(y, _mm_set1_ps(NOISE_HASH2_Y))));
+	}
+
+	size_t PerlinSse(const float* x, const float* y, float* result, size_t count)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sx = _mm_loadu_ps(x + i), sy = _mm_loadu_ps(y + i);
+			__m128 gx = FloorSse(sx), gy = FloorSse(sy);
+			__m128 ux = SmoothSse(_mm_sub_ps(sx, gx)), uy = SmoothSse(_mm_sub_ps(sy, gy));
+			__m128 gx1 = _mm_add_ps(gx, one), gy1 = _mm_add_ps(gy, one);
+
+			__m128 n1 = LerpSse(Hash2Sse(gx, gy), Hash2Sse(gx1, gy), ux);
+			__m128 n2 = LerpSse(Hash2Sse(gx, gy1), Hash2Sse(gx1, gy1), ux);
+			_mm_storeu_ps(result + i, LerpSse(n1, n2, uy));
+		}
+		return i;
+	}
+
+	NOISE_KERNELS_AVX2 inline __m256 LerpAvx2(__m256 a, __m256 b, __m256 t)
+	{
+		return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+	}
+
+	NOISE_KERNELS_AVX2 inline __m256 SmoothAvx2(__m256 k)
+	{
+		return _mm256_mul_ps(_mm256_mul_ps(k, k), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_set1_ps(2.0f), k)));
+	}
+
+	NOISE_KERNELS_AVX2 inline __m256 SinAvx2(__m256 x)
+	{
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		__m256 sign = _mm256_and_ps(x, signMask);
+		__m256 a = _mm256_andnot_ps(signMask, x);
+
+		__m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(a, _mm256_set1_ps(NOISE_FOUR_OVER_PI)));
+		j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(j);
+
+		sign = _mm256_xor_ps(sign, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+		__m256 useSin = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+		a = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(a, _mm256_mul_ps(y, _mm256_set1_ps(NOISE_PI_4_A))), _mm256_mul_ps(y, _mm256_set1_ps(NOISE_PI_4_B))),
+			_mm256_mul_ps(y, _mm256_set1_ps(NOISE_PI_4_C)));
+		__m256 z = _mm256_mul_ps(a, a);
+
+		__m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(NOISE_COS_P0), z), _mm256_set1_ps(NOISE_COS_P1)), z), _mm256_set1_ps(NOISE_COS_P2));
+		c = _mm256_mul_ps(_mm256_mul_ps(c, z), z);
+		c = _mm256_add_ps(_mm256_sub_ps(c, _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+		__m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(NOISE_SIN_P0), z), _mm256_set1_ps(NOISE_SIN_P1)), z), _mm256_set1_ps(NOISE_SIN_P2));
+		s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), a), a);
+
+		return _mm256_xor_ps(_mm256_blendv_ps(c, s, useSin), sign);
+	}
+
+	NOISE_KERNELS_AVX2 inline __m256 HashAvx2(__m256 n)
+	{
+		__m256 s = _mm256_mul_ps(SinAvx2(n), _mm256_set1_ps(NOISE_HASH_SCALE));
+		return _mm256_sub_ps(s, _mm256_floor_ps(s));
+	}
+
+	NOISE_KERNELS_AVX2 size_t NoiseAvx2(const float* x, const float* y, const float* z, float* result, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sx = _mm256_loadu_ps(x + i), sy = _mm256_loadu_ps(y + i), sz = _mm256_loadu_ps(z + i);
+			__m256 px = _mm256_floor_ps(sx), py = _mm256_floor_ps(sy), pz = _mm256_floor_ps(sz);
+			__m256 kx = SmoothAvx2(_mm256_sub_ps(sx, px)), ky = SmoothAvx2(_mm256_sub_ps(sy, py)), kz = SmoothAvx2(_mm256_sub_ps(sz, pz));
+
+			__m256 n = _mm256_add_ps(_mm256_add_ps(px, _mm256_mul_ps(py, _mm256_set1_ps(NOISE_STRIDE_Y))), _mm256_mul_ps(pz, _mm256_set1_ps(NOISE_STRIDE_Z)));
+			__m256 a = HashAvx2(n), b = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(1.0f)));
+			__m256 c = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(57.0f))), d = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(58.0f)));
+			__m256 e = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(113.0f))), f = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(114.0f)));
+			__m256 g = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(170.0f))), h = HashAvx2(_mm256_add_ps(n, _mm256_set1_ps(171.0f)));
+
+			_mm256_storeu_ps(result + i, LerpAvx2(LerpAvx2(LerpAvx2(a, b, kx), LerpAvx2(c, d, kx), ky),
+				LerpAvx2(LerpAvx2(e, f, kx), LerpAvx2(g, h, kx), ky), kz));
+		}
+		return i;
+	}
+
+	NOISE_KERNELS_AVX2 inline __m256 Hash2Avx2(__m256 x, __m256 y)
+	{
+		return HashAvx2(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(NOISE_HASH2_X)), _mm256_mul_ps(y, _mm256_set1_ps(NOISE_HASH2_Y))));
+	}
+
+	NOISE_KERNELS_AVX2 size_t PerlinAvx2(const float* x, const float* y, float* result, size_t count)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sx = _mm256_loadu_ps(x + i), sy = _mm256_loadu_ps(y + i);
+			__m256 gx = _mm256_floor_ps(sx), gy = _mm256_floor_ps(sy);
+			__m256 ux = SmoothAvx2(_mm256_sub_ps(sx, gx)), uy = SmoothAvx2(_mm256_sub_ps(sy, gy));
+			__m256 gx1 = _mm256_add_ps(gx, one), gy1 = _mm256_add_ps(gy, one);
+
+			__m256 n1 = LerpAvx2(Hash2Avx2(gx, gy), Hash2Avx2(gx1, gy), ux);
+			__m256 n2 = LerpAvx2(Hash2Avx2(gx, gy1), Hash2Avx2(gx1, gy1), ux);
+			_mm256_storeu_ps(result + i, LerpAvx2(n1, n2, uy));
+		}
+		return i;
+	}
+#endif
+
+	template <typename Function>
+	double MeasureNanoseconds(Function function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+}
+
+float NoiseKernels::Sin(float x)
+{
+	float a = fabsf(x);
+
+	int j = static_cast<int>(a * NOISE_FOUR_OVER_PI);
+	j = (j + 1) & ~1;
+	float y = static_cast<float>(j);
+
+	bool isNegative = (x < 0.0f) != ((j & 4) != 0);
+	bool useSin = (j & 2) == 0;
+
+	a = ((a - y * NOISE_PI_4_A) - y * NOISE_PI_4_B) - y * NOISE_PI_4_C;
+	float z = a * a;
+
+	float c = (NOISE_COS_P0 * z + NOISE_COS_P1) * z + NOISE_COS_P2;
+	c = c * z * z;
+	c = c - 0.5f * z + 1.0f;
+
+	float s = (NOISE_SIN_P0 * z + NOISE_SIN_P1) * z + NOISE_SIN_P2;
+	s = s * z * a + a;
+
+	float result = useSin ? s : c;
+	return isNegative ? -result : result;
+}
+
+float NoiseKernels::Hash(float n)
+{
+	float s = Sin(n) * NOISE_HASH_SCALE;
+	return s - floorf(s);
+}
+
+float NoiseKernels::Noise(float x, float y, float z)
+{
+	float px = floorf(x), py = floorf(y), pz = floorf(z);
+	float kx = Smooth(x - px), ky = Smooth(y - py), kz = Smooth(z - pz);
+
+	float n = px + py * NOISE_STRIDE_Y + pz * NOISE_STRIDE_Z;
+	float a = Hash(n), b = Hash(n + 1.0f);
+	float c = Hash(n + 57.0f), d = Hash(n + 58.0f);
+	float e = Hash(n + 113.0f), f = Hash(n + 114.0f);
+	float g = Hash(n + 170.0f), h = Hash(n + 171.0f);
+
+	return Lerp(Lerp(Lerp(a, b, kx), Lerp(c, d, kx), ky),
+		Lerp(Lerp(e, f, kx), Lerp(g, h, kx), ky),
+		kz);
+}
+
+float NoiseKernels::Hash2(float x, float y)
+{
+	return Hash(x * NOISE_HASH2_X + y * NOISE_HASH2_Y);
+}
+
+float NoiseKernels::Perlin(float x, float y)
+{
+	float gx = floorf(x), gy = floorf(y);
+	float ux = Smooth(x - gx), uy = Smooth(y - gy);
+
+	float n1 = Lerp(Hash2(gx, gy), Hash2(gx + 1.0f, gy), ux);
+	float n2 = Lerp(Hash2(gx, gy + 1.0f), Hash2(gx + 1.0f, gy + 1.0f), ux);
+	return Lerp(n1, n2, uy);
+}
+
+float NoiseKernels::Fbm(float x, float y, float z, const FbmParameters& parameters)
+{
+	float sum = 0.0f;
+	float amplitude = parameters.amplitude;
+	float frequency = parameters.frequency;
+
+	for (uint32_t octave = 0; octave < parameters.octaves; octave++)
+	{
+		sum += amplitude * Noise(x * frequency, y * frequency, z * frequency);
+		amplitude *= parameters.gain;
+		frequency *= parameters.lacunarity;
+	}
+
+	return sum;
+}
+
+FbmParameters NoiseKernels::FloorFbm()
+{
+	FbmParameters parameters = { 8, 0.6f, 0.5f, 2.0f, 0.5f };
+	return parameters;
+}
+
+void NoiseKernels::Noise(const float* x, const float* y, const float* z, float* result, size_t count, NoiseVariant variant)
+{
+	size_t done = 0;
+
+#if defined(NOISE_KERNELS_X86)
+	if (variant == NoiseVariant::Avx2 && g_hasAvx2) done = NoiseAvx2(x, y, z, result, count);
+	else if (variant != NoiseVariant::Scalar) done = NoiseSse(x, y, z, result, count);
+#endif
+
+	NoiseScalarRange(x, y, z, result, done, count);
+}
+
+void NoiseKernels::Perlin(const float* x, const float* y, float* result, size_t count, NoiseVariant variant)
+{
+	size_t done = 0;
+
+#if defined(NOISE_KERNELS_X86)
+	if (variant == NoiseVariant::Avx2 && g_hasAvx2) done = PerlinAvx2(x, y, result, count);
+	else if (variant != NoiseVariant::Scalar) done = PerlinSse(x, y, result, count);
+#endif
+
+	PerlinScalarRange(x, y, result, done, count);
+}
+
+// Scales a chunk of points per octave and runs the batch noise over it, adding in
+// the same order as the scalar Fbm.
+void NoiseKernels::Fbm(const float* x, const float* y, const float* z, float* result, size_t count,
+	const FbmParameters& parameters, NoiseVariant variant)
+{
+	float sx[NOISE_FBM_CHUNK], sy[NOISE_FBM_CHUNK], sz[NOISE_FBM_CHUNK], octaveNoise[NOISE_FBM_CHUNK];
+
+	for (size_t begin = 0; begin < count; begin += NOISE_FBM_CHUNK)
+	{
+		size_t length = std::min(NOISE_FBM_CHUNK, count - begin);
+		float* sum = result + begin;
+		std::fill(sum, sum + length, 0.0f);
+
+		float amplitude = parameters.amplitude;
+		float frequency = parameters.frequency;
+
+		for (uint32_t octave = 0; octave < parameters.octaves; octave++)
+		{
+			for (size_t i = 0; i < length; i++)
+			{
+				sx[i] = x[begin + i] * frequency;
+				sy[i] = y[begin + i] * frequency;
+				sz[i] = z[begin + i] * frequency;
+			}
+
+			Noise(sx, sy, sz, octaveNoise, length, variant);
+
+			for (size_t i = 0; i < length; i++)
+			{
+				sum[i] += amplitude * octaveNoise[i];
+			}
+
+			amplitude *= parameters.gain;
+			frequency *= parameters.lacunarity;
+		}
+	}
+}
+
+bool NoiseKernels::IsSupported(NoiseVariant variant)
+{
+	switch (variant)
+	{
+	case NoiseVariant::Scalar:	return true;
+#if defined(NOISE_KERNELS_X86)
+	case NoiseVariant::Sse:		return true;
+	case NoiseVariant::Avx2:	return g_hasAvx2;
+#endif
+	default:					return false;
+	}
+}
+
+NoiseVariant NoiseKernels::GetBestVariant()
+{
+	if (IsSupported(NoiseVariant::Avx2)) return NoiseVariant::Avx2;
+	if (IsSupported(NoiseVariant::Sse)) return NoiseVariant::Sse;
+	return NoiseVariant::Scalar;
+}
+
+NoiseBenchmarkResult NoiseKernels::Benchmark(size_t count)
+{
+	NoiseBenchmarkResult result = {};
+	result.samples = count;
+	if (count == 0) return result;
+
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> coordinate(-NOISE_BENCHMARK_EXTENT, NOISE_BENCHMARK_EXTENT);
+
+	std::vector<float> x(count), y(count), z(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = coordinate(random);
+		y[i] = coordinate(random);
+		z[i] = coordinate(random);
+	}
+
+	FbmParameters floor = FloorFbm();
+	size_t repeats = std::max<size_t>(NOISE_BENCHMARK_EVALUATIONS / count, 1);
+	size_t fbmRepeats = std::max<size_t>(NOISE_BENCHMARK_EVALUATIONS / (count * floor.octaves), 1);
+
+	std::vector<float> reference[3] = { std::vector<float>(count), std::vector<float>(count), std::vector<float>(count) };
+	std::vector<float> output(count);
+
+	for (size_t v = 0; v < NOISE_VARIANT_COUNT; v++)
+	{
+		NoiseVariant variant = static_cast<NoiseVariant>(v);
+		result.isAvailable[v] = IsSupported(variant);
+		if (!result.isAvailable[v]) continue;
+
+		// The scalar run fills the references the others are compared with.
+		std::vector<float>* outputs[3];
+		for (int k = 0; k < 3; k++) outputs[k] = (v == 0) ? &reference[k] : &output;
+
+		double noiseTime = MeasureNanoseconds([&]() {
+			for (size_t r = 0; r < repeats; r++) Noise(x.data(), y.data(), z.data(), outputs[0]->data(), count, variant);
+		});
+		if (v > 0) for (size_t i = 0; i < count; i++) result.variantDifference = std::max(result.variantDifference, fabsf(output[i] - reference[0][i]));
+
+		double perlinTime = MeasureNanoseconds([&]() {
+			for (size_t r = 0; r < repeats; r++) Perlin(x.data(), y.data(), outputs[1]->data(), count, variant);
+		});
+		if (v > 0) for (size_t i = 0; i < count; i++) result.variantDifference = std::max(result.variantDifference, fabsf(output[i] - reference[1][i]));
+
+		double fbmTime = MeasureNanoseconds([&]() {
+			for (size_t r = 0; r < fbmRepeats; r++) Fbm(x.data(), y.data(), z.data(), outputs[2]->data(), count, floor, variant);
+		});
+		if (v > 0) for (size_t i = 0; i < count; i++) result.variantDifference = std::max(result.variantDifference, fabsf(output[i] - reference[2][i]));
+
+		result.noisePerNanosecond[v] = count * repeats / std::max(noiseTime, 1.0);
+		result.perlinPerNanosecond[v] = count * repeats / std::max(perlinTime, 1.0);
+		result.fbmPerNanosecond[v] = count * fbmRepeats / std::max(fbmTime, 1.0);
+	}
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (fabsf(reference[0][i] - LibraryNoise(x[i], y[i], z[i])) > NOISE_LIBRARY_TOLERANCE) mismatches++;
+	}
+	result.libraryMismatchRate = static_cast<float>(mismatches) / count;
+
+	return result;
+}
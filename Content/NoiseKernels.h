@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// CPU versions of hash(), noise(), hash2() and perlin() from MathUtils.hlsli, for
+	// baking, collision and checks that have to agree with the shaders.
+	//
+	// Every expression keeps the operation order of the HLSL, and sin() is a fixed
+	// polynomial (range reduction by pi / 4, then the sine or cosine series)
+	// instead of the C library's, so the scalar, SSE and AVX2 variants give the same
+	// bits for the same input. The GPU's sin() is itself an approximation, so the
+	// shaders agree to within its precision rather than bit for bit: the hash
+	// magnifies a last bit difference in sin() about 44000 times, and where that
+	// carries frac() across 1 the corner value jumps between 0 and 1.
+	//
+	// The batch functions take one array per coordinate. The AVX2 variant is only
+	// used when the CPU supports it; SSE2 is part of every x86-64 CPU.
+	//
+	// Only standard C++ and compiler intrinsics are used, so the module builds and
+	// runs on any platform.
+
+	enum class NoiseVariant
+	{
+		Scalar,
+		Sse,
+		Avx2
+	};
+
+	const size_t NOISE_VARIANT_COUNT = 3;
+
+	// Octaves summed by Fbm: amplitude * noise(p * frequency), with the amplitude
+	// multiplied by gain and the frequency by lacunarity after each octave.
+	struct FbmParameters
+	{
+		uint32_t	octaves;
+		float		frequency;
+		float		amplitude;
+		float		lacunarity;
+		float		gain;
+	};
+
+	struct NoiseBenchmarkResult
+	{
+		size_t	samples;
+		bool	isAvailable[NOISE_VARIANT_COUNT];			// Indexed by NoiseVariant.
+		double	noisePerNanosecond[NOISE_VARIANT_COUNT];	// 3D noise samples.
+		double	perlinPerNanosecond[NOISE_VARIANT_COUNT];	// 2D perlin samples.
+		double	fbmPerNanosecond[NOISE_VARIANT_COUNT];		// Fbm samples of FloorFbm's octaves.
+		float	variantDifference;							// Largest difference from the scalar results.
+		float	libraryMismatchRate;						// Share of samples off by more than 0.01 from noise() built on std::sin.
+	};
+
+	class NoiseKernels
+	{
+	public:
+		static float Sin(float x);
+		static float Hash(float n);
+		static float Noise(float x, float y, float z);
+		static float Hash2(float x, float y);
+		static float Perlin(float x, float y);
+		static float Fbm(float x, float y, float z, const FbmParameters& parameters);
+
+		// The eight octaves of FloorSDF in P01_Scene.hlsli.
+		static FbmParameters FloorFbm();
+
+		static void Noise(const float* x, const float* y, const float* z, float* result, size_t count, NoiseVariant variant);
+		static void Perlin(const float* x, const float* y, float* result, size_t count, NoiseVariant variant);
+		static void Fbm(const float* x, const float* y, const float* z, float* result, size_t count,
+			const FbmParameters& parameters, NoiseVariant variant);
+
+		static bool IsSupported(NoiseVariant variant);
+
+		// The fastest variant this CPU supports.
+		static NoiseVariant GetBestVariant();
+
+		// Times every supported variant over count random points, repeated until
+		// about the same work is timed whatever the count.
+		static NoiseBenchmarkResult Benchmark(size_t count);
+	};
+}
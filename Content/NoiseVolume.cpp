@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "NoiseVolume.h"
+#include "NoiseKernels.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Lattice strides of the hash index, as in noise() of MathUtils.hlsli.
+	const float NOISE_STRIDE_Y = 57.0f;
+	const float NOISE_STRIDE_Z = 113.0f;
+
+	const float NOISE_UNORM16_MAX = 65535.0f;
+
+	float Smooth(float t)
+	{
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	float Lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	int Wrap(int i, int size)
+	{
+		int wrapped = i % size;
+		return wrapped < 0 ? wrapped + size : wrapped;
+	}
+}
+
+NoiseVolume::NoiseVolume() :
+	m_size(0)
+{
+}
+
+void NoiseVolume::Generate(uint32_t size)
+{
+	m_size = size;
+	m_texels.resize(static_cast<size_t>(size) * size * size);
+
+	size_t i = 0;
+	for (uint32_t z = 0; z < size; z++)
+	{
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float n = static_cast<float>(x) + static_cast<float>(y) * NOISE_STRIDE_Y + static_cast<float>(z) * NOISE_STRIDE_Z;
+				m_texels[i++] = static_cast<uint16_t>(NoiseKernels::Hash(n) * NOISE_UNORM16_MAX + 0.5f);
+			}
+		}
+	}
+}
+
+float NoiseVolume::Texel(int x, int y, int z) const
+{
+	int size = static_cast<int>(m_size);
+	size_t index = (static_cast<size_t>(Wrap(z, size)) * m_size + Wrap(y, size)) * m_size + Wrap(x, size);
+	return m_texels[index] / NOISE_UNORM16_MAX;
+}
+
+float NoiseVolume::Sample(float x, float y, float z) const
+{
+	if (m_size == 0) return 0.0f;
+
+	float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+	float kx = Smooth(x - fx), ky = Smooth(y - fy), kz = Smooth(z - fz);
+	int ix = static_cast<int>(fx), iy = static_cast<int>(fy), iz = static_cast<int>(fz);
+
+	float a = Texel(ix, iy, iz), b = Texel(ix + 1, iy, iz);
+	float c = Texel(ix, iy + 1, iz), d = Texel(ix + 1, iy + 1, iz);
+	float e = Texel(ix, iy, iz + 1), f = Texel(ix + 1, iy, iz + 1);
+	float g = Texel(ix, iy + 1, iz + 1), h = Texel(ix + 1, iy + 1, iz + 1);
+
+	return Lerp(Lerp(Lerp(a, b, kx), Lerp(c, d, kx), ky),
+		Lerp(Lerp(e, f, kx), Lerp(g, h, kx), ky),
+		kz);
+}
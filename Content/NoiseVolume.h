@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Tiling 3D value noise for the texture path of noise() in MathUtils.hlsli.
+	//
+	// The analytic noise() hashes the eight lattice corners around a point with
+	// sin() and blends them with a smoothstep. Here the lattice values of one
+	// Size x Size x Size tile are hashed once at startup, with NoiseKernels::Hash and
+	// the same n = x + 57y + 113z, and stored as R16_UNORM texels. noiseLookup() in
+	// MathUtils.hlsli then reads them with a single trilinear fetch, the smoothstep
+	// being folded into the texture coordinate. Inside the first tile both paths
+	// agree up to the 16 bit quantisation; beyond it the texture repeats, so lattice
+	// coordinates wrap and the tile edges have to meet without a seam.
+	//
+	// Sample mirrors noiseLookup(), so the volume can be checked without a GPU.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	class NoiseVolume
+	{
+	public:
+		NoiseVolume();
+
+		// Hashes every lattice point of a size^3 tile.
+		void Generate(uint32_t size);
+
+		uint32_t GetSize() const							{ return m_size; }
+
+		// Texels in x, then y, then z order, for an R16_UNORM Texture3D.
+		const std::vector<uint16_t>& GetTexels() const		{ return m_texels; }
+		size_t GetBytes() const								{ return m_texels.size() * sizeof(uint16_t); }
+
+		// The texture path at a point in lattice units, as noiseLookup() computes it.
+		float Sample(float x, float y, float z) const;
+
+	private:
+		float Texel(int x, int y, int z) const;
+
+		std::vector<uint16_t>	m_texels;
+		uint32_t				m_size;
+	};
+}
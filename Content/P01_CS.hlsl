@@ -0,0 +1,121 @@
+// Compute shader path of the P01 ray marcher. Each 8x8 group marches one tile
+// of the screen into marchedColor and marchedDepth, which P01_PS02.hlsl then
+// composes over the scene. Alpha 0 marks the pixels a raster object covers.
+//
+// The tile shares two things in groupshared memory: the farthest ray end under
+// it, and a distance all its rays can start from. The latter comes from one
+// cone enclosing the tile's rays, marched while no surface reaches into it, so
+// the empty water in front is crossed once per tile instead of once per pixel.
+// A tile whose rays all end at raster objects before that distance is left to
+// them without marching. The cone sees none of the bubble field, whose bubbles
+// each pixel starts before instead (see MarchPixel).
+//
+// When checkerboarding, a thread marches every other pixel of its row and writes
+// it packed into the left half of the targets, so a group covers 16x8 pixels.
+
+#include "P01_Scene.hlsli"
+
+static const uint  TILE_SIZE = 8;
+static const int   CONE_MAX_STEPS = 32;
+static const float CONE_MIN_STEP = 0.01;
+
+RWTexture2D<float4> marchedColor : register(u0);
+RWTexture2D<float> marchedDepth : register(u1);
+
+groupshared uint tileEndBits;
+groupshared float tileStart;
+
+/* Distance to the surfaces the marcher steps through, as RayMarching sees them */
+float MarchSDF(float3 p)
+{
+    float d = ObjectsSDF(p).x;
+    if (floorMode == FLOOR_SPHERE_TRACED)
+        d = min(d, FloorSDF(p));
+    return d;
+}
+
+/**
+ * Distance along the axis of the cone through a tile up to which no surface
+ * lies inside it. A ray of the tile at axial distance t is at most t * tanAngle
+ * from the axis, so a step of the axis is safe while the empty sphere around it
+ * holds the step and the cone's widening.
+ */
+float ConeStart(float2 tileMin, float2 tileMax, float2 marchSize)
+{
+    float3 axisViewDir;
+    Ray axis = PrimaryRay(CanvasAt((tileMin + tileMax) * 0.5, marchSize), axisViewDir);
+    
+    float cosAngle = 1.0;
+    for (int c = 0; c < 4; c++)
+    {
+        float2 corner = float2((c & 1) != 0 ? tileMax.x : tileMin.x, (c & 2) != 0 ? tileMax.y : tileMin.y);
+        float3 cornerDir = normalize(float3(CanvasAt(corner, marchSize), -1.0));
+        cosAngle = min(cosAngle, dot(cornerDir, axisViewDir));
+    }
+    float tanAngle = sqrt(max(1.0 - cosAngle * cosAngle, 0.0)) / cosAngle;
+    
+    float t = MIN_DIST;
+    for (int i = 0; i < CONE_MAX_STEPS; i++)
+    {
+        float d = MarchSDF(axis.o + t * axis.d);
+        float advance = (d - t * tanAngle) / (1.0 + tanAngle);
+        if (advance < CONE_MIN_STEP)
+            break;
+        t += advance;
+        if (t >= MAX_DIST)
+            break;
+    }
+    return t;
+}
+
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    // With dynamic resolution only the top left renderSize of the targets is marched
+    uint2 marchSize = uint2(renderSize);
+    uint2 pixel = isCheckerboard ? CheckerboardPixel(dispatchId.xy) : dispatchId.xy;
+    float2 tileSpan = float2(TILE_SIZE << isCheckerboard, TILE_SIZE);
+    
+    bool isInside = all(pixel < marchSize);
+    float2 fragCoord = float2(pixel) + 0.5;
+    float2 canvasXY = CanvasAt(fragCoord, float2(marchSize));
+    
+    if (groupIndex == 0)
+        tileEndBits = 0;
+    GroupMemoryBarrierWithGroupSync();
+    
+    // Ray ends are positive, so their bits order as the floats do
+    if (isInside)
+    {
+        float3 viewDir = normalize(float3(canvasXY, -1.0));
+        InterlockedMax(tileEndBits, asuint(RayEnd(fragCoord / renderScale, viewDir.z)));
+    }
+    
+    if (groupIndex == 0)
+    {
+        float2 tileMin = float2(groupId.xy) * tileSpan;
+        float2 tileMax = min(tileMin + tileSpan, float2(marchSize));
+        tileStart = ConeStart(tileMin, tileMax, float2(marchSize));
+    }
+    GroupMemoryBarrierWithGroupSync();
+    
+    if (!isInside)
+        return;
+    
+    // Every ray of the tile reaches a raster object before any surface
+    float tileEnd = asfloat(tileEndBits);
+    if (tileEnd < MAX_DIST && tileEnd <= tileStart)
+    {
+        marchedColor[dispatchId.xy] = float4(0.0, 0.0, 0.0, 0.0);
+        marchedDepth[dispatchId.xy] = 1.0;
+        return;
+    }
+    
+    float4 color;
+    float depth;
+    if (!MarchPixel(canvasXY, fragCoord, tileStart, color, depth))
+        color = float4(0.0, 0.0, 0.0, 0.0);
+    
+    marchedColor[dispatchId.xy] = color;
+    marchedDepth[dispatchId.xy] = depth;
+}
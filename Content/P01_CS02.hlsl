@@ -0,0 +1,246 @@
+// Checkerboard reconstruction of the P01 ray marcher, the GPU counterpart of
+// CheckerboardReconstruction.cpp. P01_CS.hlsl or P01_PS03.hlsl marched the
+// pixels of this frame's parity, packed into the left half of the marched
+// targets. This pass unpacks them into one of two resolved targets and fills
+// the other pixels from the one it wrote the frame before, which P01_PS02.hlsl
+// then composes over the scene.
+//
+// The eye of the marcher is fixed, so a pixel is reprojected by the rotation
+// from the view to the previous view alone. The reprojected history is kept
+// where it fits the four marched neighbours, as CheckerboardReconstruction.h
+// describes; otherwise the pixel is interpolated along the edge they show.
+
+#include "P01_Scene.hlsli"
+
+static const uint  TILE_SIZE = 8;
+
+// The limits of CheckerboardReconstruction
+static const float DISTANCE_TOLERANCE = 0.05;
+static const float COLOR_MARGIN = 0.02;
+static const float MAX_MOTION = 0.5;
+static const float STILL_MOTION = 0.2;
+
+// Marched this frame, packed, and resolved the frame before
+Texture2D<float4> tracedColor : register(t5);
+Texture2D<float> tracedDepth : register(t6);
+Texture2D<float4> historyColor : register(t7);
+Texture2D<float> historyDepth : register(t8);
+
+RWTexture2D<float4> resolvedColor : register(u0);
+RWTexture2D<float> resolvedDepth : register(u1);
+
+/* View space direction of the ray through a pixel of an image of the given size */
+float3 ViewDirAt(float2 fragCoord, float2 size)
+{
+    return normalize(float3(CanvasAt(fragCoord, size), -1.0));
+}
+
+/* A pixel marched this frame and its distance along the ray; false where a raster object covers it */
+bool LoadTraced(int2 pixel, out float4 color, out float distance)
+{
+    int2 packed = int2(pixel.x >> 1, pixel.y);
+    color = tracedColor.Load(int3(packed, 0));
+    distance = RayDistance(SceneViewDepth(tracedDepth.Load(int3(packed, 0))), ViewDirAt(float2(pixel) + 0.5, renderSize).z);
+    return color.a > 0.0;
+}
+
+/* The same for a texel of the previous frame, along its ray then */
+bool LoadHistory(int2 texel, out float4 color, out float distance)
+{
+    color = historyColor.Load(int3(texel, 0));
+    distance = RayDistance(SceneViewDepth(historyDepth.Load(int3(texel, 0))), ViewDirAt(float2(texel) + 0.5, previousRenderSize).z);
+    return color.a > 0.0;
+}
+
+void Resolve(uint2 pixel, float3 color, float distance, float viewDirZ)
+{
+    resolvedColor[pixel] = float4(color, 1.0);
+    resolvedDepth[pixel] = SceneDepthValue(distance * -viewDirZ);
+}
+
+void ResolveCovered(uint2 pixel)
+{
+    resolvedColor[pixel] = float4(0.0, 0.0, 0.0, 0.0);
+    resolvedDepth[pixel] = 1.0;
+}
+
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID)
+{
+    uint2 pixel = dispatchId.xy;
+    if (any(pixel >= uint2(renderSize)))
+        return;
+    
+    // The marched pixels are unpacked as they are
+    if (((pixel.x + pixel.y) & 1) == parity)
+    {
+        uint2 packed = uint2(pixel.x >> 1, pixel.y);
+        resolvedColor[pixel] = tracedColor.Load(int3(packed, 0));
+        resolvedDepth[pixel] = tracedDepth.Load(int3(packed, 0));
+        return;
+    }
+    
+    float2 fragCoord = float2(pixel) + 0.5;
+    float3 viewDir = ViewDirAt(fragCoord, renderSize);
+    float end = RayEnd(fragCoord / renderScale, viewDir.z);
+    
+    // Left, right, up and down, all of the marched parity
+    static const int2 offsets[4] = { int2(-1, 0), int2(1, 0), int2(0, -1), int2(0, 1) };
+    float4 neighbourColors[4];
+    float neighbourDistances[4];
+    bool isNeighbour[4];
+    uint count = 0;
+    float3 colorMin = 1e30;
+    float3 colorMax = -1e30;
+    float nearest = 1e30;
+    float farthest = 0.0;
+    [unroll]
+    for (int n = 0; n < 4; n++)
+    {
+        int2 neighbour = int2(pixel) + offsets[n];
+        isNeighbour[n] = false;
+        neighbourColors[n] = float4(0.0, 0.0, 0.0, 0.0);
+        neighbourDistances[n] = 0.0;
+        if (all(neighbour >= 0) && all(neighbour < int2(renderSize)))
+            isNeighbour[n] = LoadTraced(neighbour, neighbourColors[n], neighbourDistances[n]);
+    
+        if (isNeighbour[n])
+        {
+            colorMin = min(colorMin, neighbourColors[n].rgb);
+            colorMax = max(colorMax, neighbourColors[n].rgb);
+            nearest = min(nearest, neighbourDistances[n]);
+            farthest = max(farthest, neighbourDistances[n]);
+            count++;
+        }
+    }
+    
+    // The pair of opposite neighbours whose distances differ least, which runs
+    // along an edge rather than across it
+    int pair = -1;
+    float pairSpread = 1e30;
+    float pairDistance = 0.0;
+    [unroll]
+    for (int p = 0; p < 2; p++)
+    {
+        if (isNeighbour[p * 2] && isNeighbour[p * 2 + 1])
+        {
+            float a = neighbourDistances[p * 2];
+            float b = neighbourDistances[p * 2 + 1];
+            float spread = abs(a - b) / min(a, b);
+            if (spread < pairSpread)
+            {
+                pair = p;
+                pairSpread = spread;
+                pairDistance = min(a, b);
+            }
+        }
+    }
+    
+    if (hasHistory)
+    {
+        // Where the ray met the previous image, and how far that is from the pixel
+        float4x4 viewTrans = transpose(view);
+        float3 worldDir = viewDir.x * viewTrans._11_12_13 + viewDir.y * viewTrans._21_22_23 + viewDir.z * viewTrans._31_32_33;
+        float4x4 previousTrans = transpose(previousView);
+        float3 previousDir = float3(dot(worldDir, previousTrans._11_12_13), dot(worldDir, previousTrans._21_22_23),
+            dot(worldDir, previousTrans._31_32_33));
+    
+        bool isReprojected = false;
+        float3 reprojectedColor = 0.0;
+        float reprojectedDistance = 0.0;
+        float motion = 1e30;
+        if (previousDir.z < 0.0)
+        {
+            float2 canvas = previousDir.xy / -previousDir.z / CanvasExtent();
+            float2 p = float2(canvas.x + 1.0, 1.0 - canvas.y) * 0.5 * previousRenderSize - 0.5;
+            motion = length(p + 0.5 - fragCoord * previousRenderSize / renderSize);
+    
+            // Filtered bilinearly over the texels on the surface of the nearest one,
+            // unless the image moves too fast for the blur not to add up
+            int2 nearestTexel = int2(floor(p + 0.5));
+            float4 surfaceColor;
+            float surface;
+            if (motion <= MAX_MOTION && all(nearestTexel >= 0) && all(nearestTexel < int2(previousRenderSize)) &&
+                LoadHistory(nearestTexel, surfaceColor, surface))
+            {
+                int2 base = int2(floor(p));
+                float2 f = p - float2(base);
+                float weightSum = 0.0;
+                [unroll]
+                for (int c = 0; c < 4; c++)
+                {
+                    int2 offset = int2(c & 1, c >> 1);
+                    int2 texel = base + offset;
+                    float4 texelColor;
+                    float texelDistance;
+                    if (all(texel >= 0) && all(texel < int2(previousRenderSize)) && LoadHistory(texel, texelColor, texelDistance) &&
+                        abs(texelDistance - surface) <= surface * DISTANCE_TOLERANCE)
+                    {
+                        float2 bilinear = lerp(1.0 - f, f, float2(offset));
+                        float weight = bilinear.x * bilinear.y;
+                        reprojectedColor += weight * texelColor.rgb;
+                        reprojectedDistance += weight * texelDistance;
+                        weightSum += weight;
+                    }
+                }
+                if (weightSum > 0.0)
+                {
+                    reprojectedColor /= weightSum;
+                    reprojectedDistance /= weightSum;
+                    isReprojected = true;
+                }
+            }
+        }
+    
+        if (isReprojected)
+        {
+            // A raster object has come in front
+            if (end < MAX_DIST && reprojectedDistance >= end)
+            {
+                ResolveCovered(pixel);
+                return;
+            }
+    
+            // Within a surface, or while the camera is still, the history has to lie
+            // between the neighbours; on an edge of a moving image, match the pair along it
+            bool isFitting;
+            if (count == 0)
+                isFitting = true;
+            else if (farthest <= nearest * (1.0 + DISTANCE_TOLERANCE) || motion <= STILL_MOTION)
+                isFitting = reprojectedDistance >= nearest * (1.0 - DISTANCE_TOLERANCE) && reprojectedDistance <= farthest * (1.0 + DISTANCE_TOLERANCE);
+            else
+                isFitting = pair >= 0 && pairSpread <= DISTANCE_TOLERANCE && abs(reprojectedDistance - pairDistance) <= pairDistance * DISTANCE_TOLERANCE;
+    
+            if (isFitting)
+            {
+                if (count > 0)
+                    reprojectedColor = clamp(reprojectedColor, colorMin - COLOR_MARGIN, colorMax + COLOR_MARGIN);
+                Resolve(pixel, reprojectedColor, reprojectedDistance, viewDir.z);
+                return;
+            }
+        }
+    }
+    
+    // Hidden if the raster object is in front of all the neighbours
+    if (count == 0 || (end < MAX_DIST && nearest >= end))
+    {
+        ResolveCovered(pixel);
+        return;
+    }
+    
+    // Otherwise interpolated along the pair chosen above
+    float3 colorSum = 0.0;
+    float distance = 1e30;
+    float used = 0.0;
+    [unroll]
+    for (int m = 0; m < 4; m++)
+    {
+        if (isNeighbour[m] && (pair < 0 || m / 2 == pair))
+        {
+            colorSum += neighbourColors[m].rgb;
+            distance = min(distance, neighbourDistances[m]);
+            used += 1.0;
+        }
+    }
+    Resolve(pixel, colorSum / used, distance, viewDir.z);
+}
@@ -0,0 +1,52 @@
+// Displaces the tessellated floor patches with the heightfield of P01_Scene.hlsli.
+// Only the depth is written, for the ray marcher to stop at.
+
+#define NOISE_VOLUME
+#include "MathUtils.hlsli"
+#include "P01_Floor.hlsli"
+
+cbuffer TerrainTessellationBuffer : register(b0)
+{
+    matrix viewProjection;
+    float3 eye;
+    float referenceY;
+    float2 rootOrigin;
+    float tessellationDensity;
+    float minTessellation;
+    float maxTessellation;
+    float3 padding;
+}
+
+// Grid the vertex positions are snapped to, so that patches sharing an edge
+// displace exactly the same points
+static const float TERRAIN_SNAP = 4096.0;
+
+struct DS_INPUT
+{
+    float3 patch    : PATCH;    // x, z and size
+};
+
+struct DS_OUTPUT
+{
+    float4 pos      : SV_POSITION;
+};
+
+struct QuadTessParam
+{
+    float Edges[4]  : SV_TessFactor;
+    float Inside[2] : SV_InsideTessFactor;
+};
+
+[domain("quad")]
+DS_OUTPUT main(QuadTessParam input,
+    float2 UV : SV_DomainLocation,
+    const OutputPatch<DS_INPUT, 1> patch)
+{
+    DS_OUTPUT output;
+    
+    float2 xz = patch[0].patch.xy + UV * patch[0].patch.z;
+    xz = round(xz * TERRAIN_SNAP) / TERRAIN_SNAP;
+    
+    output.pos = mul(float4(xz.x, FloorSurfaceY(xz), xz.y, 1.0), viewProjection);
+    return output;
+}
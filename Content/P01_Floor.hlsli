@@ -0,0 +1,69 @@
+// Sea floor heightfield shared by the P01 ray marcher and the floor mesh.
+// FloorHeightfield.cpp builds the baked heights, so changes here should be
+// made there as well. Include MathUtils.hlsli with NOISE_VOLUME defined first.
+
+cbuffer NoiseModeBuffer : register(b4)
+{
+    uint useNoiseVolume;
+    float noiseVolumeScale;
+    float2 padding3;
+}
+
+cbuffer FloorHeightfieldBuffer : register(b5)
+{
+    float2 floorOrigin;
+    float floorCellSize;
+    float floorReferenceY;
+    uint floorResolution;
+    uint floorLevelCount;
+    uint floorLowOctaves;
+    uint floorMode;
+    float terrainNear;
+    float terrainFar;
+    float2 padding5;
+}
+
+// Values of floorMode
+static const uint FLOOR_SPHERE_TRACED = 0;
+static const uint FLOOR_HEIGHTFIELD = 1;
+static const uint FLOOR_MESH = 2;
+
+// Baked octaves of the floor at the cell corners (see FloorHeightfield.h)
+Texture2D<float> floorHeights : register(t1);
+
+/* Analytic noise, or the precomputed volume for comparison */
+float sceneNoise(in float3 p)
+{
+    if (useNoiseVolume) return noiseLookup(p, noiseVolumeScale);
+    return noise(p);
+}
+
+/* Floor height of the heightfield: bilinear baked octaves, detail octaves on top */
+float FloorHeight(float2 xz)
+{
+    float2 g = clamp((xz - floorOrigin) / floorCellSize, 0.0, float(floorResolution) - 1e-3);
+    int2 i = int2(g);
+    float2 k = g - float2(i);
+    float a = floorHeights.Load(int3(i, 0));
+    float b = floorHeights.Load(int3(i + int2(1, 0), 0));
+    float c = floorHeights.Load(int3(i + int2(0, 1), 0));
+    float d = floorHeights.Load(int3(i + int2(1, 1), 0));
+    float terrainHeight = lerp(lerp(a, b, k.x), lerp(c, d, k.x), k.y);
+
+    float3 p = float3(xz.x, floorReferenceY, xz.y);
+    float amplitude = 0.5;
+    float frequency = 0.6;
+    for (int o = 0; o < 8; o++)
+    {
+        if (o >= int(floorLowOctaves))
+            terrainHeight += amplitude * sceneNoise(p * frequency);
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+    return terrainHeight;
+}
+
+float FloorSurfaceY(float2 xz)
+{
+    return -(FloorHeight(xz) * 1.13 + 2.5);
+}
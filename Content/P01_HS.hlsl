@@ -0,0 +1,94 @@
+// Tessellation of the floor patches by the distance of each edge from the eye.
+// TerrainQuadtree::GetTessellation computes the same factors on the CPU, so
+// changes here should be made there as well.
+
+#define Control_Points 1
+
+cbuffer TerrainTessellationBuffer : register(b0)
+{
+    matrix viewProjection;
+    float3 eye;
+    float referenceY;
+    float2 rootOrigin;
+    float tessellationDensity;
+    float minTessellation;
+    float maxTessellation;
+    float3 padding;
+}
+
+struct HS_INPUT
+{
+    float3 patch        : PATCH;    // x, z and size
+    uint coarserSides   : SIDES;
+};
+
+struct HS_OUTPUT
+{
+    float3 patch        : PATCH;
+};
+
+struct QuadTessFactors
+{
+    float Edges[4]  : SV_TessFactor;
+    float Inside[2] : SV_InsideTessFactor;
+};
+
+/* Power of two segments for an edge with its middle at xz */
+float EdgeTessellation(float edgeLength, float2 middle)
+{
+    float eyeDistance = max(length(float3(middle.x, referenceY, middle.y) - eye), 1e-3);
+    float segments = edgeLength * tessellationDensity / eyeDistance;
+    return clamp(exp2(ceil(log2(max(segments, 1.0)))), minTessellation, maxTessellation);
+}
+
+QuadTessFactors CalcHSPatchConstants(
+    InputPatch<HS_INPUT, Control_Points> ip,
+    uint PatchID : SV_PrimitiveID)
+{
+    QuadTessFactors Output;
+    float2 corner = ip[0].patch.xy;
+    float size = ip[0].patch.z;
+    
+    // Edges in SV_TessFactor order: -x, -z, +x, +z
+    [unroll]
+    for (uint side = 0; side < 4; side++)
+    {
+        bool isAlongZ = (side & 1) == 0;
+        float across = (side < 2 ? 0.0 : size) + (isAlongZ ? corner.x : corner.y);
+        float start = isAlongZ ? corner.y : corner.x;
+        float origin = isAlongZ ? rootOrigin.y : rootOrigin.x;
+        
+        // Next to a coarser patch, half the tessellation of its edge,
+        // which is the parent's, so the vertices line up
+        float edgeLength = size;
+        float middle = start + size * 0.5;
+        float scale = 1.0;
+        if (ip[0].coarserSides & (1u << side))
+        {
+            edgeLength = size * 2.0;
+            middle = origin + floor((start - origin) / edgeLength) * edgeLength + size;
+            scale = 0.5;
+        }
+        
+        float2 xz = isAlongZ ? float2(across, middle) : float2(middle, across);
+        Output.Edges[side] = EdgeTessellation(edgeLength, xz) * scale;
+    }
+    
+    Output.Inside[0] = max(Output.Edges[1], Output.Edges[3]);
+    Output.Inside[1] = max(Output.Edges[0], Output.Edges[2]);
+    return Output;
+}
+
+[domain("quad")]
+[partitioning("pow2")]
+[outputtopology("triangle_ccw")]
+[outputcontrolpoints(1)]
+[patchconstantfunc("CalcHSPatchConstants")]
+HS_OUTPUT main(
+    InputPatch<HS_INPUT, Control_Points> patch,
+    uint i : SV_OutputControlPointID)
+{
+    HS_OUTPUT Output;
+    Output.patch = patch[i].patch;
+    return Output;
+}
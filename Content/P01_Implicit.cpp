@@ -3,18 +3,117 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
-// Loads vertex and pixel shaders from files and instantiates the cube geometry.
+namespace
+{
+	// Lattice cells along each side of the noise volume, 512 KB at 16 bits.
+	const uint32_t P01_NOISE_VOLUME_SIZE = 64;
+
+	// Canvas height P01_VS.hlsl spans, as the cube it drew before gave it.
+	const float P01_CANVAS_HEIGHT = 1.8f;
+
+	// Fixed eye of the ray marcher in P01_Scene.hlsli, and its MIN_DIST and MAX_DIST,
+	// which bound the depth of the floor mesh.
+	const float P01_EYE[3] = { -2.0f, -1.8f, 5.0f };
+	const float P01_TERRAIN_NEAR = 0.1f;
+	const float P01_TERRAIN_FAR = 50.0f;
+
+	// Values of FloorHeightfieldBuffer::floorMode, cycled with Y.
+	const uint32 P01_FLOOR_SPHERE_TRACED = 0;
+	const uint32 P01_FLOOR_MESH = 2;
+	const uint32 P01_FLOOR_MODE_COUNT = 3;
+
+	// Pixels along each side of a group of P01_CS.hlsl.
+	const UINT P01_TILE_SIZE = 8;
+
+	// GPU time the ray marcher may take with dynamic resolution, half a 60 Hz
+	// frame, the rest being left to the raster pipelines.
+	const double P01_FRAME_BUDGET = 8.0;
+
+	// Step limits of the ray marcher, cycled with 5 and 6, the last being the one
+	// it always had. Relaxed sphere tracing, turned on with 7, lengthens the steps
+	// by P01_MARCH_RELAXATION.
+	const uint32 P01_MARCH_STEP_LIMITS[] = { 16, 32, 64, 96, 128, 192, 255 };
+	const uint32 P01_MARCH_STEP_LIMIT_COUNT = 7;
+	const float P01_MARCH_RELAXATION = 1.3f;
+
+	// Bubbles of the field turned on with 9, and the seed they are placed from.
+	const uint32_t P01_BUBBLE_COUNT = 1024;
+	const uint32_t P01_BUBBLE_SEED = 7;
+}
+
+// Loads the shaders from files and prepares the noise and floor data.
 P01_Implicit::P01_Implicit(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
-	m_indexCount(0),
 	m_waterDepth(3.0f),
+	m_floorBuildMilliseconds(0.0),
+	m_checkerboardBufferData(),
+	m_resolvedIndex(0),
+	m_isCheckerboard(false),
+	m_marchingBufferData(),
+	m_marchStepLimit(P01_MARCH_STEP_LIMIT_COUNT - 1),
+	m_isRelaxedMarching(false),
+	m_isFastCoral(false),
+	m_plantGridBufferData(),
+	m_bubbleFieldBufferData(),
+	m_bubbleTileCapacity(0),
+	m_tileBubbleCapacity(0),
+	m_terrainDepthWidth(0),
+	m_terrainDepthHeight(0),
+	m_marchedWidth(0),
+	m_marchedHeight(0),
+	m_isComputePath(false),
+	m_isDynamicResolution(false),
 	m_deviceResources(deviceResources)
 {
+	m_noiseVolume.Generate(P01_NOISE_VOLUME_SIZE);
+
+	m_noiseModeBufferData.useNoiseVolume = 0;
+	m_noiseModeBufferData.noiseVolumeScale = 1.0f / P01_NOISE_VOLUME_SIZE;
+
+	m_sceneDepthBufferData.useSceneDepth = 1;
+
+	m_floorBuildMilliseconds = m_floorHeightfield.Build();
+
+	m_floorBufferData.origin = XMFLOAT2(m_floorHeightfield.GetOriginX(), m_floorHeightfield.GetOriginZ());
+	m_floorBufferData.cellSize = m_floorHeightfield.GetCellSize();
+	m_floorBufferData.referenceY = m_floorHeightfield.GetReferenceY();
+	m_floorBufferData.resolution = FloorHeightfield::Resolution;
+	m_floorBufferData.levelCount = m_floorHeightfield.GetLevelCount();
+	m_floorBufferData.lowOctaves = FloorHeightfield::LowOctaves;
+	m_floorBufferData.floorMode = P01_FLOOR_SPHERE_TRACED;
+	m_floorBufferData.terrainNear = P01_TERRAIN_NEAR;
+	m_floorBufferData.terrainFar = P01_TERRAIN_FAR;
+
+	m_terrainQuadtree.Build(m_floorHeightfield);
+	m_terrainBufferData.eye = XMFLOAT3(P01_EYE[0], P01_EYE[1], P01_EYE[2]);
+	m_terrainBufferData.referenceY = m_terrainQuadtree.GetReferenceY();
+	m_terrainBufferData.rootOrigin = XMFLOAT2(m_terrainQuadtree.GetOriginX(), m_terrainQuadtree.GetOriginZ());
+	m_terrainBufferData.tessellationDensity = TerrainQuadtree::TessellationDensity;
+	m_terrainBufferData.minTessellation = TerrainQuadtree::MinTessellation;
+	m_terrainBufferData.maxTessellation = TerrainQuadtree::MaxTessellation;
+
+	m_resolutionController.Reset(P01_FRAME_BUDGET);
+	m_renderScaleBufferData.renderSize = XMFLOAT2(0.0f, 0.0f);
+	m_renderScaleBufferData.renderScale = XMFLOAT2(1.0f, 1.0f);
+
+	m_plantGrid.Build(PlantGrid::ScenePlants());
+	m_plantGridBufferData.origin = XMFLOAT2(m_plantGrid.GetOriginX(), m_plantGrid.GetOriginZ());
+	m_plantGridBufferData.columns = m_plantGrid.GetColumns();
+	m_plantGridBufferData.rows = m_plantGrid.GetRows();
+	m_plantGridBufferData.usePlantGrid = 0;
+
+	m_bubbleField.Reset(P01_BUBBLE_COUNT, P01_BUBBLE_SEED);
+	m_bubbleFieldBufferData.useBubbleField = 0;
+	XMStoreFloat4x4(&m_bubbleRotation, XMMatrixIdentity());
+
 	CreateDeviceDependentResources();
 
 	XMVECTOR col = XMVectorSet(0.02, 0.08, 0.2, 0.0f);
@@ -28,8 +127,16 @@ void P01_Implicit::CreateDeviceDependentResources()
 	// Load shaders asynchronously.
 	auto loadPipeline01_VSTask = DX::ReadDataAsync(L"P01_VS.cso");
 	auto loadPipeline01_PSTask = DX::ReadDataAsync(L"P01_PS.cso");
+	auto loadPipeline01_VS02Task = DX::ReadDataAsync(L"P01_VS02.cso");
+	auto loadPipeline01_HSTask = DX::ReadDataAsync(L"P01_HS.cso");
+	auto loadPipeline01_DSTask = DX::ReadDataAsync(L"P01_DS.cso");
+	auto loadPipeline01_CSTask = DX::ReadDataAsync(L"P01_CS.cso");
+	auto loadPipeline01_PS02Task = DX::ReadDataAsync(L"P01_PS02.cso");
+	auto loadPipeline01_PS03Task = DX::ReadDataAsync(L"P01_PS03.cso");
+	auto loadPipeline01_CS02Task = DX::ReadDataAsync(L"P01_CS02.cso");
 
-	// After the vertex shader file is loaded, create the shader and input layout.
+	// After the vertex shader file is loaded, create the shader. It draws the
+	// full-screen triangle from SV_VertexID, so there is no input layout.
 	auto createPipeline01_VSTask = loadPipeline01_VSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateVertexShader(
@@ -39,22 +146,6 @@ void P01_Implicit::CreateDeviceDependentResources()
 				&m_vertexShader
 			)
 		);
-
-		static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		};
-
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateInputLayout(
-				vertexDesc,
-				ARRAYSIZE(vertexDesc),
-				&fileData[0],
-				fileData.size(),
-				&m_inputLayout
-			)
-		);
 		});
 
 	// After the pixel shader file is loaded, create the shader and constant buffer.
@@ -104,82 +195,297 @@ void P01_Implicit::CreateDeviceDependentResources()
 			)
 		);
 
-		});
+		CD3D11_BUFFER_DESC NoiseModeBufferDesc(sizeof(NoiseModeBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&NoiseModeBufferDesc,
+				nullptr,
+				&m_noiseModeBuffer
+			)
+		);
 
-	// Once both shaders are loaded, create the mesh.
-	auto execPipelines = (createPipeline01_PSTask && createPipeline01_VSTask).then([this]() {
+		// The noise lattice as a wrapping, linearly filtered volume.
+		UINT size = m_noiseVolume.GetSize();
+		D3D11_SUBRESOURCE_DATA noiseData = { 0 };
+		noiseData.pSysMem = m_noiseVolume.GetTexels().data();
+		noiseData.SysMemPitch = size * sizeof(uint16_t);
+		noiseData.SysMemSlicePitch = size * size * sizeof(uint16_t);
+		CD3D11_TEXTURE3D_DESC noiseDesc(DXGI_FORMAT_R16_UNORM, size, size, size, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateTexture3D(&noiseDesc, &noiseData, &m_noiseTexture));
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_noiseTexture.Get(), nullptr, &m_noiseTextureView));
 
-		// Cube
+		CD3D11_SAMPLER_DESC noiseSamplerDesc = CD3D11_SAMPLER_DESC(D3D11_DEFAULT);
+		noiseSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+		noiseSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+		noiseSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateSamplerState(&noiseSamplerDesc, &m_noiseSampler));
 
-		// Load mesh vertices. Each vertex has a position and a color.
-		static const VertexPositionColor cubeVertices[] =
+		CD3D11_BUFFER_DESC FloorBufferDesc(sizeof(FloorHeightfieldBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&FloorBufferDesc,
+				nullptr,
+				&m_floorBuffer
+			)
+		);
+
+		// Vertex heights of the floor, read with Load and interpolated in the shader.
+		UINT vertices = FloorHeightfield::Resolution + 1;
+		D3D11_SUBRESOURCE_DATA heightData = { 0 };
+		heightData.pSysMem = m_floorHeightfield.GetHeights().data();
+		heightData.SysMemPitch = vertices * sizeof(float);
+		CD3D11_TEXTURE2D_DESC heightDesc(DXGI_FORMAT_R32_FLOAT, vertices, vertices, 1, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateTexture2D(&heightDesc, &heightData, &m_floorHeightTexture));
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_floorHeightTexture.Get(), nullptr, &m_floorHeightTextureView));
+
+		// The min/max pyramid, one mip level per level.
+		UINT levelCount = m_floorHeightfield.GetLevelCount();
+		std::vector<D3D11_SUBRESOURCE_DATA> boundsData(levelCount);
+		for (UINT level = 0; level < levelCount; level++)
 		{
-			{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.0f, 0.0f, 0.0f)},
-			{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(0.0f, 0.0f, 1.0f)},
-			{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-			{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(0.0f, 1.0f, 1.0f)},
-			{XMFLOAT3(0.5f, -0.5f, -0.5f), XMFLOAT3(1.0f, 0.0f, 0.0f)},
-			{XMFLOAT3(0.5f, -0.5f,  0.5f), XMFLOAT3(1.0f, 0.0f, 1.0f)},
-			{XMFLOAT3(0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 1.0f, 0.0f)},
-			{XMFLOAT3(0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)},
-		};
+			boundsData[level].pSysMem = m_floorHeightfield.GetLevel(level).data();
+			boundsData[level].SysMemPitch = (FloorHeightfield::Resolution >> level) * 2 * sizeof(float);
+			boundsData[level].SysMemSlicePitch = 0;
+		}
+		CD3D11_TEXTURE2D_DESC boundsDesc(DXGI_FORMAT_R32G32_FLOAT, FloorHeightfield::Resolution, FloorHeightfield::Resolution, 1, levelCount, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateTexture2D(&boundsDesc, boundsData.data(), &m_floorBoundsTexture));
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_floorBoundsTexture.Get(), nullptr, &m_floorBoundsTextureView));
+
+		CD3D11_BUFFER_DESC SceneDepthBufferDesc(sizeof(SceneDepthBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&SceneDepthBufferDesc,
+				nullptr,
+				&m_sceneDepthBuffer
+			)
+		);
 
-		D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
-		vertexBufferData.pSysMem = cubeVertices;
-		vertexBufferData.SysMemPitch = 0;
-		vertexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(cubeVertices), D3D11_BIND_VERTEX_BUFFER);
+		CD3D11_BUFFER_DESC MarchingBufferDesc(sizeof(MarchingBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&vertexBufferDesc,
-				&vertexBufferData,
-				&m_vertexBuffer
+				&MarchingBufferDesc,
+				nullptr,
+				&m_marchingBuffer
 			)
 		);
 
-		// Load mesh indices. Each trio of indices represents
-		// a triangle to be rendered on the screen.
-		// For example: 0,2,1 means that the vertices with indexes
-		// 0, 2 and 1 from the vertex buffer compose the 
-		// first triangle of this mesh.
-		static const unsigned short cubeIndices[] =
-		{
-			0,2,1, // -x
-			1,2,3,
+		CD3D11_BUFFER_DESC PlantGridBufferDesc(sizeof(PlantGridBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&PlantGridBufferDesc,
+				nullptr,
+				&m_plantGridBuffer
+			)
+		);
+
+		// The cells and the stalks they list never change.
+		const std::vector<PlantCell>& cells = m_plantGrid.GetCells();
+		D3D11_SUBRESOURCE_DATA cellData = { cells.data(), 0, 0 };
+		CD3D11_BUFFER_DESC cellDesc(
+			static_cast<UINT>(cells.size() * sizeof(PlantCell)),
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_IMMUTABLE,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(PlantCell)
+		);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&cellDesc, &cellData, &m_plantCellBuffer));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC cellViewDesc(m_plantCellBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(cells.size()));
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_plantCellBuffer.Get(), &cellViewDesc, &m_plantCellView));
 
-			4,5,6, // +x
-			5,7,6,
+		const std::vector<PlantInstance>& instances = m_plantGrid.GetCellInstances();
+		D3D11_SUBRESOURCE_DATA instanceData = { instances.data(), 0, 0 };
+		CD3D11_BUFFER_DESC instanceDesc(
+			static_cast<UINT>(instances.size() * sizeof(PlantInstance)),
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_IMMUTABLE,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(PlantInstance)
+		);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&instanceDesc, &instanceData, &m_plantInstanceBuffer));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC instanceViewDesc(m_plantInstanceBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(instances.size()));
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_plantInstanceBuffer.Get(), &instanceViewDesc, &m_plantInstanceView));
+
+		CD3D11_BUFFER_DESC BubbleFieldBufferDesc(sizeof(BubbleFieldBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&BubbleFieldBufferDesc,
+				nullptr,
+				&m_bubbleFieldBuffer
+			)
+		);
 
-			0,1,5, // -y
-			0,5,4,
+		// Room for one tile and every bubble listed once until the first frame
+		// with the field bins them.
+		CreateBubbleBuffers(1, P01_BUBBLE_COUNT);
 
-			2,6,7, // +y
-			2,7,3,
+		// The water behind everything writes the far plane, so it has to pass there.
+		CD3D11_DEPTH_STENCIL_DESC depthDesc = CD3D11_DEPTH_STENCIL_DESC(D3D11_DEFAULT);
+		depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateDepthStencilState(&depthDesc, &m_depthState));
 
-			0,4,6, // -z
-			0,6,2,
+		m_analyticNoiseTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		m_volumeNoiseTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		m_unclampedTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		});
+
+	// The floor mesh: one control point per patch of the quadtree.
+	auto createPipeline01_VS02Task = loadPipeline01_VS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_terrainVertexShader
+			)
+		);
 
-			1,3,7, // +z
-			1,7,5,
+		static const D3D11_INPUT_ELEMENT_DESC patchDesc[] =
+		{
+			{ "PATCH", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "SIDES", 0, DXGI_FORMAT_R32_UINT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		};
 
-		m_indexCount = ARRAYSIZE(cubeIndices);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateInputLayout(
+				patchDesc,
+				ARRAYSIZE(patchDesc),
+				&fileData[0],
+				fileData.size(),
+				&m_terrainInputLayout
+			)
+		);
+
+		// Rewritten every frame with the patches inside the frustum.
+		CD3D11_BUFFER_DESC patchBufferDesc(
+			static_cast<UINT>(m_terrainQuadtree.GetMaxPatchCount() * sizeof(TerrainPatch)),
+			D3D11_BIND_VERTEX_BUFFER,
+			D3D11_USAGE_DYNAMIC,
+			D3D11_CPU_ACCESS_WRITE
+		);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&patchBufferDesc,
+				nullptr,
+				&m_terrainPatchBuffer
+			)
+		);
+		});
+
+	auto createPipeline01_HSTask = loadPipeline01_HSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateHullShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_terrainHullShader
+			)
+		);
 
-		D3D11_SUBRESOURCE_DATA indexBufferData = { 0 };
-		indexBufferData.pSysMem = cubeIndices;
-		indexBufferData.SysMemPitch = 0;
-		indexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC indexBufferDesc(sizeof(cubeIndices), D3D11_BIND_INDEX_BUFFER);
+		CD3D11_BUFFER_DESC TerrainBufferDesc(sizeof(TerrainTessellationBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&indexBufferDesc,
-				&indexBufferData,
-				&m_indexBuffer
+				&TerrainBufferDesc,
+				nullptr,
+				&m_terrainBuffer
+			)
+		);
+		});
+
+	auto createPipeline01_DSTask = loadPipeline01_DSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateDomainShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_terrainDomainShader
 			)
 		);
+
+		// Only depth is written, so both windings are drawn.
+		D3D11_RASTERIZER_DESC terrainRasterizerDesc = CD3D11_RASTERIZER_DESC(D3D11_DEFAULT);
+		terrainRasterizerDesc.CullMode = D3D11_CULL_NONE;
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateRasterizerState(&terrainRasterizerDesc, &m_terrainRasterizerState));
+
+		m_terrainTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
 		});
 
-	// Once the cube is loaded, the object is ready to be rendered.
+	auto createPipeline01_CSTask = loadPipeline01_CSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_computeShader
+			)
+		);
+
+		m_computeTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		});
+
+	auto createPipeline01_PS02Task = loadPipeline01_PS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_composeShader
+			)
+		);
+
+		CD3D11_BUFFER_DESC RenderScaleBufferDesc(sizeof(RenderScaleBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&RenderScaleBufferDesc,
+				nullptr,
+				&m_renderScaleBuffer
+			)
+		);
+		});
+
+	auto createPipeline01_PS03Task = loadPipeline01_PS03Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_marchPixelShader
+			)
+		);
+		});
+
+	auto createPipeline01_CS02Task = loadPipeline01_CS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_reconstructShader
+			)
+		);
+
+		CD3D11_BUFFER_DESC CheckerboardBufferDesc(sizeof(CheckerboardBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&CheckerboardBufferDesc,
+				nullptr,
+				&m_checkerboardBuffer
+			)
+		);
+
+		m_checkerboardTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		});
+
+	// Once all shaders are loaded, the object is ready to be rendered. The
+	// full-screen triangle is made in the vertex shader, without buffers.
+	auto execPipelines = (createPipeline01_PSTask && createPipeline01_VSTask &&
+		createPipeline01_VS02Task && createPipeline01_HSTask && createPipeline01_DSTask &&
+		createPipeline01_CSTask && createPipeline01_PS02Task && createPipeline01_PS03Task &&
+		createPipeline01_CS02Task);
+
 	execPipelines.then([this]() {
 		m_loadingComplete = true;
 		});
@@ -193,6 +499,11 @@ void P01_Implicit::Update(DX::StepTimer const& timer)
 	m_timeBufferData.time = timer.GetTotalSeconds();
 	m_lightBufferData.color = m_waterColor;
 	m_lightBufferData.depth = m_waterDepth;
+
+	if (m_bubbleFieldBufferData.useBubbleField)
+	{
+		m_bubbleField.Update(static_cast<float>(timer.GetElapsedSeconds()));
+	}
 }
 
 // Renders one frame using the vertex and pixel shaders.
@@ -206,6 +517,51 @@ void P01_Implicit::Render()
 
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
+	m_analyticNoiseTimer.Resolve(context);
+	m_volumeNoiseTimer.Resolve(context);
+	m_unclampedTimer.Resolve(context);
+	m_computeTimer.Resolve(context);
+	m_checkerboardTimer.Resolve(context);
+
+	// The marched image goes through the offscreen targets for the compute path,
+	// with dynamic resolution and when checkerboarding. The scale follows the time
+	// of the path in use, checkerboarded or not.
+	bool isOffscreen = m_isComputePath || m_isDynamicResolution || m_isCheckerboard;
+	DX::GpuTimer& pathTimer = m_isCheckerboard ? m_checkerboardTimer : m_isComputePath ? m_computeTimer : GetPixelTimer();
+	if (m_isDynamicResolution)
+	{
+		m_resolutionController.Update(pathTimer.GetMilliseconds());
+	}
+	UpdateRenderScale();
+
+	// The hit threshold of relaxed marching is half a pixel of the render size.
+	m_marchingBufferData.maxMarchingSteps = P01_MARCH_STEP_LIMITS[m_marchStepLimit];
+	m_marchingBufferData.relaxation = m_isRelaxedMarching ? P01_MARCH_RELAXATION : 1.0f;
+	m_marchingBufferData.pixelRadius = m_isRelaxedMarching ? GetCanvasExtents().y / m_renderScaleBufferData.renderSize.y : 0.0f;
+	m_marchingBufferData.useFastCoral = m_isFastCoral ? 1 : 0;
+
+	if (m_bubbleFieldBufferData.useBubbleField)
+	{
+		UploadBubbleField();
+	}
+
+	if (isOffscreen)
+	{
+		D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+		UINT width = static_cast<UINT>(viewport.Width);
+		UINT height = static_cast<UINT>(viewport.Height);
+		if (width != m_marchedWidth || height != m_marchedHeight)
+		{
+			CreateMarchedTargets(width, height);
+		}
+	}
+
+	// The parity marched alternates every frame.
+	m_checkerboardBufferData.isCheckerboard = m_isCheckerboard ? 1 : 0;
+	m_checkerboardBufferData.parity ^= 1;
+
+	CopySceneDepth();
+
 	// Prepare the constant buffer to send it to the graphics device.
 	context->UpdateSubresource1(
 		m_mvpBuffer.Get(),
@@ -247,27 +603,99 @@ void P01_Implicit::Render()
 		0
 	);
 
-	// Each vertex is one instance of the VertexPositionColor struct.
-	UINT stride = sizeof(VertexPositionColor);
-	UINT offset = 0;
+	context->UpdateSubresource1(
+		m_noiseModeBuffer.Get(),
+		0,
+		NULL,
+		&m_noiseModeBufferData,
+		0,
+		0,
+		0
+	);
 
-	context->IASetVertexBuffers(
+	context->UpdateSubresource1(
+		m_floorBuffer.Get(),
 		0,
-		1,
-		m_vertexBuffer.GetAddressOf(),
-		&stride,
-		&offset
+		NULL,
+		&m_floorBufferData,
+		0,
+		0,
+		0
+	);
+
+	context->UpdateSubresource1(
+		m_sceneDepthBuffer.Get(),
+		0,
+		NULL,
+		&m_sceneDepthBufferData,
+		0,
+		0,
+		0
 	);
 
-	context->IASetIndexBuffer(
-		m_indexBuffer.Get(),
-		DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
+	context->UpdateSubresource1(
+		m_renderScaleBuffer.Get(),
+		0,
+		NULL,
+		&m_renderScaleBufferData,
+		0,
+		0,
 		0
 	);
 
+	context->UpdateSubresource1(
+		m_checkerboardBuffer.Get(),
+		0,
+		NULL,
+		&m_checkerboardBufferData,
+		0,
+		0,
+		0
+	);
+
+	context->UpdateSubresource1(
+		m_marchingBuffer.Get(),
+		0,
+		NULL,
+		&m_marchingBufferData,
+		0,
+		0,
+		0
+	);
+
+	context->UpdateSubresource1(
+		m_plantGridBuffer.Get(),
+		0,
+		NULL,
+		&m_plantGridBufferData,
+		0,
+		0,
+		0
+	);
+
+	context->UpdateSubresource1(
+		m_bubbleFieldBuffer.Get(),
+		0,
+		NULL,
+		&m_bubbleFieldBufferData,
+		0,
+		0,
+		0
+	);
+
+	if (m_floorBufferData.floorMode == P01_FLOOR_MESH)
+	{
+		RenderTerrain();
+	}
+
+	// Both paths are timed from the dispatch or the draw to the end of the
+	// composition, for the settings in use.
+	pathTimer.Start(context);
+
+	// The full-screen triangle comes from the vertex ids alone.
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	context->IASetInputLayout(m_inputLayout.Get());
+	context->IASetInputLayout(nullptr);
 
 	// Attach our vertex shader.
 	context->VSSetShader(
@@ -348,33 +776,623 @@ void P01_Implicit::Render()
 		nullptr
 	);
 
-	// Attach our pixel shader.
-	context->PSSetShader(
-		m_pixelShader.Get(),
+	context->PSSetConstantBuffers1(
+		4,
+		1,
+		m_noiseModeBuffer.GetAddressOf(),
 		nullptr,
-		0
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		5,
+		1,
+		m_floorBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		6,
+		1,
+		m_sceneDepthBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		7,
+		1,
+		m_renderScaleBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		8,
+		1,
+		m_checkerboardBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		9,
+		1,
+		m_marchingBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		10,
+		1,
+		m_plantGridBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	context->PSSetConstantBuffers1(
+		11,
+		1,
+		m_bubbleFieldBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
 	);
 
-	// Draw the object.
-	context->DrawIndexed(
-		m_indexCount,
+	context->PSSetShaderResources(0, 1, m_noiseTextureView.GetAddressOf());
+	context->PSSetShaderResources(1, 1, m_floorHeightTextureView.GetAddressOf());
+	context->PSSetShaderResources(2, 1, m_floorBoundsTextureView.GetAddressOf());
+	context->PSSetShaderResources(3, 1, m_terrainDepthView.GetAddressOf());
+	context->PSSetShaderResources(4, 1, m_sceneDepthView.GetAddressOf());
+	context->PSSetShaderResources(9, 1, m_plantCellView.GetAddressOf());
+	context->PSSetShaderResources(10, 1, m_plantInstanceView.GetAddressOf());
+	context->PSSetShaderResources(11, 1, m_bubbleTileView.GetAddressOf());
+	context->PSSetShaderResources(12, 1, m_tileBubbleView.GetAddressOf());
+	context->PSSetSamplers(0, 1, m_noiseSampler.GetAddressOf());
+
+	if (isOffscreen)
+	{
+		if (m_isComputePath)
+		{
+			MarchTiles();
+		}
+		else
+		{
+			MarchPixels();
+		}
+
+		// Compose, and upscale, the marched or reconstructed image instead of
+		// marching here.
+		ID3D11ShaderResourceView* const marchedViews[2] = { m_marchedColorView.Get(), m_marchedDepthView.Get() };
+		ID3D11ShaderResourceView* const resolvedViews[2] = {
+			m_resolvedColorViews[m_resolvedIndex].Get(), m_resolvedDepthViews[m_resolvedIndex].Get()
+		};
+		if (m_isCheckerboard)
+		{
+			ReconstructCheckerboard();
+		}
+		context->PSSetShaderResources(0, 2, m_isCheckerboard ? resolvedViews : marchedViews);
+		context->PSSetShader(m_composeShader.Get(), nullptr, 0);
+	}
+	else
+	{
+		// Attach our pixel shader.
+		context->PSSetShader(
+			m_pixelShader.Get(),
+			nullptr,
+			0
+		);
+	}
+
+	context->OMSetDepthStencilState(m_depthState.Get(), 0);
+
+	context->Draw(3, 0);
+
+	pathTimer.Stop(context);
+
+	context->OMSetDepthStencilState(nullptr, 0);
+
+	// The terrain depth is bound for writing again next frame, and the marched
+	// tiles for the compute shader.
+	ID3D11ShaderResourceView* const noViews[4] = { nullptr, nullptr, nullptr, nullptr };
+	context->PSSetShaderResources(0, 4, noViews);
+
+	// The next frame reprojects into the image resolved in this one, if any.
+	m_checkerboardBufferData.previousView = m_mvpBufferData.view;
+	m_checkerboardBufferData.previousRenderSize = m_renderScaleBufferData.renderSize;
+	m_checkerboardBufferData.hasHistory = m_isCheckerboard ? 1 : 0;
+	if (m_isCheckerboard)
+	{
+		m_resolvedIndex ^= 1;
+	}
+}
+
+// Marches the render size in 8x8 tiles into the marched color and depth, with
+// the same constant buffers and resources as the pixel shader.
+void P01_Implicit::MarchTiles()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// When checkerboarding, a thread marches every other pixel of its row.
+	UINT width = static_cast<UINT>(m_renderScaleBufferData.renderSize.x);
+	UINT height = static_cast<UINT>(m_renderScaleBufferData.renderSize.y);
+	if (m_isCheckerboard)
+	{
+		width = (width + 1) / 2;
+	}
+
+	ID3D11Buffer* const sceneBuffers[12] = {
+		m_mvpBuffer.Get(), m_cameraBuffer.Get(), m_timeBuffer.Get(), m_lightBuffer.Get(),
+		m_noiseModeBuffer.Get(), m_floorBuffer.Get(), m_sceneDepthBuffer.Get(), m_renderScaleBuffer.Get(),
+		m_checkerboardBuffer.Get(), m_marchingBuffer.Get(), m_plantGridBuffer.Get(), m_bubbleFieldBuffer.Get()
+	};
+	ID3D11ShaderResourceView* const objectViews[4] = {
+		m_plantCellView.Get(), m_plantInstanceView.Get(), m_bubbleTileView.Get(), m_tileBubbleView.Get()
+	};
+	ID3D11ShaderResourceView* const sceneViews[5] = {
+		m_noiseTextureView.Get(), m_floorHeightTextureView.Get(), m_floorBoundsTextureView.Get(),
+		m_terrainDepthView.Get(), m_sceneDepthView.Get()
+	};
+	ID3D11UnorderedAccessView* const marchedAccess[2] = { m_marchedColorAccess.Get(), m_marchedDepthAccess.Get() };
+
+	context->CSSetShader(m_computeShader.Get(), nullptr, 0);
+	context->CSSetConstantBuffers1(0, 12, sceneBuffers, nullptr, nullptr);
+	context->CSSetShaderResources(0, 5, sceneViews);
+	context->CSSetShaderResources(9, 4, objectViews);
+	context->CSSetSamplers(0, 1, m_noiseSampler.GetAddressOf());
+	context->CSSetUnorderedAccessViews(0, 2, marchedAccess, nullptr);
+
+	context->Dispatch((width + P01_TILE_SIZE - 1) / P01_TILE_SIZE, (height + P01_TILE_SIZE - 1) / P01_TILE_SIZE, 1);
+
+	// Unbound so the composition can read the tiles and the terrain depth can
+	// be written again.
+	ID3D11UnorderedAccessView* const noAccess[2] = { nullptr, nullptr };
+	ID3D11ShaderResourceView* const noViews[5] = { nullptr, nullptr, nullptr, nullptr, nullptr };
+	context->CSSetUnorderedAccessViews(0, 2, noAccess, nullptr);
+	context->CSSetShaderResources(0, 5, noViews);
+	context->CSSetShader(nullptr, nullptr, 0);
+}
+
+// Marches the render size with the pixel shader into the marched color and
+// depth, with the full-screen triangle and resources Render has set up. When
+// checkerboarding, the viewport is half as wide, as the pixels are packed.
+void P01_Implicit::MarchPixels()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	ID3D11RenderTargetView* const marchedTargets[2] = { m_marchedColorTarget.Get(), m_marchedDepthTarget.Get() };
+	context->OMSetRenderTargets(2, marchedTargets, nullptr);
+
+	float width = m_renderScaleBufferData.renderSize.x;
+	if (m_isCheckerboard)
+	{
+		width = std::ceil(width * 0.5f);
+	}
+	CD3D11_VIEWPORT marchViewport(0.0f, 0.0f, width, m_renderScaleBufferData.renderSize.y);
+	context->RSSetViewports(1, &marchViewport);
+
+	context->PSSetShader(m_marchPixelShader.Get(), nullptr, 0);
+	context->Draw(3, 0);
+
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	context->RSSetViewports(1, &viewport);
+
+	ID3D11RenderTargetView* const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, backBufferTargets, m_deviceResources->GetDepthStencilView());
+}
+
+// Fills the pixels the checkerboard left out, writing the marched and the
+// reconstructed ones into the resolved image of this frame. The other one holds
+// the previous frame's.
+void P01_Implicit::ReconstructCheckerboard()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	UINT width = static_cast<UINT>(m_renderScaleBufferData.renderSize.x);
+	UINT height = static_cast<UINT>(m_renderScaleBufferData.renderSize.y);
+	UINT history = m_resolvedIndex ^ 1;
+
+	ID3D11Buffer* const sceneBuffers[9] = {
+		m_mvpBuffer.Get(), m_cameraBuffer.Get(), m_timeBuffer.Get(), m_lightBuffer.Get(),
+		m_noiseModeBuffer.Get(), m_floorBuffer.Get(), m_sceneDepthBuffer.Get(), m_renderScaleBuffer.Get(),
+		m_checkerboardBuffer.Get()
+	};
+	ID3D11ShaderResourceView* const views[9] = {
+		m_noiseTextureView.Get(), m_floorHeightTextureView.Get(), m_floorBoundsTextureView.Get(),
+		m_terrainDepthView.Get(), m_sceneDepthView.Get(),
+		m_marchedColorView.Get(), m_marchedDepthView.Get(),
+		m_resolvedColorViews[history].Get(), m_resolvedDepthViews[history].Get()
+	};
+	ID3D11UnorderedAccessView* const resolvedAccess[2] = {
+		m_resolvedColorAccess[m_resolvedIndex].Get(), m_resolvedDepthAccess[m_resolvedIndex].Get()
+	};
+
+	// The marched targets are still bound for output after the pixel shader path.
+	ID3D11RenderTargetView* const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, backBufferTargets, m_deviceResources->GetDepthStencilView());
+
+	context->CSSetShader(m_reconstructShader.Get(), nullptr, 0);
+	context->CSSetConstantBuffers1(0, 9, sceneBuffers, nullptr, nullptr);
+	context->CSSetShaderResources(0, 9, views);
+	context->CSSetUnorderedAccessViews(0, 2, resolvedAccess, nullptr);
+
+	context->Dispatch((width + P01_TILE_SIZE - 1) / P01_TILE_SIZE, (height + P01_TILE_SIZE - 1) / P01_TILE_SIZE, 1);
+
+	ID3D11UnorderedAccessView* const noAccess[2] = { nullptr, nullptr };
+	ID3D11ShaderResourceView* const noViews[9] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+	context->CSSetUnorderedAccessViews(0, 2, noAccess, nullptr);
+	context->CSSetShaderResources(0, 9, noViews);
+	context->CSSetShader(nullptr, nullptr, 0);
+}
+
+// Size the ray marcher renders at this frame: the screen, or its part the
+// resolution controller picks.
+void P01_Implicit::UpdateRenderScale()
+{
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	float scale = m_isDynamicResolution ? m_resolutionController.GetScale() : 1.0f;
+
+	float width = std::max(1.0f, std::floor(viewport.Width * scale + 0.5f));
+	float height = std::max(1.0f, std::floor(viewport.Height * scale + 0.5f));
+	m_renderScaleBufferData.renderSize = XMFLOAT2(width, height);
+	m_renderScaleBufferData.renderScale = XMFLOAT2(width / viewport.Width, height / viewport.Height);
+}
+
+// Timer of the pixel shader path for the noise in use, or on its own with the
+// rays running to MAX_DIST.
+DX::GpuTimer& P01_Implicit::GetPixelTimer()
+{
+	if (!IsSceneDepthEnabled())
+	{
+		return m_unclampedTimer;
+	}
+	return IsNoiseVolumeEnabled() ? m_volumeNoiseTimer : m_analyticNoiseTimer;
+}
+
+// Rasterises the floor patches inside the frustum into the terrain depth, seen
+// from the ray marcher's eye. The domain shader displaces them, nothing is shaded.
+void P01_Implicit::RenderTerrain()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	m_terrainTimer.Resolve(context);
+
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	UINT width = static_cast<UINT>(viewport.Width);
+	UINT height = static_cast<UINT>(viewport.Height);
+	if (width != m_terrainDepthWidth || height != m_terrainDepthHeight)
+	{
+		CreateTerrainDepth(width, height);
+	}
+
+	const std::vector<TerrainPatch>& patches = m_terrainQuadtree.GetPatches();
+	D3D11_MAPPED_SUBRESOURCE mappedPatches;
+	DX::ThrowIfFailed(
+		context->Map(m_terrainPatchBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedPatches)
+	);
+	std::copy(patches.begin(), patches.end(), static_cast<TerrainPatch*>(mappedPatches.pData));
+	context->Unmap(m_terrainPatchBuffer.Get(), 0);
+
+	context->UpdateSubresource1(
+		m_terrainBuffer.Get(),
+		0,
+		NULL,
+		&m_terrainBufferData,
+		0,
 		0,
 		0
 	);
+
+	context->ClearDepthStencilView(m_terrainDepthStencilView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	context->OMSetRenderTargets(0, nullptr, m_terrainDepthStencilView.Get());
+
+	UINT stride = sizeof(TerrainPatch);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, m_terrainPatchBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST);
+	context->IASetInputLayout(m_terrainInputLayout.Get());
+
+	context->VSSetShader(m_terrainVertexShader.Get(), nullptr, 0);
+
+	context->HSSetShader(m_terrainHullShader.Get(), nullptr, 0);
+	context->HSSetConstantBuffers1(0, 1, m_terrainBuffer.GetAddressOf(), nullptr, nullptr);
+
+	// The domain shader evaluates the same heightfield as the pixel shader.
+	context->DSSetShader(m_terrainDomainShader.Get(), nullptr, 0);
+	context->DSSetConstantBuffers1(0, 1, m_terrainBuffer.GetAddressOf(), nullptr, nullptr);
+	context->DSSetConstantBuffers1(4, 1, m_noiseModeBuffer.GetAddressOf(), nullptr, nullptr);
+	context->DSSetConstantBuffers1(5, 1, m_floorBuffer.GetAddressOf(), nullptr, nullptr);
+	context->DSSetShaderResources(0, 1, m_noiseTextureView.GetAddressOf());
+	context->DSSetShaderResources(1, 1, m_floorHeightTextureView.GetAddressOf());
+	context->DSSetSamplers(0, 1, m_noiseSampler.GetAddressOf());
+
+	context->GSSetShader(nullptr, nullptr, 0);
+	context->PSSetShader(nullptr, nullptr, 0);
+	context->RSSetState(m_terrainRasterizerState.Get());
+
+	m_terrainTimer.Start(context);
+	context->Draw(static_cast<UINT>(patches.size()), 0);
+	m_terrainTimer.Stop(context);
+
+	ID3D11RenderTargetView* const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, backBufferTargets, m_deviceResources->GetDepthStencilView());
+}
+
+// Copies the depth the raster pipelines left, for the rays to stop at. The depth
+// buffer itself stays bound for the SV_Depth of the hits.
+void P01_Implicit::CopySceneDepth()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> depthResource;
+	m_deviceResources->GetDepthStencilView()->GetResource(&depthResource);
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> depthTexture;
+	DX::ThrowIfFailed(depthResource.As(&depthTexture));
+
+	D3D11_TEXTURE2D_DESC depthDesc;
+	depthTexture->GetDesc(&depthDesc);
+
+	D3D11_TEXTURE2D_DESC copyDesc = { 0 };
+	if (m_sceneDepthTexture) m_sceneDepthTexture->GetDesc(&copyDesc);
+	if (copyDesc.Width != depthDesc.Width || copyDesc.Height != depthDesc.Height)
+	{
+		m_sceneDepthView.Reset();
+		m_sceneDepthTexture.Reset();
+
+		depthDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateTexture2D(&depthDesc, nullptr, &m_sceneDepthTexture));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC depthViewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R24_UNORM_X8_TYPELESS);
+		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_sceneDepthTexture.Get(), &depthViewDesc, &m_sceneDepthView));
+	}
+
+	context->CopyResource(m_sceneDepthTexture.Get(), depthTexture.Get());
+}
+
+// Color and depth of the offscreen paths at the size of the screen, of which the
+// top left render size is used. Alpha 0 marks the pixels left to the raster objects.
+void P01_Implicit::CreateMarchedTargets(UINT width, UINT height)
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	m_marchedColorView.Reset();
+	m_marchedColorTarget.Reset();
+	m_marchedColorAccess.Reset();
+	m_marchedColorTexture.Reset();
+	m_marchedDepthView.Reset();
+	m_marchedDepthTarget.Reset();
+	m_marchedDepthAccess.Reset();
+	m_marchedDepthTexture.Reset();
+
+	CD3D11_TEXTURE2D_DESC colorDesc(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1,
+		D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture2D(&colorDesc, nullptr, &m_marchedColorTexture));
+	DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_marchedColorTexture.Get(), nullptr, &m_marchedColorAccess));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_marchedColorTexture.Get(), nullptr, &m_marchedColorTarget));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_marchedColorTexture.Get(), nullptr, &m_marchedColorView));
+
+	CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_R32_FLOAT, width, height, 1, 1,
+		D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture2D(&depthDesc, nullptr, &m_marchedDepthTexture));
+	DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_marchedDepthTexture.Get(), nullptr, &m_marchedDepthAccess));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_marchedDepthTexture.Get(), nullptr, &m_marchedDepthTarget));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_marchedDepthTexture.Get(), nullptr, &m_marchedDepthView));
+
+	// Two resolved images of the same size for checkerboarding, written in turn.
+	for (int i = 0; i < 2; i++)
+	{
+		m_resolvedColorViews[i].Reset();
+		m_resolvedColorAccess[i].Reset();
+		m_resolvedColorTextures[i].Reset();
+		m_resolvedDepthViews[i].Reset();
+		m_resolvedDepthAccess[i].Reset();
+		m_resolvedDepthTextures[i].Reset();
+
+		CD3D11_TEXTURE2D_DESC resolvedColorDesc(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1,
+			D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE);
+		DX::ThrowIfFailed(device->CreateTexture2D(&resolvedColorDesc, nullptr, &m_resolvedColorTextures[i]));
+		DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_resolvedColorTextures[i].Get(), nullptr, &m_resolvedColorAccess[i]));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_resolvedColorTextures[i].Get(), nullptr, &m_resolvedColorViews[i]));
+
+		CD3D11_TEXTURE2D_DESC resolvedDepthDesc(DXGI_FORMAT_R32_FLOAT, width, height, 1, 1,
+			D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE);
+		DX::ThrowIfFailed(device->CreateTexture2D(&resolvedDepthDesc, nullptr, &m_resolvedDepthTextures[i]));
+		DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_resolvedDepthTextures[i].Get(), nullptr, &m_resolvedDepthAccess[i]));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_resolvedDepthTextures[i].Get(), nullptr, &m_resolvedDepthViews[i]));
+	}
+	m_checkerboardBufferData.hasHistory = 0;
+
+	m_marchedWidth = width;
+	m_marchedHeight = height;
+}
+
+// Depth of the floor mesh at the size of the screen, read back by the ray marcher.
+void P01_Implicit::CreateTerrainDepth(UINT width, UINT height)
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	m_terrainDepthView.Reset();
+	m_terrainDepthStencilView.Reset();
+	m_terrainDepthTexture.Reset();
+
+	CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_R32_TYPELESS, width, height, 1, 1,
+		D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture2D(&depthDesc, nullptr, &m_terrainDepthTexture));
+
+	CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2D, DXGI_FORMAT_D32_FLOAT);
+	DX::ThrowIfFailed(device->CreateDepthStencilView(m_terrainDepthTexture.Get(), &depthStencilViewDesc, &m_terrainDepthStencilView));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC depthViewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R32_FLOAT);
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_terrainDepthTexture.Get(), &depthViewDesc, &m_terrainDepthView));
+
+	m_terrainDepthWidth = width;
+	m_terrainDepthHeight = height;
+}
+
+// Bins the bubbles into tiles of the screen from the marcher's eye, and uploads
+// them with their tiles, growing the buffers when they no longer fit.
+void P01_Implicit::UploadBubbleField()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// The tiles cover the screen, whatever size is marched, since the canvas
+	// does not change with it.
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	UINT columns = (static_cast<UINT>(viewport.Width) + BubbleField::TileSize - 1) / BubbleField::TileSize;
+	UINT rows = (static_cast<UINT>(viewport.Height) + BubbleField::TileSize - 1) / BubbleField::TileSize;
+	XMFLOAT2 canvas = GetCanvasExtents();
+	m_bubbleField.Bin(P01_EYE, &m_bubbleRotation._11, canvas.x, canvas.y, columns, rows,
+		m_marchingBufferData.pixelRadius);
+
+	const std::vector<BubbleTile>& tiles = m_bubbleField.GetTiles();
+	const std::vector<Bubble>& tileBubbles = m_bubbleField.GetTileBubbles();
+	UINT tileCapacity = std::max(m_bubbleTileCapacity, static_cast<UINT>(tiles.size()));
+	UINT bubbleCapacity = std::max(m_tileBubbleCapacity, 1u);
+	while (bubbleCapacity < tileBubbles.size())
+	{
+		bubbleCapacity *= 2;
+	}
+	if (tileCapacity != m_bubbleTileCapacity || bubbleCapacity != m_tileBubbleCapacity)
+	{
+		CreateBubbleBuffers(tileCapacity, bubbleCapacity);
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedTiles;
+	DX::ThrowIfFailed(
+		context->Map(m_bubbleTileBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedTiles)
+	);
+	std::copy(tiles.begin(), tiles.end(), static_cast<BubbleTile*>(mappedTiles.pData));
+	context->Unmap(m_bubbleTileBuffer.Get(), 0);
+
+	D3D11_MAPPED_SUBRESOURCE mappedBubbles;
+	DX::ThrowIfFailed(
+		context->Map(m_tileBubbleBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBubbles)
+	);
+	std::copy(tileBubbles.begin(), tileBubbles.end(), static_cast<Bubble*>(mappedBubbles.pData));
+	context->Unmap(m_tileBubbleBuffer.Get(), 0);
+
+	m_bubbleFieldBufferData.columns = columns;
+	m_bubbleFieldBufferData.rows = rows;
+}
+
+void P01_Implicit::CreateBubbleBuffers(UINT tileCapacity, UINT bubbleCapacity)
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	m_bubbleTileView.Reset();
+	m_bubbleTileBuffer.Reset();
+	m_tileBubbleView.Reset();
+	m_tileBubbleBuffer.Reset();
+
+	CD3D11_BUFFER_DESC tileDesc(
+		tileCapacity * sizeof(BubbleTile),
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_DYNAMIC,
+		D3D11_CPU_ACCESS_WRITE,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(BubbleTile)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&tileDesc, nullptr, &m_bubbleTileBuffer));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC tileViewDesc(m_bubbleTileBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, tileCapacity);
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_bubbleTileBuffer.Get(), &tileViewDesc, &m_bubbleTileView));
+
+	CD3D11_BUFFER_DESC bubbleDesc(
+		bubbleCapacity * sizeof(Bubble),
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_DYNAMIC,
+		D3D11_CPU_ACCESS_WRITE,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(Bubble)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&bubbleDesc, nullptr, &m_tileBubbleBuffer));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC bubbleViewDesc(m_tileBubbleBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, bubbleCapacity);
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_tileBubbleBuffer.Get(), &bubbleViewDesc, &m_tileBubbleView));
+
+	m_bubbleTileCapacity = tileCapacity;
+	m_tileBubbleCapacity = bubbleCapacity;
 }
 
 void P01_Implicit::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
-	m_inputLayout.Reset();
 	m_vertexShader.Reset();
 	m_pixelShader.Reset();
 	m_mvpBuffer.Reset();
 	m_cameraBuffer.Reset();
 	m_timeBuffer.Reset();
 	m_lightBuffer.Reset();
-	m_vertexBuffer.Reset();
-	m_indexBuffer.Reset();
+	m_noiseModeBuffer.Reset();
+	m_noiseTexture.Reset();
+	m_noiseTextureView.Reset();
+	m_noiseSampler.Reset();
+	m_floorBuffer.Reset();
+	m_floorHeightTexture.Reset();
+	m_floorHeightTextureView.Reset();
+	m_floorBoundsTexture.Reset();
+	m_floorBoundsTextureView.Reset();
+	m_terrainVertexShader.Reset();
+	m_terrainHullShader.Reset();
+	m_terrainDomainShader.Reset();
+	m_terrainInputLayout.Reset();
+	m_terrainPatchBuffer.Reset();
+	m_terrainBuffer.Reset();
+	m_terrainRasterizerState.Reset();
+	m_terrainDepthTexture.Reset();
+	m_terrainDepthStencilView.Reset();
+	m_terrainDepthView.Reset();
+	m_terrainDepthWidth = 0;
+	m_terrainDepthHeight = 0;
+	m_terrainTimer.ReleaseDeviceDependentResources();
+	m_sceneDepthBuffer.Reset();
+	m_sceneDepthTexture.Reset();
+	m_sceneDepthView.Reset();
+	m_depthState.Reset();
+	m_unclampedTimer.ReleaseDeviceDependentResources();
+	m_analyticNoiseTimer.ReleaseDeviceDependentResources();
+	m_volumeNoiseTimer.ReleaseDeviceDependentResources();
+	m_computeShader.Reset();
+	m_composeShader.Reset();
+	m_marchedColorTexture.Reset();
+	m_marchedColorAccess.Reset();
+	m_marchedColorTarget.Reset();
+	m_marchedColorView.Reset();
+	m_marchedDepthTexture.Reset();
+	m_marchedDepthAccess.Reset();
+	m_marchedDepthTarget.Reset();
+	m_marchedDepthView.Reset();
+	m_marchedWidth = 0;
+	m_marchPixelShader.Reset();
+	m_renderScaleBuffer.Reset();
+	m_marchedHeight = 0;
+	m_computeTimer.ReleaseDeviceDependentResources();
+	m_reconstructShader.Reset();
+	m_checkerboardBuffer.Reset();
+	for (int i = 0; i < 2; i++)
+	{
+		m_resolvedColorTextures[i].Reset();
+		m_resolvedColorAccess[i].Reset();
+		m_resolvedColorViews[i].Reset();
+		m_resolvedDepthTextures[i].Reset();
+		m_resolvedDepthAccess[i].Reset();
+		m_resolvedDepthViews[i].Reset();
+	}
+	m_checkerboardTimer.ReleaseDeviceDependentResources();
+	m_marchingBuffer.Reset();
+	m_plantGridBuffer.Reset();
+	m_plantCellBuffer.Reset();
+	m_plantCellView.Reset();
+	m_plantInstanceBuffer.Reset();
+	m_plantInstanceView.Reset();
+	m_bubbleFieldBuffer.Reset();
+	m_bubbleTileBuffer.Reset();
+	m_bubbleTileView.Reset();
+	m_tileBubbleBuffer.Reset();
+	m_tileBubbleView.Reset();
+	m_bubbleTileCapacity = 0;
+	m_tileBubbleCapacity = 0;
 }
 
 void P01_Implicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection)
@@ -382,6 +1400,33 @@ void P01_Implicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.view, DirectX::XMMatrixTranspose(view));
 
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.projection, DirectX::XMMatrixTranspose(projection));
+
+	// The floor mesh is seen from the fixed eye with the camera's rotation, through
+	// a projection whose edges pass through the canvas extents, as the rays do.
+	XMMATRIX rotation = view;
+	rotation.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	XMStoreFloat4x4(&m_bubbleRotation, rotation);
+	XMFLOAT2 canvas = GetCanvasExtents();
+	XMMATRIX terrainView = XMMatrixTranslation(-P01_EYE[0], -P01_EYE[1], -P01_EYE[2]) * rotation;
+	XMMATRIX terrainProjection = XMMatrixPerspectiveRH(2.0f * canvas.x * P01_TERRAIN_NEAR, 2.0f * canvas.y * P01_TERRAIN_NEAR,
+		P01_TERRAIN_NEAR, P01_TERRAIN_FAR);
+	XMStoreFloat4x4(&m_terrainViewProjection, terrainView * terrainProjection);
+	XMStoreFloat4x4(&m_terrainBufferData.viewProjection, XMMatrixTranspose(terrainView * terrainProjection));
+
+	m_terrainQuadtree.Update(P01_EYE, &m_terrainViewProjection._11);
+}
+
+// Canvas coordinates at the screen edges, as P01_VS.hlsl and P01_CS.hlsl take
+// them. They keep the extents of the cube the rays were once drawn on: its
+// front face spanned twice the distance to it, so the corners it was given
+// landed outside the screen, and at the edges the canvas reached half of them
+// over the projection scale.
+XMFLOAT2 P01_Implicit::GetCanvasExtents()
+{
+	float scaleX = m_mvpBufferData.projection._11;
+	float scaleY = m_mvpBufferData.projection._22;
+	float aspectRatio = scaleY / scaleX;
+	return XMFLOAT2(aspectRatio / (2.0f * scaleX), P01_CANVAS_HEIGHT / (2.0f * scaleY));
 }
 
 void P01_Implicit::SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition)
@@ -409,6 +1454,67 @@ void P01_Implicit::ProcessInput(DX::StepTimer const& timer)
 		XMStoreFloat3(&m_waterColor, finalCol);
 		m_waterDepth = 3.0f;
 	}
+
+	if (IsKeyToggled(VirtualKey::T))
+	{
+		m_noiseModeBufferData.useNoiseVolume = m_noiseModeBufferData.useNoiseVolume ? 0 : 1;
+	}
+
+	if (IsKeyToggled(VirtualKey::K))
+	{
+		m_sceneDepthBufferData.useSceneDepth = m_sceneDepthBufferData.useSceneDepth ? 0 : 1;
+	}
+
+	if (IsKeyToggled(VirtualKey::U))
+	{
+		m_isComputePath = !m_isComputePath;
+	}
+
+	if (IsKeyToggled(VirtualKey::R))
+	{
+		m_isDynamicResolution = !m_isDynamicResolution;
+		m_resolutionController.Reset(P01_FRAME_BUDGET);
+	}
+
+	if (IsKeyToggled(VirtualKey::X))
+	{
+		m_isCheckerboard = !m_isCheckerboard;
+	}
+
+	if (IsKeyToggled(VirtualKey::Number5) && m_marchStepLimit > 0)
+	{
+		m_marchStepLimit--;
+	}
+
+	if (IsKeyToggled(VirtualKey::Number6) && m_marchStepLimit < P01_MARCH_STEP_LIMIT_COUNT - 1)
+	{
+		m_marchStepLimit++;
+	}
+
+	if (IsKeyToggled(VirtualKey::Number7))
+	{
+		m_isRelaxedMarching = !m_isRelaxedMarching;
+	}
+
+	if (IsKeyToggled(VirtualKey::Number8))
+	{
+		m_isFastCoral = !m_isFastCoral;
+	}
+
+	if (IsKeyToggled(VirtualKey::J))
+	{
+		m_plantGridBufferData.usePlantGrid ^= 1;
+	}
+
+	if (IsKeyToggled(VirtualKey::Number9))
+	{
+		m_bubbleFieldBufferData.useBubbleField ^= 1;
+	}
+
+	if (IsKeyToggled(VirtualKey::Y))
+	{
+		m_floorBufferData.floorMode = (m_floorBufferData.floorMode + 1) % P01_FLOOR_MODE_COUNT;
+	}
 }
 
 bool P01_Implicit::IsKeyPressed(VirtualKey key)
@@ -418,4 +1524,14 @@ bool P01_Implicit::IsKeyPressed(VirtualKey key)
 
 	if ((currentKeyState & keyDownState) == keyDownState) return true;
 	return false;
+}
+
+// True only on the frame the key goes down, so toggles do not repeat while held.
+bool P01_Implicit::IsKeyToggled(VirtualKey key)
+{
+	bool isDown = IsKeyPressed(key);
+	bool wasDown = m_keyWasDown[key];
+	m_keyWasDown[key] = isDown;
+
+	return isDown && !wasDown;
 }
\ No newline at end of file
@@ -2,7 +2,16 @@
 
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
+#include "..\Common\GpuTimer.h"
 #include "ShaderStructures.h"
+#include "NoiseVolume.h"
+#include "FloorHeightfield.h"
+#include "TerrainQuadtree.h"
+#include "ResolutionController.h"
+#include "PlantGrid.h"
+#include "BubbleField.h"
+
+#include <map>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
@@ -14,6 +23,55 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	// Reflective wobbly bubbles.
 	// Underwater plantations.
 	// Underwater coral object (Mandelbulb derivate).
+	//
+	// The noise of the surface, floor, bubbles and caustics is either the analytic
+	// noise() or one fetch from a precomputed tiling NoiseVolume, switched with T.
+	// The draw is timed separately for each path.
+	//
+	// P01 is drawn after the opaque raster pipelines. Its rays stop at their depth,
+	// copied before the draw, and its hits write SV_Depth, so both are composed in
+	// view space. K lets the rays run to MAX_DIST instead, timed on its own.
+	// The rays leave the fixed eye of P01_Scene.hlsli with the camera's rotation,
+	// not from the camera's position, so the depths only agree along each pixel's
+	// ray: a raster object meets a marched surface where it would if seen from the
+	// fixed eye, and the two drift apart as the camera moves. The scene is laid out
+	// around that eye, so it stays; Hi-Z takes its occluders before P01 draws.
+	//
+	// The floor is either sphere traced with the rest of the scene, intersected
+	// first by walking the min/max pyramid of a FloorHeightfield, or rasterised as
+	// a mesh tessellated by distance (TerrainQuadtree), cycled with Y. The mesh
+	// is drawn from the ray marcher's eye into a depth buffer, and the objects are
+	// only marched up to that depth.
+	//
+	// The marcher runs either in a pixel shader over one full-screen triangle, or
+	// in a compute shader over 8x8 tiles that share a cone-marched start distance
+	// and skip tiles covered by raster objects; its image is then composed over
+	// the scene by a second full-screen pass. U switches paths, each timed alone.
+	//
+	// R turns on dynamic resolution: a ResolutionController scales the pixels
+	// either path marches so its GPU time meets a budget, and the composing pass
+	// upscales them with weights from the marched depth.
+	//
+	// X turns on checkerboard rendering: either path marches every other pixel,
+	// alternating each frame, and a compute pass reconstructs the rest from the
+	// previous frame's image, reprojected through the camera's rotation (see
+	// CheckerboardReconstruction.h). Its time is measured on its own against the
+	// full path's; its image error is measured in tests/.
+	//
+	// 7 turns on relaxed sphere tracing, whose hit threshold also widens with the
+	// pixel's cone, and 5 and 6 lower and raise the step limit. The two are
+	// compared on the CPU, through SceneMarcher, in tests/.
+	// 8 gives the coral a trig-free kernel with levels of detail, which
+	// SceneMarcher checks against the formula in tests/ too.
+	//
+	// J takes the kelp through a PlantGrid: its stalks as instances binned into
+	// cells, of which a point evaluates its own cell's alone. The grid is
+	// checked against the loop and against all the stalks in tests/.
+	//
+	// 9 replaces the two animated bubbles with a BubbleField of a thousand,
+	// moved on the CPU each frame and binned into 16x16 pixel tiles of the
+	// screen. Both go up in dynamic structured buffers, and a pixel marches the
+	// bubbles of its own tile alone.
 
 	using namespace Windows::System;
 	using namespace Windows::UI::Core;
@@ -32,16 +90,58 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	private:
 		void ProcessInput(DX::StepTimer const& timer);
 		bool IsKeyPressed(VirtualKey key);
+		bool IsKeyToggled(VirtualKey key);
+		DirectX::XMFLOAT2 GetCanvasExtents();
+		void CreateTerrainDepth(UINT width, UINT height);
+		void RenderTerrain();
+		void CopySceneDepth();
+		void CreateMarchedTargets(UINT width, UINT height);
+		void MarchTiles();
+		void MarchPixels();
+		void ReconstructCheckerboard();
+		void UpdateRenderScale();
+		void UploadBubbleField();
+		void CreateBubbleBuffers(UINT tileCapacity, UINT bubbleCapacity);
+		DX::GpuTimer& GetPixelTimer();
+
+	public:
+		bool IsNoiseVolumeEnabled()						{ return m_noiseModeBufferData.useNoiseVolume != 0; }
+		double GetAnalyticNoiseMilliseconds()			{ return m_analyticNoiseTimer.GetMilliseconds(); }
+		double GetVolumeNoiseMilliseconds()				{ return m_volumeNoiseTimer.GetMilliseconds(); }
+		bool IsSceneDepthEnabled()						{ return m_sceneDepthBufferData.useSceneDepth != 0; }
+		double GetUnclampedMilliseconds()				{ return m_unclampedTimer.GetMilliseconds(); }
+		bool IsComputePathEnabled()						{ return m_isComputePath; }
+		double GetPixelPathMilliseconds()				{ return GetPixelTimer().GetMilliseconds(); }
+		double GetComputePathMilliseconds()				{ return m_computeTimer.GetMilliseconds(); }
+		bool IsDynamicResolutionEnabled()				{ return m_isDynamicResolution; }
+		float GetResolutionScale()						{ return m_resolutionController.GetScale(); }
+		double GetResolutionBudget()					{ return m_resolutionController.GetBudget(); }
+		DirectX::XMFLOAT2 GetRenderSize()				{ return m_renderScaleBufferData.renderSize; }
+		bool IsCheckerboardEnabled()					{ return m_isCheckerboard; }
+		double GetCheckerboardMilliseconds()			{ return m_checkerboardTimer.GetMilliseconds(); }
+		bool IsRelaxedMarchingEnabled()					{ return m_isRelaxedMarching; }
+		uint32 GetMaxMarchingSteps()					{ return m_marchingBufferData.maxMarchingSteps; }
+		bool IsFastCoralEnabled()						{ return m_isFastCoral; }
+		bool IsPlantGridEnabled()						{ return m_plantGridBufferData.usePlantGrid != 0; }
+		uint32 GetPlantStalkCount()						{ return static_cast<uint32>(m_plantGrid.GetInstances().size()); }
+		uint32 GetPlantCellCount()						{ return static_cast<uint32>(m_plantGrid.GetCells().size()); }
+		bool IsBubbleFieldEnabled()						{ return m_bubbleFieldBufferData.useBubbleField != 0; }
+		size_t GetBubbleCount()							{ return m_bubbleField.GetBubbles().size(); }
+		size_t GetTileBubbleCount()						{ return m_bubbleField.GetTileBubbles().size(); }
+		DirectX::XMUINT2 GetBubbleTiles()				{ return DirectX::XMUINT2(m_bubbleFieldBufferData.columns, m_bubbleFieldBufferData.rows); }
+		size_t GetNoiseVolumeBytes()					{ return m_noiseVolume.GetBytes(); }
+		uint32 GetFloorMode()							{ return m_floorBufferData.floorMode; }
+		double GetFloorBuildMilliseconds()				{ return m_floorBuildMilliseconds; }
+		float GetFloorInterpolationError()				{ return m_floorHeightfield.GetInterpolationError(); }
+		size_t GetTerrainPatchCount()					{ return m_terrainQuadtree.GetPatches().size(); }
+		size_t GetTerrainLeafCount()					{ return m_terrainQuadtree.GetLeaves().size(); }
+		double GetTerrainSelectMilliseconds()			{ return m_terrainQuadtree.GetSelectMilliseconds(); }
+		double GetTerrainMilliseconds()					{ return m_terrainTimer.GetMilliseconds(); }
 
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources>		    m_deviceResources;
 
-		// Direct3D resources for primitive geometries.	    
-		Microsoft::WRL::ComPtr<ID3D11InputLayout>	    m_inputLayout;
-		Microsoft::WRL::ComPtr<ID3D11Buffer>		    m_vertexBuffer;
-		Microsoft::WRL::ComPtr<ID3D11Buffer>		    m_indexBuffer;
-
 		// Shader pointers
 		Microsoft::WRL::ComPtr<ID3D11VertexShader>	    m_vertexShader;
 		Microsoft::WRL::ComPtr<ID3D11PixelShader>	    m_pixelShader;
@@ -54,17 +154,129 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_cameraBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_timeBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_lightBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_noiseModeBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_floorBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_sceneDepthBuffer;
 		
 		// System resources for shaders
 		ModelViewProjectionConstantBuffer				m_mvpBufferData;
 		CameraTrackingBuffer							m_cameraBufferData;
 		ElapsedTimeBuffer								m_timeBufferData;
 		LightBuffer										m_lightBufferData;
-		uint32											m_indexCount;
+		NoiseModeBuffer									m_noiseModeBufferData;
+		FloorHeightfieldBuffer							m_floorBufferData;
+		SceneDepthBuffer								m_sceneDepthBufferData;
 
 		DirectX::XMFLOAT3								m_waterColor;
 		float											m_waterDepth;
 
+		// Precomputed noise
+		NoiseVolume										m_noiseVolume;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>			m_noiseTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_noiseTextureView;
+		Microsoft::WRL::ComPtr<ID3D11SamplerState>		m_noiseSampler;
+		DX::GpuTimer									m_analyticNoiseTimer;
+		DX::GpuTimer									m_volumeNoiseTimer;
+
+		// Depth of the raster pipelines, and the test of SV_Depth against it
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_sceneDepthTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_sceneDepthView;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState>	m_depthState;
+		DX::GpuTimer									m_unclampedTimer;
+
+		// Floor heightfield and its min/max pyramid
+		FloorHeightfield								m_floorHeightfield;
+		double											m_floorBuildMilliseconds;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_floorHeightTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_floorHeightTextureView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_floorBoundsTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_floorBoundsTextureView;
+
+		// Tessellated floor mesh and its depth
+		TerrainQuadtree									m_terrainQuadtree;
+		TerrainTessellationBuffer						m_terrainBufferData;
+		DirectX::XMFLOAT4X4								m_terrainViewProjection;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>		m_terrainVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11HullShader>		m_terrainHullShader;
+		Microsoft::WRL::ComPtr<ID3D11DomainShader>		m_terrainDomainShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout>		m_terrainInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_terrainPatchBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_terrainBuffer;
+		Microsoft::WRL::ComPtr<ID3D11RasterizerState>	m_terrainRasterizerState;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_terrainDepthTexture;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	m_terrainDepthStencilView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_terrainDepthView;
+		UINT											m_terrainDepthWidth;
+		UINT											m_terrainDepthHeight;
+		DX::GpuTimer									m_terrainTimer;
+
+		// Compute shader path, its image and depth, and the pass composing them
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_computeShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_composeShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_marchedColorTexture;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_marchedColorAccess;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>	m_marchedColorTarget;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_marchedColorView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_marchedDepthTexture;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_marchedDepthAccess;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>	m_marchedDepthTarget;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_marchedDepthView;
+		UINT											m_marchedWidth;
+		UINT											m_marchedHeight;
+		bool											m_isComputePath;
+		DX::GpuTimer									m_computeTimer;
+
+		// Dynamic resolution of both paths
+		ResolutionController							m_resolutionController;
+		RenderScaleBuffer								m_renderScaleBufferData;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_renderScaleBuffer;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_marchPixelShader;
+		bool											m_isDynamicResolution;
+
+		// Checkerboard rendering of both paths, into two resolved images used in turn
+		CheckerboardBuffer								m_checkerboardBufferData;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_checkerboardBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_reconstructShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_resolvedColorTextures[2];
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_resolvedColorAccess[2];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_resolvedColorViews[2];
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_resolvedDepthTextures[2];
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_resolvedDepthAccess[2];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_resolvedDepthViews[2];
+		UINT											m_resolvedIndex;
+		bool											m_isCheckerboard;
+		DX::GpuTimer									m_checkerboardTimer;
+
+		// Sphere tracing, plain or relaxed, and its step limit
+		MarchingBuffer									m_marchingBufferData;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_marchingBuffer;
+		uint32											m_marchStepLimit;
+		bool											m_isRelaxedMarching;
+		bool											m_isFastCoral;
+
+		// Kelp stalks binned into cells
+		PlantGrid										m_plantGrid;
+		PlantGridBuffer									m_plantGridBufferData;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_plantGridBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_plantCellBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_plantCellView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_plantInstanceBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_plantInstanceView;
+
+		// Simulated bubbles, and their tiles of the screen, uploaded every frame
+		BubbleField										m_bubbleField;
+		BubbleFieldBuffer								m_bubbleFieldBufferData;
+		DirectX::XMFLOAT4X4								m_bubbleRotation;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_bubbleFieldBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_bubbleTileBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_bubbleTileView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_tileBubbleBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_tileBubbleView;
+		UINT											m_bubbleTileCapacity;
+		UINT											m_tileBubbleCapacity;
+
+		std::map<VirtualKey, bool>						m_keyWasDown;
+
 		// Variables used with the rendering loop.
 		bool											m_loadingComplete;
 	};
@@ -0,0 +1,84 @@
+// Composes the marched image of P01_CS.hlsl or P01_PS03.hlsl over the scene,
+// drawn with the full-screen triangle of P01_VS.hlsl.
+//
+// With dynamic resolution the image is smaller than the screen and is upscaled
+// here: the four marched texels around a pixel are blended bilinearly, each
+// weighted by how close its view depth is to that of the nearest texel. The
+// nearest texel decides coverage and depth, so silhouettes against the raster
+// objects and between marched objects stay sharp instead of smearing.
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+    matrix model;
+    matrix view;
+    matrix projection;
+};
+
+cbuffer RenderScaleBuffer : register(b7)
+{
+    float2 renderSize;
+    float2 renderScale;
+}
+
+Texture2D<float4> marchedColor : register(t0);
+Texture2D<float> marchedDepth : register(t1);
+
+// Falloff of the weight with the relative view depth difference
+static const float DEPTH_SHARPNESS = 16.0;
+
+struct PS_INPUT
+{
+    float4 pos : SV_POSITION;
+    float2 canvasXY : TEXCOORD0;
+};
+
+struct PS_OUTPUT
+{
+    float4 color : SV_Target;
+    float depth : SV_Depth;
+};
+
+/* View depth of a depth buffer value, as SceneViewDepth in P01_Scene.hlsli */
+float ViewDepth(float z)
+{
+    return projection._m32 / (z + projection._m22);
+}
+
+PS_OUTPUT main(PS_INPUT input)
+{
+    PS_OUTPUT output;
+    
+    int2 lastTexel = int2(renderSize) - 1;
+    float2 p = input.pos.xy * renderScale - 0.5;
+    int2 base = int2(floor(p));
+    float2 f = p - float2(base);
+    
+    // Alpha 0 marks the pixels a raster object covers
+    int2 nearest = clamp(int2(floor(p + 0.5)), 0, lastTexel);
+    float4 nearestColor = marchedColor.Load(int3(nearest, 0));
+    if (nearestColor.a == 0.0)
+        discard;
+    output.depth = marchedDepth.Load(int3(nearest, 0));
+    float nearestViewDepth = ViewDepth(output.depth);
+    
+    float4 colorSum = float4(0.0, 0.0, 0.0, 0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        int2 texel = clamp(base + offset, 0, lastTexel);
+        float4 color = marchedColor.Load(int3(texel, 0));
+        float viewDepth = ViewDepth(marchedDepth.Load(int3(texel, 0)));
+        
+        float2 bilinear = lerp(1.0 - f, f, float2(offset));
+        float similarity = exp(-DEPTH_SHARPNESS * abs(viewDepth - nearestViewDepth) / nearestViewDepth);
+        float weight = bilinear.x * bilinear.y * similarity * color.a;
+        colorSum += color * weight;
+        weightSum += weight;
+    }
+    
+    output.color = weightSum > 0.0 ? colorSum / weightSum : nearestColor;
+    output.color.a = 1.0;
+    
+    return output;
+}
@@ -0,0 +1,40 @@
+// Pixel shader path of the P01 ray marcher with dynamic resolution. It marches
+// into the same targets as P01_CS.hlsl, at the scaled viewport, and
+// P01_PS02.hlsl upscales them. Alpha 0 marks the pixels a raster object covers.
+//
+// When checkerboarding, the viewport is half as wide and each pixel of it
+// marches every other pixel of its row, packed as P01_CS.hlsl packs them.
+
+#include "P01_Scene.hlsli"
+
+struct PS_INPUT
+{
+    float4 pos : SV_POSITION;
+    float2 canvasXY : TEXCOORD0;
+};
+
+struct PS_OUTPUT
+{
+    float4 color : SV_Target0;
+    float depth : SV_Target1;
+};
+
+PS_OUTPUT main(PS_INPUT input)
+{
+    PS_OUTPUT output;
+    
+    float2 fragCoord = input.pos.xy;
+    float2 canvasXY = input.canvasXY;
+    if (isCheckerboard)
+    {
+        fragCoord = float2(CheckerboardPixel(uint2(input.pos.xy))) + 0.5;
+        if (fragCoord.x >= renderSize.x)
+            discard;
+        canvasXY = CanvasAt(fragCoord, renderSize);
+    }
+    
+    if (!MarchPixel(canvasXY, fragCoord, MIN_DIST, output.color, output.depth))
+        output.color = float4(0.0, 0.0, 0.0, 0.0);
+    
+    return output;
+}
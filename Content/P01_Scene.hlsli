@@ -0,0 +1,1002 @@
+// Scene of the P01 ray marcher, shared by the pixel shader drawn over a full-screen
+// triangle (P01_PS.hlsl) and the compute shader dispatched in tiles (P01_CS.hlsl),
+// and by the checkerboard reconstruction (P01_CS02.hlsl).
+
+#define NOISE_VOLUME
+#include "MathUtils.hlsli"
+#include "P01_Floor.hlsli"
+
+static const float MIN_DIST = 0.1;
+static const float MAX_DIST = 50.0; 
+static const float EPSILON  = 0.003;
+static const float3 EYE = float3(-2.0, -1.8, 5.0);
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+    matrix model;
+    matrix view;
+    matrix projection;
+};
+
+cbuffer CameraTrackingBuffer : register(b1)
+{
+    float3 cameraPosition;
+    float padding;
+}
+
+cbuffer ElapsedTimeBuffer : register(b2)
+{
+    float time;
+    float3 padding2;
+}
+
+cbuffer LightBuffer : register(b3)
+{
+    float3 waterColor;
+    float waterDepth;
+}
+
+// Min/max of the baked floor heights per cell, with one mip level per pyramid
+// level (see FloorHeightfield.h)
+Texture2D<float2> floorBounds : register(t2);
+
+cbuffer SceneDepthBuffer : register(b6)
+{
+    uint useSceneDepth;
+    float3 padding6;
+}
+
+// Size and scale of the pixels marched, below the screen's with dynamic resolution
+cbuffer RenderScaleBuffer : register(b7)
+{
+    float2 renderSize;
+    float2 renderScale;
+}
+
+// Checkerboard rendering: which pixels are marched this frame, and the view and
+// size of the previous frame the others are reprojected into
+cbuffer CheckerboardBuffer : register(b8)
+{
+    matrix previousView;
+    float2 previousRenderSize;
+    uint isCheckerboard;
+    uint parity;
+    uint hasHistory;
+    float3 padding8;
+}
+
+// Sphere tracing of RayMarching: the step limit, the factor steps are relaxed
+// by, 1 for none, the radius of a pixel's cone at distance one, 0 for a fixed
+// EPSILON, and whether the coral takes the fast kernel (see SceneMarcher.h)
+cbuffer MarchingBuffer : register(b9)
+{
+    uint maxMarchingSteps;
+    float relaxation;
+    float pixelRadius;
+    uint useFastCoral;
+}
+
+// The kelp of ObjectsSDF as stalks binned into square cells over xz: where the
+// cells start, how many there are, and whether the kelp is taken through them
+// rather than the loop of PlantsSDF (see PlantGrid.h)
+cbuffer PlantGridBuffer : register(b10)
+{
+    float2 plantGridOrigin;
+    uint plantGridColumns;
+    uint plantGridRows;
+    uint usePlantGrid;
+    float3 padding10;
+}
+
+struct PlantInstance
+{
+    float2 base;
+    float2 rotation; // cos and sin of the turn into the stalk's frame
+    float offsetY;
+    float height;
+    float material;
+    float padding;
+};
+
+struct PlantCell
+{
+    uint first;
+    uint count;
+    float bound; // below the distance to every stalk the cell does not list
+    float padding;
+};
+
+// Cells in rows of increasing z, and the stalks they list, grouped by cell
+StructuredBuffer<PlantCell> plantCells : register(t9);
+StructuredBuffer<PlantInstance> plantInstances : register(t10);
+
+// The bubble field: whether it takes the place of the two BubbleSDF, and the
+// tiles of the screen its bubbles are binned into (see BubbleField.h)
+cbuffer BubbleFieldBuffer : register(b11)
+{
+    uint useBubbleField;
+    uint bubbleColumns;
+    uint bubbleRows;
+    float padding11;
+}
+
+struct Bubble
+{
+    float3 center;
+    float radius;
+};
+
+struct BubbleTile
+{
+    uint first;
+    uint count;
+};
+
+// Tiles in rows from the top of the screen, and the bubbles they list, grouped by tile
+StructuredBuffer<BubbleTile> bubbleTiles : register(t11);
+StructuredBuffer<Bubble> tileBubbles : register(t12);
+
+// The bubbles of the tile of the pixel marched, none until SelectBubbleTile
+static uint bubbleFirst = 0;
+static uint bubbleCount = 0;
+
+// Depth of the floor mesh, rendered by P01_DS.hlsl from the eye of the ray marcher
+Texture2D<float> terrainDepth : register(t3);
+
+// Depth of the raster pipelines drawn before, copied as the depth buffer itself
+// takes SV_Depth
+Texture2D<float> sceneDepth : register(t4);
+
+// Sphere around the set of CoralSDF, and the distance from its centre beyond
+// which FastCoralSDF returns the distance to it
+static const float CORAL_BOUND_RADIUS = 1.11;
+static const float CORAL_BOUND_START = 1.3;
+
+// Levels of detail of FastCoralSDF: the iterations once the hit threshold
+// reaches each footprint, which SceneMarcher::CheckCoral verifies
+static const uint  CORAL_ITERATIONS = 12;
+static const uint  CORAL_LOD_COUNT = 4;
+static const float CORAL_LOD_FOOTPRINTS[CORAL_LOD_COUNT] = { 0.006, 0.008, 0.012, 0.024 };
+static const uint  CORAL_LOD_ITERATIONS[CORAL_LOD_COUNT] = { 8, 5, 4, 3 };
+
+// The slab the stalks stand in, the side of a plant cell, how close a stalk comes
+// to a cell it is not listed in, and the material of the bound, as in PlantGrid
+static const float PLANT_SLAB_BOTTOM = -6.0;
+static const float PLANT_SLAB_TOP = -1.9;
+static const float PLANT_CELL_SIZE = 0.5;
+static const float PLANT_MARGIN = 0.5;
+static const float PLANT_MATERIAL = 5.5;
+
+static const int   FLOOR_MAX_WALK_STEPS = 512;
+static const int   FLOOR_BISECTION_STEPS = 6;
+static const float FLOOR_CELL_NUDGE = 1e-4;
+static const float FLOOR_CELL_BIAS = 1e-2;
+
+struct Ray
+{
+    float3 o; // origin 
+    float3 d; // direction 
+};
+
+struct HitObject
+{
+    int id;
+    float d;
+};
+
+/* Sample noise to create surface waves */
+float SurfaceSDF(float2 p)
+{
+    float surfaceHeight = 0.0;
+    float amplitude = 0.2;
+    float frequency = 0.6;
+    for (int i = 0; i < 4; i++)
+    {
+        float a = sceneNoise(float3(p * frequency + float2(1.0, 1.0) * (time + 1.0) * 0.8, 1.0));
+        a -= sceneNoise(float3(p * frequency + float2(-2.0, -0.8) * time * 0.5, 1.0));
+        surfaceHeight += amplitude * a;
+        amplitude *= 0.8;
+        frequency *= 3.0;
+    }
+    return clamp(0.05 + surfaceHeight * 0.2, 0.0, 0.5);
+}
+
+/* Sample noise to create terrain */
+float FloorSDF(float3 p)
+{
+    // The heightfield and the mesh both stand for the same surface
+    if (floorMode != FLOOR_SPHERE_TRACED)
+        return p.y - FloorSurfaceY(p.xz);
+    
+    float terrainHeight = 0.0;
+    float amplitude = 0.5;
+    float frequency = 0.6;
+    for (int i = 0; i < 8; i++)
+    {
+        terrainHeight += amplitude * sceneNoise(p * frequency);
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+    
+    // Calculate the distance to the floor of the terrain
+    float distToFloor = p.y + (terrainHeight * 1.13 + 2.5);
+    return distToFloor;
+}
+
+/** 
+ * Signed distance functions for implicitly modeling a wobbly bubble
+ */ 
+float BubbleSDF(float3 p, float t)
+{
+    /* Animation based on 
+    https://www.shadertoy.com/view/WtfyWj */
+    
+    float maxDepth = 4.2;
+    float progress = pow(min(frac(t * 0.01) * 4.5, 1.0), 2.0);
+    float depth = maxDepth * (0.8 - progress * progress);
+    
+    float r = lerp(0.01, 0.09, progress);
+    float d = 2.0 - smoothstep(0.0, 1.0, min(progress * 5.0, 1.0)) * 0.3;
+    
+    // Apply noise function to make the bubble wobbly
+    float3 offset = float3(0.0, 0.0, 0.0);
+    offset.x = sceneNoise(p * 0.8 + float3(t * 0.5, 0.0, 0.0)) * 0.2;
+    offset.y = sceneNoise(p * 0.6 + float3(0.0, t * 0.5, 0.0)) * 0.2;
+    offset.z = sceneNoise(p * 0.7 + float3(0.0, 0.0, t * 0.5)) * 0.2;
+    p += offset;
+    
+    return sqrt(dot(p + float3(d, depth, -1.0 + 0.2 * progress * sin(progress * 10.0)),
+    p + float3(d, depth, -1.0 + 0.2 * progress * sin(progress * 10.0)))) - r;
+}
+
+/* The bubbles of the field listed in the tile of the pixel marched */
+float BubbleFieldSDF(float3 p)
+{
+    float d = 1e10;
+    [loop]
+    for (uint i = bubbleFirst; i < bubbleFirst + bubbleCount; i++)
+    {
+        Bubble b = tileBubbles[i];
+        d = min(d, length(p - b.center) - b.radius);
+    }
+    return d;
+}
+
+/* Distance along a ray from the eye before which it cannot come within the hit
+   threshold of a bubble of its tile */
+float BubbleTileStart()
+{
+    float start = MAX_DIST;
+    [loop]
+    for (uint i = bubbleFirst; i < bubbleFirst + bubbleCount; i++)
+    {
+        Bubble b = tileBubbles[i];
+        start = min(start, (length(b.center - EYE) - b.radius - EPSILON) / (1.0 + pixelRadius));
+    }
+    return max(start, MIN_DIST);
+}
+
+float CylinderSDF(float3 p, float h, float r)
+{
+    p.y -= clamp(p.y, 0.0, h);
+    return sqrt(dot(p, p)) - r;
+}
+
+/** 
+* Signed distance functions for implicitly modeling plants
+* Based on https://www.shadertoy.com/view/WtfyWj
+**/ 
+float PlantSDF(float3 p, float h)
+{
+    float r = 0.04 * -(p.y + 2.5) - 0.005 * pow(sin(p.y * 10.0), 4.0);
+    p.z += sin(time * 0.5 + h) * pow(0.2 * (p.y + 5.6), 3.0);
+    return CylinderSDF(p + float3(0.0, 5.7, 0.0), 5.0 * h, r);
+}
+
+float PlantsSDF(float3 p)
+{
+    float3 dd = float3(-0.3, -0.5, -0.5);
+    // Make multiple copies, each one displaced and rotated.
+    float d = 1e10;
+    for (int i = 0; i < 8; i++)
+    {
+        d = min(d, min(PlantSDF(p, 0.0), min(PlantSDF(p + dd.xyx, 5.0), PlantSDF(p + dd, 3.0))));
+        p.x -= 0.01;
+        p.z -= 0.06;
+        p.xz = mul(p.xz, rot(0.7));
+    }
+    return d;
+}
+
+/* The kelp of the three PlantsSDF through the plant grid: the stalks listed in
+   the cell of p, and the cell's bound for the others */
+float2 PlantGridSDF(float3 p)
+{
+    // How far p is above or below the slab, negative within it
+    float gap = max(PLANT_SLAB_BOTTOM - p.y, p.y - PLANT_SLAB_TOP);
+    
+    float2 cell = (p.xz - plantGridOrigin) / PLANT_CELL_SIZE;
+    float2 gridSize = float2(plantGridColumns, plantGridRows);
+    if (any(cell < 0.0) || any(cell >= gridSize))
+    {
+        float2 outside = max(max(-cell, cell - gridSize), 0.0) * PLANT_CELL_SIZE;
+        return float2(max(gap, length(outside) + PLANT_MARGIN), PLANT_MATERIAL);
+    }
+    
+    PlantCell c = plantCells[uint(cell.y) * plantGridColumns + uint(cell.x)];
+    float2 d = float2(max(gap, c.bound), PLANT_MATERIAL);
+    [loop]
+    for (uint i = c.first; i < c.first + c.count; i++)
+    {
+        PlantInstance s = plantInstances[i];
+        float2 q = p.xz - s.base;
+        float3 stalk = float3(q.x * s.rotation.x - q.y * s.rotation.y, p.y + s.offsetY, q.x * s.rotation.y + q.y * s.rotation.x);
+        d = min(float2(PlantSDF(stalk, s.height), s.material), d);
+    }
+    return d;
+}
+
+/**
+ * Signed distance functions for implicitly modeling a coral object 
+ * Based on https://www.shadertoy.com/view/XsfGR8
+ **/
+float CoralSDF(float3 p)
+{
+    float3 zn = float3(p.xyz);
+    float radius = 0.0;
+    float hit = 0.0;
+    float n = 12; //9;
+    float d = 2.0;
+    for (int i = 0; i < 12; i++) //18
+    {
+        radius = sqrt(dot(zn, zn));
+        if (radius > 2.0)
+        {
+            hit = 0.5 * log(radius) * radius / d;
+        }
+        else
+        {
+            float rado = pow(radius, 8.0);
+            float theta = atan2(length(zn.xy), zn.z);
+            float phi = atan2(zn.y, zn.x);
+            d = pow(radius, 7.0) * 7.0 * d + 1.0;
+
+            float sint = sin(theta * n);
+            zn.x = rado * sint * cos(phi * n);
+            zn.y = rado * sint * sin(phi * n);
+            zn.z = rado * cos(theta * n);
+            zn += p;
+        }
+    }
+    return hit;
+}
+
+/* A unit complex number to the twelfth power, by squaring */
+float2 Power12(float2 w)
+{
+    float2 w2 = float2(w.x * w.x - w.y * w.y, 2.0 * w.x * w.y);
+    float2 w4 = float2(w2.x * w2.x - w2.y * w2.y, 2.0 * w2.x * w2.y);
+    float2 w8 = float2(w4.x * w4.x - w4.y * w4.y, 2.0 * w4.x * w4.y);
+    return float2(w8.x * w4.x - w8.y * w4.y, w8.x * w4.y + w8.y * w4.x);
+}
+
+/**
+ * CoralSDF without trigonometry or pow: the angles are multiplied by raising
+ * their unit complex numbers to the twelfth power. It stops at the first
+ * iteration that escapes, and beyond CORAL_BOUND_START returns the distance
+ * to the bounding sphere, which is the longer step there.
+ */
+float FastCoralSDF(float3 p, uint iterations)
+{
+    float r2 = dot(p, p);
+    if (r2 > CORAL_BOUND_START * CORAL_BOUND_START)
+        return sqrt(r2) - CORAL_BOUND_RADIUS;
+    
+    float3 zn = p;
+    float d = 2.0;
+    for (uint i = 0; i < iterations; i++)
+    {
+        r2 = dot(zn, zn);
+        float radius = sqrt(r2);
+        if (r2 > 4.0)
+            return 0.5 * log(radius) * radius / d;
+        
+        float r7 = r2 * r2 * r2 * radius;
+        d = r7 * 7.0 * d + 1.0;
+        
+        // cos and sin of phi and theta, which atan2 gives as 0 at the origin
+        float xy = length(zn.xy);
+        float2 phi = xy > 0.0 ? zn.xy / xy : float2(1.0, 0.0);
+        float2 theta = radius > 0.0 ? float2(zn.z, xy) / radius : float2(1.0, 0.0);
+        phi = Power12(phi);
+        theta = Power12(theta);
+        
+        zn = r7 * radius * float3(theta.y * phi, theta.x) + p;
+    }
+    return 0.0;
+}
+
+/* Iterations of FastCoralSDF for the hit threshold at a point */
+uint CoralIterations(float footprint)
+{
+    uint iterations = CORAL_ITERATIONS;
+    [unroll]
+    for (uint level = 0; level < CORAL_LOD_COUNT; level++)
+    {
+        if (footprint >= CORAL_LOD_FOOTPRINTS[level])
+            iterations = CORAL_LOD_ITERATIONS[level];
+    }
+    return iterations;
+}
+
+/* The coral of the scene, from the formula or the fast kernel */
+float SceneCoralSDF(float3 p, uint iterations)
+{
+    return useFastCoral ? FastCoralSDF(p, iterations) : CoralSDF(p);
+}
+
+/* Everything but the floor, which the heightfield walk can intersect on its own */
+float2 ObjectsSDF(float3 p)
+{
+    float3 pp = p;
+    pp.xz = mul(pp.xz, rot(-.5));
+    
+    float d = -p.y - SurfaceSDF(p.xz);
+    float t = time * 0.6;
+    d += (0.5 + 0.5 * (sin(p.z * 0.2 + t) + sin((p.z + p.x) * 0.1 + t * 2.0))) * 0.4;
+    
+    // The coral loses iterations where the hit threshold hides the difference
+    uint coralIterations = CoralIterations(max(EPSILON, length(p - EYE) * pixelRadius));
+    
+    // The field's bubbles of the pixel's tile, or the two animated ones
+    float2 bubbles;
+    if (useBubbleField)
+        bubbles = float2(BubbleFieldSDF(p), 4.5);
+    else
+        bubbles = min(float2(BubbleSDF(pp, time - 0.8), 4.5), float2(BubbleSDF(pp, time), 4.5));
+    
+    // The kelp's stalks near p alone, or all 72 of them
+    if (usePlantGrid)
+    {
+        return min(float2(d, 1.5),
+               min(PlantGridSDF(p),
+               min(float2(SceneCoralSDF(p - float3(-4.0, -2.4, 1.0), coralIterations), 7.5),
+               min(float2(SceneCoralSDF(p - float3(-2.0, -2.8, -2.8), coralIterations), 6.5),
+                   bubbles))));
+    }
+    
+    return min(float2(d, 1.5),
+           min(float2(PlantsSDF(p - float3(0.0, 0.0, 0.0)), 5.5),
+           min(float2(PlantsSDF(p - float3(1.0, 0.0, -0.5)), 5.5),
+           min(float2(SceneCoralSDF(p - float3(-4.0, -2.4, 1.0), coralIterations), 7.5),
+           min(float2(PlantsSDF(p - float3(-2.5, 0.0, -1.3)), 8.5),
+           min(float2(SceneCoralSDF(p - float3(-2.0, -2.8, -2.8), coralIterations), 6.5),
+               bubbles))))));
+}
+
+/**
+ * Signed distance function describing the scene.
+ * Based on https://www.shadertoy.com/view/WtfyWj
+ * Absolute value of the return value indicates the distance to the surface.
+ * Sign indicates whether the point is inside or outside the surface,
+ * negative indicating inside.
+ */
+float2 SceneSDF(float3 p)
+{
+    return min(float2(FloorSDF(p), 3.5), ObjectsSDF(p));
+}
+
+/**
+ * Adv. effects:
+ * Caustics, God Rays and Ambient Occlusion
+ * 
+ * Caustics based on https://www.shadertoy.com/view/WdByRR 
+ * 
+ * God rays and Ambient Occlusion 
+ * based on https://www.shadertoy.com/view/WtfyWj
+ */
+float Caustics(float3 p)
+{
+    return abs(sceneNoise(p + fmod(time * 0.5, 40.0) * 2.0) - sceneNoise(p + float3(4.0, 0.0, 4.0) + fmod(time * 0.5, 40.0) * 1.0));
+}
+
+float GodRays(float3 p, float3 lightPos)
+{
+    float3 lightDir = normalize(lightPos - p);
+    float3 sp = p + lightDir * -p.y;
+    float f = 1.0 - clamp(SurfaceSDF(sp.xz) * 10.0, 0.0, 1.0);
+    f *= 1.0 - length(lightDir.xz);
+    return smoothstep(0.2, 1.0, f * 0.7);
+}
+
+float CastLightBeam(float3 ro, float3 rd, float3 light, float hitDist)
+{
+    // March through the scene, accumulating god rays.
+    float3 p = ro;
+    float3 st = rd * hitDist / 96.0;
+    float god = 0.0;
+    for (int i = 0; i < 96; i++)
+    {
+        float distFromGodLight = 1.0 - GodRays(p, light);
+        god += GodRays(p, light);
+        p += st;
+    }
+    god /= 96.0;
+    return smoothstep(0.0, 1.0, min(god, 1.0));
+}
+
+float AmbientOcclusion(float3 p, float3 n)
+{
+    const float dist = 0.5;
+    return smoothstep(0.0, 1.0, 1.0 - (dist - SceneSDF(p + n * dist).x));
+}
+
+float3 EstimateNormal(float3 p)
+{
+    float2 e = float2(1.0, -1.0) * 0.0025;
+    return normalize(e.xyy * SceneSDF(p + e.xyy).x +
+					 e.yyx * SceneSDF(p + e.yyx).x +
+					 e.yxy * SceneSDF(p + e.yxy).x +
+					 e.xxx * SceneSDF(p + e.xxx).x);
+}
+
+/* Bisects a step of the floor walk that ended below the floor surface */
+float FloorBisect(Ray ray, float above, float below)
+{
+    for (int i = 0; i < FLOOR_BISECTION_STEPS; i++)
+    {
+        float middle = (above + below) * 0.5;
+        float3 p = ray.o + middle * ray.d;
+        if (p.y > FloorSurfaceY(p.xz))
+            above = middle;
+        else
+            below = middle;
+    }
+    return (above + below) * 0.5;
+}
+
+/**
+ * Floor intersection by walking the min/max pyramid of the heightfield,
+ * as FloorHeightfield::Intersect does on the CPU.
+ * Returns end if the ray misses the floor.
+ */
+float FloorIntersect(Ray ray, float start, float end)
+{
+    int top = int(floorLevelCount) - 1;
+    int level = top;
+    float t = start;
+    int steps = 0;
+    
+    while (t < end && steps < FLOOR_MAX_WALK_STEPS)
+    {
+        steps++;
+        float3 p = ray.o + t * ray.d;
+        float2 g = (p.xz - floorOrigin) / floorCellSize + sign(ray.d.xz) * FLOOR_CELL_BIAS;
+        if (any(g < 0.0) || any(g >= float(floorResolution)))
+            break;
+        
+        // The cell of this level that holds the ray, and where the ray leaves it
+        uint2 cell = uint2(g) >> level;
+        float size = floorCellSize * float(1u << level);
+        float2 edge = floorOrigin + float2(cell) * size + step(0.0, ray.d.xz) * size;
+        float2 exits = abs(ray.d.xz) > 1e-6 ? (edge - ray.o.xz) / ray.d.xz : end;
+        float leave = min(min(exits.x, exits.y), end);
+        
+        // The lowest baked height gives the highest surface, as the detail only deepens it
+        float highest = -(floorBounds.Load(int3(cell, level)).x * 1.13 + 2.5);
+        float exitY = ray.o.y + leave * ray.d.y;
+        
+        if (min(p.y, exitY) > highest)
+        {
+            t = leave + FLOOR_CELL_NUDGE;
+            level = min(level + 1, top);
+            continue;
+        }
+        if (level > 0)
+        {
+            level--;
+            continue;
+        }
+        
+        // Step by the height above the surface, bisecting a step that ends below it
+        float above = t;
+        float gap = p.y - FloorSurfaceY(p.xz);
+        steps++;
+        while (gap >= EPSILON && above < leave && steps < FLOOR_MAX_WALK_STEPS)
+        {
+            float next = min(above + gap, leave);
+            float3 q = ray.o + next * ray.d;
+            gap = q.y - FloorSurfaceY(q.xz);
+            steps++;
+            if (gap < 0.0)
+                return FloorBisect(ray, above, next);
+            above = next;
+        }
+        if (gap < EPSILON)
+            return above;
+        t = leave + FLOOR_CELL_NUDGE;
+    }
+    return end;
+}
+
+/**
+ * Distance along the ray at which it reaches a view depth.
+ * viewDirZ is the view space z of the normalised ray.
+ */
+float RayDistance(float viewDepth, float viewDirZ)
+{
+    return viewDepth / -viewDirZ;
+}
+
+/**
+ * Distance along the ray to the floor mesh, from the depth P01_DS.hlsl wrote
+ * under this pixel. Returns MAX_DIST where the mesh was not drawn.
+ */
+float TerrainDistance(float2 screenCoord, float viewDirZ)
+{
+    float z = terrainDepth.Load(int3(screenCoord, 0));
+    if (z >= 1.0)
+        return MAX_DIST;
+    float viewDepth = terrainNear * terrainFar / (terrainFar - z * (terrainFar - terrainNear));
+    return RayDistance(viewDepth, viewDirZ);
+}
+
+/**
+ * View depth of a value in the scene depth buffer, and back, through the
+ * projection of the raster pipelines. The ray marcher keeps its own eye, so
+ * both are composed in view space: the SV_Depth written is the distance from
+ * EYE, not from the camera, and only orders the marched surfaces against the
+ * raster objects along the same pixel.
+ */
+float SceneViewDepth(float z)
+{
+    return projection._m32 / (z + projection._m22);
+}
+
+float SceneDepthValue(float viewDepth)
+{
+    return projection._m32 / viewDepth - projection._m22;
+}
+
+/**
+ * Ray Marching
+ * Unless it is sphere traced, the floor was hit at floorDepth already,
+ * and only the other objects are marched up to it.
+ * Steps are relaxed, and the hit threshold grows with the pixel's cone,
+ * as MarchingBuffer sets.
+ */
+HitObject RayMarching(Ray ray, float start, float end, float floorDepth)
+{
+    HitObject object;
+    
+    object.id = 0;
+    float depth = start;
+    float outside = 1.0; // Tracks inside and outside of bubble (for refraction)
+    
+    bool isFloorHit = floorDepth < end;
+    end = min(end, floorDepth);
+    
+    float omega = relaxation;
+    float previousRadius = 0.0;
+    float stepLength = 0.0;
+    
+    [loop]
+    for (uint i = 0; i < maxMarchingSteps; i++)
+    {
+        float3 p = ray.o + depth * ray.d;
+        float2 dist = ObjectsSDF(p);
+        if (floorMode == FLOOR_SPHERE_TRACED)
+            dist = min(float2(FloorSDF(p), 3.5), dist);
+        float radius = abs(dist.x);
+        
+        // The spheres of this point and the last do not overlap, so a surface may
+        // lie between: step back to where the plain step would have ended
+        if (omega > 1.0 && radius + previousRadius < stepLength)
+        {
+            stepLength -= omega * stepLength;
+            omega = 1.0;
+        }
+        else
+        {
+            if (dist.x < max(EPSILON, depth * pixelRadius))
+            {
+                if (dist.y == 4.5)
+                {
+                    // Bubble refraction based on https://www.shadertoy.com/view/WtfyWj
+                    ray.d = refract(ray.d, EstimateNormal(ray.o + depth * ray.d) * sign(outside), 1.0);
+                    outside *= -1.0;
+                    previousRadius = 0.0;
+                    stepLength = 0.0;
+                    continue;
+                }
+                object.d = depth;
+                object.id = int(dist.y);
+                
+                return object;
+            }
+            stepLength = dist.x * omega;
+        }
+        previousRadius = radius;
+        depth += stepLength;
+        if (depth >= end)
+            break;
+    }
+    object.d = end;
+    if (isFloorHit)
+        object.id = 3;
+    return object;
+}
+
+/* Lighting, Shadows and Visual Effects */
+float3 Shading(HitObject hObj, float3 n, float3 p, float3 l)
+{
+    float3 texColor = float3(0.15, 0.25, 0.6);
+
+    if (hObj.id == 1) // Sea
+    {
+        n.y = -n.y;
+    }
+    else
+    {
+        if (hObj.id == 3)  // Sand
+        {
+            texColor += float3(0.1, 0.1, 0.0);
+        }
+        else if (hObj.id == 6) // Coral back
+        {
+            texColor += float3(1.12, 0.25, .15) * 0.7;
+        }
+        else if (hObj.id == 7) // Coral  front
+        {
+            texColor += float3(1.32, 0.35, .15);
+        }
+        else if (hObj.id == 5) // Plant
+        {
+            texColor += float3(0.0, 0.2, 0.0);
+        }
+        else if (hObj.id == 8) // Plant
+        {
+            texColor += float3(0.0, 0.2, 0.0);
+        }
+            
+        texColor += smoothstep(0.0, 1.0, (1.0 - Caustics(p * 0.5)) * 0.4); // Caustics
+        texColor *= 0.4 + 0.6 * GodRays(p, l); // God light
+        texColor *= AmbientOcclusion(p, n); // Ambient occlusion
+            
+        float3 lightDir = normalize(l - p);
+        float s1 = max(0.0, SceneSDF(p + lightDir * 0.25).x / 0.25);
+        float s2 = max(0.0, SceneSDF(p + lightDir).x);
+        texColor *= clamp((s1 + s2) * 0.5, 0.0, 1.0); // Shadows
+    }
+    
+    return texColor;
+}
+/**
+ * Phong Illumination:
+ * Based on https://www.shadertoy.com/view/lt33z7
+ */  
+
+/**
+ * Lighting contribution of a single point light source via Phong illumination.
+ * 
+ * The float3 returned is the RGB color of the light's contribution.
+ *
+ * k_a: Ambient color
+ * k_d: Diffuse color
+ * k_s: Specular color
+ * alpha: Shininess coefficient
+ * p: position of point being lit
+ * eye: the position of the camera
+ * lightPos: the position of the light
+ * lightIntensity: color/intensity of the light
+ *
+ * See https://en.wikipedia.org/wiki/Phong_reflection_model#Description
+ */
+float3 PhongContribForLight(float3 k_d, float3 k_s, float alpha, float3 p, float3 eye, float3 lightPos, float3 lightIntensity)
+{
+    float3 N = EstimateNormal(p);
+    float3 L = normalize(lightPos - p);
+    float3 V = normalize(eye - p);
+    float3 R = normalize(reflect(-L, N));
+    
+    float dotLN = dot(L, N);
+    float dotRV = dot(R, V);
+    
+    if (dotLN < 0.0)
+    {
+        // Light not visible from this point on the surface
+        return float3(0.0, 0.0, 0.0);
+    }
+    
+    if (dotRV < 0.0)
+    {
+        // Light reflection in opposite direction as viewer, apply only diffuse
+        // component
+        return lightIntensity * (k_d * dotLN);
+    }
+    return lightIntensity * (k_d * dotLN + k_s * pow(dotRV, alpha));
+}
+/**
+ * Lighting via Phong illumination.
+ * 
+ * The float3 returned is the RGB color of that point after lighting is applied.
+ * k_a: Ambient color
+ * k_d: Diffuse color
+ * k_s: Specular color
+ * alpha: Shininess coefficient
+ * p: position of point being lit
+ * eye: the position of the camera
+ *
+ * See https://en.wikipedia.org/wiki/Phong_reflection_model#Description
+ */
+float3 PhongIllumination(float3 k_a, float3 k_d, float3 k_s, float alpha, float3 p, float3 eye)
+{
+    const float3 ambientLight = 0.5 * float3(0.1, 0.1, 0.1);
+    float3 color = ambientLight * k_a;
+    float3 lightPos = float3(-1.0, 10.0, 1.0); // Refactor from buffer
+    float3 lightIntensity = float3(0.1, 0.1, 0.1);
+    color += PhongContribForLight(k_d, k_s, alpha, p, eye, lightPos, lightIntensity);
+    return color;
+}
+
+/**
+ * Render Scene and Postprocessing
+ * The ray starts at start and stops at end, where a raster object is in front. hitDistance is
+ * negative if nothing was hit. Returns false if the raster object is left to
+ * show through, as the compute shader cannot discard.
+ */
+bool Render(Ray ray, float start, float end, float floorDepth, out float4 fragColor, out float hitDistance, in float2 fragCoord)
+{
+    HitObject hObj = RayMarching(ray, start, end, floorDepth);
+    float3 lightPos = float3(-1.0, 10.0, 1.0);
+    
+    // The raster object is in front, leave the pixel to it
+    hitDistance = hObj.id > 0 ? hObj.d : -1.0;
+    fragColor = float4(0.0, 0.0, 0.0, 0.0);
+    if (hObj.id == 0 && end < MAX_DIST)
+        return false;
+ 
+    float3 pixelColor = waterColor;
+    
+    float3 p = ray.o + hObj.d * ray.d;
+    if (hObj.id > 0)
+    {
+        float3 n = EstimateNormal(p);
+        float3 texColor = Shading(hObj, n, p, lightPos);
+        
+        // Lighting
+        float shininess = 10.0;
+        float3 K_a = float3(0.1, 0.1, 0.1);
+        float3 K_d = float3(0.2, 0.2, 0.2);
+        float3 K_s = float3(0.2, 0.2, 0.2);
+        pixelColor = PhongIllumination(K_a, K_d, K_s, shininess, p, hObj.d) + texColor; // review //hObj.d -> ray.o or ray.d
+    }
+    
+    // Post processing
+    
+    // Fog
+    float fog = clamp(pow(hObj.d / MAX_DIST * waterDepth, 1.5), 0.0, 1.0);
+    pixelColor = lerp(pixelColor, waterColor, fog);
+        
+    // God rays
+    pixelColor = lerp(pixelColor, float3(0.15, 0.25, 0.3) * 12.0, CastLightBeam(ray.o, ray.d, lightPos, hObj.d));
+    
+    // Gamma correction
+    pixelColor = pow(pixelColor, float3(0.4545, 0.4545, 0.4545));
+    
+    fragColor = float4(pixelColor, 1.0);
+    return true;
+}
+
+/* Canvas extents at the screen edges, as P01_VS.hlsl computes them */
+float2 CanvasExtent()
+{
+    float aspectRatio = projection._m11 / projection._m00;
+    return float2(aspectRatio / (2.0 * projection._m00), 1.8 / (2.0 * projection._m11));
+}
+
+float2 CanvasAt(float2 fragCoord, float2 marchSize)
+{
+    float2 ndc = float2(fragCoord.x / marchSize.x * 2.0 - 1.0, 1.0 - fragCoord.y / marchSize.y * 2.0);
+    return ndc * CanvasExtent();
+}
+
+/**
+ * Selects the bubbles of the tile a point of the canvas lies in, as
+ * BubbleField::GetTileIndex finds it.
+ */
+void SelectBubbleTile(float2 canvasXY)
+{
+    float2 position = float2(canvasXY.x, -canvasXY.y) / CanvasExtent() * 0.5 + 0.5;
+    int2 size = int2(bubbleColumns, bubbleRows);
+    int2 tile = clamp(int2(floor(position * float2(size))), 0, size - 1);
+    BubbleTile bubbleTile = bubbleTiles[tile.y * bubbleColumns + tile.x];
+    bubbleFirst = bubbleTile.first;
+    bubbleCount = bubbleTile.count;
+}
+
+/**
+ * Pixel marched by a thread or pixel of the packed half-width image when
+ * checkerboarding: every other pixel of the row, those with (x + y) % 2 == parity.
+ */
+uint2 CheckerboardPixel(uint2 packed)
+{
+    return uint2(packed.x * 2 + ((packed.y + parity) & 1), packed.y);
+}
+
+/**
+ * Primary ray through a point of the canvas, with its direction in view space.
+ */
+Ray PrimaryRay(float2 canvasXY, out float3 viewDir)
+{
+    Ray ray;
+
+    // Set eye position
+    ray.o = EYE;
+
+    // Set ray direction in view space 
+    float dist2Imageplane = 1.0;
+    viewDir = float3(canvasXY, -dist2Imageplane);
+    viewDir = normalize(viewDir);
+
+    // Transform viewDir using the inverse view matrix
+    float4x4 viewTrans = transpose(view);
+    ray.d = viewDir.x * viewTrans._11_12_13 + viewDir.y * viewTrans._21_22_23 
+        + viewDir.z * viewTrans._31_32_33;
+    
+    return ray;
+}
+
+/**
+ * Distance at which the ray through a screen pixel reaches the raster objects
+ * drawn before, or MAX_DIST.
+ */
+float RayEnd(float2 screenCoord, float viewDirZ)
+{
+    if (!useSceneDepth)
+        return MAX_DIST;
+    return min(RayDistance(SceneViewDepth(sceneDepth.Load(int3(screenCoord, 0))), viewDirZ), MAX_DIST);
+}
+
+/**
+ * Marches and shades one pixel, for the pixel shader and the compute shader
+ * alike, from start on where nothing lies in front. fragDepth is the depth
+ * buffer value of the hit, the far plane for the water behind everything.
+ * Returns false where a raster object is in front.
+ */
+bool MarchPixel(float2 canvasXY, float2 fragCoord, float start, out float4 fragColor, out float fragDepth)
+{
+    float3 viewDir;
+    Ray ray = PrimaryRay(canvasXY, viewDir);
+    
+    // Only the bubbles of the pixel's tile can lie on its ray, and none before
+    // the nearest of them
+    if (useBubbleField)
+    {
+        SelectBubbleTile(canvasXY);
+        start = min(start, BubbleTileStart());
+    }
+    
+    // The depths below are at the size of the screen
+    float2 screenCoord = fragCoord / renderScale;
+    
+    // The floor is found up front, unless it is sphere traced with the rest
+    float floorDepth = MAX_DIST;
+    if (floorMode == FLOOR_HEIGHTFIELD)
+        floorDepth = FloorIntersect(ray, MIN_DIST, MAX_DIST);
+    else if (floorMode == FLOOR_MESH)
+        floorDepth = TerrainDistance(screenCoord, viewDir.z);
+    
+    // Rays stop at the raster objects drawn before
+    float end = RayEnd(screenCoord, viewDir.z);
+    
+    // Render
+    float hitDistance;
+    start = min(start, min(end, floorDepth));
+    bool isShown = Render(ray, start, end, floorDepth, fragColor, hitDistance, fragCoord);
+    
+    // Hits are depth tested with the raster objects, the water behind is farthest
+    fragDepth = hitDistance > 0.0 ? SceneDepthValue(hitDistance * -viewDir.z) : 1.0;
+    
+    return isShown;
+}
@@ -5,30 +5,24 @@ cbuffer ModelViewProjectionConstantBuffer : register(b0)
     matrix projection;
 };
 
-struct VS_INPUT
-{
-    float3 pos      : POSITION;
-    float3 color    : COLOR;
-};
-
 struct VS_OUTPUT
 {
     float4 pos      : SV_POSITION;
     float2 canvasXY : TEXCOORD0;
 };
 
-VS_OUTPUT main(VS_INPUT input)
+// One triangle covering the screen, made from the vertex id without buffers.
+VS_OUTPUT main(uint vertexId : SV_VertexID)
 {
     VS_OUTPUT output;
     
-    float4 inPos = float4(input.pos, 1.0);
-    inPos.xyz *= 100.0;
-    inPos.z += 25.0;
-    inPos = mul(inPos, projection);
-    output.pos = inPos;
+    float2 ndc = float2(vertexId == 1 ? 3.0 : -1.0, vertexId == 2 ? 3.0 : -1.0);
+    output.pos = float4(ndc, 0.0, 1.0);
     
+    // Canvas extents at the screen edges, as the cube drawn before gave them
     float aspectRatio = projection._m11 / projection._m00;
-    output.canvasXY = sign(output.pos.xy) * float2(aspectRatio, 1.8); // 1.0
+    float2 canvasExtent = float2(aspectRatio / (2.0 * projection._m00), 1.8 / (2.0 * projection._m11));
+    output.canvasXY = ndc * canvasExtent;
 
     return output;
-}
\ No newline at end of file
+}
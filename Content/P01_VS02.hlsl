@@ -0,0 +1,21 @@
+// Passes the floor patches of TerrainQuadtree straight on to P01_HS.hlsl.
+
+struct VS_INPUT
+{
+    float3 patch        : PATCH;    // x, z and size
+    uint coarserSides   : SIDES;
+};
+
+struct VS_OUTPUT
+{
+    float3 patch        : PATCH;
+    uint coarserSides   : SIDES;
+};
+
+VS_OUTPUT main(VS_INPUT input)
+{
+    VS_OUTPUT output;
+    output.patch = input.patch;
+    output.coarserSides = input.coarserSides;
+    return output;
+}
@@ -3,17 +3,50 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <chrono>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// Resolutions the Home benchmark times. The largest grid takes about 770 MB,
+	// more than a 32-bit process can count on, so those builds stop at 2000.
+#if defined(_WIN64)
+	const uint32_t P02_BENCHMARK_RESOLUTIONS[] = { 100, 1000, 4000 };
+#else
+	const uint32_t P02_BENCHMARK_RESOLUTIONS[] = { 100, 1000, 2000 };
+#endif
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 P02_Explicit::P02_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
 	m_indexCount(0),
+	m_indexFormat(DXGI_FORMAT_R16_UINT),
+	m_resolution(100),
+	m_buildMilliseconds(0.0),
+	m_gridBytes(0),
+	m_vertexCacheBefore(),
+	m_vertexCacheAfter(),
+	m_pendingIndexCount(0),
+	m_pendingIndexFormat(DXGI_FORMAT_R16_UINT),
+	m_pendingResolution(0),
+	m_pendingBuildMilliseconds(0.0),
+	m_pendingGridBytes(0),
+	m_pendingVertexCacheBefore(),
+	m_pendingVertexCacheAfter(),
+	m_gridReady(false),
+	m_gridBuildInFlight(false),
+	m_benchmarkReady(false),
+	m_benchmarkInFlight(false),
 	m_deviceResources(deviceResources)
 {
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixIdentity());
+
 	CreateDeviceDependentResources();
 }
 
@@ -81,95 +114,127 @@ void P02_Explicit::CreateDeviceDependentResources()
 		);
 		});
 
-	// Once both shaders are loaded, create the mesh.
+	// Once both shaders are loaded, build the grid on a worker thread.
 	auto execPipelines = (createPipeline02_PSTask && createPipeline02_VSTask).then([this]() {
+		return RebuildGridAsync(m_resolution);
+		});
 
-		const UINT particles = 100;
+	// Once the grid buffers exist, the object is ready to be rendered.
+	execPipelines.then([this]() {
+		m_loadingComplete = true;
+		});
+}
 
-		// Load mesh vertices. Each vertex has a position and a color.
-		const UINT vSize = (particles - 1) * (particles - 1);
-		const UINT iSize = particles * particles * 2;
+// Generates the grid and its buffers off the render thread. The buffers are
+// swapped in by Update once they are complete.
+Concurrency::task<void> P02_Explicit::RebuildGridAsync(uint32 resolution)
+{
+	m_gridBuildInFlight = true;
 
-		static VertexPositionColor vertices[vSize];
-		static unsigned short indices[iSize];
+	return Concurrency::create_task([this, resolution]() {
+		auto start = std::chrono::high_resolution_clock::now();
 
-		float dx = XM_2PI / (particles - 1);
-		float dy = XM_PI / (particles - 1);
+		GridMesh mesh;
+		GridGenerator::BuildSphereGrid(resolution, mesh);
 
-		UINT vertexFlag = 0;
-		UINT indexFlag = 0;
-		for (UINT i = 0; i < particles - 1; i++)
-		{
-			float y = i * dy;
-			for (UINT j = 0; j < particles - 1; j++)
-			{
-				if (indexFlag > iSize)
-					break;
-				float x = j * dx;
-				VertexPositionColor v;
-				v.pos.x = x;
-				v.pos.y = y;
-				v.pos.z = 0;
-				v.color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-				vertices[vertexFlag] = v;
-
-				vertexFlag = vertexFlag + 1;
-
-				unsigned short index0 = i * particles + j;
-				unsigned short index1 = index0 + 1;
-				unsigned short index2 = index0 + particles;
-				unsigned short index3 = index2 + 1;
-
-				indices[indexFlag] = index0;
-				indices[indexFlag + 1] = index2;
-				indices[indexFlag + 2] = index1;
-				indices[indexFlag + 3] = index1;
-				indices[indexFlag + 4] = index2;
-				indices[indexFlag + 5] = index3;
-
-				indexFlag = indexFlag + 6;
-			}
-		}
+		// Render draws the grid as a point list, which the post-transform cache and
+		// overdraw orders do nothing for. The ratios are what the grid would get as
+		// the triangle list its indices describe, an offline measurement of the
+		// optimiser and not a gain of this draw.
+		m_pendingVertexCacheBefore = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+		GridGenerator::OptimizeSphereGrid(mesh);
+		m_pendingVertexCacheAfter = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
 
 		D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
-		vertexBufferData.pSysMem = vertices;
+		vertexBufferData.pSysMem = mesh.vertices.data();
 		vertexBufferData.SysMemPitch = 0;
 		vertexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(vertices), D3D11_BIND_VERTEX_BUFFER);
+		CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(mesh.vertices.size() * sizeof(VertexPositionColor)), D3D11_BIND_VERTEX_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
 				&vertexBufferDesc,
 				&vertexBufferData,
-				&m_vertexBuffer
+				&m_pendingVertexBuffer
 			)
 		);
 
-		m_indexCount = ARRAYSIZE(indices);
+		// Only fall back to 32-bit indices once the grid outgrows 16-bit addressing.
+		bool wideIndices = GridGenerator::RequiresWideIndices(mesh.vertices.size());
+		std::vector<uint16_t> narrowIndices;
+		if (!wideIndices)
+		{
+			narrowIndices = GridGenerator::NarrowIndices(mesh.indices);
+		}
 
 		D3D11_SUBRESOURCE_DATA indexBufferData = { 0 };
-		indexBufferData.pSysMem = indices;
+		indexBufferData.pSysMem = wideIndices ? static_cast<const void*>(mesh.indices.data()) : static_cast<const void*>(narrowIndices.data());
 		indexBufferData.SysMemPitch = 0;
 		indexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC indexBufferDesc(sizeof(indices), D3D11_BIND_INDEX_BUFFER);
+		CD3D11_BUFFER_DESC indexBufferDesc(static_cast<UINT>(mesh.indices.size() * GridGenerator::GetIndexSize(mesh.vertices.size())), D3D11_BIND_INDEX_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
 				&indexBufferDesc,
 				&indexBufferData,
-				&m_indexBuffer
+				&m_pendingIndexBuffer
 			)
 		);
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		m_pendingIndexCount = static_cast<uint32>(mesh.indices.size());
+		m_pendingIndexFormat = wideIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+		m_pendingResolution = resolution;
+		m_pendingBuildMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+		m_pendingGridBytes = GridGenerator::GetMemoryFootprint(mesh);
+		m_gridReady = true;
 		});
+}
 
-	// Once the particles are loaded, the object is ready to be rendered.
-	execPipelines.then([this]() {
-		m_loadingComplete = true;
+// Times grid generation at the reference resolutions without touching the GPU.
+void P02_Explicit::RunGridBenchmarkAsync()
+{
+	m_benchmarkInFlight = true;
+
+	Concurrency::create_task([this]() {
+		m_pendingBenchmark.clear();
+		for (uint32_t resolution : P02_BENCHMARK_RESOLUTIONS)
+		{
+			m_pendingBenchmark.push_back(GridGenerator::Benchmark(resolution));
+		}
+		m_benchmarkReady = true;
 		});
 }
 
 // Called once per frame, rotates the cube and calculates the model and view matrices.
 void P02_Explicit::Update(DX::StepTimer const& timer)
 {
-	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMMatrixIdentity()));
+	ProcessInput(timer);
+
+	// Swap in a finished grid rebuild.
+	if (m_gridReady)
+	{
+		m_vertexBuffer = m_pendingVertexBuffer;
+		m_indexBuffer = m_pendingIndexBuffer;
+		m_pendingVertexBuffer.Reset();
+		m_pendingIndexBuffer.Reset();
+		m_indexCount = m_pendingIndexCount;
+		m_indexFormat = m_pendingIndexFormat;
+		m_resolution = m_pendingResolution;
+		m_buildMilliseconds = m_pendingBuildMilliseconds;
+		m_gridBytes = m_pendingGridBytes;
+		m_vertexCacheBefore = m_pendingVertexCacheBefore;
+		m_vertexCacheAfter = m_pendingVertexCacheAfter;
+		m_gridReady = false;
+		m_gridBuildInFlight = false;
+	}
+
+	if (m_benchmarkReady)
+	{
+		m_benchmark.swap(m_pendingBenchmark);
+		m_benchmarkReady = false;
+		m_benchmarkInFlight = false;
+	}
+
 	m_timeBufferData.time = static_cast<float>(timer.GetTotalSeconds());
 }
 
@@ -177,7 +242,7 @@ void P02_Explicit::Update(DX::StepTimer const& timer)
 void P02_Explicit::Render()
 {
 	// Loading is asynchronous. Only draw geometry after it's loaded.
-	if (!m_loadingComplete)
+	if (!m_loadingComplete || !m_vertexBuffer)
 	{
 		return;
 	}
@@ -220,7 +285,7 @@ void P02_Explicit::Render()
 
 	context->IASetIndexBuffer(
 		m_indexBuffer.Get(),
-		DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
+		m_indexFormat, // 16-bit indices until the grid needs more than 65536 vertices.
 		0
 	);
 
@@ -308,6 +373,15 @@ void P02_Explicit::ReleaseDeviceDependentResources()
 	m_timeBuffer.Reset();
 	m_vertexBuffer.Reset();
 	m_indexBuffer.Reset();
+	m_pendingVertexBuffer.Reset();
+	m_pendingIndexBuffer.Reset();
+	m_gridReady = false;
+}
+
+// The sphere's world matrix from its scene graph node, not transposed.
+void P02_Explicit::SetModelMatrix(const DirectX::XMFLOAT4X4& model)
+{
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&model)));
 }
 
 void P02_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection)
@@ -321,3 +395,43 @@ void P02_Explicit::SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosi
 {
 	m_cameraBufferData.position = cameraPosition;
 }
+
+void P02_Explicit::ProcessInput(DX::StepTimer const& timer)
+{
+	const uint32 minResolution = 4;
+	const uint32 maxResolution = 2048;
+
+	// One step per key press, and only one rebuild at a time; presses are
+	// ignored until it lands.
+	bool isPageUp = IsKeyToggled(VirtualKey::PageUp);
+	bool isPageDown = IsKeyToggled(VirtualKey::PageDown);
+	if (m_loadingComplete && !m_gridBuildInFlight)
+	{
+		if (isPageUp && m_resolution < maxResolution)
+			RebuildGridAsync(std::min(m_resolution * 2, maxResolution));
+
+		else if (isPageDown && m_resolution > minResolution)
+			RebuildGridAsync(std::max(m_resolution / 2, minResolution));
+	}
+
+	if (IsKeyToggled(VirtualKey::Home) && !m_benchmarkInFlight) RunGridBenchmarkAsync();
+}
+
+bool P02_Explicit::IsKeyPressed(VirtualKey key)
+{
+	auto keyDownState = CoreVirtualKeyStates::Down;
+	auto currentKeyState = CoreWindow::GetForCurrentThread()->GetKeyState(key);
+
+	if ((currentKeyState & keyDownState) == keyDownState) return true;
+	return false;
+}
+
+// True only on the frame the key goes down, so a held key does not repeat.
+bool P02_Explicit::IsKeyToggled(VirtualKey key)
+{
+	bool isDown = IsKeyPressed(key);
+	bool wasDown = m_keyWasDown[key];
+	m_keyWasDown[key] = isDown;
+
+	return isDown && !wasDown;
+}
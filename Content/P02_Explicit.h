@@ -3,6 +3,11 @@
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
 #include "ShaderStructures.h"
+#include "MeshOptimizer.h"
+#include "GridGenerator.h"
+
+#include <atomic>
+#include <map>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
@@ -11,17 +16,37 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	// Underwater coral object generated procedurally 
 	// using a vertex shader
 
+	using namespace Windows::System;
+	using namespace Windows::UI::Core;
+
 	class P02_Explicit
 	{
 	public:
 		P02_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		void CreateDeviceDependentResources();
+		void SetModelMatrix(const DirectX::XMFLOAT4X4& model);
 		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection);
 		void SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition);
 		void ReleaseDeviceDependentResources();
 		void Update(DX::StepTimer const& timer);
 		void Render();
 
+	private:
+		void ProcessInput(DX::StepTimer const& timer);
+		bool IsKeyPressed(VirtualKey key);
+		bool IsKeyToggled(VirtualKey key);
+		Concurrency::task<void> RebuildGridAsync(uint32 resolution);
+		void RunGridBenchmarkAsync();
+
+	public:
+		VertexCacheStatistics GetVertexCacheBefore()	{ return m_vertexCacheBefore; }
+		VertexCacheStatistics GetVertexCacheAfter()		{ return m_vertexCacheAfter; }
+		uint32 GetResolution()							{ return m_resolution; }
+		bool IsUsingWideIndices()						{ return m_indexFormat == DXGI_FORMAT_R32_UINT; }
+		double GetBuildMilliseconds()					{ return m_buildMilliseconds; }
+		size_t GetGridBytes()							{ return m_gridBytes; }
+		const std::vector<GridBenchmarkResult>& GetBenchmark() { return m_benchmark; }
+
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources>		    m_deviceResources;
@@ -48,6 +73,31 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		CameraTrackingBuffer							m_cameraBufferData;
 		ElapsedTimeBuffer								m_timeBufferData;
 		uint32											m_indexCount;
+		DXGI_FORMAT										m_indexFormat;
+		uint32											m_resolution;
+		double											m_buildMilliseconds;
+		size_t											m_gridBytes;
+		VertexCacheStatistics							m_vertexCacheBefore;
+		VertexCacheStatistics							m_vertexCacheAfter;
+		std::vector<GridBenchmarkResult>				m_benchmark;
+
+		// Grid rebuilt on a worker thread, swapped in by Update.
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_pendingVertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_pendingIndexBuffer;
+		uint32											m_pendingIndexCount;
+		DXGI_FORMAT										m_pendingIndexFormat;
+		uint32											m_pendingResolution;
+		double											m_pendingBuildMilliseconds;
+		size_t											m_pendingGridBytes;
+		VertexCacheStatistics							m_pendingVertexCacheBefore;
+		VertexCacheStatistics							m_pendingVertexCacheAfter;
+		std::vector<GridBenchmarkResult>				m_pendingBenchmark;
+		std::atomic<bool>								m_gridReady;
+		std::atomic<bool>								m_gridBuildInFlight;
+		std::atomic<bool>								m_benchmarkReady;
+		std::atomic<bool>								m_benchmarkInFlight;
+
+		std::map<VirtualKey, bool>						m_keyWasDown;
 
 		// Variables used with the rendering loop.
 		bool											m_loadingComplete;
@@ -37,11 +37,8 @@ VS_OUTPUT main(VS_INPUT input)
     inPos.y = r * sin(input.pos.y) * sin(input.pos.x) - 2.0;
     inPos.z = r * cos(input.pos.y * sin(elapsedTime * 0.5));
 
-    // Placement
-    inPos.xyz *= 5.0;
-    inPos.z -= 10.0;
-    inPos.y += 10.0;
-    inPos.x += 20.0;
+    // Placement comes from the sphere's scene graph node.
+    inPos = mul(inPos, model);
 
     // Projection
     inPos = mul(inPos, view);
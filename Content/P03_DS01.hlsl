@@ -69,7 +69,7 @@ DS_OUTPUT main(QuadTessParam input,
     
 	output.pos = float4(uvPos, 1);
     
-	// output.pos = mul(output.pos, model);
+    output.pos = mul(output.pos, model);
     output.pos = mul(output.pos, view);
     output.pos = mul(output.pos, projection);
 	
@@ -67,9 +67,9 @@ DS_OUTPUT main(QuadTessParam input,
     uvPos.z = radius * cos(theta);
     uvPos.yz += noise(uvPos) * 2.5 * noiseStrength;
     
-    output.pos = float4(uvPos - float3(50.0, 0.0, 0.0), 1);
+    output.pos = float4(uvPos, 1);
     
-	// output.pos = mul(output.pos, model);
+    output.pos = mul(output.pos, model);
     output.pos = mul(output.pos, view);
     output.pos = mul(output.pos, projection);
 	
@@ -3,11 +3,32 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// Surface level of detail by projected diameter in pixels.
+	const LodThresholds P03_SURFACE_LOD = { 160.0f, 48.0f, 0.15f };
+
+	// Bounds of the P03_DS01.hlsl and P03_DS02.hlsl spheres in their own space,
+	// padded for the noise.
+	const LodSphere P03_SURFACE_BOUNDS[] =
+	{
+		{ 0.0f, 0.0f, 0.0f, 5.5f },
+		{ 0.0f, 0.0f, 0.0f, 10.5f },
+	};
+
+	// Simplified surfaces are tessellated this many times more coarsely.
+	const float P03_SIMPLIFIED_TESSELLATION_DIVISOR = 4.0f;
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 P03_Explicit::P03_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
@@ -15,8 +36,20 @@ P03_Explicit::P03_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceRes
 	m_tessellationFactor(31.0f),
 	m_noiseStrength(0.01f),
 	m_indexCount(0),
+	m_surfaceLod(P03_SURFACE_LOD),
+	m_lodView(),
+	m_isLodEnabled(true),
+	m_isImpostorInstanceDirty(true),
 	m_deviceResources(deviceResources)
 {
+	m_surfaceLod.Resize(SurfaceCount);
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		m_surfaceImpostors[i] = std::unique_ptr<ImpostorAtlas>(new ImpostorAtlas(deviceResources));
+		XMStoreFloat4x4(&m_surfaceModels[i], XMMatrixIdentity());
+		m_surfaceBounds[i] = P03_SURFACE_BOUNDS[i];
+	}
+
 	CreateDeviceDependentResources();
 }
 
@@ -24,7 +57,6 @@ P03_Explicit::P03_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceRes
 void P03_Explicit::Update(DX::StepTimer const& timer)
 {
 	ProcessInput(timer);
-	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMMatrixIdentity()));
 	m_timeBufferData.time = timer.GetTotalSeconds();
 	m_tessellationBufferData.tessellationFactor = m_tessellationFactor;
 	m_noiseBufferData.noiseStrength = m_noiseStrength;
@@ -52,6 +84,20 @@ void P03_Explicit::Render()
 		0
 	);
 
+	// Impostors sit at the surfaces' world space centres.
+	if (m_isImpostorInstanceDirty)
+	{
+		VertexPositionColorNormal instances[SurfaceCount];
+		for (UINT i = 0; i < SurfaceCount; i++)
+		{
+			const LodSphere& bounds = m_surfaceBounds[i];
+			instances[i] = { XMFLOAT3(bounds.x, bounds.y, bounds.z), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+		}
+
+		context->UpdateSubresource1(m_impostorInstanceBuffer.Get(), 0, NULL, instances, 0, 0, 0);
+		m_isImpostorInstanceDirty = false;
+	}
+
 	context->UpdateSubresource1(
 		m_cameraBuffer.Get(),
 		0,
@@ -183,6 +229,21 @@ void P03_Explicit::Render()
 		0
 	);
 
+	// Each surface is drawn at its own level of detail.
+	m_surfaceLod.BeginFrame();
+	LodLevel levels[SurfaceCount];
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		const LodSphere& bounds = m_surfaceBounds[i];
+		float size = m_isLodEnabled ?
+			LodSelector::ProjectedSize(m_lodView, bounds.x, bounds.y, bounds.z, bounds.radius) :
+			std::numeric_limits<float>::max();
+		levels[i] = m_surfaceLod.Update(i, size);
+	}
+
+	// The impostor atlases are baked on the first frame the shaders are ready.
+	if (!m_surfaceImpostors[0]->IsBaked()) BakeSurfaceImpostors();
+
 	// Rasterization
 	context->RSSetState(m_rasterizerState.Get());
 
@@ -193,16 +254,46 @@ void P03_Explicit::Render()
 		0
 	);
 
-	// Draw the object.
-	context->DrawIndexed(
-		m_indexCount,
+	float simplifiedFactor = std::max(1.0f, m_tessellationFactor / P03_SIMPLIFIED_TESSELLATION_DIVISOR);
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		if (levels[i] == LodLevel::Full) DrawSurface(i, m_tessellationFactor, m_surfaceModels[i]);
+		else if (levels[i] == LodLevel::Simplified) DrawSurface(i, simplifiedFactor, m_surfaceModels[i]);
+	}
+
+	// Impostors go last, as they replace the tessellation pipeline.
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		if (levels[i] != LodLevel::Impostor) continue;
+
+		const LodSphere& bounds = m_surfaceBounds[i];
+		m_surfaceImpostors[i]->Draw(m_impostorInstanceBuffer.Get(), i, 1, bounds.radius, m_mvpBuffer.Get(), m_cameraBufferData.position);
+	}
+}
+
+// Draws one surface with the given tessellation factor and transposed model matrix.
+// The rest of the pipeline is set up by Render.
+void P03_Explicit::DrawSurface(UINT surface, float tessellationFactor, const XMFLOAT4X4& model)
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	m_mvpBufferData.model = model;
+	context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+
+	m_tessellationBufferData.tessellationFactor = tessellationFactor;
+	context->UpdateSubresource1(
+		m_tessellationBuffer.Get(),
+		0,
+		NULL,
+		&m_tessellationBufferData,
+		0,
 		0,
 		0
 	);
 
-	// Attach our domain shader.
+	// Attach the surface's domain shader.
 	context->DSSetShader(
-		m_domainShader02.Get(),
+		(surface == 0) ? m_domainShader01.Get() : m_domainShader02.Get(),
 		nullptr,
 		0
 	);
@@ -215,6 +306,57 @@ void P03_Explicit::Render()
 	);
 }
 
+// Draws each surface at full tessellation into its impostor atlas, in the
+// surface's own space, then puts the scene's matrices back.
+void P03_Explicit::BakeSurfaceImpostors()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	ModelViewProjectionConstantBuffer sceneMatrices = m_mvpBufferData;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		const LodSphere& bounds = P03_SURFACE_BOUNDS[i];
+		XMFLOAT3 center(bounds.x, bounds.y, bounds.z);
+
+		m_surfaceImpostors[i]->Bake(center, bounds.radius, [this, i, &identity](const XMMATRIX& view, const XMMATRIX& projection) {
+			XMStoreFloat4x4(&m_mvpBufferData.view, XMMatrixTranspose(view));
+			XMStoreFloat4x4(&m_mvpBufferData.projection, XMMatrixTranspose(projection));
+
+			DrawSurface(i, m_tessellationFactor, identity);
+			});
+	}
+
+	m_mvpBufferData = sceneMatrices;
+	context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+}
+
+// Both surfaces and their per-level costs, for the LOD report.
+LodObjectSet P03_Explicit::GetLodObjects()
+{
+	LodObjectSet set;
+	set.name = "surfaces";
+	set.thresholds = P03_SURFACE_LOD;
+	set.isInstanced = false;
+	set.spheres.assign(m_surfaceBounds, m_surfaceBounds + SurfaceCount);
+
+	// Every quad patch is tessellated into two triangles per cell, and fractional
+	// odd partitioning rounds the factor up.
+	auto patchTriangles = [this](float factor) {
+		float cells = ceilf(factor);
+		return static_cast<uint32_t>((m_indexCount / 4) * 2 * cells * cells);
+	};
+
+	set.triangles[0] = patchTriangles(m_tessellationFactor);
+	set.triangles[1] = patchTriangles(std::max(1.0f, m_tessellationFactor / P03_SIMPLIFIED_TESSELLATION_DIVISOR));
+	set.triangles[2] = 2;
+	return set;
+}
+
 void P03_Explicit::CreateDeviceDependentResources()
 {
 	// Load shaders asynchronously.
@@ -417,10 +559,22 @@ void P03_Explicit::CreateDeviceDependentResources()
 				&m_indexBuffer
 			)
 		);
+
+		// One impostor instance per surface, tinted white and facing along +x. Render
+		// writes the centres whenever a surface moves.
+		CD3D11_BUFFER_DESC instanceDesc(SurfaceCount * sizeof(VertexPositionColorNormal), D3D11_BIND_VERTEX_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&instanceDesc,
+				nullptr,
+				&m_impostorInstanceBuffer
+			)
+		);
+		m_isImpostorInstanceDirty = true;
 		});
 
-	// Once the cube is loaded, the object is ready to be rendered.
-	execPipelines.then([this]() {
+	// Once the cube and the impostor shaders are loaded, the object is ready to be rendered.
+	(execPipelines && m_surfaceImpostors[0]->CreateDeviceDependentResources() && m_surfaceImpostors[1]->CreateDeviceDependentResources()).then([this]() {
 		m_loadingComplete = true;
 		});
 }
@@ -441,6 +595,28 @@ void P03_Explicit::ReleaseDeviceDependentResources()
 	m_noiseBuffer.Reset();
 	m_vertexBuffer.Reset();
 	m_indexBuffer.Reset();
+	m_impostorInstanceBuffer.Reset();
+	for (UINT i = 0; i < SurfaceCount; i++)
+	{
+		m_surfaceImpostors[i]->ReleaseDeviceDependentResources();
+	}
+}
+
+// A surface's world matrix from its scene graph node, not transposed.
+void P03_Explicit::SetSurfaceModelMatrix(UINT surface, const DirectX::XMFLOAT4X4& model)
+{
+	XMMATRIX world = XMLoadFloat4x4(&model);
+	XMStoreFloat4x4(&m_surfaceModels[surface], XMMatrixTranspose(world));
+
+	// The level of detail and impostor follow the bounds into world space.
+	const LodSphere& local = P03_SURFACE_BOUNDS[surface];
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(local.x, local.y, local.z, 1.0f), world));
+	float scale = std::max(XMVectorGetX(XMVector3Length(world.r[0])),
+		std::max(XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2]))));
+
+	m_surfaceBounds[surface] = { center.x, center.y, center.z, local.radius * scale };
+	m_isImpostorInstanceDirty = true;
 }
 
 void P03_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection)
@@ -448,6 +624,9 @@ void P03_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.view, DirectX::XMMatrixTranspose(view));
 
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.projection, DirectX::XMMatrixTranspose(projection));
+
+	// The domain shaders apply view and projection separately; the impostors use the product.
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.viewProjection, DirectX::XMMatrixTranspose(DirectX::XMMatrixMultiply(view, projection)));
 }
 
 void P03_Explicit::SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition)
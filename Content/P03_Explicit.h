@@ -3,6 +3,10 @@
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
 #include "ShaderStructures.h"
+#include "LodSelector.h"
+#include "ImpostorAtlas.h"
+
+#include <memory>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
@@ -11,6 +15,9 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	// Underwater coral objects generated using 
 	// parametric surface designing and
 	// tessellation with SM5 hull and domain shaders.
+	//
+	// Each surface lowers its tessellation factor when it is small on screen,
+	// and is replaced by a billboard impostor baked at startup further away.
 
 	using namespace Windows::System;
 	using namespace Windows::UI::Core;
@@ -20,6 +27,7 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	public:
 		P03_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		void CreateDeviceDependentResources();
+		void SetSurfaceModelMatrix(UINT surface, const DirectX::XMFLOAT4X4& model);
 		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection);
 		void SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition);
 		void ReleaseDeviceDependentResources();
@@ -29,10 +37,21 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	private:
 		void ProcessInput(DX::StepTimer const& timer);
 		bool IsKeyPressed(VirtualKey key);
+		void DrawSurface(UINT surface, float tessellationFactor, const DirectX::XMFLOAT4X4& model);
+		void BakeSurfaceImpostors();
 	
 	public:
 		float GetTessellationFactor()		{ return m_tessellationFactor; }
 		float GetNoiseStrength()			{ return m_noiseStrength; }
+		LodLevel GetLodLevel(UINT surface)	{ return m_surfaceLod.GetLevel(surface); }
+
+		// Levels are picked from the camera of the last SetLodView.
+		void SetLodView(const LodView& view)	{ m_lodView = view; }
+		void SetLodEnabled(bool isEnabled)		{ m_isLodEnabled = isEnabled; }
+		LodObjectSet GetLodObjects();
+
+		// The sphere of P03_DS01.hlsl and the larger one of P03_DS02.hlsl.
+		static const UINT SurfaceCount = 2;
 
 	private:
 		// Cached pointer to device resources.
@@ -70,6 +89,18 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		NoiseStrengthBuffer								m_noiseBufferData;
 		uint32											m_indexCount;
 
+		// Distance level of detail
+		LodSelector										m_surfaceLod;
+		LodView											m_lodView;
+		std::unique_ptr<ImpostorAtlas>					m_surfaceImpostors[SurfaceCount];
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_impostorInstanceBuffer;
+		bool											m_isLodEnabled;
+
+		// Transposed model matrices and world space bounds, from the scene graph.
+		DirectX::XMFLOAT4X4								m_surfaceModels[SurfaceCount];
+		LodSphere										m_surfaceBounds[SurfaceCount];
+		bool											m_isImpostorInstanceDirty;
+
 		// Variables used with the rendering loop.
 		float											m_tessellationFactor;
 		float											m_noiseStrength;
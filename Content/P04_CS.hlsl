@@ -0,0 +1,76 @@
+// Compute shader version of P04_GS.hlsl.
+// Each thread amplifies one triangle into three and appends them to the output buffer.
+// The pass is dispatched once per subdivision level, reading the previous level's output.
+
+struct CoralVertex
+{
+    float3 pos;
+    float3 normal;
+    float4 color;
+};
+
+struct CoralTriangle
+{
+    CoralVertex v[3];
+};
+
+cbuffer AmplificationConstantBuffer : register(b0)
+{
+    matrix model;
+    uint triangleCount;
+    float3 padding;
+};
+
+StructuredBuffer<CoralTriangle> inputTriangles : register(t0);
+AppendStructuredBuffer<CoralTriangle> outputTriangles : register(u0);
+
+CoralVertex MakeVertex(float3 pos, float3 normal, float4 color)
+{
+    CoralVertex v;
+    v.pos = pos;
+    v.normal = normal;
+    v.color = color;
+    return v;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= triangleCount)
+        return;
+
+    CoralTriangle input = inputTriangles[id.x];
+    CoralTriangle output;
+
+    float3 p0 = input.v[0].pos;
+    float3 p1 = input.v[1].pos;
+    float3 p2 = input.v[2].pos;
+
+    float3 m0 = (p0 + p1) / 2.0;
+    float3 m1 = (p1 + p2) / 2.0;
+    float3 m2 = (p2 + p0) / 2.0;
+
+    // The colour follows where the triangle lies in the world, as in P04_GS.hlsl
+    float4 color = float4((sign(mul(float4(p0, 1.0), model).xy) + 1.0) / 2.0, 1.0, 1.0);
+
+    // Triangle 1
+    float3 faceNormal = normalize(cross(m0 - p0, m2 - p0));
+    output.v[0] = MakeVertex(p0 + faceNormal, -faceNormal, color);
+    output.v[1] = MakeVertex(m0, faceNormal, color);
+    output.v[2] = MakeVertex(m2, faceNormal, color);
+    outputTriangles.Append(output);
+
+    // Triangle 2
+    faceNormal = normalize(cross(p1 - m0, m1 - m0));
+    output.v[0] = MakeVertex(m0, faceNormal, color);
+    output.v[1] = MakeVertex(p1 + faceNormal, faceNormal, color);
+    output.v[2] = MakeVertex(m1, -faceNormal, color);
+    outputTriangles.Append(output);
+
+    // Triangle 3
+    faceNormal = normalize(cross(m1 - m2, p2 - m2));
+    output.v[0] = MakeVertex(m2, -faceNormal, color);
+    output.v[1] = MakeVertex(m1, faceNormal, color);
+    output.v[2] = MakeVertex(p2 + faceNormal, faceNormal, color);
+    outputTriangles.Append(output);
+}
@@ -3,18 +3,65 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// Deepest compute amplification level; the triangle buffers are sized for it.
+	const uint32 P04_MAX_AMPLIFICATION_LEVEL = 8;
+
+	// Deepest CPU generator level, 12 * 3^11 = 2.1 million triangles.
+	const uint32 P04_MAX_GENERATOR_LEVEL = 11;
+
+	// Triangles copied to the GPU per frame while a generated coral streams in (about 4 MB).
+	const size_t P04_UPLOAD_CHUNK_TRIANGLES = 32768;
+
+	// Coral level of detail by projected diameter in pixels. The bounds are padded
+	// past the seed cube for the extrusion.
+	const LodThresholds P04_CORAL_LOD = { 160.0f, 48.0f, 0.15f };
+	const float P04_CORAL_MARGIN = 2.0f;
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 P04_Explicit::P04_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
 	m_isWireframe(false),
+	m_isAmplificationDirty(true),
+	m_isCountReadbackPending(false),
+	m_isReferenceDirty(true),
 	m_indexCount(0),
+	m_amplificationMode(AmplificationMode::GeometryShader),
+	m_amplificationLevel(1),
+	m_outputBufferIndex(0),
+	m_gpuTriangleCount(0),
+	m_referenceMilliseconds(0.0),
+	m_generatorLevel(6),
+	m_generatorSeed(1),
+	m_generatorStatistics(),
+	m_pendingStatistics(),
+	m_uploadedTriangleCount(0),
+	m_generatorReady(false),
+	m_generatorInFlight(false),
+	m_isGeneratorStale(false),
+	m_coralLod(P04_CORAL_LOD),
+	m_lodView(),
+	m_coralBounds(),
+	m_coralWorldBounds(),
+	m_coralImpostor(deviceResources),
+	m_isLodEnabled(true),
+	m_isImpostorInstanceDirty(true),
 	m_deviceResources(deviceResources)
 {
+	m_coralLod.Resize(1);
+	XMStoreFloat4x4(&m_mvpBufferData.model, XMMatrixIdentity());
+
 	CreateDeviceDependentResources();
 }
 
@@ -24,6 +71,8 @@ void P04_Explicit::CreateDeviceDependentResources()
 	auto loadPipeline04_VSTask = DX::ReadDataAsync(L"P04_VS.cso");
 	auto loadPipeline04_GSTask = DX::ReadDataAsync(L"P04_GS.cso");
 	auto loadPipeline04_PSTask = DX::ReadDataAsync(L"P04_PS.cso");
+	auto loadPipeline04_CSTask = DX::ReadDataAsync(L"P04_CS.cso");
+	auto loadPipeline04_VS02Task = DX::ReadDataAsync(L"P04_VS02.cso");
 
 	// After the vertex shader file is loaded, create the shader and input layout.
 	auto createPipeline04_VSTask = loadPipeline04_VSTask.then([this](const std::vector<byte>& fileData) {
@@ -66,6 +115,39 @@ void P04_Explicit::CreateDeviceDependentResources()
 		);
 		});
 
+	// After the compute shader file is loaded, create the shader and constant buffer.
+	auto createPipeline04_CSTask = loadPipeline04_CSTask.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_computeShader
+			)
+		);
+
+		CD3D11_BUFFER_DESC AmplificationBufferDesc(sizeof(AmplificationConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&AmplificationBufferDesc,
+				nullptr,
+				&m_amplificationBuffer
+			)
+		);
+		});
+
+	// After the triangle vertex shader file is loaded, create the shader. It has no input layout.
+	auto createPipeline04_VS02Task = loadPipeline04_VS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_triangleVertexShader
+			)
+		);
+		});
+
 	// After the pixel shader file is loaded, create the shader and constant buffer.
 	auto createPipeline04_PSTask = loadPipeline04_PSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
@@ -98,7 +180,8 @@ void P04_Explicit::CreateDeviceDependentResources()
 		});
 
 	// Once both shaders are loaded, create the mesh.
-	auto execPipelines = (createPipeline04_PSTask && createPipeline04_GSTask && createPipeline04_VSTask).then([this]() {
+	auto execPipelines = (createPipeline04_PSTask && createPipeline04_GSTask && createPipeline04_VSTask &&
+		createPipeline04_CSTask && createPipeline04_VS02Task).then([this]() {
 
 		// Cube
 
@@ -195,10 +278,45 @@ void P04_Explicit::CreateDeviceDependentResources()
 				&m_indexBuffer
 			)
 		);
+
+		// Standalone cube triangles in the coral's own space seed the compute amplification.
+		CoralSubdivision::BuildSeedTriangles(cubeVertices, cubeIndices, ARRAYSIZE(cubeIndices), XMFLOAT3(0.0f, 0.0f, 0.0f), m_seedTriangles);
+		CreateAmplificationResources(m_seedTriangles);
+
+		// Bounding sphere of the seed, which the impostor is baked around.
+		XMVECTOR minimum = XMVectorReplicate(std::numeric_limits<float>::max());
+		XMVECTOR maximum = XMVectorReplicate(-std::numeric_limits<float>::max());
+		for (const CoralTriangle& triangle : m_seedTriangles)
+		{
+			for (const CoralVertex& vertex : triangle.vertices)
+			{
+				minimum = XMVectorMin(minimum, XMLoadFloat3(&vertex.pos));
+				maximum = XMVectorMax(maximum, XMLoadFloat3(&vertex.pos));
+			}
+		}
+
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f));
+		float radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(maximum, minimum))) + P04_CORAL_MARGIN;
+		m_coralBounds = { center.x, center.y, center.z, radius };
+		UpdateWorldBounds();
+
+		// One impostor instance, written by Render at the coral's world space centre.
+		CD3D11_BUFFER_DESC instanceDesc(sizeof(VertexPositionColorNormal), D3D11_BIND_VERTEX_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&instanceDesc,
+				nullptr,
+				&m_impostorInstanceBuffer
+			)
+		);
+
+		m_amplifyTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		m_drawTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
 		});
 
 	// Once the cube is loaded, the object is ready to be rendered.
-	execPipelines.then([this]() {
+	(execPipelines && m_coralImpostor.CreateDeviceDependentResources()).then([this]() {
 		m_loadingComplete = true;
 		});
 }
@@ -207,7 +325,52 @@ void P04_Explicit::CreateDeviceDependentResources()
 void P04_Explicit::Update(DX::StepTimer const& timer)
 {
 	ProcessInput(timer);
-	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMMatrixIdentity()));
+
+	if (m_loadingComplete && m_isReferenceDirty) RunReferenceSubdivision();
+
+	// Take over a finished CPU coral and start streaming it from the beginning.
+	if (m_generatorReady)
+	{
+		m_generatedTriangles.swap(m_pendingTriangles);
+		std::vector<CoralTriangle>().swap(m_pendingTriangles);
+		m_generatorStatistics = m_pendingStatistics;
+
+		CD3D11_BUFFER_DESC generatedBufferDesc(
+			static_cast<UINT>(m_generatedTriangles.size() * sizeof(CoralTriangle)),
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DEFAULT,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(CoralTriangle)
+		);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&generatedBufferDesc,
+				nullptr,
+				m_generatedBuffer.ReleaseAndGetAddressOf()
+			)
+		);
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC generatedViewDesc(m_generatedBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(m_generatedTriangles.size()));
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateShaderResourceView(
+				m_generatedBuffer.Get(),
+				&generatedViewDesc,
+				m_generatedView.ReleaseAndGetAddressOf()
+			)
+		);
+
+		m_uploadedTriangleCount = 0;
+		m_generatorReady = false;
+		m_generatorInFlight = false;
+	}
+
+	// The CPU coral is generated the first time its mode is selected, and again
+	// once the coral has moved, since its colours depend on where it stands.
+	if (m_loadingComplete && m_amplificationMode == AmplificationMode::Cpu && (!m_generatedBuffer || m_isGeneratorStale) && !m_generatorInFlight)
+	{
+		GenerateCoralAsync();
+	}
 }
 
 // Renders one frame using the vertex and pixel shaders.
@@ -221,6 +384,23 @@ void P04_Explicit::Render()
 
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
+	m_amplifyTimer.Resolve(context);
+	m_drawTimer.Resolve(context);
+	ReadBackTriangleCount();
+
+	bool isComputeMode = m_amplificationMode == AmplificationMode::ComputeShader;
+	bool isCpuMode = m_amplificationMode == AmplificationMode::Cpu;
+
+	// The coral is static, so the compute passes only run when the level changes.
+	if (isComputeMode && m_isAmplificationDirty) Amplify();
+
+	// Generated corals are uploaded a chunk per frame and drawn as far as they have arrived.
+	if (isCpuMode)
+	{
+		StreamCoral();
+		if (m_uploadedTriangleCount == 0) return;
+	}
+
 	// Prepare the constant buffer to send it to the graphics device.
 	context->UpdateSubresource1(
 		m_mvpBuffer.Get(),
@@ -232,34 +412,113 @@ void P04_Explicit::Render()
 		0
 	);
 
-	// Each vertex is one instance of the VertexPositionColor struct.
-	UINT stride = sizeof(VertexPositionColorNormal);
-	UINT offset = 0;
+	// The impostor sits at the coral's world space centre.
+	if (m_isImpostorInstanceDirty)
+	{
+		VertexPositionColorNormal instance = { XMFLOAT3(m_coralWorldBounds.x, m_coralWorldBounds.y, m_coralWorldBounds.z), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+		context->UpdateSubresource1(m_impostorInstanceBuffer.Get(), 0, NULL, &instance, 0, 0, 0);
+		m_isImpostorInstanceDirty = false;
+	}
 
-	context->IASetVertexBuffers(
-		0,
-		1,
-		m_vertexBuffer.GetAddressOf(),
-		&stride,
-		&offset
-	);
+	// There is one coral, so the selector holds a single object.
+	m_coralLod.BeginFrame();
+	float size = m_isLodEnabled ?
+		LodSelector::ProjectedSize(m_lodView, m_coralWorldBounds.x, m_coralWorldBounds.y, m_coralWorldBounds.z, m_coralWorldBounds.radius) :
+		std::numeric_limits<float>::max();
+	LodLevel level = m_coralLod.Update(0, size);
 
-	context->IASetIndexBuffer(
-		m_indexBuffer.Get(),
-		DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
-		0
-	);
+	// The impostor atlas is baked on the first frame the shaders are ready.
+	if (!m_coralImpostor.IsBaked()) BakeCoralImpostor();
 
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST); //TRIANGLELIST
+	// Rasterization
+	context->RSSetState(m_rasterizerState.Get());
 
-	context->IASetInputLayout(m_inputLayout.Get());
+	m_drawTimer.Start(context);
 
-	// Attach our vertex shader.
-	context->VSSetShader(
-		m_vertexShader.Get(),
-		nullptr,
-		0
-	);
+	if (level == LodLevel::Full)
+	{
+		DrawCoral(m_amplificationMode);
+	}
+	else if (level == LodLevel::Simplified)
+	{
+		DrawSeedTriangles();
+	}
+	else
+	{
+		m_coralImpostor.Draw(m_impostorInstanceBuffer.Get(), 0, 1, m_coralWorldBounds.radius, m_mvpBuffer.Get(), m_cameraBufferData.position);
+	}
+
+	m_drawTimer.Stop(context);
+}
+
+// Draws the coral as amplified by the given mode.
+void P04_Explicit::DrawCoral(AmplificationMode mode)
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	bool isComputeMode = mode == AmplificationMode::ComputeShader;
+	bool isCpuMode = mode == AmplificationMode::Cpu;
+
+	if (isComputeMode || isCpuMode)
+	{
+		// Triangles are fetched from the structured buffer, so there is no vertex input.
+		context->IASetInputLayout(nullptr);
+
+		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		// Send the constant buffer to the graphics device.
+		context->VSSetConstantBuffers1(
+			0,
+			1,
+			m_mvpBuffer.GetAddressOf(),
+			nullptr,
+			nullptr
+		);
+
+		context->VSSetShaderResources(
+			0,
+			1,
+			isCpuMode ? m_generatedView.GetAddressOf() : m_triangleViews[m_outputBufferIndex].GetAddressOf()
+		);
+
+		// Attach our triangle vertex shader.
+		context->VSSetShader(
+			m_triangleVertexShader.Get(),
+			nullptr,
+			0
+		);
+	}
+	else
+	{
+		// Each vertex is one instance of the VertexPositionColor struct.
+		UINT stride = sizeof(VertexPositionColorNormal);
+		UINT offset = 0;
+
+		context->IASetVertexBuffers(
+			0,
+			1,
+			m_vertexBuffer.GetAddressOf(),
+			&stride,
+			&offset
+		);
+
+		context->IASetIndexBuffer(
+			m_indexBuffer.Get(),
+			DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
+			0
+		);
+
+		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST); //TRIANGLELIST
+
+		context->IASetInputLayout(m_inputLayout.Get());
+
+		// Attach our vertex shader.
+		context->VSSetShader(
+			m_vertexShader.Get(),
+			nullptr,
+			0
+		);
+	}
 
 	// Detach our hull shader.
 	context->HSSetShader(
@@ -275,39 +534,343 @@ void P04_Explicit::Render()
 		0
 	);
 
-	// Send the constant buffer to the graphics device.
-	context->GSSetConstantBuffers1(
-		0,
-		1,
-		m_mvpBuffer.GetAddressOf(),
+	if (isComputeMode || isCpuMode)
+	{
+		// Detach our geometry shader.
+		context->GSSetShader(
+			nullptr,
+			nullptr,
+			0
+		);
+	}
+	else
+	{
+		// Send the constant buffer to the graphics device.
+		context->GSSetConstantBuffers1(
+			0,
+			1,
+			m_mvpBuffer.GetAddressOf(),
+			nullptr,
+			nullptr
+		);
+
+		// Attach our geometry shader.
+		context->GSSetShader(
+			m_geometryShader.Get(),
+			nullptr,
+			0
+		);
+	}
+
+	// Attach our pixel shader.
+	context->PSSetShader(
+		m_pixelShader.Get(),
 		nullptr,
-		nullptr
+		0
 	);
 
-	// Attach our geometry shader.
-	context->GSSetShader(
-		m_geometryShader.Get(),
+	// Draw the object.
+	if (isComputeMode)
+	{
+		context->DrawInstancedIndirect(
+			m_drawArgsBuffer.Get(),
+			0
+		);
+
+		ID3D11ShaderResourceView* nullView = nullptr;
+		context->VSSetShaderResources(0, 1, &nullView);
+	}
+	else if (isCpuMode)
+	{
+		context->DrawInstanced(
+			3,
+			static_cast<UINT>(m_uploadedTriangleCount),
+			0,
+			0
+		);
+
+		ID3D11ShaderResourceView* nullView = nullptr;
+		context->VSSetShaderResources(0, 1, &nullView);
+	}
+	else
+	{
+		context->DrawIndexed(
+			m_indexCount,
+			0,
+			0
+		);
+	}
+}
+
+// The unamplified cube, one instance per seed triangle.
+void P04_Explicit::DrawSeedTriangles()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	context->VSSetConstantBuffers1(0, 1, m_mvpBuffer.GetAddressOf(), nullptr, nullptr);
+	context->VSSetShaderResources(0, 1, m_seedView.GetAddressOf());
+	context->VSSetShader(m_triangleVertexShader.Get(), nullptr, 0);
+
+	context->HSSetShader(nullptr, nullptr, 0);
+	context->DSSetShader(nullptr, nullptr, 0);
+	context->GSSetShader(nullptr, nullptr, 0);
+
+	context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+
+	context->DrawInstanced(3, static_cast<UINT>(m_seedTriangles.size()), 0, 0);
+
+	ID3D11ShaderResourceView* nullView = nullptr;
+	context->VSSetShaderResources(0, 1, &nullView);
+}
+
+// Draws the geometry shader coral into every cell of the impostor atlas, in the
+// coral's own space, then puts the scene's matrices back.
+void P04_Explicit::BakeCoralImpostor()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	ModelViewProjectionConstantBuffer sceneMatrices = m_mvpBufferData;
+	XMFLOAT3 center(m_coralBounds.x, m_coralBounds.y, m_coralBounds.z);
+
+	m_coralImpostor.Bake(center, m_coralBounds.radius, [this, context](const XMMATRIX& view, const XMMATRIX& projection) {
+		XMStoreFloat4x4(&m_mvpBufferData.view, XMMatrixTranspose(view));
+		XMStoreFloat4x4(&m_mvpBufferData.projection, XMMatrixTranspose(projection));
+		XMStoreFloat4x4(&m_mvpBufferData.viewProjection, XMMatrixTranspose(XMMatrixMultiply(view, projection)));
+		m_mvpBufferData.modelViewProjection = m_mvpBufferData.viewProjection;
+		context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+
+		DrawCoral(AmplificationMode::GeometryShader);
+		});
+
+	m_mvpBufferData = sceneMatrices;
+	context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+}
+
+// The coral's bounds and per-level costs, for the LOD report.
+LodObjectSet P04_Explicit::GetLodObjects()
+{
+	LodObjectSet set;
+	set.name = "coral";
+	set.thresholds = P04_CORAL_LOD;
+	set.isInstanced = false;
+	set.spheres.push_back(m_coralWorldBounds);
+
+	size_t fullTriangles = m_seedTriangles.size() * 3;
+	if (m_amplificationMode == AmplificationMode::ComputeShader) fullTriangles = CoralSubdivision::GetTriangleCount(m_seedTriangles.size(), m_amplificationLevel);
+	else if (m_amplificationMode == AmplificationMode::Cpu) fullTriangles = m_generatedTriangles.size();
+
+	set.triangles[0] = static_cast<uint32_t>(fullTriangles);
+	set.triangles[1] = static_cast<uint32_t>(m_seedTriangles.size());
+	set.triangles[2] = 2;
+	return set;
+}
+
+// Runs one compute pass per level, ping-ponging between the two triangle buffers.
+void P04_Explicit::Amplify()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	ID3D11ShaderResourceView* nullView = nullptr;
+	ID3D11UnorderedAccessView* nullAppendView = nullptr;
+
+	m_amplifyTimer.Start(context);
+
+	context->CSSetShader(
+		m_computeShader.Get(),
 		nullptr,
 		0
 	);
 
-	// Rasterization
-	context->RSSetState(m_rasterizerState.Get());
+	ID3D11ShaderResourceView* inputView = m_seedView.Get();
+	UINT triangleCount = static_cast<UINT>(m_seedTriangles.size());
 
-	// Attach our pixel shader.
-	context->PSSetShader(
-		m_pixelShader.Get(),
+	for (uint32 level = 0; level < m_amplificationLevel; level++)
+	{
+		UINT output = level % 2;
+
+		AmplificationConstantBuffer amplificationData = { m_mvpBufferData.model, triangleCount, XMFLOAT3(0.0f, 0.0f, 0.0f) };
+		context->UpdateSubresource1(
+			m_amplificationBuffer.Get(),
+			0,
+			NULL,
+			&amplificationData,
+			0,
+			0,
+			0
+		);
+
+		// The append counter restarts at zero for every level.
+		UINT initialCount = 0;
+		context->CSSetConstantBuffers1(0, 1, m_amplificationBuffer.GetAddressOf(), nullptr, nullptr);
+		context->CSSetShaderResources(0, 1, &inputView);
+		context->CSSetUnorderedAccessViews(0, 1, m_triangleAppendViews[output].GetAddressOf(), &initialCount);
+
+		context->Dispatch((triangleCount + 63) / 64, 1, 1);
+
+		// Unbind so this level's output can be read by the next one.
+		context->CSSetUnorderedAccessViews(0, 1, &nullAppendView, nullptr);
+		context->CSSetShaderResources(0, 1, &nullView);
+
+		inputView = m_triangleViews[output].Get();
+		triangleCount *= 3;
+		m_outputBufferIndex = output;
+	}
+
+	context->CSSetShader(
+		nullptr,
 		nullptr,
 		0
 	);
 
-	// Draw the object.
-	context->DrawIndexed(
-		m_indexCount,
+	// The appended triangle count becomes the instance count of the indirect draw.
+	context->CopyStructureCount(m_drawArgsBuffer.Get(), sizeof(UINT), m_triangleAppendViews[m_outputBufferIndex].Get());
+	context->CopyStructureCount(m_countReadbackBuffer.Get(), 0, m_triangleAppendViews[m_outputBufferIndex].Get());
+
+	m_amplifyTimer.Stop(context);
+
+	m_isCountReadbackPending = true;
+	m_isAmplificationDirty = false;
+}
+
+void P04_Explicit::CreateAmplificationResources(const std::vector<CoralTriangle>& seed)
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Seed triangles, read by the first level.
+	D3D11_SUBRESOURCE_DATA seedBufferData = { 0 };
+	seedBufferData.pSysMem = seed.data();
+	seedBufferData.SysMemPitch = 0;
+	seedBufferData.SysMemSlicePitch = 0;
+	CD3D11_BUFFER_DESC seedBufferDesc(
+		static_cast<UINT>(seed.size() * sizeof(CoralTriangle)),
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_DEFAULT,
+		0,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(CoralTriangle)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&seedBufferDesc, &seedBufferData, &m_seedBuffer));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC seedViewDesc(m_seedBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(seed.size()));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_seedBuffer.Get(), &seedViewDesc, &m_seedView));
+
+	// Two buffers sized for the deepest level, alternating as input and output.
+	UINT capacity = static_cast<UINT>(CoralSubdivision::GetTriangleCount(seed.size(), P04_MAX_AMPLIFICATION_LEVEL));
+	CD3D11_BUFFER_DESC triangleBufferDesc(
+		capacity * sizeof(CoralTriangle),
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+		D3D11_USAGE_DEFAULT,
+		0,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(CoralTriangle)
+	);
+
+	for (UINT i = 0; i < 2; i++)
+	{
+		DX::ThrowIfFailed(device->CreateBuffer(&triangleBufferDesc, nullptr, &m_triangleBuffers[i]));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC triangleViewDesc(m_triangleBuffers[i].Get(), DXGI_FORMAT_UNKNOWN, 0, capacity);
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_triangleBuffers[i].Get(), &triangleViewDesc, &m_triangleViews[i]));
+
+		CD3D11_UNORDERED_ACCESS_VIEW_DESC appendViewDesc(m_triangleBuffers[i].Get(), DXGI_FORMAT_UNKNOWN, 0, capacity, D3D11_BUFFER_UAV_FLAG_APPEND);
+		DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_triangleBuffers[i].Get(), &appendViewDesc, &m_triangleAppendViews[i]));
+	}
+
+	// DrawInstancedIndirect arguments: three vertices per instance, one instance per triangle.
+	static const UINT drawArgs[] = { 3, 0, 0, 0 };
+
+	D3D11_SUBRESOURCE_DATA drawArgsData = { 0 };
+	drawArgsData.pSysMem = drawArgs;
+	drawArgsData.SysMemPitch = 0;
+	drawArgsData.SysMemSlicePitch = 0;
+	CD3D11_BUFFER_DESC drawArgsDesc(sizeof(drawArgs), 0, D3D11_USAGE_DEFAULT, 0, D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS);
+	DX::ThrowIfFailed(device->CreateBuffer(&drawArgsDesc, &drawArgsData, &m_drawArgsBuffer));
+
+	// Staging copy of the final append count, checked against the reference implementation.
+	CD3D11_BUFFER_DESC readbackDesc(sizeof(UINT), 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+	DX::ThrowIfFailed(device->CreateBuffer(&readbackDesc, nullptr, &m_countReadbackBuffer));
+}
+
+// Reads the GPU triangle count once the copy has landed, without stalling.
+void P04_Explicit::ReadBackTriangleCount()
+{
+	if (!m_isCountReadbackPending) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	D3D11_MAPPED_SUBRESOURCE mappedCount;
+	if (context->Map(m_countReadbackBuffer.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedCount) == S_OK)
+	{
+		m_gpuTriangleCount = *static_cast<const UINT*>(mappedCount.pData);
+		context->Unmap(m_countReadbackBuffer.Get(), 0);
+		m_isCountReadbackPending = false;
+	}
+}
+
+// Generates the CPU coral on a worker task; the subdivision itself runs on every core.
+void P04_Explicit::GenerateCoralAsync()
+{
+	m_generatorInFlight = true;
+
+	uint32 level = m_generatorLevel;
+	uint32 seed = m_generatorSeed;
+	XMFLOAT4X4 world = GetWorldMatrix();
+	m_isGeneratorStale = false;
+
+	Concurrency::create_task([this, world, level, seed]() {
+		m_pendingStatistics = CoralGenerator::Generate(m_seedTriangles, world, level, seed, m_pendingTriangles);
+		m_generatorReady = true;
+		});
+}
+
+// Copies the next chunk of the generated coral into the GPU buffer.
+void P04_Explicit::StreamCoral()
+{
+	size_t triangleCount = m_generatorStatistics.triangleCount;
+	if (!m_generatedBuffer || m_uploadedTriangleCount >= triangleCount) return;
+
+	size_t chunk = std::min(P04_UPLOAD_CHUNK_TRIANGLES, triangleCount - m_uploadedTriangleCount);
+
+	D3D11_BOX box;
+	box.left = static_cast<UINT>(m_uploadedTriangleCount * sizeof(CoralTriangle));
+	box.right = static_cast<UINT>((m_uploadedTriangleCount + chunk) * sizeof(CoralTriangle));
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+
+	m_deviceResources->GetD3DDeviceContext()->UpdateSubresource1(
+		m_generatedBuffer.Get(),
+		0,
+		&box,
+		&m_generatedTriangles[m_uploadedTriangleCount],
+		0,
 		0,
 		0
 	);
 
+	m_uploadedTriangleCount += chunk;
+
+	// The GPU copy is all that is drawn from now on.
+	if (m_uploadedTriangleCount == triangleCount)
+	{
+		std::vector<CoralTriangle>().swap(m_generatedTriangles);
+	}
+}
+
+// Times the C++ reference subdivision at the current level.
+void P04_Explicit::RunReferenceSubdivision()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	CoralSubdivision::Subdivide(m_seedTriangles, GetWorldMatrix(), m_amplificationLevel, m_referenceTriangles);
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	m_referenceMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	m_isReferenceDirty = false;
 }
 
 void P04_Explicit::ReleaseDeviceDependentResources()
@@ -321,13 +884,75 @@ void P04_Explicit::ReleaseDeviceDependentResources()
 	m_cameraBuffer.Reset();
 	m_vertexBuffer.Reset();
 	m_indexBuffer.Reset();
+	m_computeShader.Reset();
+	m_triangleVertexShader.Reset();
+	m_seedBuffer.Reset();
+	m_seedView.Reset();
+	for (UINT i = 0; i < 2; i++)
+	{
+		m_triangleBuffers[i].Reset();
+		m_triangleViews[i].Reset();
+		m_triangleAppendViews[i].Reset();
+	}
+	m_drawArgsBuffer.Reset();
+	m_countReadbackBuffer.Reset();
+	m_amplificationBuffer.Reset();
+	m_generatedBuffer.Reset();
+	m_generatedView.Reset();
+	m_uploadedTriangleCount = 0;
+	m_impostorInstanceBuffer.Reset();
+	m_coralImpostor.ReleaseDeviceDependentResources();
+	m_amplifyTimer.ReleaseDeviceDependentResources();
+	m_drawTimer.ReleaseDeviceDependentResources();
+	m_isAmplificationDirty = true;
+	m_isCountReadbackPending = false;
 }
 
-void P04_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection)
+// The coral's world matrix from its scene graph node, not transposed. Must come
+// before SetViewProjectionMatrixConstantBuffer, which combines the two.
+void P04_Explicit::SetModelMatrix(const DirectX::XMFLOAT4X4& model)
+{
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&model)));
+	UpdateWorldBounds();
+
+	// The amplified triangles are coloured by their world position.
+	m_isAmplificationDirty = true;
+	m_isReferenceDirty = true;
+	m_isGeneratorStale = true;
+}
+
+// The coral's world matrix, not transposed.
+DirectX::XMFLOAT4X4 P04_Explicit::GetWorldMatrix()
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranspose(XMLoadFloat4x4(&m_mvpBufferData.model)));
+	return world;
+}
+
+// Moves the seed's bounds into world space, for the level of detail and impostor.
+void P04_Explicit::UpdateWorldBounds()
+{
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&m_mvpBufferData.model));
+
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(m_coralBounds.x, m_coralBounds.y, m_coralBounds.z, 1.0f), world));
+	float scale = std::max(XMVectorGetX(XMVector3Length(world.r[0])),
+		std::max(XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2]))));
+
+	m_coralWorldBounds = { center.x, center.y, center.z, m_coralBounds.radius * scale };
+	m_isImpostorInstanceDirty = true;
+}
+
+void P04_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection, DirectX::XMFLOAT4X4& viewProjection)
 {
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.view, DirectX::XMMatrixTranspose(view));
 
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.projection, DirectX::XMMatrixTranspose(projection));
+
+	// Both matrices are already transposed, so (M * VP)^T = VP^T * M^T.
+	m_mvpBufferData.viewProjection = viewProjection;
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.modelViewProjection,
+		DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&viewProjection), DirectX::XMLoadFloat4x4(&m_mvpBufferData.model)));
 }
 
 void P04_Explicit::SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition)
@@ -350,6 +975,54 @@ void P04_Explicit::ProcessInput(DX::StepTimer const& timer)
 		auto device = m_deviceResources->GetD3DDevice();
 		device->CreateRasterizerState(&rasterizerDesc, m_rasterizerState.GetAddressOf());
 	}
+
+	if (IsKeyToggled(VirtualKey::G))
+	{
+		if (m_amplificationMode == AmplificationMode::GeometryShader)		m_amplificationMode = AmplificationMode::ComputeShader;
+		else if (m_amplificationMode == AmplificationMode::ComputeShader)	m_amplificationMode = AmplificationMode::Cpu;
+		else																m_amplificationMode = AmplificationMode::GeometryShader;
+		m_isAmplificationDirty = true;
+	}
+
+	// The CPU generator has its own depth and seed; changes wait for the current coral to finish.
+	if (m_amplificationMode == AmplificationMode::Cpu && m_loadingComplete && !m_generatorInFlight)
+	{
+		if (IsKeyToggled(VirtualKey::Number1) && m_generatorLevel > 1)
+		{
+			m_generatorLevel--;
+			GenerateCoralAsync();
+		}
+
+		if (IsKeyToggled(VirtualKey::Number2) && m_generatorLevel < P04_MAX_GENERATOR_LEVEL)
+		{
+			m_generatorLevel++;
+			GenerateCoralAsync();
+		}
+
+		if (IsKeyToggled(VirtualKey::N))
+		{
+			m_generatorSeed++;
+			GenerateCoralAsync();
+		}
+	}
+
+	// Subdivision levels only apply to the compute path; the geometry shader is fixed at one.
+	if (m_amplificationMode == AmplificationMode::ComputeShader)
+	{
+		if (IsKeyToggled(VirtualKey::Number1) && m_amplificationLevel > 1)
+		{
+			m_amplificationLevel--;
+			m_isAmplificationDirty = true;
+			m_isReferenceDirty = true;
+		}
+
+		if (IsKeyToggled(VirtualKey::Number2) && m_amplificationLevel < P04_MAX_AMPLIFICATION_LEVEL)
+		{
+			m_amplificationLevel++;
+			m_isAmplificationDirty = true;
+			m_isReferenceDirty = true;
+		}
+	}
 }
 
 bool P04_Explicit::IsKeyPressed(VirtualKey key)
@@ -359,4 +1032,14 @@ bool P04_Explicit::IsKeyPressed(VirtualKey key)
 
 	if ((currentKeyState & keyDownState) == keyDownState) return true;
 	return false;
-}
\ No newline at end of file
+}
+
+// True only on the frame the key goes down, so toggles do not repeat while held.
+bool P04_Explicit::IsKeyToggled(VirtualKey key)
+{
+	bool isDown = IsKeyPressed(key);
+	bool wasDown = m_keyWasDown[key];
+	m_keyWasDown[key] = isDown;
+
+	return isDown && !wasDown;
+}
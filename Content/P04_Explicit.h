@@ -2,7 +2,15 @@
 
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
+#include "..\Common\GpuTimer.h"
 #include "ShaderStructures.h"
+#include "CoralSubdivision.h"
+#include "CoralGenerator.h"
+#include "LodSelector.h"
+#include "ImpostorAtlas.h"
+
+#include <atomic>
+#include <map>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
@@ -10,16 +18,31 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	// 
 	// Coral object created by transforming a simple triangle mesh 
 	// using a geometry shader.
+	//
+	// The same amplification can run as a chain of compute passes that append
+	// into a structured buffer, drawn with DrawInstancedIndirect, or be generated
+	// on the CPU and streamed to the GPU a chunk at a time.
+	//
+	// From further away the coral drops to the bare seed cube, then to a
+	// billboard impostor baked from the geometry shader coral at startup.
 
 	using namespace Windows::System;
 	using namespace Windows::UI::Core;
 
+	enum class AmplificationMode
+	{
+		GeometryShader,
+		ComputeShader,
+		Cpu
+	};
+
 	class P04_Explicit
 	{
 	public:
 		P04_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		void CreateDeviceDependentResources();
-		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection);
+		void SetModelMatrix(const DirectX::XMFLOAT4X4& model);
+		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection, DirectX::XMFLOAT4X4& viewProjection);
 		void SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition);
 		void ReleaseDeviceDependentResources();
 		void Update(DX::StepTimer const& timer);
@@ -28,6 +51,38 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	private:
 		void ProcessInput(DX::StepTimer const& timer);
 		bool IsKeyPressed(VirtualKey key);
+		bool IsKeyToggled(VirtualKey key);
+		void CreateAmplificationResources(const std::vector<CoralTriangle>& seed);
+		void RunReferenceSubdivision();
+		void Amplify();
+		void ReadBackTriangleCount();
+		void GenerateCoralAsync();
+		void StreamCoral();
+		void DrawCoral(AmplificationMode mode);
+		void DrawSeedTriangles();
+		void BakeCoralImpostor();
+		void UpdateWorldBounds();
+		DirectX::XMFLOAT4X4 GetWorldMatrix();
+
+	public:
+		AmplificationMode GetAmplificationMode()		{ return m_amplificationMode; }
+		uint32 GetAmplificationLevel()					{ return m_amplificationLevel; }
+		uint32 GetGpuTriangleCount()					{ return m_gpuTriangleCount; }
+		size_t GetReferenceTriangleCount()				{ return m_referenceTriangles.size(); }
+		double GetReferenceMilliseconds()				{ return m_referenceMilliseconds; }
+		double GetAmplifyGpuMilliseconds()				{ return m_amplifyTimer.GetMilliseconds(); }
+		double GetDrawGpuMilliseconds()					{ return m_drawTimer.GetMilliseconds(); }
+		uint32 GetGeneratorLevel()						{ return m_generatorLevel; }
+		uint32 GetGeneratorSeed()						{ return m_generatorSeed; }
+		size_t GetUploadedTriangleCount()				{ return m_uploadedTriangleCount; }
+		bool IsGeneratorBusy()							{ return m_generatorInFlight; }
+		CoralGeneratorStatistics GetGeneratorStatistics() { return m_generatorStatistics; }
+		LodLevel GetLodLevel()							{ return m_coralLod.GetLevel(0); }
+
+		// The level is picked from the camera of the last SetLodView.
+		void SetLodView(const LodView& view)			{ m_lodView = view; }
+		void SetLodEnabled(bool isEnabled)				{ m_isLodEnabled = isEnabled; }
+		LodObjectSet GetLodObjects();
 
 	private:
 		// Cached pointer to device resources.
@@ -43,6 +98,22 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		Microsoft::WRL::ComPtr<ID3D11GeometryShader>	m_geometryShader;
 		Microsoft::WRL::ComPtr<ID3D11PixelShader>	    m_pixelShader;
 
+		// Compute amplification
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_computeShader;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>		m_triangleVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_seedBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_seedView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_triangleBuffers[2];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_triangleViews[2];
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_triangleAppendViews[2];
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_drawArgsBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_countReadbackBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_amplificationBuffer;
+
+		// CPU generated coral, filled in chunks
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_generatedBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_generatedView;
+
 		// Rasterization
 		Microsoft::WRL::ComPtr<ID3D11RasterizerState>	m_rasterizerState;
 
@@ -55,8 +126,46 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		CameraTrackingBuffer							m_cameraBufferData;
 		uint32											m_indexCount;
 
+		// Amplification state
+		AmplificationMode								m_amplificationMode;
+		uint32											m_amplificationLevel;
+		uint32											m_outputBufferIndex;
+		uint32											m_gpuTriangleCount;
+		std::vector<CoralTriangle>						m_seedTriangles;
+		std::vector<CoralTriangle>						m_referenceTriangles;
+		double											m_referenceMilliseconds;
+		DX::GpuTimer									m_amplifyTimer;
+		DX::GpuTimer									m_drawTimer;
+		std::map<VirtualKey, bool>						m_keyWasDown;
+
+		// CPU generator state. The worker fills m_pendingTriangles and raises
+		// m_generatorReady; Update takes the result over on the render thread.
+		uint32											m_generatorLevel;
+		uint32											m_generatorSeed;
+		std::vector<CoralTriangle>						m_generatedTriangles;
+		std::vector<CoralTriangle>						m_pendingTriangles;
+		CoralGeneratorStatistics						m_generatorStatistics;
+		CoralGeneratorStatistics						m_pendingStatistics;
+		size_t											m_uploadedTriangleCount;
+		std::atomic<bool>								m_generatorReady;
+		std::atomic<bool>								m_generatorInFlight;
+		bool											m_isGeneratorStale;
+
+		// Distance level of detail
+		LodSelector										m_coralLod;
+		LodView											m_lodView;
+		LodSphere										m_coralBounds;			// In the coral's own space.
+		LodSphere										m_coralWorldBounds;
+		ImpostorAtlas									m_coralImpostor;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_impostorInstanceBuffer;
+		bool											m_isLodEnabled;
+		bool											m_isImpostorInstanceDirty;
+
 		// Variables used with the rendering loop.
 		bool											m_isWireframe;
+		bool											m_isAmplificationDirty;
+		bool											m_isCountReadbackPending;
+		bool											m_isReferenceDirty;
 		bool											m_loadingComplete;
 	};
 }
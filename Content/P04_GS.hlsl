@@ -5,6 +5,8 @@ cbuffer ModelViewProjectionConstantBuffer : register(b0)
     matrix model;
     matrix view;
     matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
 };
 
 struct GS_INPUT
@@ -21,6 +23,12 @@ struct GS_OUTPUT
     float3 normal : TEXCOORD0;
 };
 
+// Shader cost per emitted vertex, counted by hand from the HLSL
+// (not taken from an fxc listing; the .asm from AssemblerOutput can confirm it):
+// model, view and projection were three separate float4x4 products (12 dp4),
+// now a single product with the CPU-combined modelViewProjection (4 dp4).
+// The vertex colour is computed once per input triangle instead of per vertex.
+
 [maxvertexcount(24)]
 void main(
 	triangle GS_INPUT input[3] : SV_POSITION,
@@ -37,6 +45,9 @@ void main(
     float3 m0 = (p0 + p1) / 2.0;
     float3 m1 = (p1 + p2) / 2.0;
     float3 m2 = (p2 + p0) / 2.0;
+
+    // The colour follows where the triangle lies in the world, not in the coral's own space
+    float4 color = float4((sign(mul(float4(p0, 1.0), model).xy) + 1.0) / 2.0, 1.0, 1.0);
     
     // Triangle 1
     
@@ -46,27 +57,21 @@ void main(
     float3 faceNormal = normalize(cross(edge1, edge2));
     
     output.pos = float4(p0 + float3(1.0, 1.0, 1.0) * faceNormal, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = -faceNormal;
-    output.color =  float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0); // float4(1.0, 0.0, 0.0, 1.0); // input[0].color;
+    output.color = color; // float4(1.0, 0.0, 0.0, 1.0); // input[0].color;
     OutputStream.Append(output);
     
     output.pos = float4(m0, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     output.pos = float4(m2, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     // End the current primitive
@@ -80,27 +85,21 @@ void main(
     faceNormal = normalize(cross(edge1, edge2));
     
     output.pos = float4(m0, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     output.pos = float4(p1 + float3(1.0, 1.0, 1.0) * faceNormal, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     output.pos = float4(m1, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = -faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     // End the current primitive
@@ -115,27 +114,21 @@ void main(
     faceNormal = normalize(cross(edge1, edge2));
     
     output.pos = float4(m2, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = -faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     output.pos = float4(m1, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     output.pos = float4(p2 + float3(1.0, 1.0, 1.0) * faceNormal, 1.0);
-    output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
+    output.pos = mul(output.pos, modelViewProjection);
     output.normal = faceNormal;
-    output.color = float4((sign(p0.xy) + 1.0) / 2.0, 1.0, 1.0);
+    output.color = color;
     OutputStream.Append(output);
     
     // End the current primitive
@@ -16,10 +16,8 @@ VS_OUTPUT main(VS_INPUT input)
 {
     VS_OUTPUT output = (VS_OUTPUT)0;
 
+    // Left in the coral's own space; the geometry shader applies modelViewProjection.
     output.pos = float4(input.pos, 1.0);
-    output.pos.z -= 20;
-    output.pos.y -= 4;
-    output.pos.x -= 20;
     output.color = float4(input.color, 1.0);
     output.normal = input.normal;
 
@@ -0,0 +1,45 @@
+// Draws the triangles produced by P04_CS.hlsl without an input layout.
+// One instance per triangle, SV_VertexID selects the corner.
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+    matrix model;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
+};
+
+struct CoralVertex
+{
+    float3 pos;
+    float3 normal;
+    float4 color;
+};
+
+struct CoralTriangle
+{
+    CoralVertex v[3];
+};
+
+StructuredBuffer<CoralTriangle> triangles : register(t0);
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float4 color : COLOR0;
+    float3 normal : TEXCOORD0;
+};
+
+VS_OUTPUT main(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    VS_OUTPUT output = (VS_OUTPUT)0;
+
+    CoralVertex v = triangles[instanceID].v[vertexID];
+
+    output.pos = mul(float4(v.pos, 1.0), modelViewProjection);
+    output.color = v.color;
+    output.normal = v.normal;
+
+    return output;
+}
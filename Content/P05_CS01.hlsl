@@ -0,0 +1,9 @@
+// Fills the dead list with every particle index. Run once after the buffers are created.
+
+AppendStructuredBuffer<uint> deadList : register(u0);
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    deadList.Append(id.x);
+}
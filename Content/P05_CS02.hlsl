@@ -0,0 +1,34 @@
+// Emits up to emitCount bubbles: each thread takes a free index from the dead
+// list, initialises that particle and appends it to the alive list.
+
+#include "P05_Particles.hlsli"
+
+cbuffer ParticleConstantBuffer : register(b0)
+{
+    float deltaTime;
+    uint emitCount;
+    uint frameIndex;
+    float padding;
+};
+
+cbuffer DeadListCountBuffer : register(b1)
+{
+    uint deadCount;
+    float3 padding2;
+};
+
+RWStructuredBuffer<Particle> particles : register(u0);
+ConsumeStructuredBuffer<uint> deadList : register(u1);
+AppendStructuredBuffer<uint> aliveList : register(u2);
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    // Consuming from an empty list is undefined, so emission stops when the pool is full.
+    if (id.x >= emitCount || id.x >= deadCount)
+        return;
+
+    uint index = deadList.Consume();
+    particles[index] = EmitParticle(id.x, frameIndex);
+    aliveList.Append(index);
+}
@@ -0,0 +1,43 @@
+// Moves every alive bubble. Survivors are appended to the next frame's alive
+// list and the rest return their index to the dead list.
+
+#include "P05_Particles.hlsli"
+
+cbuffer ParticleConstantBuffer : register(b0)
+{
+    float deltaTime;
+    uint emitCount;
+    uint frameIndex;
+    float padding;
+};
+
+cbuffer AliveListCountBuffer : register(b1)
+{
+    uint aliveCount;
+    float3 padding2;
+};
+
+RWStructuredBuffer<Particle> particles : register(u0);
+AppendStructuredBuffer<uint> deadList : register(u1);
+ConsumeStructuredBuffer<uint> aliveList : register(u2);
+AppendStructuredBuffer<uint> nextAliveList : register(u3);
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= aliveCount)
+        return;
+
+    uint index = aliveList.Consume();
+    Particle p = particles[index];
+
+    if (UpdateParticle(p, deltaTime))
+    {
+        particles[index] = p;
+        nextAliveList.Append(index);
+    }
+    else
+    {
+        deadList.Append(index);
+    }
+}
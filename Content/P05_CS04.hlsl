@@ -0,0 +1,50 @@
+// Builds the bubble draw list from this frame's alive list and sorts every block
+// of SORT_GROUP_SIZE entries in groupshared memory. Slots past the alive count
+// are padding and sort to the back.
+
+#include "P05_Particles.hlsli"
+#include "P05_Sort.hlsli"
+
+cbuffer AliveListCountBuffer : register(b1)
+{
+    uint aliveCount;
+    float3 padding2;
+};
+
+StructuredBuffer<Particle> particles : register(t0);
+StructuredBuffer<uint> aliveList : register(t1);
+RWStructuredBuffer<uint2> sortList : register(u0);
+
+groupshared uint2 g_entries[SORT_GROUP_SIZE];
+
+[numthreads(SORT_GROUP_SIZE, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID, uint3 threadID : SV_GroupThreadID)
+{
+    uint2 entry = uint2(g_paddingKey, 0);
+    if (id.x < aliveCount)
+    {
+        uint index = aliveList[id.x];
+        entry = uint2(DepthKey(length(particles[index].position - cameraPosition)), index);
+    }
+
+    g_entries[threadID.x] = entry;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Directions use the global index, so neighbouring blocks come out in
+    // opposite orders, ready for the first global merge.
+    uint groupStart = id.x - threadID.x;
+    for (uint k = 2; k <= SORT_GROUP_SIZE; k <<= 1)
+    {
+        for (uint j = k >> 1; j > 0; j >>= 1)
+        {
+            uint partner = threadID.x ^ j;
+            if (partner > threadID.x)
+            {
+                CompareAndSwap(g_entries[threadID.x], g_entries[partner], groupStart + threadID.x, k);
+            }
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+
+    sortList[id.x] = g_entries[threadID.x];
+}
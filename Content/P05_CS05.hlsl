@@ -0,0 +1,19 @@
+// One bitonic merge step whose compare distance spans more than one thread group.
+
+#include "P05_Sort.hlsli"
+
+RWStructuredBuffer<uint2> sortList : register(u0);
+
+[numthreads(256, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint partner = id.x ^ compareDistance;
+    if (partner > id.x)
+    {
+        uint2 a = sortList[id.x];
+        uint2 b = sortList[partner];
+        CompareAndSwap(a, b, id.x, blockSize);
+        sortList[id.x] = a;
+        sortList[partner] = b;
+    }
+}
@@ -0,0 +1,29 @@
+// Finishes a bitonic merge of sequences of length blockSize: every step from
+// compareDistance down to 1 stays inside one thread group, so they run in
+// groupshared memory in a single dispatch.
+
+#include "P05_Sort.hlsli"
+
+RWStructuredBuffer<uint2> sortList : register(u0);
+
+groupshared uint2 g_entries[SORT_GROUP_SIZE];
+
+[numthreads(SORT_GROUP_SIZE, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID, uint3 threadID : SV_GroupThreadID)
+{
+    g_entries[threadID.x] = sortList[id.x];
+    GroupMemoryBarrierWithGroupSync();
+
+    uint groupStart = id.x - threadID.x;
+    for (uint j = compareDistance; j > 0; j >>= 1)
+    {
+        uint partner = threadID.x ^ j;
+        if (partner > threadID.x)
+        {
+            CompareAndSwap(g_entries[threadID.x], g_entries[partner], groupStart + threadID.x, blockSize);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    sortList[id.x] = g_entries[threadID.x];
+}
@@ -3,17 +3,110 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// The dynamic fish buffer is sized for the largest shoal.
+	const size_t P05_MAX_FISH = 65536;
+	const size_t P05_MIN_FISH = 1000;
+	const size_t P05_DEFAULT_FISH = 10000;
+
+	// A/B benchmark of the fish expansion: each count is drawn with both paths for a
+	// number of frames, and only the later frames are averaged since GPU timestamps
+	// are read back a few frames late.
+	const UINT P05_BENCHMARK_FISH[] = { 10000, 100000, 1000000 };
+	const UINT P05_BENCHMARK_FRAMES = 24;
+	const UINT P05_BENCHMARK_WARMUP_FRAMES = 8;
+
+	// Bubble pool size, a multiple of the compute shaders' 64 thread groups.
+	const UINT P05_MAX_BUBBLES = 16384;
+	const float P05_BUBBLES_PER_SECOND = 1500.0f;
+
+	// Thread group sizes of the sort passes. The whole pool is sorted, so its size
+	// must be a power of two and a multiple of the groupshared block.
+	const UINT P05_SORT_GROUP_SIZE = 1024;
+	const UINT P05_SORT_GLOBAL_GROUP_SIZE = 256;
+
+	// Fish level of detail: projected diameters in pixels, and a bounding radius
+	// around the 0.45 long outline of P05_GS.hlsl.
+	const LodThresholds P05_FISH_LOD = { 24.0f, 10.0f, 0.15f };
+	const float P05_FISH_RADIUS = 0.25f;
+
+	// C++ version of Gradient() in MathUtils.hlsli, used once per fish for its colour.
+	XMFLOAT3 Gradient(float x, float y, float z)
+	{
+		float length = sqrtf(x * x + y * y + z * z);
+		float t = (length > 0.0f) ? (-x + y) / (length * sqrtf(2.0f)) : 0.0f;
+		t = std::min(std::max(t, 0.0f), 1.0f);
+
+		XMFLOAT3 variation(sinf(x * 0.6f), sinf(y * 0.6f), sinf(z * 0.6f));
+		XMFLOAT3 startColor(0.0f + variation.x, 1.0f + variation.y, 1.0f + variation.z);
+		XMFLOAT3 endColor(1.0f + variation.x, 0.0f + variation.y, 0.0f + variation.z);
+
+		return XMFLOAT3(
+			startColor.x + (endColor.x - startColor.x) * t,
+			startColor.y + (endColor.y - startColor.y) * t,
+			startColor.z + (endColor.z - startColor.z) * t);
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 P05_Explicit::P05_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
-	m_indexCount(0),
+	m_simulationMilliseconds(0.0),
+	m_fishExpansion(FishExpansion::VertexShader),
+	m_expansionBenchmarkStage(-1),
+	m_expansionBenchmarkFrame(0),
+	m_expansionBenchmarkSum(0.0),
+	m_expansionBenchmarkSamples(0),
+	m_particleConstantBufferData(),
+	m_aliveListIndex(0),
+	m_isParticlePoolReset(true),
+	m_isBubbleCountReadbackPending(false),
+	m_gpuBubbleCount(0),
+	m_emitAccumulator(0.0f),
+	m_bubbleReference(P05_MAX_BUBBLES),
+	m_bubbleReferenceMilliseconds(0.0),
+	m_sortConstantBufferData(),
+	m_bubbleBlending(BubbleBlending::SortedAlpha),
+	m_fishLod(P05_FISH_LOD),
+	m_lodView(),
+	m_fishImpostor(deviceResources),
+	m_fishLodFirst(),
+	m_isLodEnabled(true),
+	m_isShoalVisible(true),
+	m_areBubblesVisible(true),
+	m_particleBenchmarkReady(false),
+	m_particleBenchmarkInFlight(false),
 	m_deviceResources(deviceResources)
 {
+	// The shoal swims in front of the start camera, where the old grid used to circle.
+	BoidsSettings settings = BoidsSimulation::GetDefaultSettings();
+	settings.boundsMin = { -35.0f, -8.0f, -80.0f };
+	settings.boundsMax = { 35.0f, 10.0f, -20.0f };
+
+	m_simulation = std::unique_ptr<BoidsSimulation>(new BoidsSimulation(settings, 202219807));
+
+	// Corals to swim around: P02, the two P03 surfaces and P04.
+	std::vector<BoidSphere> obstacles;
+	obstacles.push_back({ { 20.0f, 0.0f, -10.0f }, 5.0f });
+	obstacles.push_back({ { 0.0f, 0.0f, 0.0f }, 5.0f });
+	obstacles.push_back({ { -50.0f, 0.0f, 0.0f }, 10.0f });
+	obstacles.push_back({ { -20.0f, -4.0f, -20.0f }, 3.0f });
+	m_simulation->SetObstacles(obstacles);
+
+	SetFishCount(P05_DEFAULT_FISH);
+
 	CreateDeviceDependentResources();
 }
 
@@ -21,10 +114,23 @@ void P05_Explicit::CreateDeviceDependentResources()
 {
 	// Load shaders asynchronously.
 	auto loadPipeline05_VSTask = DX::ReadDataAsync(L"P05_VS.cso");
+	auto loadPipeline05_VS03Task = DX::ReadDataAsync(L"P05_VS03.cso");
 	auto loadPipeline05_GSTask = DX::ReadDataAsync(L"P05_GS.cso");
 	auto loadPipeline05_PSTask = DX::ReadDataAsync(L"P05_PS.cso");
+	auto loadPipeline05_CS01Task = DX::ReadDataAsync(L"P05_CS01.cso");
+	auto loadPipeline05_CS02Task = DX::ReadDataAsync(L"P05_CS02.cso");
+	auto loadPipeline05_CS03Task = DX::ReadDataAsync(L"P05_CS03.cso");
+	auto loadPipeline05_VS02Task = DX::ReadDataAsync(L"P05_VS02.cso");
+	auto loadPipeline05_PS02Task = DX::ReadDataAsync(L"P05_PS02.cso");
+	auto loadPipeline05_CS04Task = DX::ReadDataAsync(L"P05_CS04.cso");
+	auto loadPipeline05_CS05Task = DX::ReadDataAsync(L"P05_CS05.cso");
+	auto loadPipeline05_CS06Task = DX::ReadDataAsync(L"P05_CS06.cso");
+	auto loadPipeline05_PS03Task = DX::ReadDataAsync(L"P05_PS03.cso");
+	auto loadPipeline05_VS04Task = DX::ReadDataAsync(L"P05_VS04.cso");
+	auto loadPipeline05_PS04Task = DX::ReadDataAsync(L"P05_PS04.cso");
 
-	// After the vertex shader file is loaded, create the shader and input layout.
+	// After the vertex shader file is loaded, create the shader, its per-instance
+	// input layout and the constant buffer.
 	auto createPipeline05_VSTask = loadPipeline05_VSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateVertexShader(
@@ -35,10 +141,50 @@ void P05_Explicit::CreateDeviceDependentResources()
 			)
 		);
 
+		// Each fish is one instance; the quad corner comes from SV_VertexID.
+		static const D3D11_INPUT_ELEMENT_DESC instanceDesc[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		};
+
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateInputLayout(
+				instanceDesc,
+				ARRAYSIZE(instanceDesc),
+				&fileData[0],
+				fileData.size(),
+				&m_instanceInputLayout
+			)
+		);
+
+		CD3D11_BUFFER_DESC MVPBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&MVPBufferDesc,
+				nullptr,
+				&m_mvpBuffer
+			)
+		);
+		});
+
+	// Geometry shader path: the same buffer read as a point list.
+	auto createPipeline05_VS03Task = loadPipeline05_VS03Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_pointVertexShader
+			)
+		);
+
 		static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
 		{
 			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 			{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		};
 
 		DX::ThrowIfFailed(
@@ -47,12 +193,11 @@ void P05_Explicit::CreateDeviceDependentResources()
 				ARRAYSIZE(vertexDesc),
 				&fileData[0],
 				fileData.size(),
-				&m_inputLayout
+				&m_pointInputLayout
 			)
 		);
 		});
 
-	// After the geometry shader file is loaded, create the shader and constant buffer.
 	auto createPipeline05_GSTask = loadPipeline05_GSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateGeometryShader(
@@ -62,16 +207,18 @@ void P05_Explicit::CreateDeviceDependentResources()
 				&m_geometryShader
 			)
 		);
+		});
 
-		CD3D11_BUFFER_DESC MVPBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+	// After the pixel shader file is loaded, create the shader and constant buffer.
+	auto createPipeline05_PSTask = loadPipeline05_PSTask.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&MVPBufferDesc,
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
 				nullptr,
-				&m_mvpBuffer
+				&m_pixelShader
 			)
 		);
-
 		CD3D11_BUFFER_DESC CameraBufferDesc(sizeof(CameraTrackingBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
@@ -80,7 +227,6 @@ void P05_Explicit::CreateDeviceDependentResources()
 				&m_cameraBuffer
 			)
 		);
-
 		CD3D11_BUFFER_DESC TimeBufferDesc(sizeof(ElapsedTimeBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
@@ -91,112 +237,178 @@ void P05_Explicit::CreateDeviceDependentResources()
 		);
 		});
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	auto createPipeline05_PSTask = loadPipeline05_PSTask.then([this](const std::vector<byte>& fileData) {
+	// Bubble particle compute passes: pool initialisation, emission and simulation.
+	auto createPipeline05_CS01Task = loadPipeline05_CS01Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_particleInitShader
+			)
+		);
+		});
+
+	auto createPipeline05_CS02Task = loadPipeline05_CS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_particleEmitShader
+			)
+		);
+		});
+
+	auto createPipeline05_CS03Task = loadPipeline05_CS03Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_particleSimulateShader
+			)
+		);
+		});
+
+	// Bubble billboards, expanded in the vertex shader from the alive list.
+	auto createPipeline05_VS02Task = loadPipeline05_VS02Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_bubbleVertexShader
+			)
+		);
+		});
+
+	auto createPipeline05_PS02Task = loadPipeline05_PS02Task.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreatePixelShader(
 				&fileData[0],
 				fileData.size(),
 				nullptr,
-				&m_pixelShader
+				&m_bubblePixelShader
 			)
 		);
-		CD3D11_BUFFER_DESC CameraBufferDesc(sizeof(CameraTrackingBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		});
+
+	// Bubble depth sort: draw list build with block sort, global merge step, local merge.
+	auto createPipeline05_CS04Task = loadPipeline05_CS04Task.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&CameraBufferDesc,
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
 				nullptr,
-				&m_cameraBuffer
+				&m_sortBuildShader
 			)
 		);
-		CD3D11_BUFFER_DESC TimeBufferDesc(sizeof(ElapsedTimeBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		});
+
+	auto createPipeline05_CS05Task = loadPipeline05_CS05Task.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&TimeBufferDesc,
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
 				nullptr,
-				&m_timeBuffer
+				&m_sortGlobalShader
 			)
 		);
 		});
 
-	// Once both shaders are loaded, create the mesh.
-	auto execPipelines = (createPipeline05_PSTask && createPipeline05_GSTask && createPipeline05_VSTask).then([this]() {
-
-		// M x N 2D Grid
-		int m = 10;
-		int n = 10;
-		float w = 10.0f;
-		float d = 10.0f;
-		float halfWidth = 0.5f * w;
-		float halfDepth = 0.5f * d;
-		float dx = w / (n - 1);
-		float dz = d / (m - 1);
-		constexpr float FLOAT_MIN = -10.0f;
-		constexpr float FLOAT_MAX = 10.0f;
-
-		VertexPositionColor gridVertices[100] = {};
-
-		for (int i = 0; i < m; ++i) {
-			float z = halfDepth - i * dz;
-			for (int j = 0; j < n; ++j) {
-				float x = -halfWidth + j * dx;
-				// Flat
-				gridVertices[i * n + j].pos = XMFLOAT3(x, 0.0f, z);
-
-				// White blueprint
-				gridVertices[i * n + j].color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-			}
-		};
+	auto createPipeline05_CS06Task = loadPipeline05_CS06Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateComputeShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_sortLocalShader
+			)
+		);
+		});
 
-		// Create index buffer for m x n grid
-		WORD gridIndices[486] = {};
-		int k = 0;
-
-		for (int i = 0; i < m - 1; ++i) {
-			for (int j = 0; j < n - 1; ++j) {
-				gridIndices[k] = i * n + j;
-				gridIndices[k + 1] = i * n + (j + 1);
-				gridIndices[k + 2] = (i + 1) * n + j;
-				gridIndices[k + 3] = (i + 1) * n + j;
-				gridIndices[k + 4] = i * n + (j + 1);
-				gridIndices[k + 5] = (i + 1) * n + (j + 1);
-
-				k += 6;
-			}
-		}
+	// Weighted blended transparency: accumulation pixel shader and full-screen composite.
+	auto createPipeline05_PS03Task = loadPipeline05_PS03Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_bubbleAccumulatePixelShader
+			)
+		);
+		});
 
-		D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
-		vertexBufferData.pSysMem = gridVertices;
-		vertexBufferData.SysMemPitch = 0;
-		vertexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(gridVertices), D3D11_BIND_VERTEX_BUFFER);
+	auto createPipeline05_VS04Task = loadPipeline05_VS04Task.then([this](const std::vector<byte>& fileData) {
 		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&vertexBufferDesc,
-				&vertexBufferData,
-				&m_vertexBuffer
+			m_deviceResources->GetD3DDevice()->CreateVertexShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_compositeVertexShader
 			)
 		);
+		});
 
-		m_indexCount = ARRAYSIZE(gridIndices);
+	auto createPipeline05_PS04Task = loadPipeline05_PS04Task.then([this](const std::vector<byte>& fileData) {
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreatePixelShader(
+				&fileData[0],
+				fileData.size(),
+				nullptr,
+				&m_compositePixelShader
+			)
+		);
+		});
 
-		D3D11_SUBRESOURCE_DATA indexBufferData = { 0 };
-		indexBufferData.pSysMem = gridIndices;
-		indexBufferData.SysMemPitch = 0;
-		indexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC IndexBufferDesc(sizeof(gridIndices), D3D11_BIND_INDEX_BUFFER);
+	// Once all shaders are loaded, create the fish and particle buffers.
+	auto execPipelines = (createPipeline05_PSTask && createPipeline05_VSTask &&
+		createPipeline05_VS03Task && createPipeline05_GSTask &&
+		createPipeline05_CS01Task && createPipeline05_CS02Task && createPipeline05_CS03Task &&
+		createPipeline05_VS02Task && createPipeline05_PS02Task &&
+		createPipeline05_CS04Task && createPipeline05_CS05Task && createPipeline05_CS06Task &&
+		createPipeline05_PS03Task && createPipeline05_VS04Task && createPipeline05_PS04Task).then([this]() {
+
+		// One vertex per fish, rewritten every frame from the simulation. It is
+		// per-instance data for the vertex shader path and a point list for the GS.
+		CD3D11_BUFFER_DESC fishBufferDesc(
+			static_cast<UINT>(P05_MAX_FISH * sizeof(VertexPositionColorNormal)),
+			D3D11_BIND_VERTEX_BUFFER,
+			D3D11_USAGE_DYNAMIC,
+			D3D11_CPU_ACCESS_WRITE
+		);
 		DX::ThrowIfFailed(
 			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&IndexBufferDesc,
-				&indexBufferData,
-				&m_indexBuffer
+				&fishBufferDesc,
+				nullptr,
+				&m_fishBuffer
 			)
 		);
 
+		CreateParticleResources();
+
+		m_particleTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		m_fishDrawTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+		m_sortTimer.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+
+		// A single fish at the origin heading along +x, drawn into the impostor atlas.
+		static const VertexPositionColorNormal bakeFish = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+
+		D3D11_SUBRESOURCE_DATA bakeFishData = { 0 };
+		bakeFishData.pSysMem = &bakeFish;
+		CD3D11_BUFFER_DESC bakeFishDesc(sizeof(bakeFish), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&bakeFishDesc,
+				&bakeFishData,
+				&m_impostorBakeBuffer
+			)
+		);
 		});
 
 	// Once the cube is loaded, the object is ready to be rendered.
-	execPipelines.then([this]() {
+	(execPipelines && m_fishImpostor.CreateDeviceDependentResources()).then([this]() {
 		m_loadingComplete = true;
 		});
 }
@@ -204,9 +416,50 @@ void P05_Explicit::CreateDeviceDependentResources()
 // Called once per frame, rotates the cube and calculates the model and view matrices.
 void P05_Explicit::Update(DX::StepTimer const& timer)
 {
+	ProcessInput(timer);
+
+	if (m_particleBenchmarkReady)
+	{
+		m_particleBenchmark.swap(m_pendingParticleBenchmark);
+		m_sortBenchmark.swap(m_pendingSortBenchmark);
+		m_particleBenchmarkReady = false;
+		m_particleBenchmarkInFlight = false;
+	}
+
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMMatrixIdentity()));
 
-	m_timeBufferData.time = timer.GetTotalSeconds();
+	m_timeBufferData.time = static_cast<float>(timer.GetTotalSeconds());
+
+	// Long frames are clamped so the shoal does not scatter after a stall.
+	float dt = std::min(static_cast<float>(timer.GetElapsedSeconds()), 1.0f / 30.0f);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	m_simulation->Step(dt);
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	m_simulationMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	// The bubble pool only advances once the compute shaders exist, so the GPU
+	// and the CPU reference see the same sequence of frames.
+	if (!m_loadingComplete) return;
+
+	m_emitAccumulator += P05_BUBBLES_PER_SECOND * dt;
+	UINT emitCount = static_cast<UINT>(m_emitAccumulator);
+	m_emitAccumulator -= emitCount;
+
+	m_particleConstantBufferData.deltaTime = dt;
+	m_particleConstantBufferData.emitCount = emitCount;
+	m_particleConstantBufferData.frameIndex++;
+
+	start = std::chrono::high_resolution_clock::now();
+
+	m_bubbleReference.Step(dt, emitCount, m_particleConstantBufferData.frameIndex);
+
+	end = std::chrono::high_resolution_clock::now();
+
+	m_bubbleReferenceMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
 }
 
 // Renders one frame using the vertex and pixel shaders.
@@ -220,6 +473,14 @@ void P05_Explicit::Render()
 
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
+	m_particleTimer.Resolve(context);
+	m_fishDrawTimer.Resolve(context);
+	m_sortTimer.Resolve(context);
+	ReadBackBubbleCount();
+
+	SimulateParticles();
+	SortBubbles();
+
 	// Prepare the constant buffer to send it to the graphics device.
 	context->UpdateSubresource1(
 		m_mvpBuffer.Get(),
@@ -251,34 +512,10 @@ void P05_Explicit::Render()
 		0
 	);
 
-	// Each vertex is one instance of the VertexPositionColor struct.
-	UINT stride = sizeof(VertexPositionColor);
-	UINT offset = 0;
+	// The impostor atlas is baked on the first frame the shaders are ready.
+	if (!m_fishImpostor.IsBaked()) BakeFishImpostor();
 
-	context->IASetVertexBuffers(
-		0,
-		1,
-		m_vertexBuffer.GetAddressOf(),
-		&stride,
-		&offset
-	);
-
-	context->IASetIndexBuffer(
-		m_indexBuffer.Get(),
-		DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
-		0
-	);
-
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
-
-	context->IASetInputLayout(m_inputLayout.Get());
-
-	// Attach our vertex shader.
-	context->VSSetShader(
-		m_vertexShader.Get(),
-		nullptr,
-		0
-	);
+	UploadFish();
 
 	// Detach our hull shader.
 	context->HSSetShader(
@@ -294,38 +531,6 @@ void P05_Explicit::Render()
 		0
 	);
 
-	// Send the constant buffer to the graphics device.
-	context->GSSetConstantBuffers1(
-		0,
-		1,
-		m_mvpBuffer.GetAddressOf(),
-		nullptr,
-		nullptr
-	);
-
-	context->GSSetConstantBuffers1(
-		1,
-		1,
-		m_cameraBuffer.GetAddressOf(),
-		nullptr,
-		nullptr
-	);
-
-	context->GSSetConstantBuffers1(
-		2,
-		1,
-		m_timeBuffer.GetAddressOf(),
-		nullptr,
-		nullptr
-	);
-
-	// Attach our geometry shader.
-	context->GSSetShader(
-		m_geometryShader.Get(),
-		nullptr,
-		0
-	);
-
 	// Rasterization
 	D3D11_RASTERIZER_DESC rasterizerDesc = CD3D11_RASTERIZER_DESC(D3D11_DEFAULT);
 
@@ -353,36 +558,815 @@ void P05_Explicit::Render()
 		0
 	);
 
-	// Draw the object.
-	context->DrawIndexed(
-		m_indexCount,
+	// While the A/B benchmark runs, the synthetic shoal is drawn instead of the simulated one.
+	if (m_expansionBenchmarkStage >= 0)
+	{
+		UINT stage = static_cast<UINT>(m_expansionBenchmarkStage);
+		FishExpansion expansion = (stage % 2 == 0) ? FishExpansion::VertexShader : FishExpansion::GeometryShader;
+
+		m_fishDrawTimer.Start(context);
+		DrawFish(m_benchmarkFishBuffer.Get(), 0, P05_BENCHMARK_FISH[stage / 2], expansion);
+		m_fishDrawTimer.Stop(context);
+
+		UpdateExpansionBenchmark();
+	}
+	else if (m_isShoalVisible)
+	{
+		UINT full = static_cast<UINT>(m_fishLod.GetCount(LodLevel::Full));
+		UINT simplified = static_cast<UINT>(m_fishLod.GetCount(LodLevel::Simplified));
+		UINT impostors = static_cast<UINT>(m_fishLod.GetCount(LodLevel::Impostor));
+
+		// Full detail keeps the selected expansion, simplified fish are always the instanced quad.
+		m_fishDrawTimer.Start(context);
+		DrawFish(m_fishBuffer.Get(), m_fishLodFirst[0], full, m_fishExpansion);
+		DrawFish(m_fishBuffer.Get(), m_fishLodFirst[1], simplified, FishExpansion::VertexShader);
+		m_fishImpostor.Draw(m_fishBuffer.Get(), m_fishLodFirst[2], impostors, P05_FISH_RADIUS, m_mvpBuffer.Get(), m_cameraBufferData.position);
+		m_fishDrawTimer.Stop(context);
+	}
+
+	// Bubbles read the particle pool instead of the input assembler.
+	context->GSSetShader(
+		nullptr,
+		nullptr,
+		0
+	);
+
+	context->IASetInputLayout(nullptr);
+
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	context->VSSetConstantBuffers1(
+		0,
+		1,
+		m_mvpBuffer.GetAddressOf(),
+		nullptr,
+		nullptr
+	);
+
+	if (m_areBubblesVisible) RenderBubbles();
+
+	ID3D11ShaderResourceView* nullViews[2] = { nullptr, nullptr };
+	context->VSSetShaderResources(0, 2, nullViews);
+}
+
+// Draws fishCount fish, starting at firstFish, from a buffer of VertexPositionColorNormal with the chosen expansion.
+void P05_Explicit::DrawFish(ID3D11Buffer* fishBuffer, UINT firstFish, UINT fishCount, FishExpansion expansion)
+{
+	if (fishCount == 0) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// Each fish is one instance of the VertexPositionColorNormal struct.
+	UINT stride = sizeof(VertexPositionColorNormal);
+	UINT offset = 0;
+
+	context->IASetVertexBuffers(
+		0,
+		1,
+		&fishBuffer,
+		&stride,
+		&offset
+	);
+
+	if (expansion == FishExpansion::VertexShader)
+	{
+		context->IASetInputLayout(m_instanceInputLayout.Get());
+		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
+		context->VSSetShader(m_vertexShader.Get(), nullptr, 0);
+		context->VSSetConstantBuffers1(0, 1, m_mvpBuffer.GetAddressOf(), nullptr, nullptr);
+		context->GSSetShader(nullptr, nullptr, 0);
+
+		// Four strip vertices per fish.
+		context->DrawInstanced(4, fishCount, 0, firstFish);
+	}
+	else
+	{
+		context->IASetInputLayout(m_pointInputLayout.Get());
+		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+
+		context->VSSetShader(m_pointVertexShader.Get(), nullptr, 0);
+
+		// Send the constant buffer to the graphics device.
+		context->GSSetConstantBuffers1(0, 1, m_mvpBuffer.GetAddressOf(), nullptr, nullptr);
+		context->GSSetConstantBuffers1(1, 1, m_cameraBuffer.GetAddressOf(), nullptr, nullptr);
+		context->GSSetConstantBuffers1(2, 1, m_timeBuffer.GetAddressOf(), nullptr, nullptr);
+		context->GSSetShader(m_geometryShader.Get(), nullptr, 0);
+
+		// One point per fish, expanded into six vertices by the geometry shader.
+		context->Draw(fishCount, firstFish);
+	}
+}
+
+// Draws one fish through the geometry shader path into every cell of the impostor
+// atlas, then puts the scene's matrices back.
+void P05_Explicit::BakeFishImpostor()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	ModelViewProjectionConstantBuffer sceneMatrices = m_mvpBufferData;
+
+	context->HSSetShader(nullptr, nullptr, 0);
+	context->DSSetShader(nullptr, nullptr, 0);
+	context->PSSetConstantBuffers1(0, 1, m_cameraBuffer.GetAddressOf(), nullptr, nullptr);
+	context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+
+	m_fishImpostor.Bake(XMFLOAT3(0.0f, 0.0f, 0.0f), P05_FISH_RADIUS, [this, context](const XMMATRIX& view, const XMMATRIX& projection) {
+		XMStoreFloat4x4(&m_mvpBufferData.view, XMMatrixTranspose(view));
+		XMStoreFloat4x4(&m_mvpBufferData.projection, XMMatrixTranspose(projection));
+		XMStoreFloat4x4(&m_mvpBufferData.viewProjection, XMMatrixTranspose(XMMatrixMultiply(view, projection)));
+		m_mvpBufferData.modelViewProjection = m_mvpBufferData.viewProjection;
+		context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+
+		DrawFish(m_impostorBakeBuffer.Get(), 0, 1, FishExpansion::GeometryShader);
+		});
+
+	m_mvpBufferData = sceneMatrices;
+	context->UpdateSubresource1(m_mvpBuffer.Get(), 0, NULL, &m_mvpBufferData, 0, 0, 0);
+}
+
+// Builds the synthetic benchmark shoal on first use and starts with the first count.
+void P05_Explicit::StartExpansionBenchmark()
+{
+	UINT maxFish = P05_BENCHMARK_FISH[ARRAYSIZE(P05_BENCHMARK_FISH) - 1];
+
+	if (!m_benchmarkFishBuffer)
+	{
+		// Fish spread through the shoal's box with random headings, coloured like the real shoal.
+		BoidsSettings settings = m_simulation->GetSettings();
+		std::mt19937 random(202219807);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<VertexPositionColorNormal> fish(maxFish);
+		for (VertexPositionColorNormal& f : fish)
+		{
+			f.pos = XMFLOAT3(
+				settings.boundsMin.x + unit(random) * (settings.boundsMax.x - settings.boundsMin.x),
+				settings.boundsMin.y + unit(random) * (settings.boundsMax.y - settings.boundsMin.y),
+				settings.boundsMin.z + unit(random) * (settings.boundsMax.z - settings.boundsMin.z));
+			f.color = Gradient((f.pos.x / 35.0f) * 5.0f, 0.0f, ((f.pos.z + 50.0f) / 30.0f) * 5.0f);
+
+			float angle = unit(random) * XM_2PI;
+			f.normal = XMFLOAT3(cosf(angle), 0.0f, sinf(angle));
+		}
+
+		D3D11_SUBRESOURCE_DATA fishData = { 0 };
+		fishData.pSysMem = fish.data();
+		fishData.SysMemPitch = 0;
+		fishData.SysMemSlicePitch = 0;
+		CD3D11_BUFFER_DESC fishDesc(maxFish * sizeof(VertexPositionColorNormal), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+		DX::ThrowIfFailed(
+			m_deviceResources->GetD3DDevice()->CreateBuffer(
+				&fishDesc,
+				&fishData,
+				&m_benchmarkFishBuffer
+			)
+		);
+	}
+
+	m_expansionBenchmark.clear();
+	for (UINT count : P05_BENCHMARK_FISH)
+	{
+		m_expansionBenchmark.push_back({ count, 0.0, 0.0 });
+	}
+
+	m_expansionBenchmarkStage = 0;
+	m_expansionBenchmarkFrame = 0;
+	m_expansionBenchmarkSum = 0.0;
+	m_expansionBenchmarkSamples = 0;
+}
+
+// Called after each benchmark draw. Even stages time the vertex shader path, odd stages the GS.
+void P05_Explicit::UpdateExpansionBenchmark()
+{
+	m_expansionBenchmarkFrame++;
+	if (m_expansionBenchmarkFrame > P05_BENCHMARK_WARMUP_FRAMES)
+	{
+		m_expansionBenchmarkSum += m_fishDrawTimer.GetMilliseconds();
+		m_expansionBenchmarkSamples++;
+	}
+
+	if (m_expansionBenchmarkFrame < P05_BENCHMARK_FRAMES) return;
+
+	double average = m_expansionBenchmarkSum / std::max<uint32>(m_expansionBenchmarkSamples, 1);
+	FishExpansionBenchmarkResult& result = m_expansionBenchmark[m_expansionBenchmarkStage / 2];
+	if (m_expansionBenchmarkStage % 2 == 0)
+	{
+		result.vertexShaderMilliseconds = average;
+	}
+	else
+	{
+		result.geometryShaderMilliseconds = average;
+	}
+
+	m_expansionBenchmarkStage++;
+	m_expansionBenchmarkFrame = 0;
+	m_expansionBenchmarkSum = 0.0;
+	m_expansionBenchmarkSamples = 0;
+
+	if (m_expansionBenchmarkStage >= static_cast<int>(2 * ARRAYSIZE(P05_BENCHMARK_FISH)))
+	{
+		m_expansionBenchmarkStage = -1;
+	}
+}
+
+// Writes the current fish positions, colours and headings into the dynamic fish
+// buffer, grouped as full detail, simplified and impostor fish.
+void P05_Explicit::UploadFish()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	const std::vector<BoidVector>& positions = m_simulation->GetPositions();
+	const std::vector<BoidVector>& velocities = m_simulation->GetVelocities();
+
+	// With LOD off every fish counts as filling the view, so it stays at full detail.
+	m_fishLod.BeginFrame();
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		float size = m_isLodEnabled ?
+			LodSelector::ProjectedSize(m_lodView, positions[i].x, positions[i].y, positions[i].z, P05_FISH_RADIUS) :
+			std::numeric_limits<float>::max();
+		m_fishLod.Update(i, size);
+	}
+
+	UINT next[LOD_LEVEL_COUNT];
+	UINT first = 0;
+	for (size_t level = 0; level < LOD_LEVEL_COUNT; level++)
+	{
+		m_fishLodFirst[level] = first;
+		next[level] = first;
+		first += static_cast<UINT>(m_fishLod.GetCount(static_cast<LodLevel>(level)));
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedVertices;
+	DX::ThrowIfFailed(
+		context->Map(m_fishBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertices)
+	);
+
+	VertexPositionColorNormal* vertices = static_cast<VertexPositionColorNormal*>(mappedVertices.pData);
+
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const BoidVector& v = velocities[i];
+		float speed = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+		float inverseSpeed = (speed > 0.0f) ? 1.0f / speed : 0.0f;
+
+		VertexPositionColorNormal& vertex = vertices[next[static_cast<size_t>(m_fishLod.GetLevel(i))]++];
+		vertex.pos = XMFLOAT3(positions[i].x, positions[i].y, positions[i].z);
+		vertex.color = m_fishColors[i];
+		vertex.normal = XMFLOAT3(v.x * inverseSpeed, v.y * inverseSpeed, v.z * inverseSpeed);
+	}
+
+	context->Unmap(m_fishBuffer.Get(), 0);
+}
+
+void P05_Explicit::CreateParticleResources()
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Particle pool, written by the compute passes and read by the bubble vertex shader.
+	CD3D11_BUFFER_DESC particleBufferDesc(
+		P05_MAX_BUBBLES * sizeof(Particle),
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+		D3D11_USAGE_DEFAULT,
+		0,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(Particle)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&particleBufferDesc, nullptr, &m_particleBuffer));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC particleViewDesc(m_particleBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES);
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_particleBuffer.Get(), &particleViewDesc, &m_particleView));
+
+	CD3D11_UNORDERED_ACCESS_VIEW_DESC particleAccessViewDesc(m_particleBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES);
+	DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_particleBuffer.Get(), &particleAccessViewDesc, &m_particleAccessView));
+
+	// Index lists: free slots, and the alive particles of this frame and the next.
+	CD3D11_BUFFER_DESC indexListDesc(
+		P05_MAX_BUBBLES * sizeof(UINT),
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+		D3D11_USAGE_DEFAULT,
+		0,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		sizeof(UINT)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&indexListDesc, nullptr, &m_deadListBuffer));
+
+	CD3D11_UNORDERED_ACCESS_VIEW_DESC deadListAccessViewDesc(m_deadListBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES, D3D11_BUFFER_UAV_FLAG_APPEND);
+	DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_deadListBuffer.Get(), &deadListAccessViewDesc, &m_deadListAccessView));
+
+	for (UINT i = 0; i < 2; i++)
+	{
+		DX::ThrowIfFailed(device->CreateBuffer(&indexListDesc, nullptr, &m_aliveListBuffers[i]));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC aliveListViewDesc(m_aliveListBuffers[i].Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES);
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_aliveListBuffers[i].Get(), &aliveListViewDesc, &m_aliveListViews[i]));
+
+		CD3D11_UNORDERED_ACCESS_VIEW_DESC aliveListAccessViewDesc(m_aliveListBuffers[i].Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES, D3D11_BUFFER_UAV_FLAG_APPEND);
+		DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_aliveListBuffers[i].Get(), &aliveListAccessViewDesc, &m_aliveListAccessViews[i]));
+	}
+
+	// Emission parameters, and the list lengths copied in with CopyStructureCount.
+	CD3D11_BUFFER_DESC particleConstantBufferDesc(sizeof(ParticleConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+	DX::ThrowIfFailed(device->CreateBuffer(&particleConstantBufferDesc, nullptr, &m_particleConstantBuffer));
+
+	CD3D11_BUFFER_DESC countBufferDesc(sizeof(ParticleCountBuffer), D3D11_BIND_CONSTANT_BUFFER);
+	DX::ThrowIfFailed(device->CreateBuffer(&countBufferDesc, nullptr, &m_deadCountBuffer));
+	DX::ThrowIfFailed(device->CreateBuffer(&countBufferDesc, nullptr, &m_aliveCountBuffer));
+
+	// DrawInstancedIndirect arguments: six vertices per instance, one instance per alive bubble.
+	static const UINT drawArgs[] = { 6, 0, 0, 0 };
+
+	D3D11_SUBRESOURCE_DATA drawArgsData = { 0 };
+	drawArgsData.pSysMem = drawArgs;
+	drawArgsData.SysMemPitch = 0;
+	drawArgsData.SysMemSlicePitch = 0;
+	CD3D11_BUFFER_DESC drawArgsDesc(sizeof(drawArgs), 0, D3D11_USAGE_DEFAULT, 0, D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS);
+	DX::ThrowIfFailed(device->CreateBuffer(&drawArgsDesc, &drawArgsData, &m_bubbleDrawArgsBuffer));
+
+	// Draw list of (depth key, particle index) pairs covering the whole pool.
+	CD3D11_BUFFER_DESC sortListDesc(
+		P05_MAX_BUBBLES * 2 * sizeof(UINT),
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+		D3D11_USAGE_DEFAULT,
+		0,
+		D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+		2 * sizeof(UINT)
+	);
+	DX::ThrowIfFailed(device->CreateBuffer(&sortListDesc, nullptr, &m_sortListBuffer));
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC sortListViewDesc(m_sortListBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES);
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_sortListBuffer.Get(), &sortListViewDesc, &m_sortListView));
+
+	CD3D11_UNORDERED_ACCESS_VIEW_DESC sortListAccessViewDesc(m_sortListBuffer.Get(), DXGI_FORMAT_UNKNOWN, 0, P05_MAX_BUBBLES);
+	DX::ThrowIfFailed(device->CreateUnorderedAccessView(m_sortListBuffer.Get(), &sortListAccessViewDesc, &m_sortListAccessView));
+
+	CD3D11_BUFFER_DESC sortConstantBufferDesc(sizeof(SortConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+	DX::ThrowIfFailed(device->CreateBuffer(&sortConstantBufferDesc, nullptr, &m_sortConstantBuffer));
+
+	// Sorted bubbles blend over the scene. Weighted blended transparency adds up
+	// weighted colour in target 0 and multiplies revealage into target 1.
+	CD3D11_BLEND_DESC alphaBlendDesc = CD3D11_BLEND_DESC(D3D11_DEFAULT);
+	alphaBlendDesc.RenderTarget[0].BlendEnable = TRUE;
+	alphaBlendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	alphaBlendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	alphaBlendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	alphaBlendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	DX::ThrowIfFailed(device->CreateBlendState(&alphaBlendDesc, &m_alphaBlendState));
+
+	CD3D11_BLEND_DESC accumulateBlendDesc = CD3D11_BLEND_DESC(D3D11_DEFAULT);
+	accumulateBlendDesc.IndependentBlendEnable = TRUE;
+	accumulateBlendDesc.RenderTarget[0].BlendEnable = TRUE;
+	accumulateBlendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	accumulateBlendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	accumulateBlendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	accumulateBlendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	accumulateBlendDesc.RenderTarget[1].BlendEnable = TRUE;
+	accumulateBlendDesc.RenderTarget[1].SrcBlend = D3D11_BLEND_ZERO;
+	accumulateBlendDesc.RenderTarget[1].DestBlend = D3D11_BLEND_INV_SRC_COLOR;
+	accumulateBlendDesc.RenderTarget[1].SrcBlendAlpha = D3D11_BLEND_ZERO;
+	accumulateBlendDesc.RenderTarget[1].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	DX::ThrowIfFailed(device->CreateBlendState(&accumulateBlendDesc, &m_accumulateBlendState));
+
+	// Transparent bubbles are hidden by the opaque scene but do not hide each other.
+	CD3D11_DEPTH_STENCIL_DESC depthReadOnlyDesc = CD3D11_DEPTH_STENCIL_DESC(D3D11_DEFAULT);
+	depthReadOnlyDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DX::ThrowIfFailed(device->CreateDepthStencilState(&depthReadOnlyDesc, &m_depthReadOnlyState));
+
+	// Staging copy of the alive count, compared with the CPU reference.
+	CD3D11_BUFFER_DESC readbackDesc(sizeof(UINT), 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+	DX::ThrowIfFailed(device->CreateBuffer(&readbackDesc, nullptr, &m_bubbleCountReadbackBuffer));
+
+	// The GPU pool starts empty on the next frame, so the reference does too.
+	m_isParticlePoolReset = true;
+	m_aliveListIndex = 0;
+	m_emitAccumulator = 0.0f;
+	m_particleConstantBufferData.deltaTime = 0.0f;
+	m_particleConstantBufferData.emitCount = 0;
+	m_particleConstantBufferData.frameIndex = 0;
+	m_bubbleReference.Reset();
+}
+
+// Runs the emit and simulate passes for this frame's bubbles.
+void P05_Explicit::SimulateParticles()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	ID3D11UnorderedAccessView* nullAccessViews[4] = { nullptr, nullptr, nullptr, nullptr };
+	UINT keepCount = static_cast<UINT>(-1);
+
+	m_particleTimer.Start(context);
+
+	context->UpdateSubresource1(
+		m_particleConstantBuffer.Get(),
+		0,
+		NULL,
+		&m_particleConstantBufferData,
+		0,
 		0,
 		0
 	);
+
+	context->CSSetConstantBuffers1(0, 1, m_particleConstantBuffer.GetAddressOf(), nullptr, nullptr);
+
+	ID3D11UnorderedAccessView* aliveListView = m_aliveListAccessViews[m_aliveListIndex].Get();
+	ID3D11UnorderedAccessView* nextAliveListView = m_aliveListAccessViews[1 - m_aliveListIndex].Get();
+
+	// First frame after creation: every index is free and nothing is alive.
+	if (m_isParticlePoolReset)
+	{
+		UINT initialCount = 0;
+		context->CSSetShader(m_particleInitShader.Get(), nullptr, 0);
+		context->CSSetUnorderedAccessViews(0, 1, m_deadListAccessView.GetAddressOf(), &initialCount);
+		context->Dispatch(P05_MAX_BUBBLES / 64, 1, 1);
+		context->CSSetUnorderedAccessViews(0, 1, nullAccessViews, nullptr);
+	}
+
+	// Emit: the dead list length caps how many bubbles can be spawned.
+	if (m_particleConstantBufferData.emitCount > 0)
+	{
+		context->CopyStructureCount(m_deadCountBuffer.Get(), 0, m_deadListAccessView.Get());
+
+		ID3D11UnorderedAccessView* emitViews[3] = { m_particleAccessView.Get(), m_deadListAccessView.Get(), aliveListView };
+		UINT emitCounts[3] = { keepCount, keepCount, m_isParticlePoolReset ? 0 : keepCount };
+
+		context->CSSetShader(m_particleEmitShader.Get(), nullptr, 0);
+		context->CSSetConstantBuffers1(1, 1, m_deadCountBuffer.GetAddressOf(), nullptr, nullptr);
+		context->CSSetUnorderedAccessViews(0, 3, emitViews, emitCounts);
+		context->Dispatch((m_particleConstantBufferData.emitCount + 63) / 64, 1, 1);
+		context->CSSetUnorderedAccessViews(0, 3, nullAccessViews, nullptr);
+
+		m_isParticlePoolReset = false;
+	}
+
+	// Simulate: consume this frame's alive list into the next one. The alive count is
+	// only known on the GPU, so the whole pool is dispatched and extra threads exit early.
+	context->CopyStructureCount(m_aliveCountBuffer.Get(), 0, aliveListView);
+
+	ID3D11UnorderedAccessView* simulateViews[4] = { m_particleAccessView.Get(), m_deadListAccessView.Get(), aliveListView, nextAliveListView };
+	UINT simulateCounts[4] = { keepCount, keepCount, m_isParticlePoolReset ? 0 : keepCount, 0 };
+
+	context->CSSetShader(m_particleSimulateShader.Get(), nullptr, 0);
+	context->CSSetConstantBuffers1(1, 1, m_aliveCountBuffer.GetAddressOf(), nullptr, nullptr);
+	context->CSSetUnorderedAccessViews(0, 4, simulateViews, simulateCounts);
+	context->Dispatch(P05_MAX_BUBBLES / 64, 1, 1);
+	context->CSSetUnorderedAccessViews(0, 4, nullAccessViews, nullptr);
+
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	m_isParticlePoolReset = false;
+	m_aliveListIndex = 1 - m_aliveListIndex;
+
+	// The survivors become the instance count of the indirect draw.
+	context->CopyStructureCount(m_bubbleDrawArgsBuffer.Get(), sizeof(UINT), nextAliveListView);
+	context->CopyStructureCount(m_bubbleCountReadbackBuffer.Get(), 0, nextAliveListView);
+
+	m_particleTimer.Stop(context);
+
+	m_isBubbleCountReadbackPending = true;
+}
+
+// Builds this frame's draw list and sorts it back to front with a bitonic sort.
+// Merges of blocks up to P05_SORT_GROUP_SIZE run in groupshared memory; larger
+// merges take one global dispatch per step until the compare distance fits in a
+// block again.
+void P05_Explicit::SortBubbles()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	ID3D11UnorderedAccessView* nullAccessView = nullptr;
+	ID3D11ShaderResourceView* nullViews[2] = { nullptr, nullptr };
+
+	m_sortTimer.Start(context);
+
+	// The alive list written by this frame's simulate pass.
+	context->CopyStructureCount(m_aliveCountBuffer.Get(), 0, m_aliveListAccessViews[m_aliveListIndex].Get());
+
+	m_sortConstantBufferData.cameraPosition = m_cameraBufferData.position;
+	m_sortConstantBufferData.blockSize = P05_SORT_GROUP_SIZE;
+	m_sortConstantBufferData.compareDistance = P05_SORT_GROUP_SIZE / 2;
+	context->UpdateSubresource1(m_sortConstantBuffer.Get(), 0, NULL, &m_sortConstantBufferData, 0, 0, 0);
+
+	ID3D11ShaderResourceView* buildViews[2] = { m_particleView.Get(), m_aliveListViews[m_aliveListIndex].Get() };
+
+	context->CSSetShader(m_sortBuildShader.Get(), nullptr, 0);
+	context->CSSetConstantBuffers1(0, 1, m_sortConstantBuffer.GetAddressOf(), nullptr, nullptr);
+	context->CSSetConstantBuffers1(1, 1, m_aliveCountBuffer.GetAddressOf(), nullptr, nullptr);
+	context->CSSetShaderResources(0, 2, buildViews);
+	context->CSSetUnorderedAccessViews(0, 1, m_sortListAccessView.GetAddressOf(), nullptr);
+	context->Dispatch(P05_MAX_BUBBLES / P05_SORT_GROUP_SIZE, 1, 1);
+	context->CSSetShaderResources(0, 2, nullViews);
+
+	for (UINT k = 2 * P05_SORT_GROUP_SIZE; k <= P05_MAX_BUBBLES; k <<= 1)
+	{
+		m_sortConstantBufferData.blockSize = k;
+
+		context->CSSetShader(m_sortGlobalShader.Get(), nullptr, 0);
+		for (UINT j = k / 2; j >= P05_SORT_GROUP_SIZE; j >>= 1)
+		{
+			m_sortConstantBufferData.compareDistance = j;
+			context->UpdateSubresource1(m_sortConstantBuffer.Get(), 0, NULL, &m_sortConstantBufferData, 0, 0, 0);
+			context->Dispatch(P05_MAX_BUBBLES / P05_SORT_GLOBAL_GROUP_SIZE, 1, 1);
+		}
+
+		m_sortConstantBufferData.compareDistance = P05_SORT_GROUP_SIZE / 2;
+		context->UpdateSubresource1(m_sortConstantBuffer.Get(), 0, NULL, &m_sortConstantBufferData, 0, 0, 0);
+
+		context->CSSetShader(m_sortLocalShader.Get(), nullptr, 0);
+		context->Dispatch(P05_MAX_BUBBLES / P05_SORT_GROUP_SIZE, 1, 1);
+	}
+
+	context->CSSetUnorderedAccessViews(0, 1, &nullAccessView, nullptr);
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	m_sortTimer.Stop(context);
+}
+
+void P05_Explicit::RenderBubbles()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// Bubbles are drawn in sorted order in every mode, so only the blending changes.
+	ID3D11ShaderResourceView* bubbleViews[2] = { m_particleView.Get(), m_sortListView.Get() };
+
+	context->VSSetShader(m_bubbleVertexShader.Get(), nullptr, 0);
+	context->VSSetShaderResources(0, 2, bubbleViews);
+
+	if (m_bubbleBlending == BubbleBlending::Opaque)
+	{
+		context->PSSetShader(m_bubblePixelShader.Get(), nullptr, 0);
+		context->DrawInstancedIndirect(m_bubbleDrawArgsBuffer.Get(), 0);
+		return;
+	}
+
+	ID3D11RenderTargetView* const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	ID3D11DepthStencilView* depthStencilView = m_deviceResources->GetDepthStencilView();
+
+	context->OMSetDepthStencilState(m_depthReadOnlyState.Get(), 0);
+
+	if (m_bubbleBlending == BubbleBlending::SortedAlpha)
+	{
+		context->OMSetBlendState(m_alphaBlendState.Get(), nullptr, 0xFFFFFFFF);
+		context->PSSetShader(m_bubblePixelShader.Get(), nullptr, 0);
+		context->DrawInstancedIndirect(m_bubbleDrawArgsBuffer.Get(), 0);
+	}
+	else
+	{
+		CreateTransparencyTargets();
+
+		static const float accumulationClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		static const float revealageClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		context->ClearRenderTargetView(m_accumulationTargetView.Get(), accumulationClear);
+		context->ClearRenderTargetView(m_revealageTargetView.Get(), revealageClear);
+
+		// Accumulate against the scene depth buffer, then composite over the back buffer.
+		ID3D11RenderTargetView* const transparencyTargets[2] = { m_accumulationTargetView.Get(), m_revealageTargetView.Get() };
+		context->OMSetRenderTargets(2, transparencyTargets, depthStencilView);
+		context->OMSetBlendState(m_accumulateBlendState.Get(), nullptr, 0xFFFFFFFF);
+		context->PSSetShader(m_bubbleAccumulatePixelShader.Get(), nullptr, 0);
+		context->DrawInstancedIndirect(m_bubbleDrawArgsBuffer.Get(), 0);
+
+		context->OMSetRenderTargets(1, backBufferTargets, nullptr);
+
+		ID3D11ShaderResourceView* compositeViews[2] = { m_accumulationView.Get(), m_revealageView.Get() };
+		ID3D11ShaderResourceView* nullViews[2] = { nullptr, nullptr };
+
+		context->OMSetBlendState(m_alphaBlendState.Get(), nullptr, 0xFFFFFFFF);
+		context->VSSetShader(m_compositeVertexShader.Get(), nullptr, 0);
+		context->PSSetShader(m_compositePixelShader.Get(), nullptr, 0);
+		context->PSSetShaderResources(0, 2, compositeViews);
+		context->Draw(3, 0);
+		context->PSSetShaderResources(0, 2, nullViews);
+
+		context->OMSetRenderTargets(1, backBufferTargets, depthStencilView);
+	}
+
+	context->OMSetBlendState(nullptr, nullptr, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(nullptr, 0);
+}
+
+// (Re)creates the accumulation and revealage targets at the size of the back buffer.
+void P05_Explicit::CreateTransparencyTargets()
+{
+	Size outputSize = m_deviceResources->GetOutputSize();
+	UINT width = std::max(static_cast<UINT>(outputSize.Width), 1u);
+	UINT height = std::max(static_cast<UINT>(outputSize.Height), 1u);
+
+	if (m_accumulationTexture)
+	{
+		D3D11_TEXTURE2D_DESC currentDesc;
+		m_accumulationTexture->GetDesc(&currentDesc);
+		if (currentDesc.Width == width && currentDesc.Height == height) return;
+	}
+
+	auto device = m_deviceResources->GetD3DDevice();
+
+	CD3D11_TEXTURE2D_DESC accumulationDesc(DXGI_FORMAT_R16G16B16A16_FLOAT, width, height, 1, 1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture2D(&accumulationDesc, nullptr, &m_accumulationTexture));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_accumulationTexture.Get(), nullptr, &m_accumulationTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_accumulationTexture.Get(), nullptr, &m_accumulationView));
+
+	CD3D11_TEXTURE2D_DESC revealageDesc(DXGI_FORMAT_R16_FLOAT, width, height, 1, 1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture2D(&revealageDesc, nullptr, &m_revealageTexture));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_revealageTexture.Get(), nullptr, &m_revealageTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_revealageTexture.Get(), nullptr, &m_revealageView));
+}
+
+void P05_Explicit::ReadBackBubbleCount()
+{
+	if (!m_isBubbleCountReadbackPending) return;
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	D3D11_MAPPED_SUBRESOURCE mappedCount;
+	if (context->Map(m_bubbleCountReadbackBuffer.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedCount) == S_OK)
+	{
+		m_gpuBubbleCount = *static_cast<const UINT*>(mappedCount.pData);
+		context->Unmap(m_bubbleCountReadbackBuffer.Get(), 0);
+		m_isBubbleCountReadbackPending = false;
+	}
+}
+
+void P05_Explicit::SetFishCount(size_t count)
+{
+	size_t previousCount = m_simulation->GetCount();
+	m_simulation->Resize(count);
+	m_fishLod.Resize(count);
+
+	// New fish take their colour from where they spawn, mapped onto the old 10x10 grid.
+	const std::vector<BoidVector>& positions = m_simulation->GetPositions();
+	m_fishColors.resize(count);
+	for (size_t i = previousCount; i < count; i++)
+	{
+		float x = (positions[i].x / 35.0f) * 5.0f;
+		float z = ((positions[i].z + 50.0f) / 30.0f) * 5.0f;
+		m_fishColors[i] = Gradient(x, 0.0f, z);
+	}
 }
 
 void P05_Explicit::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
-	m_inputLayout.Reset();
 	m_vertexShader.Reset();
-	m_geometryShader.Reset();
 	m_pixelShader.Reset();
 	m_mvpBuffer.Reset();
 	m_cameraBuffer.Reset();
 	m_timeBuffer.Reset();
-	m_vertexBuffer.Reset();
-	m_indexBuffer.Reset();
+	m_instanceInputLayout.Reset();
+	m_pointInputLayout.Reset();
+	m_pointVertexShader.Reset();
+	m_geometryShader.Reset();
+	m_fishBuffer.Reset();
+	m_benchmarkFishBuffer.Reset();
+	m_impostorBakeBuffer.Reset();
+	m_fishImpostor.ReleaseDeviceDependentResources();
+	m_fishDrawTimer.ReleaseDeviceDependentResources();
+	m_expansionBenchmarkStage = -1;
+
+	m_particleInitShader.Reset();
+	m_particleEmitShader.Reset();
+	m_particleSimulateShader.Reset();
+	m_bubbleVertexShader.Reset();
+	m_bubblePixelShader.Reset();
+	m_particleBuffer.Reset();
+	m_particleView.Reset();
+	m_particleAccessView.Reset();
+	m_deadListBuffer.Reset();
+	m_deadListAccessView.Reset();
+	for (UINT i = 0; i < 2; i++)
+	{
+		m_aliveListBuffers[i].Reset();
+		m_aliveListViews[i].Reset();
+		m_aliveListAccessViews[i].Reset();
+	}
+	m_particleConstantBuffer.Reset();
+	m_deadCountBuffer.Reset();
+	m_aliveCountBuffer.Reset();
+	m_bubbleDrawArgsBuffer.Reset();
+	m_bubbleCountReadbackBuffer.Reset();
+	m_particleTimer.ReleaseDeviceDependentResources();
+	m_isBubbleCountReadbackPending = false;
+
+	m_sortBuildShader.Reset();
+	m_sortGlobalShader.Reset();
+	m_sortLocalShader.Reset();
+	m_bubbleAccumulatePixelShader.Reset();
+	m_compositeVertexShader.Reset();
+	m_compositePixelShader.Reset();
+	m_sortListBuffer.Reset();
+	m_sortListView.Reset();
+	m_sortListAccessView.Reset();
+	m_sortConstantBuffer.Reset();
+	m_alphaBlendState.Reset();
+	m_accumulateBlendState.Reset();
+	m_depthReadOnlyState.Reset();
+	m_accumulationTexture.Reset();
+	m_accumulationTargetView.Reset();
+	m_accumulationView.Reset();
+	m_revealageTexture.Reset();
+	m_revealageTargetView.Reset();
+	m_revealageView.Reset();
+	m_sortTimer.ReleaseDeviceDependentResources();
 }
 
-void P05_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection)
+void P05_Explicit::SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection, DirectX::XMFLOAT4X4& viewProjection)
 {
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.view, DirectX::XMMatrixTranspose(view));
 
 	DirectX::XMStoreFloat4x4(&m_mvpBufferData.projection, DirectX::XMMatrixTranspose(projection));
+
+	// Both matrices are already transposed, so (M * VP)^T = VP^T * M^T.
+	m_mvpBufferData.viewProjection = viewProjection;
+	DirectX::XMStoreFloat4x4(&m_mvpBufferData.modelViewProjection,
+		DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&viewProjection), DirectX::XMLoadFloat4x4(&m_mvpBufferData.model)));
 }
 
 void P05_Explicit::SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition)
 {
 	m_cameraBufferData.position = cameraPosition;
-}
\ No newline at end of file
+}
+
+// The shoal as it is now, for the LOD report.
+LodObjectSet P05_Explicit::GetLodObjects()
+{
+	LodObjectSet set;
+	set.name = "fish";
+	set.thresholds = P05_FISH_LOD;
+	set.isInstanced = true;
+
+	// Two triangles at every level: the coarser ones save the geometry shader and the lighting.
+	set.triangles[0] = 2;
+	set.triangles[1] = 2;
+	set.triangles[2] = 2;
+
+	for (const BoidVector& p : m_simulation->GetPositions())
+	{
+		set.spheres.push_back({ p.x, p.y, p.z, P05_FISH_RADIUS });
+	}
+	return set;
+}
+
+// Compares the AoS and SoA particle kernels, and the CPU depth sorts, at the
+// reference counts without touching the GPU.
+void P05_Explicit::RunParticleBenchmarkAsync()
+{
+	m_particleBenchmarkInFlight = true;
+
+	Concurrency::create_task([this]() {
+		static const size_t counts[] = { 1000, 100000, 1000000 };
+		static const size_t sortCounts[] = { 1000, P05_MAX_BUBBLES, 100000, 1000000 };
+
+		m_pendingParticleBenchmark.clear();
+		for (size_t count : counts)
+		{
+			m_pendingParticleBenchmark.push_back(ParticleStore::Benchmark(count, 20));
+		}
+
+		m_pendingSortBenchmark.clear();
+		for (size_t count : sortCounts)
+		{
+			m_pendingSortBenchmark.push_back(ParticleSorter::Benchmark(count));
+		}
+		m_particleBenchmarkReady = true;
+		});
+}
+
+void P05_Explicit::ProcessInput(DX::StepTimer const& timer)
+{
+	if (IsKeyPressed(VirtualKey::End) && !m_particleBenchmarkInFlight) RunParticleBenchmarkAsync();
+
+	if (IsKeyToggled(VirtualKey::I))
+		m_fishExpansion = (m_fishExpansion == FishExpansion::VertexShader) ? FishExpansion::GeometryShader : FishExpansion::VertexShader;
+
+	if (IsKeyToggled(VirtualKey::O))
+		m_bubbleBlending = static_cast<BubbleBlending>((static_cast<int>(m_bubbleBlending) + 1) % 3);
+
+	if (IsKeyToggled(VirtualKey::B) && m_loadingComplete && m_expansionBenchmarkStage < 0)
+		StartExpansionBenchmark();
+
+	if (IsKeyToggled(VirtualKey::Number3) && m_simulation->GetCount() > P05_MIN_FISH)
+		SetFishCount(std::max(m_simulation->GetCount() / 2, P05_MIN_FISH));
+
+	if (IsKeyToggled(VirtualKey::Number4) && m_simulation->GetCount() < P05_MAX_FISH)
+		SetFishCount(std::min(m_simulation->GetCount() * 2, P05_MAX_FISH));
+}
+
+bool P05_Explicit::IsKeyPressed(VirtualKey key)
+{
+	auto keyDownState = CoreVirtualKeyStates::Down;
+	auto currentKeyState = CoreWindow::GetForCurrentThread()->GetKeyState(key);
+
+	if ((currentKeyState & keyDownState) == keyDownState) return true;
+	return false;
+}
+
+// True only on the frame the key goes down, so steps do not repeat while held.
+bool P05_Explicit::IsKeyToggled(VirtualKey key)
+{
+	bool isDown = IsKeyPressed(key);
+	bool wasDown = m_keyWasDown[key];
+	m_keyWasDown[key] = isDown;
+
+	return isDown && !wasDown;
+}
@@ -2,36 +2,132 @@
 
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
+#include "..\Common\GpuTimer.h"
 #include "ShaderStructures.h"
+#include "BoidsSimulation.h"
+#include "BubbleSimulation.h"
+#include "ParticleSorter.h"
+#include "LodSelector.h"
+#include "ImpostorAtlas.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP 
 {
 	// Graphic Pipeline 05:
 	// 
 	// A shoal of colourful coral reef fish created as a particle system.
+	//
+	// Each fish is a point simulated as a boid on the CPU, streamed into a
+	// dynamic vertex buffer every frame and drawn as an instanced quad facing its
+	// direction of travel. The original geometry shader expansion of the same
+	// buffer is kept behind a switch for A/B timing. Further away, fish drop to
+	// the instanced quad and then to impostors baked into an atlas at startup,
+	// as picked by LodSelector.
+	//
+	// Bubbles are a persistent GPU particle pool: compute shaders emit and kill
+	// them through append/consume index lists, and the survivors are drawn with
+	// DrawInstancedIndirect. BubbleSimulation runs the same rules on the CPU.
+	// Every frame the survivors are sorted back to front by a bitonic sort on
+	// the GPU, so they can be alpha blended, or they are blended without a sort
+	// through weighted blended order-independent transparency.
+
+	using namespace Windows::System;
+	using namespace Windows::UI::Core;
+
+	enum class FishExpansion
+	{
+		VertexShader,
+		GeometryShader
+	};
+
+	enum class BubbleBlending
+	{
+		Opaque,
+		SortedAlpha,
+		WeightedBlended
+	};
+
+	struct FishExpansionBenchmarkResult
+	{
+		uint32	fishCount;
+		double	vertexShaderMilliseconds;
+		double	geometryShaderMilliseconds;
+	};
 
 	class P05_Explicit
 	{
 	public:
 		P05_Explicit(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		void CreateDeviceDependentResources();
-		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection);
+		void SetViewProjectionMatrixConstantBuffer(DirectX::XMMATRIX& view, DirectX::XMMATRIX& projection, DirectX::XMFLOAT4X4& viewProjection);
 		void SetCameraPositionConstantBuffer(DirectX::XMFLOAT3& cameraPosition);
 		void ReleaseDeviceDependentResources();
 		void Update(DX::StepTimer const& timer);
 		void Render();
 
+	private:
+		void ProcessInput(DX::StepTimer const& timer);
+		bool IsKeyPressed(VirtualKey key);
+		bool IsKeyToggled(VirtualKey key);
+		void SetFishCount(size_t count);
+		void UploadFish();
+		void CreateParticleResources();
+		void SimulateParticles();
+		void SortBubbles();
+		void RenderBubbles();
+		void CreateTransparencyTargets();
+		void ReadBackBubbleCount();
+		void RunParticleBenchmarkAsync();
+		void DrawFish(ID3D11Buffer* fishBuffer, UINT firstFish, UINT fishCount, FishExpansion expansion);
+		void BakeFishImpostor();
+		void StartExpansionBenchmark();
+		void UpdateExpansionBenchmark();
+
+	public:
+		size_t GetFishCount()							{ return m_simulation->GetCount(); }
+		double GetSimulationMilliseconds()				{ return m_simulationMilliseconds; }
+		double GetFishPerMillisecond()					{ return (m_simulationMilliseconds > 0.0) ? m_simulation->GetCount() / m_simulationMilliseconds : 0.0; }
+		uint32 GetGpuBubbleCount()						{ return m_gpuBubbleCount; }
+		size_t GetReferenceBubbleCount()				{ return m_bubbleReference.GetCount(); }
+		double GetParticleGpuMilliseconds()				{ return m_particleTimer.GetMilliseconds(); }
+		double GetBubbleReferenceMilliseconds()			{ return m_bubbleReferenceMilliseconds; }
+		const std::vector<ParticleBenchmarkResult>& GetParticleBenchmark() { return m_particleBenchmark; }
+		FishExpansion GetFishExpansion()				{ return m_fishExpansion; }
+		double GetFishDrawGpuMilliseconds()				{ return m_fishDrawTimer.GetMilliseconds(); }
+		bool IsExpansionBenchmarkRunning()				{ return m_expansionBenchmarkStage >= 0; }
+		const std::vector<FishExpansionBenchmarkResult>& GetExpansionBenchmark() { return m_expansionBenchmark; }
+		BubbleBlending GetBubbleBlending()				{ return m_bubbleBlending; }
+		double GetSortGpuMilliseconds()					{ return m_sortTimer.GetMilliseconds(); }
+		const std::vector<SortBenchmarkResult>& GetSortBenchmark() { return m_sortBenchmark; }
+		bool IsLodEnabled()								{ return m_isLodEnabled; }
+		size_t GetFishLodCount(LodLevel level)			{ return m_fishLod.GetCount(level); }
+
+		// Levels are picked per fish from the camera of the last SetLodView.
+		void SetLodView(const LodView& view)			{ m_lodView = view; }
+		void SetLodEnabled(bool isEnabled)				{ m_isLodEnabled = isEnabled; }
+		LodObjectSet GetLodObjects();
+
+		// Culled parts are still simulated but not drawn (see SceneCuller).
+		void SetVisibility(bool isShoalVisible, bool areBubblesVisible)	{ m_isShoalVisible = isShoalVisible; m_areBubblesVisible = areBubblesVisible; }
+
+		// Vertices leaving the expansion stage per fish: one strip quad, or two separate GS triangles.
+		static uint32 GetVerticesPerFish(FishExpansion expansion)	{ return (expansion == FishExpansion::VertexShader) ? 4 : 6; }
+
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources>		    m_deviceResources;
 
 		// Direct3D resources for primitive geometries.	    
-		Microsoft::WRL::ComPtr<ID3D11InputLayout>	    m_inputLayout;
-		Microsoft::WRL::ComPtr<ID3D11Buffer>		    m_vertexBuffer;
-		Microsoft::WRL::ComPtr<ID3D11Buffer>		    m_indexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout>	    m_instanceInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout>	    m_pointInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>		    m_fishBuffer;
 
 		// Shader pointers
 		Microsoft::WRL::ComPtr<ID3D11VertexShader>	    m_vertexShader;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>	    m_pointVertexShader;
 		Microsoft::WRL::ComPtr<ID3D11GeometryShader>	m_geometryShader;
 		Microsoft::WRL::ComPtr<ID3D11PixelShader>	    m_pixelShader;
 
@@ -47,7 +143,94 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		ModelViewProjectionConstantBuffer				m_mvpBufferData;
 		CameraTrackingBuffer							m_cameraBufferData;
 		ElapsedTimeBuffer								m_timeBufferData;
-		uint32											m_indexCount;
+
+		// Shoal simulation
+		std::unique_ptr<BoidsSimulation>				m_simulation;
+		std::vector<DirectX::XMFLOAT3>					m_fishColors;
+		double											m_simulationMilliseconds;
+		std::map<VirtualKey, bool>						m_keyWasDown;
+
+		// Fish expansion switch and its A/B benchmark over a synthetic shoal.
+		FishExpansion									m_fishExpansion;
+		DX::GpuTimer									m_fishDrawTimer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_benchmarkFishBuffer;
+		std::vector<FishExpansionBenchmarkResult>		m_expansionBenchmark;
+		int												m_expansionBenchmarkStage;
+		uint32											m_expansionBenchmarkFrame;
+		double											m_expansionBenchmarkSum;
+		uint32											m_expansionBenchmarkSamples;
+
+		// GPU bubble particles
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_particleInitShader;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_particleEmitShader;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_particleSimulateShader;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>		m_bubbleVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_bubblePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_particleBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_particleView;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_particleAccessView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_deadListBuffer;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_deadListAccessView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_aliveListBuffers[2];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_aliveListViews[2];
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_aliveListAccessViews[2];
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_particleConstantBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_deadCountBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_aliveCountBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_bubbleDrawArgsBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_bubbleCountReadbackBuffer;
+		DX::GpuTimer									m_particleTimer;
+		ParticleConstantBuffer							m_particleConstantBufferData;
+		UINT											m_aliveListIndex;
+		bool											m_isParticlePoolReset;
+		bool											m_isBubbleCountReadbackPending;
+		uint32											m_gpuBubbleCount;
+		float											m_emitAccumulator;
+		BubbleSimulation								m_bubbleReference;
+		double											m_bubbleReferenceMilliseconds;
+
+		// Bubble depth sort and transparency.
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_sortBuildShader;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_sortGlobalShader;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader>		m_sortLocalShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_bubbleAccumulatePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>		m_compositeVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>		m_compositePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_sortListBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_sortListView;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>	m_sortListAccessView;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_sortConstantBuffer;
+		Microsoft::WRL::ComPtr<ID3D11BlendState>		m_alphaBlendState;
+		Microsoft::WRL::ComPtr<ID3D11BlendState>		m_accumulateBlendState;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState>	m_depthReadOnlyState;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_accumulationTexture;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>	m_accumulationTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_accumulationView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>			m_revealageTexture;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>	m_revealageTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_revealageView;
+		SortConstantBuffer								m_sortConstantBufferData;
+		DX::GpuTimer									m_sortTimer;
+		BubbleBlending									m_bubbleBlending;
+
+		// Distance level of detail. The fish buffer is written grouped by level, so
+		// each level is a single draw starting at m_fishLodFirst.
+		LodSelector										m_fishLod;
+		LodView											m_lodView;
+		ImpostorAtlas									m_fishImpostor;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>			m_impostorBakeBuffer;
+		UINT											m_fishLodFirst[LOD_LEVEL_COUNT];
+		bool											m_isLodEnabled;
+		bool											m_isShoalVisible;
+		bool											m_areBubblesVisible;
+
+		// AoS vs SoA particle and CPU sort benchmarks, run on a worker thread.
+		std::vector<ParticleBenchmarkResult>			m_particleBenchmark;
+		std::vector<ParticleBenchmarkResult>			m_pendingParticleBenchmark;
+		std::vector<SortBenchmarkResult>				m_sortBenchmark;
+		std::vector<SortBenchmarkResult>				m_pendingSortBenchmark;
+		std::atomic<bool>								m_particleBenchmarkReady;
+		std::atomic<bool>								m_particleBenchmarkInFlight;
 
 		// Variables used with the rendering loop.
 		bool											m_loadingComplete;
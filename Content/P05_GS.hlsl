@@ -3,6 +3,8 @@ cbuffer ModelViewProjectionConstantBuffer : register(b0)
     matrix model;
     matrix view;
     matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
 };
 
 cbuffer CameraConstantBuffer : register(b1)
@@ -21,6 +23,7 @@ struct GS_INPUT
 {
     float4 pos : SV_POSITION;
     float3 color : COLOR0;
+    float3 heading : TEXCOORD1;
 };
 
 struct GS_OUTPUT
@@ -30,27 +33,32 @@ struct GS_OUTPUT
     float2 uv : TEXCOORD0;
 };
 
-// Transformations
-float4 Transform(in float4 inPos)
+// Geometry shader fish path, kept behind the P05 expansion switch for A/B timing
+// against the instanced vertex shader in P05_VS.hlsl.
+//
+// Shader cost per emitted vertex, counted by hand from the HLSL
+// (not taken from an fxc listing; the .asm from AssemblerOutput can confirm it):
+// each of the six vertices is one viewProjection product (4 dp4), and the two
+// triangles are separate strips, so the shared corners are transformed twice.
+// The heading frame is built once per fish from two cross products.
+
+// Fish outline in its own frame: x along the heading, y up.
+static const float3 g_positions[4] =
 {
-    inPos.xyz *= 1.5;
-    inPos.z -= 55.0;
-    
-    inPos.x -= smoothstep(0, 2.0, cos(inPos.yz)) * sin(time) * 3.0;
-    inPos.y -= smoothstep(0, 1.0, cos(inPos.z)) * sin(time) * 0.8;
-    // inPos.z -= smoothstep(0, 1.0, cos(inPos.xy)) * sin(time) * 1.8;
-
-    // Create the rotation matrix
-    float c = cos(time * 0.2);
-    float s = sin(time * 0.2);
-    float4x4 rotationMatrix = float4x4(
-        c, 0, -s, 0,
-        0, 1, 0, 0,
-        s, 0, c, 0,
-        0, 0, 0, 1
-    );
-    inPos = mul(inPos, rotationMatrix);
-    return inPos;
+    float3(-1, 1, 0),
+    float3(-1, -1, 0),
+    float3(1, 1, 0),
+    float3(1, -1, 0),
+};
+
+static const float g_fishScale = 1.5;
+
+// Places a corner of the fish outline in world space and projects it.
+float4 Transform(in float3 center, in float3 forward, in float3 up, in float3 corner, in float quadSize)
+{
+    float3 offset = (forward * corner.x + up * corner.y) * quadSize * g_fishScale;
+
+    return mul(float4(center + offset, 1.0), viewProjection);
 }
 
 [maxvertexcount(6)]
@@ -59,48 +67,41 @@ void main(point GS_INPUT input[1], inout
 {
     GS_OUTPUT output = (GS_OUTPUT) 0;
 
-    float4 vPos = input[0].pos;
+    float3 center = input[0].pos.xyz;
 
-    static const float3 g_positions[4] =
+    // Shared by every vertex of the fish.
+    output.color = input[0].color;
+    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+
+    // The outline's x axis follows the direction of travel, rolled upright.
+    float3 heading = input[0].heading;
+    if (dot(heading, heading) < 1e-6)
     {
-        float3(-1, 1, 0),
-		float3(-1, -1, 0),
-		float3(1, 1, 0),
-		float3(1, -1, 0),
-    };
+        heading = float3(1, 0, 0);
+    }
+
+    float3 side = cross(float3(0, 1, 0), heading);
+    if (dot(side, side) < 1e-6)
+    {
+        side = float3(1, 0, 0);
+    }
+    side = normalize(side);
+    float3 up = cross(heading, side);
 
 	// triangle 1 
 
     float quadSize = 0.15;
 
 	// vertex 1:  
-    output.pos = vPos + float4(quadSize * g_positions[1], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[1], quadSize);
     OutputStream.Append(output);
 
 	// vertex 2:  
-    output.pos = vPos + float4(quadSize * g_positions[0], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[0], quadSize);
     OutputStream.Append(output);
 
 	// vertex 3:  
-    output.pos = vPos + float4(quadSize * g_positions[2], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[2], quadSize);
     OutputStream.Append(output);
 
     OutputStream.RestartStrip();
@@ -110,33 +111,15 @@ void main(point GS_INPUT input[1], inout
     quadSize = 0.1;
 
 	// vertex 1:  
-    output.pos = vPos + float4(quadSize * g_positions[2], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[2], quadSize);
     OutputStream.Append(output);
 
 	// vertex 2:  
-    output.pos = vPos + float4(quadSize * g_positions[3], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[3], quadSize);
     OutputStream.Append(output);
 
 	// vertex 3:  
-    output.pos = vPos + float4(quadSize * g_positions[1], 0.0);
-    output.pos = Transform(output.pos);
-    //output.pos = mul(output.pos, model);
-    output.pos = mul(output.pos, view);
-    output.pos = mul(output.pos, projection);
-    output.color = input[0].color;
-    output.uv = (sign(input[0].pos.xy) + 1.0) / 2.0;
+    output.pos = Transform(center, heading, up, g_positions[1], quadSize);
     OutputStream.Append(output);
 
     OutputStream.RestartStrip();
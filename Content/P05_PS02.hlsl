@@ -0,0 +1,22 @@
+// Bubble shading for the opaque and sorted alpha blending modes.
+// Alpha is ignored while no blend state is bound.
+
+#include "P05_Particles.hlsli"
+
+struct PS_INPUT
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+    float fade : TEXCOORD1;
+    float depth : TEXCOORD2;
+};
+
+float4 main(PS_INPUT input) : SV_Target
+{
+    if (dot(input.uv, input.uv) > 1.0)
+    {
+        discard;
+    }
+
+    return ShadeBubble(input.uv, input.fade);
+}
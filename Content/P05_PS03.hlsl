@@ -0,0 +1,38 @@
+// Weighted blended order-independent transparency (McGuire and Bavoil, 2013),
+// accumulation pass. Target 0 sums weighted premultiplied colour and alpha with
+// additive blending, target 1 multiplies up the revealage (1 - alpha).
+
+#include "P05_Particles.hlsli"
+
+struct PS_INPUT
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+    float fade : TEXCOORD1;
+    float depth : TEXCOORD2;
+};
+
+struct PS_OUTPUT
+{
+    float4 accumulation : SV_Target0;
+    float revealage : SV_Target1;
+};
+
+PS_OUTPUT main(PS_INPUT input)
+{
+    if (dot(input.uv, input.uv) > 1.0)
+    {
+        discard;
+    }
+
+    float4 color = ShadeBubble(input.uv, input.fade);
+
+    // Depth weight of equation 10 in the paper, with z the view space depth.
+    float z = input.depth;
+    float weight = color.a * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3);
+
+    PS_OUTPUT output;
+    output.accumulation = float4(color.rgb * color.a, color.a) * weight;
+    output.revealage = color.a;
+    return output;
+}
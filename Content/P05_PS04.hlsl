@@ -0,0 +1,21 @@
+// Weighted blended transparency composite: resolves the accumulation targets and
+// blends the average bubble colour over the scene by the total coverage.
+
+Texture2D<float4> accumulationTexture : register(t0);
+Texture2D<float> revealageTexture : register(t1);
+
+float4 main(float4 pos : SV_POSITION) : SV_Target
+{
+    int3 texel = int3(pos.xy, 0);
+
+    float revealage = revealageTexture.Load(texel);
+    if (revealage >= 1.0)
+    {
+        discard;
+    }
+
+    float4 accumulation = accumulationTexture.Load(texel);
+    float3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+
+    return float4(average, 1.0 - revealage);
+}
@@ -0,0 +1,97 @@
+// Bubble particle layout and rules shared by the P05 particle shaders.
+// BubbleSimulation.cpp mirrors these functions on the CPU, so changes here
+// should be made there as well.
+
+struct Particle
+{
+    float3 position;
+    float age;
+    float3 velocity;
+    float lifetime;
+};
+
+// Bubbles rise from the foot of the corals and the sand below the shoal (xyz, spread).
+static const float4 g_emitters[4] =
+{
+    float4(20.0, -5.0, -10.0, 2.0),
+    float4(-20.0, -7.0, -20.0, 1.5),
+    float4(0.0, -8.0, -45.0, 6.0),
+    float4(-25.0, -8.0, -65.0, 4.0),
+};
+
+static const float g_surfaceHeight = 12.0;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform in [0, 1), 24 bits so the CPU reference produces the same value.
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return (state & 0x00FFFFFF) / 16777216.0;
+}
+
+// The nth particle emitted in a frame depends only on n and the frame index.
+// Random numbers are drawn one statement at a time so the order is explicit.
+Particle EmitParticle(uint slot, uint frameIndex)
+{
+    uint state = Hash(frameIndex) ^ slot;
+
+    float4 emitter = g_emitters[Hash(state) & 3];
+
+    float offsetX = Random(state) - 0.5;
+    float offsetZ = Random(state) - 0.5;
+    float driftX = Random(state) - 0.5;
+    float rise = Random(state);
+    float driftZ = Random(state) - 0.5;
+    float lifetime = Random(state);
+
+    Particle p;
+    p.position = emitter.xyz + float3(offsetX, 0.0, offsetZ) * 2.0 * emitter.w;
+    p.velocity = float3(driftX * 0.4, 1.5 + rise, driftZ * 0.4);
+    p.age = 0.0;
+    p.lifetime = 6.0 + lifetime * 4.0;
+    return p;
+}
+
+// Advances a particle by deltaTime. Returns false once it should be killed.
+bool UpdateParticle(inout Particle p, float deltaTime)
+{
+    p.age += deltaTime;
+
+    // Buoyancy with drag towards a terminal rise speed, plus a sideways wobble.
+    p.velocity.y += (2.5 - p.velocity.y) * 0.5 * deltaTime;
+    p.velocity.x += sin(p.age * 4.0 + p.lifetime * 10.0) * 0.8 * deltaTime;
+    p.velocity.z += cos(p.age * 3.0 + p.lifetime * 10.0) * 0.8 * deltaTime;
+
+    p.position += p.velocity * deltaTime;
+
+    return p.age < p.lifetime && p.position.y < g_surfaceHeight;
+}
+
+// Bubble shading used by both bubble pixel shaders: a disc with a bright rim and
+// a small highlight. uv is inside the unit disc. The middle of the bubble is
+// mostly see-through, so alpha follows the rim and the highlight.
+float4 ShadeBubble(float2 uv, float fade)
+{
+    float r2 = dot(uv, uv);
+
+    // Sphere normal of the disc, lit from above.
+    float3 N = float3(uv, sqrt(1.0 - r2));
+    float rim = pow(1.0 - N.z, 3.0);
+    float highlight = pow(saturate(dot(N, normalize(float3(-0.4, 0.6, 0.7)))), 40.0);
+
+    float3 water = float3(0.55, 0.8, 0.95);
+    float3 color = water * (0.35 + 0.65 * rim) + highlight;
+
+    float alpha = saturate(0.2 + 0.7 * rim + highlight) * (0.5 + 0.5 * fade);
+
+    return float4(color * (0.6 + 0.4 * fade), alpha);
+}
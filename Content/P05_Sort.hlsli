@@ -0,0 +1,37 @@
+// Bitonic depth sort of the P05 bubbles, shared by the sort compute passes.
+// ParticleSorter.cpp runs the same network on the CPU.
+//
+// The sort list holds one uint2 per pool slot: x is the key and y the particle
+// index. Keys grow towards the camera, so an ascending sort draws back to front.
+
+cbuffer SortConstantBuffer : register(b0)
+{
+    float3 cameraPosition;
+    uint blockSize;
+    uint compareDistance;
+    uint3 padding;
+};
+
+// Number of entries sorted in groupshared memory by one thread group.
+#define SORT_GROUP_SIZE 1024
+
+static const uint g_paddingKey = 0xFFFFFFFF;
+
+uint DepthKey(float distance)
+{
+    // A particle exactly at the camera must still sort ahead of the padding.
+    return min(g_paddingKey - asuint(distance), g_paddingKey - 1);
+}
+
+// Orders a pair for the merge of sequences of length k: bit k of the lower index
+// picks ascending or descending order.
+void CompareAndSwap(inout uint2 a, inout uint2 b, uint lowerIndex, uint k)
+{
+    bool ascending = (lowerIndex & k) == 0;
+    if ((a.x > b.x) == ascending)
+    {
+        uint2 t = a;
+        a = b;
+        b = t;
+    }
+}
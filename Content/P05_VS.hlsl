@@ -1,41 +1,72 @@
-#include "MathUtils.hlsli"
+// Instanced fish expansion in the vertex shader.
+// Drawn with DrawInstanced(4, fishCount) as a triangle strip: each fish is one
+// instance of the fish vertex buffer, and SV_VertexID selects the quad corner.
 
 cbuffer ModelViewProjectionConstantBuffer : register(b0)
 {
     matrix model;
     matrix view;
     matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
 };
 
-cbuffer CameraTrackingBuffer : register(b1)
-{
-    float3 cameraPosition;
-    float padding;
-}
-
-cbuffer TimeConstantBuffer : register(b2)
-{
-    float iTime;
-    float3 padding2;
-}
-
+// Per instance.
 struct VS_INPUT
 {
     float3 pos      : POSITION;
     float3 color    : COLOR0;
+    float3 heading  : NORMAL;
 };
 
 struct VS_OUTPUT
 {
     float4 pos      : SV_POSITION;
     float3 color    : COLOR0;
+    float2 uv       : TEXCOORD0;
 };
 
-VS_OUTPUT main(VS_INPUT input)
+// Fish outline in its own frame: x along the heading, y up, z the half size.
+// The tail end keeps the 0.15 body size of P05_GS.hlsl and the head end the 0.1
+// size of its second triangle, so the two triangles become one tapered quad.
+static const float3 g_corners[4] =
+{
+    float3(-1, -1, 0.15),
+    float3(-1, 1, 0.15),
+    float3(1, -1, 0.1),
+    float3(1, 1, 0.1),
+};
+
+static const float g_fishScale = 1.5;
+
+VS_OUTPUT main(VS_INPUT input, uint vertexID : SV_VertexID)
 {
     VS_OUTPUT output;
-    output.pos = float4(input.pos, 1.0);
-    output.color = Gradient(output.pos.xyz);
+
+    float3 corner = g_corners[vertexID];
+
+    // The outline's x axis follows the direction of travel, rolled upright.
+    float3 heading = input.heading;
+    if (dot(heading, heading) < 1e-6)
+    {
+        heading = float3(1, 0, 0);
+    }
+
+    float3 side = cross(float3(0, 1, 0), heading);
+    if (dot(side, side) < 1e-6)
+    {
+        side = float3(1, 0, 0);
+    }
+    side = normalize(side);
+    float3 up = cross(heading, side);
+
+    float3 offset = (heading * corner.x + up * corner.y) * corner.z * g_fishScale;
+
+    output.pos = mul(float4(input.pos + offset, 1.0), viewProjection);
+
+    // Gradient() of the spawn position, evaluated once per fish on the CPU.
+    output.color = input.color;
+    output.uv = (sign(input.pos.xy) + 1.0) / 2.0;
 
     return output;
-}
\ No newline at end of file
+}
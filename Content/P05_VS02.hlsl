@@ -0,0 +1,62 @@
+// Bubble billboards for the GPU particle system.
+// Drawn with DrawInstancedIndirect: one instance per alive particle, whose
+// index comes from the depth sorted draw list, and six vertices expanded from
+// SV_VertexID.
+
+#include "P05_Particles.hlsli"
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+    matrix model;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    matrix modelViewProjection;
+};
+
+StructuredBuffer<Particle> particles : register(t0);
+StructuredBuffer<uint2> sortList : register(t1);
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD0;
+    float fade : TEXCOORD1;
+    float depth : TEXCOORD2;
+};
+
+// Two triangles of a unit quad.
+static const float2 g_corners[6] =
+{
+    float2(-1, -1),
+    float2(-1, 1),
+    float2(1, 1),
+    float2(1, 1),
+    float2(1, -1),
+    float2(-1, -1),
+};
+
+VS_OUTPUT main(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    VS_OUTPUT output;
+
+    Particle p = particles[sortList[instanceID].y];
+    float2 corner = g_corners[vertexID];
+
+    // Bubbles grow as they rise and shrink away just before they die.
+    float life = saturate(p.age / p.lifetime);
+    float radius = lerp(0.05, 0.2, life) * saturate((p.lifetime - p.age) * 4.0);
+
+    // Camera right and up are the first two columns of the view matrix.
+    float3 right = float3(view._11, view._21, view._31);
+    float3 up = float3(view._12, view._22, view._32);
+
+    float3 position = p.position + (right * corner.x + up * corner.y) * radius;
+
+    output.pos = mul(float4(position, 1.0), viewProjection);
+    output.uv = corner;
+    output.fade = 1.0 - life;
+    output.depth = mul(float4(position, 1.0), view).z;
+
+    return output;
+}
@@ -0,0 +1,28 @@
+// Pass-through for the geometry shader fish path (P05_GS.hlsl).
+// Each fish arrives as one point of a point list.
+
+struct VS_INPUT
+{
+    float3 pos      : POSITION;
+    float3 color    : COLOR0;
+    float3 heading  : NORMAL;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos      : SV_POSITION;
+    float3 color    : COLOR0;
+    float3 heading  : TEXCOORD1;
+};
+
+VS_OUTPUT main(VS_INPUT input)
+{
+    VS_OUTPUT output;
+    output.pos = float4(input.pos, 1.0);
+
+    // Gradient() of the spawn position, evaluated once per fish on the CPU.
+    output.color = input.color;
+    output.heading = input.heading;
+
+    return output;
+}
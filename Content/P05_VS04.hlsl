@@ -0,0 +1,7 @@
+// Full-screen triangle for the transparency composite, generated from SV_VertexID.
+
+float4 main(uint vertexID : SV_VertexID) : SV_POSITION
+{
+    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+    return float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+}
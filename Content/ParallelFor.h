@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <ppl.h>
+#endif
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Ranges handed out per hardware thread, so the ranges that finish early
+	// leave their threads free for the rest.
+	const size_t PARALLEL_FOR_RANGES_PER_THREAD = 4;
+
+	// Splits [0, count) into contiguous ranges and calls function(begin, end)
+	// for each, returning once every range is done.
+	//
+	// With MSVC the ranges go to the PPL scheduler, whose worker threads live
+	// as long as the process, so calling this every frame creates no threads.
+	// Elsewhere, where only the tests and benchmarks run, each call starts and
+	// joins one std::thread per hardware thread.
+	template <typename Function>
+	void ParallelFor(size_t count, Function function)
+	{
+		size_t threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+		size_t rangeCount = std::min(count, threadCount * PARALLEL_FOR_RANGES_PER_THREAD);
+
+		if (threadCount <= 1 || rangeCount <= 1)
+		{
+			if (count > 0) function(static_cast<size_t>(0), count);
+			return;
+		}
+
+		size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		rangeCount = (count + rangeSize - 1) / rangeSize;
+
+#if defined(_MSC_VER)
+		concurrency::parallel_for(static_cast<size_t>(0), rangeCount, [&function, rangeSize, count](size_t range) {
+			size_t begin = range * rangeSize;
+			function(begin, std::min(count, begin + rangeSize));
+		});
+#else
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (size_t t = 1; t < threadCount; t++)
+		{
+			threads.emplace_back([&function, t, threadCount, rangeCount, rangeSize, count]() {
+				for (size_t range = t; range < rangeCount; range += threadCount)
+				{
+					size_t begin = range * rangeSize;
+					function(begin, std::min(count, begin + rangeSize));
+				}
+			});
+		}
+
+		for (size_t range = 0; range < rangeCount; range += threadCount)
+		{
+			size_t begin = range * rangeSize;
+			function(begin, std::min(count, begin + rangeSize));
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+#endif
+	}
+}
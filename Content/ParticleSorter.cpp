@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "ParticleSorter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const uint32_t SORT_RADIX_BITS = 8;
+	const uint32_t SORT_RADIX_BUCKETS = 1 << SORT_RADIX_BITS;
+
+	// The benchmark cloud fills the P05 bubble volume around a camera at the start position.
+	const float SORT_BENCHMARK_EXTENT = 40.0f;
+
+	double ElapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	bool SameKeys(const std::vector<SortEntry>& a, const std::vector<SortEntry>& b)
+	{
+		if (a.size() != b.size()) return false;
+
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].key != b[i].key) return false;
+		}
+		return true;
+	}
+}
+
+uint32_t ParticleSorter::DepthKey(float distance)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &distance, sizeof(bits));
+
+	// A particle exactly at the camera must still sort ahead of the padding.
+	return std::min(PaddingKey() - bits, PaddingKey() - 1);
+}
+
+void ParticleSorter::BuildKeys(const float* x, const float* y, const float* z, size_t count,
+	float cameraX, float cameraY, float cameraZ, std::vector<SortEntry>& entries)
+{
+	entries.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		float dx = x[i] - cameraX;
+		float dy = y[i] - cameraY;
+		float dz = z[i] - cameraZ;
+
+		entries[i].key = DepthKey(sqrtf(dx * dx + dy * dy + dz * dz));
+		entries[i].index = static_cast<uint32_t>(i);
+	}
+}
+
+void ParticleSorter::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	scratch.resize(entries.size());
+
+	for (uint32_t shift = 0; shift < 32; shift += SORT_RADIX_BITS)
+	{
+		size_t offsets[SORT_RADIX_BUCKETS] = {};
+		for (const SortEntry& entry : entries)
+		{
+			offsets[(entry.key >> shift) & (SORT_RADIX_BUCKETS - 1)]++;
+		}
+
+		// Exclusive prefix sum turns the histogram into bucket start offsets.
+		size_t sum = 0;
+		for (uint32_t bucket = 0; bucket < SORT_RADIX_BUCKETS; bucket++)
+		{
+			size_t bucketCount = offsets[bucket];
+			offsets[bucket] = sum;
+			sum += bucketCount;
+		}
+
+		for (const SortEntry& entry : entries)
+		{
+			scratch[offsets[(entry.key >> shift) & (SORT_RADIX_BUCKETS - 1)]++] = entry;
+		}
+
+		entries.swap(scratch);
+	}
+}
+
+void ParticleSorter::BitonicSort(std::vector<SortEntry>& entries)
+{
+	size_t count = entries.size();
+	size_t size = 1;
+	while (size < count)
+	{
+		size <<= 1;
+	}
+
+	SortEntry padding = { PaddingKey(), 0 };
+	entries.resize(size, padding);
+
+	// Same loop nest as the GPU passes: k is the size of the sequences being merged,
+	// j the distance between compared elements, and bit k of i picks the direction.
+	for (size_t k = 2; k <= size; k <<= 1)
+	{
+		for (size_t j = k >> 1; j > 0; j >>= 1)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				size_t partner = i ^ j;
+				if (partner <= i) continue;
+
+				bool ascending = (i & k) == 0;
+				if ((entries[i].key > entries[partner].key) == ascending)
+				{
+					std::swap(entries[i], entries[partner]);
+				}
+			}
+		}
+	}
+
+	entries.resize(count);
+}
+
+bool ParticleSorter::IsSorted(const std::vector<SortEntry>& entries)
+{
+	for (size_t i = 1; i < entries.size(); i++)
+	{
+		if (entries[i - 1].key > entries[i].key) return false;
+	}
+	return true;
+}
+
+SortBenchmarkResult ParticleSorter::Benchmark(size_t count)
+{
+	SortBenchmarkResult result = { count, 0.0, 0.0, 0.0, false };
+
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> unit(-SORT_BENCHMARK_EXTENT, SORT_BENCHMARK_EXTENT);
+
+	std::vector<float> x(count), y(count), z(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = unit(random);
+		y[i] = unit(random);
+		z[i] = unit(random);
+	}
+
+	std::vector<SortEntry> keys;
+	BuildKeys(x.data(), y.data(), z.data(), count, 0.0f, 0.0f, -70.0f, keys);
+
+	std::vector<SortEntry> radix = keys;
+	std::vector<SortEntry> scratch;
+	auto start = std::chrono::high_resolution_clock::now();
+	RadixSort(radix, scratch);
+	result.radixMilliseconds = ElapsedMilliseconds(start);
+
+	std::vector<SortEntry> bitonic = keys;
+	start = std::chrono::high_resolution_clock::now();
+	BitonicSort(bitonic);
+	result.bitonicMilliseconds = ElapsedMilliseconds(start);
+
+	std::vector<SortEntry> reference = keys;
+	start = std::chrono::high_resolution_clock::now();
+	std::sort(reference.begin(), reference.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+	result.stdSortMilliseconds = ElapsedMilliseconds(start);
+
+	result.isConsistent = IsSorted(reference) && SameKeys(radix, reference) && SameKeys(bitonic, reference);
+	return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// CPU reference of the P05 bubble depth sort.
+	//
+	// Keys are built exactly as in P05_CS04.hlsl: the bit pattern of the distance to
+	// the camera, inverted so that an ascending sort draws the farthest particle
+	// first. The bitonic network performs the same compare-and-swap steps as the
+	// compute passes, and the LSD radix sort and std::sort give reference orders and
+	// timings to compare it with.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	// Matches the uint2 entries of the GPU sort list: x is the key, y the particle index.
+	struct SortEntry
+	{
+		uint32_t	key;
+		uint32_t	index;
+	};
+
+	struct SortBenchmarkResult
+	{
+		size_t	count;
+		double	radixMilliseconds;
+		double	bitonicMilliseconds;
+		double	stdSortMilliseconds;
+		bool	isConsistent;		// All three methods produced the same key order.
+	};
+
+	class ParticleSorter
+	{
+	public:
+		// Key of a particle at the given distance. Distances are never negative, so
+		// their bit patterns order like the floats. The largest key marks padding.
+		static uint32_t DepthKey(float distance);
+		static uint32_t PaddingKey()					{ return 0xFFFFFFFFu; }
+
+		// One entry per particle of the structure-of-arrays positions.
+		static void BuildKeys(const float* x, const float* y, const float* z, size_t count,
+			float cameraX, float cameraY, float cameraZ, std::vector<SortEntry>& entries);
+
+		// Four 8-bit counting passes, stable. Scratch is resized to match.
+		static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+		// Pads to a power of two with PaddingKey() and runs the bitonic network.
+		// Padding entries end up at the back and are removed again.
+		static void BitonicSort(std::vector<SortEntry>& entries);
+
+		static bool IsSorted(const std::vector<SortEntry>& entries);
+
+		// Times the three sorts on the same random particle cloud.
+		static SortBenchmarkResult Benchmark(size_t count);
+	};
+}
@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "ParticleStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_STORE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PARTICLE_STORE_AVX2
+#else
+#define PARTICLE_STORE_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// The benchmark box, large enough that only a few particles touch a wall each step.
+	const ParticleBounds PARTICLE_BENCHMARK_BOUNDS = { -50.0f, -50.0f, -50.0f, 50.0f, 50.0f, 50.0f };
+
+	// Array of structures layout used as the benchmark baseline.
+	struct AosParticle
+	{
+		float x, y, z;
+		float vx, vy, vz;
+		float age;
+		float lifetime;
+	};
+
+	bool DetectAvx2()
+	{
+#if defined(PARTICLE_STORE_X86) && defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// The OS must save the YMM registers as well as the CPU supporting AVX2.
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#elif defined(PARTICLE_STORE_X86)
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+
+	const bool g_hasAvx2 = DetectAvx2();
+
+	void IntegrateScalar(size_t begin, size_t end, float deltaTime, float* x, float* y, float* z, const float* vx, const float* vy, const float* vz, float* age)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			x[i] += vx[i] * deltaTime;
+			y[i] += vy[i] * deltaTime;
+			z[i] += vz[i] * deltaTime;
+			age[i] += deltaTime;
+		}
+	}
+
+	void DampScalar(size_t begin, size_t end, float factor, float* vx, float* vy, float* vz)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			vx[i] *= factor;
+			vy[i] *= factor;
+			vz[i] *= factor;
+		}
+	}
+
+	void BoundAxisScalar(size_t begin, size_t end, float minimum, float maximum, float* p, float* v)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (p[i] < minimum)
+			{
+				p[i] = minimum;
+				v[i] = fabsf(v[i]);
+			}
+			else if (p[i] > maximum)
+			{
+				p[i] = maximum;
+				v[i] = -fabsf(v[i]);
+			}
+		}
+	}
+
+#if defined(PARTICLE_STORE_X86)
+	// The kernels return how many particles they handled; the caller finishes the tail in scalar code.
+	// Multiplies and adds stay separate so results match the scalar path bit for bit.
+
+	PARTICLE_STORE_AVX2 size_t IntegrateAvx2(size_t count, float deltaTime, float* x, float* y, float* z, const float* vx, const float* vy, const float* vz, float* age)
+	{
+		__m256 dt = _mm256_set1_ps(deltaTime);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_store_ps(x + i, _mm256_add_ps(_mm256_load_ps(x + i), _mm256_mul_ps(_mm256_load_ps(vx + i), dt)));
+			_mm256_store_ps(y + i, _mm256_add_ps(_mm256_load_ps(y + i), _mm256_mul_ps(_mm256_load_ps(vy + i), dt)));
+			_mm256_store_ps(z + i, _mm256_add_ps(_mm256_load_ps(z + i), _mm256_mul_ps(_mm256_load_ps(vz + i), dt)));
+			_mm256_store_ps(age + i, _mm256_add_ps(_mm256_load_ps(age + i), dt));
+		}
+		return i;
+	}
+
+	PARTICLE_STORE_AVX2 size_t DampAvx2(size_t count, float factor, float* vx, float* vy, float* vz)
+	{
+		__m256 f = _mm256_set1_ps(factor);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_store_ps(vx + i, _mm256_mul_ps(_mm256_load_ps(vx + i), f));
+			_mm256_store_ps(vy + i, _mm256_mul_ps(_mm256_load_ps(vy + i), f));
+			_mm256_store_ps(vz + i, _mm256_mul_ps(_mm256_load_ps(vz + i), f));
+		}
+		return i;
+	}
+
+	PARTICLE_STORE_AVX2 size_t BoundAxisAvx2(size_t count, float minimum, float maximum, float* p, float* v)
+	{
+		__m256 lo = _mm256_set1_ps(minimum);
+		__m256 hi = _mm256_set1_ps(maximum);
+		__m256 signMask = _mm256_set1_ps(-0.0f);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 position = _mm256_load_ps(p + i);
+			__m256 velocity = _mm256_load_ps(v + i);
+
+			__m256 below = _mm256_cmp_ps(position, lo, _CMP_LT_OQ);
+			__m256 above = _mm256_cmp_ps(position, hi, _CMP_GT_OQ);
+
+			// |v| where the particle left through the bottom, -|v| through the top.
+			__m256 speed = _mm256_andnot_ps(signMask, velocity);
+			velocity = _mm256_blendv_ps(velocity, speed, below);
+			velocity = _mm256_blendv_ps(velocity, _mm256_or_ps(speed, signMask), above);
+
+			_mm256_store_ps(p + i, _mm256_min_ps(_mm256_max_ps(position, lo), hi));
+			_mm256_store_ps(v + i, velocity);
+		}
+		return i;
+	}
+#endif
+
+	double AosStepMilliseconds(std::vector<AosParticle>& particles, uint32_t steps)
+	{
+		const ParticleBounds& b = PARTICLE_BENCHMARK_BOUNDS;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t step = 0; step < steps; step++)
+		{
+			for (AosParticle& p : particles)
+			{
+				p.x += p.vx * 0.016f;
+				p.y += p.vy * 0.016f;
+				p.z += p.vz * 0.016f;
+				p.age += 0.016f;
+			}
+
+			for (AosParticle& p : particles)
+			{
+				p.vx *= 0.99f;
+				p.vy *= 0.99f;
+				p.vz *= 0.99f;
+			}
+
+			for (AosParticle& p : particles)
+			{
+				if (p.x < b.minX) { p.x = b.minX; p.vx = fabsf(p.vx); }
+				else if (p.x > b.maxX) { p.x = b.maxX; p.vx = -fabsf(p.vx); }
+				if (p.y < b.minY) { p.y = b.minY; p.vy = fabsf(p.vy); }
+				else if (p.y > b.maxY) { p.y = b.maxY; p.vy = -fabsf(p.vy); }
+				if (p.z < b.minZ) { p.z = b.minZ; p.vz = fabsf(p.vz); }
+				else if (p.z > b.maxZ) { p.z = b.maxZ; p.vz = -fabsf(p.vz); }
+			}
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / std::max<uint32_t>(steps, 1);
+	}
+}
+
+ParticleStore::ParticleStore() :
+	m_count(0)
+{
+}
+
+void ParticleStore::Reserve(size_t capacity)
+{
+	m_x.reserve(capacity);
+	m_y.reserve(capacity);
+	m_z.reserve(capacity);
+	m_vx.reserve(capacity);
+	m_vy.reserve(capacity);
+	m_vz.reserve(capacity);
+	m_age.reserve(capacity);
+	m_lifetime.reserve(capacity);
+}
+
+void ParticleStore::Clear()
+{
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+	m_vx.clear();
+	m_vy.clear();
+	m_vz.clear();
+	m_age.clear();
+	m_lifetime.clear();
+	m_count = 0;
+}
+
+size_t ParticleStore::Add(float x, float y, float z, float vx, float vy, float vz, float lifetime)
+{
+	m_x.push_back(x);
+	m_y.push_back(y);
+	m_z.push_back(z);
+	m_vx.push_back(vx);
+	m_vy.push_back(vy);
+	m_vz.push_back(vz);
+	m_age.push_back(0.0f);
+	m_lifetime.push_back(lifetime);
+	return m_count++;
+}
+
+void ParticleStore::Remove(size_t index)
+{
+	size_t last = m_count - 1;
+
+	m_x[index] = m_x[last];
+	m_y[index] = m_y[last];
+	m_z[index] = m_z[last];
+	m_vx[index] = m_vx[last];
+	m_vy[index] = m_vy[last];
+	m_vz[index] = m_vz[last];
+	m_age[index] = m_age[last];
+	m_lifetime[index] = m_lifetime[last];
+
+	m_x.pop_back();
+	m_y.pop_back();
+	m_z.pop_back();
+	m_vx.pop_back();
+	m_vy.pop_back();
+	m_vz.pop_back();
+	m_age.pop_back();
+	m_lifetime.pop_back();
+	m_count = last;
+}
+
+void ParticleStore::Integrate(float deltaTime)
+{
+	size_t done = 0;
+#if defined(PARTICLE_STORE_X86)
+	if (g_hasAvx2) done = IntegrateAvx2(m_count, deltaTime, m_x.data(), m_y.data(), m_z.data(), m_vx.data(), m_vy.data(), m_vz.data(), m_age.data());
+#endif
+	IntegrateScalar(done, m_count, deltaTime, m_x.data(), m_y.data(), m_z.data(), m_vx.data(), m_vy.data(), m_vz.data(), m_age.data());
+}
+
+void ParticleStore::Damp(float factor)
+{
+	size_t done = 0;
+#if defined(PARTICLE_STORE_X86)
+	if (g_hasAvx2) done = DampAvx2(m_count, factor, m_vx.data(), m_vy.data(), m_vz.data());
+#endif
+	DampScalar(done, m_count, factor, m_vx.data(), m_vy.data(), m_vz.data());
+}
+
+void ParticleStore::ApplyBounds(const ParticleBounds& bounds)
+{
+	const float minimum[3] = { bounds.minX, bounds.minY, bounds.minZ };
+	const float maximum[3] = { bounds.maxX, bounds.maxY, bounds.maxZ };
+	float* positions[3] = { m_x.data(), m_y.data(), m_z.data() };
+	float* velocities[3] = { m_vx.data(), m_vy.data(), m_vz.data() };
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		size_t done = 0;
+#if defined(PARTICLE_STORE_X86)
+		if (g_hasAvx2) done = BoundAxisAvx2(m_count, minimum[axis], maximum[axis], positions[axis], velocities[axis]);
+#endif
+		BoundAxisScalar(done, m_count, minimum[axis], maximum[axis], positions[axis], velocities[axis]);
+	}
+}
+
+size_t ParticleStore::RemoveExpired()
+{
+	size_t removed = 0;
+	size_t i = 0;
+	while (i < m_count)
+	{
+		if (m_age[i] >= m_lifetime[i])
+		{
+			Remove(i);
+			removed++;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return removed;
+}
+
+bool ParticleStore::IsVectorised()
+{
+	return g_hasAvx2;
+}
+
+ParticleBenchmarkResult ParticleStore::Benchmark(size_t count, uint32_t steps)
+{
+	ParticleBenchmarkResult result = { count, 0.0, 0.0 };
+
+	// Both layouts start from the same random particles.
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> velocity(-5.0f, 5.0f);
+
+	std::vector<AosParticle> aos(count);
+	ParticleStore soa;
+	soa.Reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		AosParticle& p = aos[i];
+		p.x = position(random);
+		p.y = position(random);
+		p.z = position(random);
+		p.vx = velocity(random);
+		p.vy = velocity(random);
+		p.vz = velocity(random);
+		p.age = 0.0f;
+		p.lifetime = 1000.0f;
+
+		soa.Add(p.x, p.y, p.z, p.vx, p.vy, p.vz, p.lifetime);
+	}
+
+	result.aosMilliseconds = AosStepMilliseconds(aos, steps);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t step = 0; step < steps; step++)
+	{
+		soa.Integrate(0.016f);
+		soa.Damp(0.99f);
+		soa.ApplyBounds(PARTICLE_BENCHMARK_BOUNDS);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	result.soaMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / std::max<uint32_t>(steps, 1);
+	return result;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Structure-of-arrays particle storage for the CPU side of the P05 particles.
+	//
+	// Every attribute lives in its own 32 byte aligned array, so the integration,
+	// damping and bounds kernels stream through memory eight floats at a time with
+	// AVX2. The AVX2 kernels are picked at runtime when the CPU supports them, and
+	// scalar loops are used otherwise. Removal swaps the last particle into the
+	// hole, keeping the arrays packed.
+	//
+	// Only standard C++ and compiler intrinsics are used, so the module builds and
+	// runs on any platform.
+
+	template <typename T, size_t Alignment = 32>
+	class AlignedAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef AlignedAllocator<U, Alignment> other;
+		};
+
+		AlignedAllocator() {}
+
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		// Over-allocates and stores the original pointer just before the aligned block.
+		T* allocate(size_t count)
+		{
+			void* block = std::malloc(count * sizeof(T) + Alignment + sizeof(void*));
+			if (!block) throw std::bad_alloc();
+
+			uintptr_t start = reinterpret_cast<uintptr_t>(block) + sizeof(void*);
+			uintptr_t aligned = (start + Alignment - 1) & ~static_cast<uintptr_t>(Alignment - 1);
+			reinterpret_cast<void**>(aligned)[-1] = block;
+			return reinterpret_cast<T*>(aligned);
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+			if (pointer) std::free(reinterpret_cast<void**>(pointer)[-1]);
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>&) const	{ return true; }
+
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment>&) const	{ return false; }
+	};
+
+	struct ParticleBounds
+	{
+		float minX, minY, minZ;
+		float maxX, maxY, maxZ;
+	};
+
+	struct ParticleBenchmarkResult
+	{
+		size_t	count;
+		double	aosMilliseconds;	// Per step.
+		double	soaMilliseconds;
+	};
+
+	class ParticleStore
+	{
+	public:
+		typedef std::vector<float, AlignedAllocator<float>> Array;
+
+		ParticleStore();
+
+		void Reserve(size_t capacity);
+		void Clear();
+
+		// Appends a particle and returns its index.
+		size_t Add(float x, float y, float z, float vx, float vy, float vz, float lifetime);
+
+		// Moves the last particle into index, so indices above it are not stable.
+		void Remove(size_t index);
+
+		// position += velocity * dt, age += dt.
+		void Integrate(float deltaTime);
+
+		// velocity *= factor.
+		void Damp(float factor);
+
+		// Clamps positions into the box and turns velocities back inwards at the walls.
+		void ApplyBounds(const ParticleBounds& bounds);
+
+		// Removes every particle whose age has reached its lifetime. Returns how many were removed.
+		size_t RemoveExpired();
+
+		size_t GetCount() const							{ return m_count; }
+
+		const float* GetX() const						{ return m_x.data(); }
+		const float* GetY() const						{ return m_y.data(); }
+		const float* GetZ() const						{ return m_z.data(); }
+		const float* GetVelocityX() const				{ return m_vx.data(); }
+		const float* GetVelocityY() const				{ return m_vy.data(); }
+		const float* GetVelocityZ() const				{ return m_vz.data(); }
+		const float* GetAge() const						{ return m_age.data(); }
+		const float* GetLifetime() const				{ return m_lifetime.data(); }
+
+		float* GetVelocityX()							{ return m_vx.data(); }
+		float* GetVelocityY()							{ return m_vy.data(); }
+		float* GetVelocityZ()							{ return m_vz.data(); }
+
+		// True when the AVX2 kernels are in use on this CPU.
+		static bool IsVectorised();
+
+		// Times Integrate, Damp and ApplyBounds on an array of structures and on this
+		// store, averaged over the given number of steps.
+		static ParticleBenchmarkResult Benchmark(size_t count, uint32_t steps);
+
+	private:
+		Array	m_x;
+		Array	m_y;
+		Array	m_z;
+		Array	m_vx;
+		Array	m_vy;
+		Array	m_vz;
+		Array	m_age;
+		Array	m_lifetime;
+		size_t	m_count;
+	};
+}
@@ -0,0 +1,302 @@
+#include "pch.h"
+#include "PlantGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float PlantGrid::SlabBottom = -6.0f;
+const float PlantGrid::SlabTop = -1.9f;
+const float PlantGrid::CellSize = 0.5f;
+const float PlantGrid::Margin = 0.5f;
+const float PlantGrid::Material = 5.5f;
+
+namespace
+{
+	// The three PlantsSDF of ObjectsSDF: where each is moved on xz, and its material.
+	const float PLANT_GROUP_OFFSETS[3][2] = { { 0.0f, 0.0f }, { 1.0f, -0.5f }, { -2.5f, -1.3f } };
+	const float PLANT_GROUP_MATERIALS[3] = { 5.5f, 5.5f, 8.5f };
+
+	// The loop of PlantsSDF: the three stalks of an iteration, moved in its
+	// frame, with their heights, and how the frame moves and turns after each.
+	const uint32_t PLANT_LOOP_COUNT = 8;
+	const float PLANT_STALK_OFFSETS[3][3] = { { 0.0f, 0.0f, 0.0f }, { -0.3f, -0.5f, -0.3f }, { -0.3f, -0.5f, -0.5f } };
+	const float PLANT_STALK_HEIGHTS[3] = { 0.0f, 5.0f, 3.0f };
+	const float PLANT_LOOP_SHIFT[2] = { 0.01f, 0.06f };
+	const float PLANT_LOOP_ANGLE = 0.7f;
+
+	// Bound of a cell without stalks beyond its own.
+	const float PLANT_NO_BOUND = 1e10f;
+
+	// Stalks per square unit of Forest.
+	const float PLANT_FOREST_DENSITY = 2.0f;
+
+	float Length(float x, float y, float z)
+	{
+		return sqrtf(x * x + y * y + z * z);
+	}
+
+	// p.xz = mul(p.xz, rot(a)), as in MathUtils.hlsli.
+	void Rotate(float& x, float& z, float a)
+	{
+		float c = cosf(a);
+		float s = sinf(a);
+		float rx = x * c - z * s;
+		z = x * s + z * c;
+		x = rx;
+	}
+
+	// min() of two float2 in MathUtils.hlsli, which keeps the second on a tie.
+	void Nearer(float distance, float id, float& nearest, float& nearestId)
+	{
+		if (distance < nearest)
+		{
+			nearest = distance;
+			nearestId = id;
+		}
+	}
+
+	// Distance on xz from a point to a rectangle, zero inside.
+	float RectDistance(float x, float z, float x0, float z0, float x1, float z1)
+	{
+		float dx = std::max(std::max(x0 - x, x - x1), 0.0f);
+		float dz = std::max(std::max(z0 - z, z - z1), 0.0f);
+		return sqrtf(dx * dx + dz * dz);
+	}
+}
+
+PlantGrid::PlantGrid() :
+	m_originX(0.0f),
+	m_originZ(0.0f),
+	m_columns(0),
+	m_rows(0)
+{
+}
+
+float PlantGrid::PlantSDF(const float p[3], float h, float time)
+{
+	float wave = sinf(p[1] * 10.0f);
+	float r = 0.04f * -(p[1] + 2.5f) - 0.005f * wave * wave * wave * wave;
+	float bend = 0.2f * (p[1] + 5.6f);
+	float z = p[2] + sinf(time * 0.5f + h) * bend * bend * bend;
+
+	// CylinderSDF of height 5h, standing at y = -5.7
+	float y = p[1] + 5.7f;
+	y -= std::min(std::max(y, 0.0f), 5.0f * h);
+	return Length(p[0], y, z) - r;
+}
+
+float PlantGrid::PlantsSDF(const float p[3], float time)
+{
+	float q[3] = { p[0], p[1], p[2] };
+	float d = 1e10f;
+	for (uint32_t i = 0; i < PLANT_LOOP_COUNT; i++)
+	{
+		float a[3] = { q[0] - 0.3f, q[1] - 0.5f, q[2] - 0.3f };
+		float b[3] = { q[0] - 0.3f, q[1] - 0.5f, q[2] - 0.5f };
+		d = std::min(d, std::min(PlantSDF(q, 0.0f, time), std::min(PlantSDF(a, 5.0f, time), PlantSDF(b, 3.0f, time))));
+		q[0] -= PLANT_LOOP_SHIFT[0];
+		q[2] -= PLANT_LOOP_SHIFT[1];
+		Rotate(q[0], q[2], PLANT_LOOP_ANGLE);
+	}
+	return d;
+}
+
+float PlantGrid::StalkSDF(const float p[3], const PlantInstance& instance, float time)
+{
+	float dx = p[0] - instance.baseX;
+	float dz = p[2] - instance.baseZ;
+	float q[3] = {
+		dx * instance.cosine - dz * instance.sine,
+		p[1] + instance.offsetY,
+		dx * instance.sine + dz * instance.cosine
+	};
+	return PlantSDF(q, instance.height, time);
+}
+
+std::vector<PlantInstance> PlantGrid::ScenePlants()
+{
+	std::vector<PlantInstance> instances;
+	for (uint32_t group = 0; group < 3; group++)
+	{
+		// Iteration i of the loop sees p.xz - offset turned by i times the angle
+		// and moved by t; a stalk stands where that plus its own offset is zero.
+		float tx = 0.0f, tz = 0.0f;
+		for (uint32_t i = 0; i < PLANT_LOOP_COUNT; i++)
+		{
+			float angle = i * PLANT_LOOP_ANGLE;
+			for (uint32_t stalk = 0; stalk < 3; stalk++)
+			{
+				float x = -PLANT_STALK_OFFSETS[stalk][0] - tx;
+				float z = -PLANT_STALK_OFFSETS[stalk][2] - tz;
+				Rotate(x, z, -angle);
+
+				PlantInstance instance = {};
+				instance.baseX = x + PLANT_GROUP_OFFSETS[group][0];
+				instance.baseZ = z + PLANT_GROUP_OFFSETS[group][1];
+				instance.cosine = cosf(angle);
+				instance.sine = sinf(angle);
+				instance.offsetY = PLANT_STALK_OFFSETS[stalk][1];
+				instance.height = PLANT_STALK_HEIGHTS[stalk];
+				instance.material = PLANT_GROUP_MATERIALS[group];
+				instances.push_back(instance);
+			}
+			tx -= PLANT_LOOP_SHIFT[0];
+			tz -= PLANT_LOOP_SHIFT[1];
+			Rotate(tx, tz, PLANT_LOOP_ANGLE);
+		}
+	}
+	return instances;
+}
+
+std::vector<PlantInstance> PlantGrid::Forest(uint32_t count, uint32_t seed)
+{
+	// A square around the origin, with the heights and y offsets of the scene's
+	// stalks so they stay within the slab.
+	float halfSide = 0.5f * sqrtf(count / PLANT_FOREST_DENSITY);
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> position(-halfSide, halfSide);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	std::uniform_int_distribution<uint32_t> stalk(0, 2);
+
+	std::vector<PlantInstance> instances(count);
+	for (auto& instance : instances)
+	{
+		float a = angle(generator);
+		uint32_t kind = stalk(generator);
+		instance = {};
+		instance.baseX = position(generator);
+		instance.baseZ = position(generator);
+		instance.cosine = cosf(a);
+		instance.sine = sinf(a);
+		instance.offsetY = PLANT_STALK_OFFSETS[kind][1];
+		instance.height = PLANT_STALK_HEIGHTS[kind];
+		instance.material = Material;
+	}
+	return instances;
+}
+
+float PlantGrid::Reach(const PlantInstance& instance)
+{
+	// In the stalk's frame, the radius shrinks as y grows and the sway is
+	// monotonic in y, so both are largest at an end of the slab.
+	float bottom = SlabBottom + instance.offsetY;
+	float top = SlabTop + instance.offsetY;
+	float radius = std::max(0.04f * -(bottom + 2.5f), 0.0f);
+	float bendBottom = fabsf(0.2f * (bottom + 5.6f));
+	float bendTop = fabsf(0.2f * (top + 5.6f));
+	float bend = std::max(bendBottom, bendTop);
+	return radius + bend * bend * bend;
+}
+
+void PlantGrid::Build(const std::vector<PlantInstance>& instances)
+{
+	m_instances = instances;
+	m_cellInstances.clear();
+	m_cells.clear();
+
+	std::vector<float> reaches(instances.size());
+	float maxReach = 0.0f;
+	float minX = 0.0f, minZ = 0.0f, maxX = 0.0f, maxZ = 0.0f;
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		reaches[i] = Reach(instances[i]);
+		maxReach = std::max(maxReach, reaches[i]);
+		minX = i == 0 ? instances[i].baseX : std::min(minX, instances[i].baseX);
+		minZ = i == 0 ? instances[i].baseZ : std::min(minZ, instances[i].baseZ);
+		maxX = i == 0 ? instances[i].baseX : std::max(maxX, instances[i].baseX);
+		maxZ = i == 0 ? instances[i].baseZ : std::max(maxZ, instances[i].baseZ);
+	}
+
+	// Every stalk lies Margin inside the grid, so outside it the distance to
+	// the grid plus Margin bounds them all.
+	float border = maxReach + Margin;
+	m_originX = minX - border;
+	m_originZ = minZ - border;
+	m_columns = instances.empty() ? 0 : static_cast<uint32_t>(ceilf((maxX - minX + 2.0f * border) / CellSize));
+	m_rows = instances.empty() ? 0 : static_cast<uint32_t>(ceilf((maxZ - minZ + 2.0f * border) / CellSize));
+
+	m_cells.resize(static_cast<size_t>(m_columns) * m_rows);
+	for (uint32_t row = 0; row < m_rows; row++)
+	{
+		for (uint32_t column = 0; column < m_columns; column++)
+		{
+			float x0 = m_originX + column * CellSize;
+			float z0 = m_originZ + row * CellSize;
+
+			PlantCell& cell = m_cells[static_cast<size_t>(row) * m_columns + column];
+			cell.first = static_cast<uint32_t>(m_cellInstances.size());
+			cell.count = 0;
+			cell.bound = PLANT_NO_BOUND;
+			cell.padding = 0.0f;
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				float distance = RectDistance(instances[i].baseX, instances[i].baseZ, x0, z0, x0 + CellSize, z0 + CellSize) - reaches[i];
+				if (distance < Margin)
+				{
+					m_cellInstances.push_back(instances[i]);
+					cell.count++;
+				}
+				else
+				{
+					cell.bound = std::min(cell.bound, distance);
+				}
+			}
+		}
+	}
+}
+
+const PlantCell* PlantGrid::FindCell(const float p[3], float& bound) const
+{
+	// How far the point is above or below the slab, negative within it
+	float gap = std::max(SlabBottom - p[1], p[1] - SlabTop);
+
+	float x = (p[0] - m_originX) / CellSize;
+	float z = (p[2] - m_originZ) / CellSize;
+	if (x < 0.0f || z < 0.0f || x >= m_columns || z >= m_rows)
+	{
+		float outside = RectDistance(p[0], p[2], m_originX, m_originZ,
+			m_originX + m_columns * CellSize, m_originZ + m_rows * CellSize);
+		bound = std::max(gap, outside + Margin);
+		return nullptr;
+	}
+
+	const PlantCell& cell = m_cells[static_cast<size_t>(z) * m_columns + static_cast<size_t>(x)];
+	bound = std::max(gap, cell.bound);
+	return &cell;
+}
+
+float PlantGrid::GetBound(const float p[3]) const
+{
+	float bound;
+	FindCell(p, bound);
+	return bound;
+}
+
+float PlantGrid::Distance(const float p[3], float time, float& material) const
+{
+	float nearest;
+	const PlantCell* cell = FindCell(p, nearest);
+	material = Material;
+	if (cell != nullptr)
+	{
+		for (uint32_t i = cell->first; i < cell->first + cell->count; i++)
+		{
+			Nearer(StalkSDF(p, m_cellInstances[i], time), m_cellInstances[i].material, nearest, material);
+		}
+	}
+	return nearest;
+}
+
+float PlantGrid::BruteDistance(const float p[3], float time, float& material) const
+{
+	float nearest = PLANT_NO_BOUND;
+	material = Material;
+	for (const auto& instance : m_instances)
+	{
+		Nearer(StalkSDF(p, instance, time), instance.material, nearest, material);
+	}
+	return nearest;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Domain repetition of the kelp of P01.
+	//
+	// PlantsSDF of P01_Scene.hlsli evaluates 24 stalks in a loop, each in the frame
+	// of the one before it, moved and rotated, and ObjectsSDF calls it three times:
+	// 72 stalks at every step of every ray. Each stalk is the same PlantSDF in a
+	// frame of its own, so it can be given as an instance instead: where its base
+	// stands on xz, the rotation of its frame, its y offset and its height.
+	// ScenePlants lists the 72 stalks of the scene this way.
+	//
+	// The instances are binned into a grid of square cells over xz. Stalks reach
+	// no higher than SlabTop and no lower than SlabBottom, and within that slab
+	// their sway and radius keep them within a reach of their base. A cell lists
+	// the stalks that come within Margin of it, and keeps a bound below the
+	// distance of all the others. A point evaluates the stalks of its cell alone
+	// and takes the bound for the rest, which gives min(distance to all stalks,
+	// bound): the same as evaluating every stalk wherever the tracer is near
+	// one, and a shorter step than the distance elsewhere. Above and below the
+	// slab, the distance to it bounds the stalks that are not listed as well.
+	//
+	// A point evaluates as many stalks as share its cell, however many the scene
+	// holds, so whole forests cost the same per step as a clump.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	// One stalk, laid out as PlantInstance of P01_Scene.hlsli.
+	struct PlantInstance
+	{
+		float	baseX;
+		float	baseZ;
+		float	cosine;		// Rotation from world xz into the stalk's frame.
+		float	sine;
+		float	offsetY;	// Added to y in the stalk's frame.
+		float	height;		// h of PlantSDF, which also sets the phase of the sway.
+		float	material;	// Id of ObjectsSDF.
+		float	padding;
+	};
+
+	// One cell of the grid, laid out as PlantCell of P01_Scene.hlsli.
+	struct PlantCell
+	{
+		uint32_t	first;		// Of its stalks in the cell instances.
+		uint32_t	count;
+		float		bound;		// Below the distance to every stalk not listed.
+		float		padding;
+	};
+
+	class PlantGrid
+	{
+	public:
+		// The slab the stalks stand in, the side of a cell, and how close a stalk
+		// has to come to a cell to be listed in it.
+		static const float SlabBottom;
+		static const float SlabTop;
+		static const float CellSize;
+		static const float Margin;
+
+		// Material the bound returns, which is never a hit.
+		static const float Material;
+
+		PlantGrid();
+
+		// Bins the instances into cells over their extent.
+		void Build(const std::vector<PlantInstance>& instances);
+
+		// Distance to the stalks through the grid, and through all of them, with
+		// the material of the nearest.
+		float Distance(const float p[3], float time, float& material) const;
+		float BruteDistance(const float p[3], float time, float& material) const;
+
+		// The bound Distance takes for the stalks not evaluated at a point.
+		float GetBound(const float p[3]) const;
+
+		// Cells in rows of increasing z, and the instances they index, grouped by cell.
+		const std::vector<PlantCell>& GetCells() const				{ return m_cells; }
+		const std::vector<PlantInstance>& GetCellInstances() const	{ return m_cellInstances; }
+		const std::vector<PlantInstance>& GetInstances() const		{ return m_instances; }
+		float GetOriginX() const									{ return m_originX; }
+		float GetOriginZ() const									{ return m_originZ; }
+		uint32_t GetColumns() const									{ return m_columns; }
+		uint32_t GetRows() const									{ return m_rows; }
+
+		// PlantSDF and PlantsSDF as the shaders have them.
+		static float PlantSDF(const float p[3], float h, float time);
+		static float PlantsSDF(const float p[3], float time);
+
+		// One stalk of an instance.
+		static float StalkSDF(const float p[3], const PlantInstance& instance, float time);
+
+		// The stalks of the three PlantsSDF of ObjectsSDF, and a forest of stalks
+		// like them spread over the sea floor.
+		static std::vector<PlantInstance> ScenePlants();
+		static std::vector<PlantInstance> Forest(uint32_t count, uint32_t seed);
+
+	private:
+		// How far from its base a stalk can be within the slab.
+		static float Reach(const PlantInstance& instance);
+
+		const PlantCell* FindCell(const float p[3], float& bound) const;
+
+		std::vector<PlantInstance>	m_instances;
+		std::vector<PlantInstance>	m_cellInstances;
+		std::vector<PlantCell>		m_cells;
+		float						m_originX;
+		float						m_originZ;
+		uint32_t					m_columns;
+		uint32_t					m_rows;
+	};
+}
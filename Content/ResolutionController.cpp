@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float ResolutionController::MinScale = 0.5f;
+const float ResolutionController::MaxScale = 1.0f;
+const double ResolutionController::ProportionalGain = 0.1;
+const double ResolutionController::IntegralGain = 0.05;
+const double ResolutionController::DerivativeGain = 0.02;
+const double ResolutionController::Tolerance = 0.05;
+
+ResolutionController::ResolutionController() :
+	m_budget(0.0),
+	m_integral(0.0),
+	m_previousError(0.0),
+	m_hasPrevious(false),
+	m_scale(MaxScale)
+{
+}
+
+void ResolutionController::Reset(double budgetMilliseconds)
+{
+	m_budget = budgetMilliseconds;
+	m_integral = 0.0;
+	m_previousError = 0.0;
+	m_hasPrevious = false;
+	m_scale = MaxScale;
+}
+
+float ResolutionController::Update(double frameMilliseconds)
+{
+	if (frameMilliseconds <= 0.0 || m_budget <= 0.0) return m_scale;
+
+	const double minArea = static_cast<double>(MinScale) * MinScale;
+	const double maxArea = static_cast<double>(MaxScale) * MaxScale;
+
+	double error = (m_budget - frameMilliseconds) / m_budget;
+	double derivative = m_hasPrevious ? error - m_previousError : 0.0;
+	m_previousError = error;
+	m_hasPrevious = true;
+
+	// Full resolution is the operating point; the integral stays within the limits.
+	m_integral = std::min(std::max(m_integral + IntegralGain * error, minArea - 1.0), maxArea - 1.0);
+
+	double area = 1.0 + ProportionalGain * error + m_integral + DerivativeGain * derivative;
+	area = std::min(std::max(area, minArea), maxArea);
+
+	m_scale = static_cast<float>(std::sqrt(area));
+	return m_scale;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Picks the resolution P01 ray marches at, so its GPU time meets a budget.
+	//
+	// The cost of the marcher grows with its pixel count, so the controller works
+	// on the area, the square of the scale on each axis. Every frame it compares
+	// the measured time with the budget, relative to the budget, and sets the area
+	// from a PID sum of that error around full resolution. The integral does most
+	// of the work and is clamped to the area limits, so it does not wind up while
+	// the scale sits at one of them. The gains are small because the GPU timer
+	// reads back a few frames late.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	class ResolutionController
+	{
+	public:
+		// Limits of the scale on each axis.
+		static const float MinScale;
+		static const float MaxScale;
+
+		static const double ProportionalGain;
+		static const double IntegralGain;
+		static const double DerivativeGain;
+
+		// Relative distance from the budget that counts as settled.
+		static const double Tolerance;
+
+		ResolutionController();
+
+		// Starts again at full resolution with a budget in milliseconds.
+		void Reset(double budgetMilliseconds);
+
+		// Feeds the time the scaled work took and returns the scale for the next
+		// frame. A time of zero, before the GPU timer has results, is ignored.
+		float Update(double frameMilliseconds);
+
+		float GetScale() const						{ return m_scale; }
+		double GetBudget() const					{ return m_budget; }
+
+	private:
+		double	m_budget;
+		double	m_integral;
+		double	m_previousError;
+		bool	m_hasPrevious;
+		float	m_scale;
+	};
+}
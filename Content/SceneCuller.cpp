@@ -0,0 +1,439 @@
+#include "pch.h"
+#include "SceneCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SCENE_CULLER_X86
+#include <immintrin.h>
+#endif
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const float CULL_PI = 3.14159265358979323846f;
+
+	// Projections closer to the camera than this count as crossing the near plane.
+	const float CULL_MIN_W = 1.0e-5f;
+
+	// Widest screen rectangle, in texels of the chosen level, read for one sphere.
+	const float CULL_HIZ_FOOTPRINT = 2.0f;
+
+	// The start camera and projection of SceneRenderer, used by the benchmark.
+	const float CULL_BENCHMARK_EYE[3] = { 0.0f, -2.5f, -15.5f };
+	const float CULL_BENCHMARK_FOV_Y = 70.0f * CULL_PI / 180.0f;
+	const float CULL_BENCHMARK_ASPECT = 16.0f / 9.0f;
+	const float CULL_BENCHMARK_NEAR = 0.01f;
+	const float CULL_BENCHMARK_FAR = 100.0f;
+
+	// Roughly this many sphere tests are timed per path, whatever the count.
+	const size_t CULL_BENCHMARK_TESTS = 4000000;
+
+	// Size of the synthetic depth grid, matching the GPU reduction.
+	const uint32_t CULL_BENCHMARK_GRID_WIDTH = 128;
+	const uint32_t CULL_BENCHMARK_GRID_HEIGHT = 64;
+
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++)
+				{
+					sum += a[row * 4 + k] * b[k * 4 + column];
+				}
+				result[row * 4 + column] = sum;
+			}
+		}
+	}
+
+	// The view-projection SceneRenderer builds at its start camera: a left-handed
+	// look along +z followed by a right-handed perspective projection.
+	void BenchmarkViewProjection(float viewProjection[16])
+	{
+		const float view[16] =
+		{
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			-CULL_BENCHMARK_EYE[0], -CULL_BENCHMARK_EYE[1], -CULL_BENCHMARK_EYE[2], 1.0f
+		};
+
+		float height = 1.0f / tanf(0.5f * CULL_BENCHMARK_FOV_Y);
+		float width = height / CULL_BENCHMARK_ASPECT;
+		float range = CULL_BENCHMARK_FAR / (CULL_BENCHMARK_NEAR - CULL_BENCHMARK_FAR);
+
+		const float projection[16] =
+		{
+			width, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, -1.0f,
+			0.0f, 0.0f, range * CULL_BENCHMARK_NEAR, 0.0f
+		};
+
+		Multiply(view, projection, viewProjection);
+	}
+
+	void Transform(const float m[16], float x, float y, float z, float clip[4])
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			clip[c] = x * m[c] + y * m[4 + c] + z * m[8 + c] + m[12 + c];
+		}
+	}
+
+	size_t TestScalarRange(const CullFrustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		size_t begin, size_t end, uint8_t* visible)
+	{
+		size_t visibleCount = 0;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			bool isInside = true;
+			for (int p = 0; p < 6 && isInside; p++)
+			{
+				float distance = frustum.a[p] * x[i] + frustum.b[p] * y[i] + frustum.c[p] * z[i] + frustum.d[p];
+				isInside = distance >= -radius[i];
+			}
+
+			visible[i] = isInside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+
+		return visibleCount;
+	}
+
+	template <typename Function>
+	double MeasureMicroseconds(size_t repeats, Function function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repeats; r++)
+		{
+			function();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::micro>(end - start).count();
+	}
+
+	double ObjectsPerMicrosecond(size_t count, size_t repeats, double microseconds)
+	{
+		return static_cast<double>(count) * repeats / std::max(microseconds, 1.0e-3);
+	}
+}
+
+HiZBuffer::HiZBuffer() :
+	m_viewProjection()
+{
+}
+
+void HiZBuffer::Build(const float* depth, uint32_t width, uint32_t height, const float viewProjection[16])
+{
+	Clear();
+	if (width == 0 || height == 0) return;
+
+	std::copy(viewProjection, viewProjection + 16, m_viewProjection);
+
+	m_levels.push_back(std::vector<float>(depth, depth + static_cast<size_t>(width) * height));
+	m_widths.push_back(width);
+	m_heights.push_back(height);
+
+	// Each texel keeps the farthest depth of the 2x2 texels under it. Odd edges
+	// repeat their last texel, so every level still covers the whole screen.
+	while (width > 1 || height > 1)
+	{
+		uint32_t nextWidth = (width + 1) / 2;
+		uint32_t nextHeight = (height + 1) / 2;
+		const std::vector<float>& source = m_levels.back();
+		std::vector<float> next(static_cast<size_t>(nextWidth) * nextHeight);
+
+		for (uint32_t y = 0; y < nextHeight; y++)
+		{
+			uint32_t y0 = 2 * y;
+			uint32_t y1 = std::min(y0 + 1, height - 1);
+
+			for (uint32_t x = 0; x < nextWidth; x++)
+			{
+				uint32_t x0 = 2 * x;
+				uint32_t x1 = std::min(x0 + 1, width - 1);
+
+				next[static_cast<size_t>(y) * nextWidth + x] = std::max(
+					std::max(source[static_cast<size_t>(y0) * width + x0], source[static_cast<size_t>(y0) * width + x1]),
+					std::max(source[static_cast<size_t>(y1) * width + x0], source[static_cast<size_t>(y1) * width + x1]));
+			}
+		}
+
+		m_levels.push_back(std::move(next));
+		m_widths.push_back(nextWidth);
+		m_heights.push_back(nextHeight);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+void HiZBuffer::Clear()
+{
+	m_levels.clear();
+	m_widths.clear();
+	m_heights.clear();
+}
+
+bool HiZBuffer::IsOccluded(const CullSphere& sphere) const
+{
+	if (m_levels.empty()) return false;
+
+	// Screen rectangle and nearest depth of the sphere's bounding box.
+	float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max();
+	float maxX = -std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+	float nearestZ = 1.0f;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float clip[4];
+		Transform(m_viewProjection,
+			sphere.x + ((corner & 1) ? sphere.radius : -sphere.radius),
+			sphere.y + ((corner & 2) ? sphere.radius : -sphere.radius),
+			sphere.z + ((corner & 4) ? sphere.radius : -sphere.radius),
+			clip);
+
+		if (clip[3] <= CULL_MIN_W) return false;
+
+		float x = clip[0] / clip[3];
+		float y = clip[1] / clip[3];
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearestZ = std::min(nearestZ, clip[2] / clip[3]);
+	}
+
+	if (nearestZ <= 0.0f) return false;
+
+	// Off screen spheres are left to the frustum test.
+	if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) return false;
+
+	minX = std::max(minX, -1.0f);
+	maxX = std::min(maxX, 1.0f);
+	minY = std::max(minY, -1.0f);
+	maxY = std::min(maxY, 1.0f);
+
+	// Texel rectangle on the base level, with y running down the screen.
+	float left = (minX * 0.5f + 0.5f) * m_widths[0];
+	float right = (maxX * 0.5f + 0.5f) * m_widths[0];
+	float top = (0.5f - maxY * 0.5f) * m_heights[0];
+	float bottom = (0.5f - minY * 0.5f) * m_heights[0];
+
+	// The level where the rectangle spans only a couple of texels.
+	float extent = std::max(right - left, bottom - top) / CULL_HIZ_FOOTPRINT;
+	size_t level = (extent > 1.0f) ? static_cast<size_t>(ceilf(log2f(extent))) : 0;
+	level = std::min(level, m_levels.size() - 1);
+
+	float scale = 1.0f / static_cast<float>(1u << level);
+	uint32_t width = m_widths[level];
+	uint32_t height = m_heights[level];
+	uint32_t x0 = std::min(static_cast<uint32_t>(left * scale), width - 1);
+	uint32_t x1 = std::min(static_cast<uint32_t>(right * scale), width - 1);
+	uint32_t y0 = std::min(static_cast<uint32_t>(top * scale), height - 1);
+	uint32_t y1 = std::min(static_cast<uint32_t>(bottom * scale), height - 1);
+
+	const std::vector<float>& depth = m_levels[level];
+	for (uint32_t y = y0; y <= y1; y++)
+	{
+		for (uint32_t x = x0; x <= x1; x++)
+		{
+			if (nearestZ <= depth[static_cast<size_t>(y) * width + x]) return false;
+		}
+	}
+
+	return true;
+}
+
+CullFrustum SceneCuller::ExtractFrustum(const float viewProjection[16])
+{
+	// Column c of the row-vector matrix gives clip coordinate c. Inside is
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+	const float* m = viewProjection;
+	const float planes[6][4] =
+	{
+		{ m[3] + m[0], m[7] + m[4], m[11] + m[8], m[15] + m[12] },		// Left.
+		{ m[3] - m[0], m[7] - m[4], m[11] - m[8], m[15] - m[12] },		// Right.
+		{ m[3] + m[1], m[7] + m[5], m[11] + m[9], m[15] + m[13] },		// Bottom.
+		{ m[3] - m[1], m[7] - m[5], m[11] - m[9], m[15] - m[13] },		// Top.
+		{ m[2], m[6], m[10], m[14] },									// Near.
+		{ m[3] - m[2], m[7] - m[6], m[11] - m[10], m[15] - m[14] },		// Far.
+	};
+
+	CullFrustum frustum;
+	for (int p = 0; p < 6; p++)
+	{
+		// Normalised so the plane distance compares directly with a radius.
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		float inverse = (length > 0.0f) ? 1.0f / length : 0.0f;
+
+		frustum.a[p] = planes[p][0] * inverse;
+		frustum.b[p] = planes[p][1] * inverse;
+		frustum.c[p] = planes[p][2] * inverse;
+		frustum.d[p] = planes[p][3] * inverse;
+	}
+
+	return frustum;
+}
+
+bool SceneCuller::IsVisible(const CullFrustum& frustum, const CullSphere& sphere)
+{
+	uint8_t visible;
+	return TestScalarRange(frustum, &sphere.x, &sphere.y, &sphere.z, &sphere.radius, 0, 1, &visible) != 0;
+}
+
+size_t SceneCuller::TestScalar(const CullFrustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	return TestScalarRange(frustum, x, y, z, radius, 0, count, visible);
+}
+
+size_t SceneCuller::TestSimd(const CullFrustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	size_t visibleCount = 0;
+	size_t i = 0;
+
+#if defined(SCENE_CULLER_X86)
+	__m128 planeA[6], planeB[6], planeC[6], planeD[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeA[p] = _mm_set1_ps(frustum.a[p]);
+		planeB[p] = _mm_set1_ps(frustum.b[p]);
+		planeC[p] = _mm_set1_ps(frustum.c[p]);
+		planeD[p] = _mm_set1_ps(frustum.d[p]);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	// The sums are formed in the same order as the scalar test, so both agree exactly.
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sx = _mm_loadu_ps(x + i);
+		__m128 sy = _mm_loadu_ps(y + i);
+		__m128 sz = _mm_loadu_ps(z + i);
+		__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[p], sx), _mm_mul_ps(planeB[p], sy)), _mm_mul_ps(planeC[p], sz)),
+				planeD[p]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+		}
+		visibleCount += static_cast<size_t>(visible[i] + visible[i + 1] + visible[i + 2] + visible[i + 3]);
+	}
+#endif
+
+	return visibleCount + TestScalarRange(frustum, x, y, z, radius, i, count, visible);
+}
+
+bool SceneCuller::IsVectorised()
+{
+#if defined(SCENE_CULLER_X86)
+	return true;
+#else
+	return false;
+#endif
+}
+
+CullBenchmarkResult SceneCuller::Benchmark(size_t count)
+{
+	CullBenchmarkResult result = { count, 0.0, 0.0, 0.0, 0, 0, true };
+	if (count == 0) return result;
+
+	// Spheres scattered through a box around the start camera, about half of
+	// them in view.
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> spreadX(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> spreadY(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> spreadZ(-110.0f, 30.0f);
+	std::uniform_real_distribution<float> spreadRadius(0.2f, 3.0f);
+
+	std::vector<float> x(count), y(count), z(count), radius(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = spreadX(random);
+		y[i] = spreadY(random);
+		z[i] = spreadZ(random);
+		radius[i] = spreadRadius(random);
+	}
+
+	float viewProjection[16];
+	BenchmarkViewProjection(viewProjection);
+	CullFrustum frustum = ExtractFrustum(viewProjection);
+
+	size_t repeats = std::max<size_t>(1, CULL_BENCHMARK_TESTS / count);
+	std::vector<uint8_t> scalarVisible(count), simdVisible(count);
+
+	double scalarTime = MeasureMicroseconds(repeats, [&]() {
+		result.visibleCount = TestScalar(frustum, x.data(), y.data(), z.data(), radius.data(), count, scalarVisible.data());
+	});
+
+	double simdTime = MeasureMicroseconds(repeats, [&]() {
+		TestSimd(frustum, x.data(), y.data(), z.data(), radius.data(), count, simdVisible.data());
+	});
+
+	result.isConsistent = (scalarVisible == simdVisible);
+	result.scalarObjectsPerMicrosecond = ObjectsPerMicrosecond(count, repeats, scalarTime);
+	result.simdObjectsPerMicrosecond = ObjectsPerMicrosecond(count, repeats, simdTime);
+
+	// A wall 20 units in front of the camera over the left half of the screen, and
+	// nothing over the right half.
+	float wall[4];
+	Transform(viewProjection, 0.0f, CULL_BENCHMARK_EYE[1], CULL_BENCHMARK_EYE[2] - 20.0f, wall);
+	float wallDepth = wall[2] / wall[3];
+
+	std::vector<float> depth(static_cast<size_t>(CULL_BENCHMARK_GRID_WIDTH) * CULL_BENCHMARK_GRID_HEIGHT, 1.0f);
+	for (uint32_t row = 0; row < CULL_BENCHMARK_GRID_HEIGHT; row++)
+	{
+		std::fill_n(depth.begin() + static_cast<size_t>(row) * CULL_BENCHMARK_GRID_WIDTH, CULL_BENCHMARK_GRID_WIDTH / 2, wallDepth);
+	}
+
+	HiZBuffer hiZ;
+	hiZ.Build(depth.data(), CULL_BENCHMARK_GRID_WIDTH, CULL_BENCHMARK_GRID_HEIGHT, viewProjection);
+
+	// Only the spheres that pass the frustum test reach the occlusion test.
+	std::vector<CullSphere> candidates;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (scalarVisible[i])
+		{
+			CullSphere sphere = { x[i], y[i], z[i], radius[i] };
+			candidates.push_back(sphere);
+		}
+	}
+
+	if (!candidates.empty())
+	{
+		size_t hiZRepeats = std::max<size_t>(1, CULL_BENCHMARK_TESTS / 8 / candidates.size());
+		double hiZTime = MeasureMicroseconds(hiZRepeats, [&]() {
+			size_t occluded = 0;
+			for (const CullSphere& sphere : candidates)
+			{
+				occluded += hiZ.IsOccluded(sphere) ? 1 : 0;
+			}
+			result.occludedCount = occluded;
+		});
+
+		result.hiZObjectsPerMicrosecond = ObjectsPerMicrosecond(candidates.size(), hiZRepeats, hiZTime);
+	}
+
+	return result;
+}
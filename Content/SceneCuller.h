@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Visibility tests for the bounding spheres of the scene objects.
+	//
+	// The frustum test takes its six planes straight from the view-projection
+	// matrix, so it works with the scene's mixed handed camera as it is. Spheres
+	// are passed as one array per coordinate, and the SSE path tests four of them
+	// per instruction against each plane.
+	//
+	// HiZBuffer keeps a max-depth pyramid of an earlier frame's depth buffer. A
+	// sphere is occluded when the nearest depth of its bounding box lies behind
+	// the farthest depth under its screen rectangle.
+	//
+	// Matrices are 16 floats in DirectXMath row-vector order, not transposed.
+	//
+	// Only standard C++ and compiler intrinsics are used, so the module builds and
+	// runs on any platform.
+
+	struct CullSphere
+	{
+		float	x;
+		float	y;
+		float	z;
+		float	radius;
+	};
+
+	// Planes a x + b y + c z + d >= 0 on the inside, one array per coefficient.
+	struct CullFrustum
+	{
+		float	a[6];
+		float	b[6];
+		float	c[6];
+		float	d[6];
+	};
+
+	struct CullBenchmarkResult
+	{
+		size_t	count;
+		double	scalarObjectsPerMicrosecond;
+		double	simdObjectsPerMicrosecond;
+		double	hiZObjectsPerMicrosecond;
+		size_t	visibleCount;
+		size_t	occludedCount;
+		bool	isConsistent;		// Scalar and SIMD agree on every sphere.
+	};
+
+	class HiZBuffer
+	{
+	public:
+		HiZBuffer();
+
+		// Builds the pyramid from a width x height grid of depths, 0 near to 1 far,
+		// rendered with the given view-projection.
+		void Build(const float* depth, uint32_t width, uint32_t height, const float viewProjection[16]);
+
+		void Clear();
+
+		// False whenever the sphere reaches the near plane or the pyramid is empty.
+		bool IsOccluded(const CullSphere& sphere) const;
+
+		bool IsEmpty() const							{ return m_levels.empty(); }
+		uint32_t GetWidth() const						{ return m_widths.empty() ? 0 : m_widths[0]; }
+		uint32_t GetHeight() const						{ return m_heights.empty() ? 0 : m_heights[0]; }
+		size_t GetLevelCount() const					{ return m_levels.size(); }
+
+	private:
+		std::vector<std::vector<float>>	m_levels;
+		std::vector<uint32_t>			m_widths;
+		std::vector<uint32_t>			m_heights;
+		float							m_viewProjection[16];
+	};
+
+	class SceneCuller
+	{
+	public:
+		static CullFrustum ExtractFrustum(const float viewProjection[16]);
+
+		static bool IsVisible(const CullFrustum& frustum, const CullSphere& sphere);
+
+		// Sets visible[i] to 1 or 0 for count spheres and returns how many are visible.
+		static size_t TestScalar(const CullFrustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+			size_t count, uint8_t* visible);
+
+		// Same results as TestScalar, four spheres at a time when SSE is available.
+		static size_t TestSimd(const CullFrustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+			size_t count, uint8_t* visible);
+
+		static bool IsVectorised();
+
+		// Random spheres around the start camera, tested by each path.
+		static CullBenchmarkResult Benchmark(size_t count);
+	};
+}
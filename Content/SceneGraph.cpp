@@ -0,0 +1,291 @@
+#include "pch.h"
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Children per node in the benchmark tree.
+	const size_t SCENE_BENCHMARK_BRANCHING = 4;
+
+	// Largest world matrix difference the benchmark accepts between the methods.
+	const float SCENE_BENCHMARK_TOLERANCE = 1.0e-3f;
+
+	// Baseline for the benchmark: one heap allocation per node, children reached
+	// through pointers and every world matrix recomputed by recursion.
+	struct PointerNode
+	{
+		SceneMatrix									local;
+		SceneMatrix									world;
+		std::vector<std::unique_ptr<PointerNode>>	children;
+	};
+
+	void UpdatePointerNode(PointerNode& node, const SceneMatrix& parentWorld)
+	{
+		node.world = SceneGraph::Multiply(node.local, parentWorld);
+		for (auto& child : node.children)
+		{
+			UpdatePointerNode(*child, node.world);
+		}
+	}
+
+	SceneTransform RandomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+		std::uniform_real_distribution<float> angle(-0.5f, 0.5f);
+		std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+		SceneTransform transform;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			transform.position[axis] = offset(random);
+			transform.rotation[axis] = angle(random);
+			transform.scale[axis] = scale(random);
+		}
+		return transform;
+	}
+
+	bool IsClose(const SceneMatrix& a, const SceneMatrix& b)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			if (fabsf(a.m[i] - b.m[i]) > SCENE_BENCHMARK_TOLERANCE * std::max(1.0f, fabsf(a.m[i]))) return false;
+		}
+		return true;
+	}
+
+	template <typename Function>
+	double MeasureMilliseconds(uint32_t frames, Function function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			function(frame);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / std::max<uint32_t>(frames, 1);
+	}
+}
+
+SceneGraph::SceneGraph() :
+	m_updateStamp(0),
+	m_firstDirty(0)
+{
+}
+
+SceneNodeId SceneGraph::AddNode(SceneNodeId parent, const SceneTransform& local)
+{
+	SceneNodeId node = static_cast<SceneNodeId>(m_parents.size());
+
+	m_parents.push_back(parent < node ? parent : SCENE_NO_PARENT);
+	m_locals.push_back(local);
+	m_localMatrices.push_back(Compose(local));
+	m_worlds.push_back(m_localMatrices.back());
+	m_dirty.push_back(1);
+	m_updateStamps.push_back(m_updateStamp - 1);
+	m_firstDirty = std::min<size_t>(m_firstDirty, node);
+
+	return node;
+}
+
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_locals.clear();
+	m_localMatrices.clear();
+	m_worlds.clear();
+	m_dirty.clear();
+	m_updateStamps.clear();
+	m_firstDirty = 0;
+}
+
+void SceneGraph::SetLocal(SceneNodeId node, const SceneTransform& local)
+{
+	m_locals[node] = local;
+	m_localMatrices[node] = Compose(local);
+	m_dirty[node] = 1;
+	m_firstDirty = std::min<size_t>(m_firstDirty, node);
+}
+
+size_t SceneGraph::Update()
+{
+	m_updateStamp++;
+
+	size_t count = m_parents.size();
+	size_t updated = 0;
+
+	// Nothing before the first dirty node can have changed.
+	for (size_t i = m_firstDirty; i < count; i++)
+	{
+		SceneNodeId parent = m_parents[i];
+		bool isParentUpdated = parent != SCENE_NO_PARENT && m_updateStamps[parent] == m_updateStamp;
+		if (!m_dirty[i] && !isParentUpdated) continue;
+
+		m_worlds[i] = (parent == SCENE_NO_PARENT) ? m_localMatrices[i] : Multiply(m_localMatrices[i], m_worlds[parent]);
+		m_dirty[i] = 0;
+		m_updateStamps[i] = m_updateStamp;
+		updated++;
+	}
+
+	m_firstDirty = count;
+	return updated;
+}
+
+void SceneGraph::Invalidate()
+{
+	std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(1));
+	m_firstDirty = 0;
+}
+
+SceneTransform SceneGraph::Identity()
+{
+	SceneTransform transform = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	return transform;
+}
+
+SceneMatrix SceneGraph::Compose(const SceneTransform& transform)
+{
+	float cp = cosf(transform.rotation[0]), sp = sinf(transform.rotation[0]);
+	float cy = cosf(transform.rotation[1]), sy = sinf(transform.rotation[1]);
+	float cr = cosf(transform.rotation[2]), sr = sinf(transform.rotation[2]);
+
+	const float* s = transform.scale;
+	const float* t = transform.position;
+
+	SceneMatrix result =
+	{ {
+		s[0] * (cr * cy + sr * sp * sy), s[0] * (sr * cp), s[0] * (sr * sp * cy - cr * sy), 0.0f,
+		s[1] * (cr * sp * sy - sr * cy), s[1] * (cr * cp), s[1] * (sr * sy + cr * sp * cy), 0.0f,
+		s[2] * (cp * sy), s[2] * (-sp), s[2] * (cp * cy), 0.0f,
+		t[0], t[1], t[2], 1.0f
+	} };
+	return result;
+}
+
+SceneMatrix SceneGraph::Multiply(const SceneMatrix& a, const SceneMatrix& b)
+{
+	SceneMatrix result;
+
+	// The last column of an affine matrix is always (0, 0, 0, 1).
+	for (int row = 0; row < 4; row++)
+	{
+		const float* r = a.m + row * 4;
+		float w = (row == 3) ? 1.0f : 0.0f;
+
+		for (int column = 0; column < 3; column++)
+		{
+			result.m[row * 4 + column] = r[0] * b.m[column] + r[1] * b.m[4 + column] + r[2] * b.m[8 + column] + w * b.m[12 + column];
+		}
+		result.m[row * 4 + 3] = w;
+	}
+
+	return result;
+}
+
+void SceneGraph::TransformSphere(const SceneMatrix& world, const float center[3], float radius, float worldCenter[3], float& worldRadius)
+{
+	const float* m = world.m;
+	float largestScale = 0.0f;
+
+	for (int column = 0; column < 3; column++)
+	{
+		worldCenter[column] = center[0] * m[column] + center[1] * m[4 + column] + center[2] * m[8 + column] + m[12 + column];
+	}
+
+	for (int row = 0; row < 3; row++)
+	{
+		const float* r = m + row * 4;
+		largestScale = std::max(largestScale, sqrtf(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]));
+	}
+
+	worldRadius = radius * largestScale;
+}
+
+SceneGraphBenchmarkResult SceneGraph::Benchmark(size_t nodeCount, size_t dirtyPerFrame, uint32_t frames)
+{
+	SceneGraphBenchmarkResult result = { nodeCount, dirtyPerFrame, 0.0, 0.0, 0.0, 0.0, true };
+	if (nodeCount == 0 || frames == 0) return result;
+
+	std::mt19937 random(202219807);
+
+	// Both layouts hold the same tree, node i under node (i - 1) / 4.
+	SceneGraph graph;
+	std::vector<PointerNode*> pointerNodes;
+	std::unique_ptr<PointerNode> pointerRoot;
+
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		SceneNodeId parent = (i == 0) ? SCENE_NO_PARENT : static_cast<SceneNodeId>((i - 1) / SCENE_BENCHMARK_BRANCHING);
+		SceneTransform local = RandomTransform(random);
+		graph.AddNode(parent, local);
+
+		std::unique_ptr<PointerNode> node(new PointerNode());
+		node->local = Compose(local);
+		pointerNodes.push_back(node.get());
+
+		if (i == 0) pointerRoot = std::move(node);
+		else pointerNodes[parent]->children.push_back(std::move(node));
+	}
+
+	graph.Update();
+
+	// The same nodes move in every run, so the final matrices can be compared.
+	std::vector<std::vector<SceneNodeId>> moves(frames);
+	std::vector<std::vector<SceneTransform>> moveTransforms(frames);
+	std::uniform_int_distribution<size_t> pick(0, nodeCount - 1);
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		for (size_t j = 0; j < dirtyPerFrame; j++)
+		{
+			moves[frame].push_back(static_cast<SceneNodeId>(pick(random)));
+			moveTransforms[frame].push_back(RandomTransform(random));
+		}
+	}
+
+	size_t recomputed = 0;
+	result.dirtyMilliseconds = MeasureMilliseconds(frames, [&](uint32_t frame) {
+		for (size_t j = 0; j < moves[frame].size(); j++)
+		{
+			graph.SetLocal(moves[frame][j], moveTransforms[frame][j]);
+		}
+		recomputed += graph.Update();
+	});
+	result.recomputedPerFrame = static_cast<double>(recomputed) / frames;
+
+	// Flat arrays, every node recomputed each frame.
+	SceneGraph fullGraph;
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		fullGraph.AddNode(graph.GetParent(static_cast<SceneNodeId>(i)), graph.GetLocal(static_cast<SceneNodeId>(i)));
+	}
+
+	result.fullMilliseconds = MeasureMilliseconds(frames, [&](uint32_t) {
+		fullGraph.Invalidate();
+		fullGraph.Update();
+	});
+
+	// Pointer tree, every node recomputed each frame from its final local transform.
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		pointerNodes[i]->local = Compose(graph.GetLocal(static_cast<SceneNodeId>(i)));
+	}
+
+	SceneMatrix identity = Compose(Identity());
+	result.pointerTreeMilliseconds = MeasureMilliseconds(frames, [&](uint32_t) {
+		UpdatePointerNode(*pointerRoot, identity);
+	});
+
+	for (size_t i = 0; i < nodeCount && result.isConsistent; i++)
+	{
+		const SceneMatrix& world = graph.GetWorld(static_cast<SceneNodeId>(i));
+		result.isConsistent = IsClose(world, fullGraph.GetWorld(static_cast<SceneNodeId>(i))) && IsClose(world, pointerNodes[i]->world);
+	}
+
+	return result;
+}
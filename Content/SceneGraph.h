@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Transform hierarchy of the scene objects.
+	//
+	// Every node has a local scale, rotation and position relative to its parent.
+	// Nodes live in flat arrays indexed by id, and a parent is always added before
+	// its children, so a single pass in id order sees every parent before its
+	// children. Update only recomputes the world matrices of nodes whose local
+	// transform changed, or whose parent's world matrix changed in the same pass,
+	// starting from the first dirty node.
+	//
+	// Matrices are 16 floats in DirectXMath row-vector order, the same layout as
+	// XMFLOAT4X4, not transposed.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	typedef uint32_t SceneNodeId;
+
+	const SceneNodeId SCENE_NO_PARENT = 0xFFFFFFFF;
+
+	struct SceneMatrix
+	{
+		float	m[16];
+	};
+
+	// Scale first, then rotation by pitch (x), yaw (y) and roll (z) in radians as
+	// XMMatrixRotationRollPitchYaw, then translation.
+	struct SceneTransform
+	{
+		float	position[3];
+		float	rotation[3];
+		float	scale[3];
+	};
+
+	struct SceneGraphBenchmarkResult
+	{
+		size_t	nodeCount;
+		size_t	dirtyPerFrame;			// Nodes moved each frame by the dirty flag run.
+		double	dirtyMilliseconds;		// Per frame, recomputing only what moved.
+		double	fullMilliseconds;		// Per frame, recomputing every node of the flat arrays.
+		double	pointerTreeMilliseconds;	// Per frame, recursing through heap allocated nodes.
+		double	recomputedPerFrame;		// World matrices recomputed per frame by the dirty flag run.
+		bool	isConsistent;			// All three agree on every world matrix.
+	};
+
+	class SceneGraph
+	{
+	public:
+		SceneGraph();
+
+		// Adds a node under an existing parent, or a root with SCENE_NO_PARENT.
+		SceneNodeId AddNode(SceneNodeId parent, const SceneTransform& local);
+
+		void Clear();
+
+		void SetLocal(SceneNodeId node, const SceneTransform& local);
+
+		// Recomputes the world matrices that are out of date and returns how many were.
+		size_t Update();
+
+		// Marks every node dirty, so the next Update recomputes them all.
+		void Invalidate();
+
+		const SceneTransform& GetLocal(SceneNodeId node) const	{ return m_locals[node]; }
+		const SceneMatrix& GetWorld(SceneNodeId node) const		{ return m_worlds[node]; }
+		SceneNodeId GetParent(SceneNodeId node) const			{ return m_parents[node]; }
+		size_t GetNodeCount() const								{ return m_parents.size(); }
+
+		// True when the node's world matrix was recomputed by the last Update.
+		bool WasUpdated(SceneNodeId node) const					{ return m_updateStamps[node] == m_updateStamp; }
+
+		static SceneTransform Identity();
+		static SceneMatrix Compose(const SceneTransform& transform);
+
+		// a * b, for affine matrices.
+		static SceneMatrix Multiply(const SceneMatrix& a, const SceneMatrix& b);
+
+		// A bounding sphere given in the node's space, in world space. The radius
+		// grows with the largest axis scale.
+		static void TransformSphere(const SceneMatrix& world, const float center[3], float radius, float worldCenter[3], float& worldRadius);
+
+		// A random tree of nodeCount nodes, four children per node, updated for the
+		// given number of frames with dirtyPerFrame nodes moving each frame.
+		static SceneGraphBenchmarkResult Benchmark(size_t nodeCount, size_t dirtyPerFrame, uint32_t frames);
+
+	private:
+		std::vector<SceneNodeId>	m_parents;
+		std::vector<SceneTransform>	m_locals;
+		std::vector<SceneMatrix>	m_localMatrices;	// Composed when the local transform is set.
+		std::vector<SceneMatrix>	m_worlds;
+		std::vector<uint8_t>		m_dirty;
+		std::vector<uint32_t>		m_updateStamps;		// Update that last recomputed each world matrix.
+		uint32_t					m_updateStamp;
+		size_t						m_firstDirty;		// Lowest dirty id, or the node count when none is.
+	};
+}
@@ -3,18 +3,117 @@
 
 #include "..\Common\DirectXHelper.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
 using namespace _202219807_ACW_700119_D3D11_UWP_APP;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 using namespace Microsoft::WRL;
 
+namespace
+{
+	// Frames replayed along the standard camera path by the LOD report.
+	const uint32_t SCENE_LOD_REPORT_FRAMES = 240;
+
+	// Nodes of the scene graph. Every pipeline with explicit geometry hangs off the
+	// reef, so moving the reef moves them all.
+	enum SceneNode
+	{
+		SCENE_NODE_REEF,
+		SCENE_NODE_P02,
+		SCENE_NODE_P03_SMALL,
+		SCENE_NODE_P03_LARGE,
+		SCENE_NODE_P04
+	};
+
+	struct SceneNodeDesc
+	{
+		SceneNodeId		parent;
+		SceneTransform	local;
+	};
+
+	// In SceneNode order, so each node's id is its index.
+	const SceneNodeDesc SCENE_NODES[] =
+	{
+		{ SCENE_NO_PARENT, { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } } },
+		{ SCENE_NODE_REEF, { { 20.0f, 10.0f, -10.0f }, { 0.0f, 0.0f, 0.0f }, { 5.0f, 5.0f, 5.0f } } },		// Deformed grid sphere.
+		{ SCENE_NODE_REEF, { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } } },			// Tessellated surfaces.
+		{ SCENE_NODE_REEF, { { -50.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } } },
+		{ SCENE_NODE_REEF, { { -20.0f, -4.0f, -20.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } } },		// Coral.
+	};
+
+	// What each culled object belongs to. P01 is the full-screen background and is
+	// always drawn.
+	enum SceneCullOwner
+	{
+		SCENE_CULL_P02,
+		SCENE_CULL_P03,
+		SCENE_CULL_P04,
+		SCENE_CULL_SHOAL,
+		SCENE_CULL_BUBBLES
+	};
+
+	struct SceneCullObject
+	{
+		CullSphere	bounds;
+		int			owner;
+		int			node;
+	};
+
+	// Bounds of the explicit geometry in the space of its scene graph node, with a
+	// margin for the displacement the shaders add. P05 simulates in world space, so
+	// the shoal and bubbles sit directly on the reef.
+	const SceneCullObject SCENE_CULL_OBJECTS[] =
+	{
+		{ { 0.0f, -2.0f, 0.0f, 1.1f }, SCENE_CULL_P02, SCENE_NODE_P02 },
+		{ { 0.0f, 0.0f, 0.0f, 6.5f }, SCENE_CULL_P03, SCENE_NODE_P03_SMALL },
+		{ { 0.0f, 0.0f, 0.0f, 11.5f }, SCENE_CULL_P03, SCENE_NODE_P03_LARGE },
+		{ { 0.0f, 0.0f, 0.0f, 4.0f }, SCENE_CULL_P04, SCENE_NODE_P04 },
+		{ { 0.0f, 1.0f, -50.0f, 47.0f }, SCENE_CULL_SHOAL, SCENE_NODE_REEF },		// Boids box.
+		{ { -2.5f, 2.0f, -37.5f, 46.0f }, SCENE_CULL_BUBBLES, SCENE_NODE_REEF },	// Emitters up to the surface.
+	};
+
+	// Sphere counts of the culling benchmark.
+	const size_t SCENE_CULL_BENCHMARK_COUNTS[] = { 64, 4096, 1000000 };
+
+	// Node counts of the scene graph benchmark, with one node in a hundred moving
+	// every frame.
+	const size_t SCENE_GRAPH_BENCHMARK_COUNTS[] = { 10000, 100000 };
+	const size_t SCENE_GRAPH_BENCHMARK_DIRTY_DIVISOR = 100;
+	const uint32_t SCENE_GRAPH_BENCHMARK_FRAMES = 60;
+
+	// Point counts of the CPU noise benchmark: cache resident and streaming.
+	const size_t SCENE_NOISE_BENCHMARK_COUNTS[] = { 4096, 1000000 };
+
+	// Pages of the help and of the debug info, stepped through with F1 and F2,
+	// and the margin the overlay keeps from the edges of the window.
+	const uint32_t SCENE_HELP_PAGE_COUNT = 2;
+	const uint32_t SCENE_DEBUG_PAGE_COUNT = 5;
+	const float SCENE_OVERLAY_MARGIN = 20.0f;
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 SceneRenderer::SceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_deviceResources(deviceResources),
 	m_isExplicitMode(false),
-	m_isDebugMode(false),
-	m_showControls(false)
+	m_helpPage(0),
+	m_debugPage(0),
+	m_isLodEnabled(true),
+	m_isFrustumCullingEnabled(true),
+	m_isOcclusionCullingEnabled(false),
+	m_frustumCulledCount(0),
+	m_occludedCount(0),
+	m_cullBenchmarkReady(false),
+	m_cullBenchmarkInFlight(false),
+	m_sceneGraphUpdatedCount(0),
+	m_sceneGraphBenchmarkReady(false),
+	m_sceneGraphBenchmarkInFlight(false),
+	m_noiseBenchmarkReady(false),
+	m_noiseBenchmarkInFlight(false),
+	m_lodPixelScale(1.0f)
 {
 	// Create device independent resources
 	ComPtr<IDWriteTextFormat> textFormat;
@@ -52,6 +151,20 @@ SceneRenderer::SceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceR
 	m_p03_Explicit = std::unique_ptr<P03_Explicit>(new P03_Explicit(m_deviceResources));
 	m_p04_Explicit = std::unique_ptr<P04_Explicit>(new P04_Explicit(m_deviceResources));
 	m_p05_Explicit = std::unique_ptr<P05_Explicit>(new P05_Explicit(m_deviceResources));
+	m_hiZOcclusion = std::unique_ptr<HiZOcclusion>(new HiZOcclusion(m_deviceResources));
+
+	for (const SceneNodeDesc& node : SCENE_NODES)
+	{
+		m_sceneGraph.AddNode(node.parent, node.local);
+	}
+
+	// Filled in world space by UpdateSceneGraph.
+	size_t cullCount = ARRAYSIZE(SCENE_CULL_OBJECTS);
+	m_cullX.assign(cullCount, 0.0f);
+	m_cullY.assign(cullCount, 0.0f);
+	m_cullZ.assign(cullCount, 0.0f);
+	m_cullRadius.assign(cullCount, 0.0f);
+	m_cullVisible.assign(cullCount, 1);
 
 	DX::ThrowIfFailed(
 		m_deviceResources->GetD2DDeviceContext()->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &m_whiteBrush)
@@ -71,6 +184,7 @@ void SceneRenderer::CreateDeviceDependentResources()
 	m_p03_Explicit->CreateDeviceDependentResources();
 	m_p04_Explicit->CreateDeviceDependentResources();
 	m_p05_Explicit->CreateDeviceDependentResources();
+	m_hiZOcclusion->CreateDeviceDependentResources();
 }
 
 // Initializes view parameters when the window size changes.
@@ -100,6 +214,11 @@ void SceneRenderer::CreateWindowSizeDependentResources()
 	DirectX::XMMATRIX orientationMatrix = XMLoadFloat4x4(&orientation);
 
 	DirectX::XMStoreFloat4x4(&m_projectionMatrix, perspectiveMatrix * orientationMatrix);
+
+	// Pixels covered by one unit at distance one, for the projected sizes that pick
+	// the level of detail. The orientation only rotates the y scale of the projection.
+	float yScale = sqrtf(m_projectionMatrix._21 * m_projectionMatrix._21 + m_projectionMatrix._22 * m_projectionMatrix._22);
+	m_lodPixelScale = 0.5f * outputSize.Height * yScale;
 }
 
 // Called once per frame, rotates the cube and calculates the model and view matrices.
@@ -108,14 +227,207 @@ void SceneRenderer::Update(DX::StepTimer const& timer)
 	// Update display text.
 	uint32 fps = timer.GetFramesPerSecond();
 
-	std::wstring guiHead1 = L"Simulation Controls: ";
+	// One key per line, split so that each page fits a 720p window.
+	std::wstring guiContext1[SCENE_HELP_PAGE_COUNT] = {
+		L"\n F1 : Help, next page\n F2 : Debug info, next page\n F3 : Render only explicit geometry\n F4 : Enable wireframe mode\n F5/F6 : Decrease/increase tessellation factor\n F7/F8 : Decrease/increase noise strength\n F9/F10 : Day/night theme\n T : Analytic/precomputed noise (P01)\n K : Rays stop at raster depth on/off (P01)\n Y : Sphere traced/heightfield/mesh floor (P01)\n U : Pixel shader/compute shader ray marching (P01)\n R : Dynamic resolution on/off (P01)\n X : Checkerboard rendering on/off (P01)\n 5/6 : Ray marching step limit (P01)\n 7 : Plain/relaxed sphere tracing (P01)\n 8 : Coral formula/fast kernel (P01)\n J : Kelp loop/plant grid (P01)\n 9 : Two bubbles/bubble field (P01)",
+		L"\n Insert : CPU noise benchmark\n PgUp/PgDn : Grid resolution (P02)\n Home : Grid benchmark (P02)\n G : Coral geometry shader/compute shader/CPU (P04)\n 1/2 : Coral subdivision level (P04)\n N : New coral seed (P04, CPU)\n 3/4 : Fish count (P05)\n End : Particle and depth sort benchmarks (P05)\n I : Fish vertex shader/geometry shader (P05)\n B : Fish expansion benchmark (P05)\n O : Bubbles opaque/sorted alpha/weighted blended (P05)\n L : Level of detail on/off (P03-P05)\n P : LOD report on the standard camera path (P03-P05)\n C : Frustum culling on/off\n H : Hi-Z occlusion culling on/off\n V : Culling benchmark\n E : Scene graph benchmark"
+	};
+
+	std::wstring gridBenchmark;
+	for (const auto& result : m_p02_Explicit->GetBenchmark())
+	{
+		gridBenchmark += L"\n " + std::to_wstring(result.resolution) + L"x" + std::to_wstring(result.resolution) + L": " +
+			std::to_wstring(result.milliseconds) + L" ms, " + std::to_wstring(result.bytes / (1024 * 1024)) + L" MB";
+	}
+
+	std::wstring particleBenchmark;
+	for (const auto& result : m_p05_Explicit->GetParticleBenchmark())
+	{
+		particleBenchmark += L"\n " + std::to_wstring(result.count) + L" particles: AoS " +
+			std::to_wstring(result.aosMilliseconds) + L" ms, SoA " + std::to_wstring(result.soaMilliseconds) + L" ms";
+	}
+	if (!particleBenchmark.empty())
+	{
+		particleBenchmark = (ParticleStore::IsVectorised() ? L"\n Particle kernels (AVX2):" : L"\n Particle kernels (scalar):") + particleBenchmark;
+	}
+
+	static const wchar_t* bubbleBlendingNames[] = { L"opaque", L"sorted alpha", L"weighted blended" };
+	std::wstring bubbleBlending = bubbleBlendingNames[static_cast<int>(m_p05_Explicit->GetBubbleBlending())];
+	bubbleBlending += L", sort " + std::to_wstring(m_p05_Explicit->GetSortGpuMilliseconds()) + L" ms GPU";
+	for (const auto& result : m_p05_Explicit->GetSortBenchmark())
+	{
+		bubbleBlending += L"\n " + std::to_wstring(result.count) + L" keys: radix " +
+			std::to_wstring(result.radixMilliseconds) + L" ms, bitonic " + std::to_wstring(result.bitonicMilliseconds) + L" ms, std::sort " +
+			std::to_wstring(result.stdSortMilliseconds) + L" ms" + (result.isConsistent ? L"" : L" (order mismatch)");
+	}
+
+	// Vertices leaving the expansion stage per second, in millions.
+	auto megaVerticesPerSecond = [](uint32 fishCount, FishExpansion expansion, double milliseconds) {
+		return (milliseconds > 0.0) ? fishCount * P05_Explicit::GetVerticesPerFish(expansion) / (milliseconds * 1000.0) : 0.0;
+	};
+
+	FishExpansion fishExpansion = m_p05_Explicit->GetFishExpansion();
+	std::wstring fishInfo = (fishExpansion == FishExpansion::VertexShader) ? L"instanced vertex shader" : L"geometry shader";
+	fishInfo += L"\n Fish draw: " + std::to_wstring(m_p05_Explicit->GetFishDrawGpuMilliseconds()) + L" ms GPU, " +
+		std::to_wstring(megaVerticesPerSecond(static_cast<uint32>(m_p05_Explicit->GetFishCount()), fishExpansion, m_p05_Explicit->GetFishDrawGpuMilliseconds())) + L" Mvert/s";
+	if (m_p05_Explicit->IsExpansionBenchmarkRunning())
+	{
+		fishInfo += L"\n Expansion benchmark running...";
+	}
+	for (const auto& result : m_p05_Explicit->GetExpansionBenchmark())
+	{
+		fishInfo += L"\n " + std::to_wstring(result.fishCount) + L" fish: VS " +
+			std::to_wstring(megaVerticesPerSecond(result.fishCount, FishExpansion::VertexShader, result.vertexShaderMilliseconds)) + L", GS " +
+			std::to_wstring(megaVerticesPerSecond(result.fishCount, FishExpansion::GeometryShader, result.geometryShaderMilliseconds)) + L" Mvert/s";
+	}
+
+	std::wstring coralInfo = L"geometry shader";
+	if (m_p04_Explicit->GetAmplificationMode() == AmplificationMode::ComputeShader)
+	{
+		coralInfo = L"compute shader, level " + std::to_wstring(m_p04_Explicit->GetAmplificationLevel()) +
+			L"\n Triangles: " + std::to_wstring(m_p04_Explicit->GetGpuTriangleCount()) + L" GPU, " +
+			std::to_wstring(m_p04_Explicit->GetReferenceTriangleCount()) + L" reference" +
+			L"\n GPU amplify: " + std::to_wstring(m_p04_Explicit->GetAmplifyGpuMilliseconds()) + L" ms";
+	}
+	else if (m_p04_Explicit->GetAmplificationMode() == AmplificationMode::Cpu)
+	{
+		CoralGeneratorStatistics coralStatistics = m_p04_Explicit->GetGeneratorStatistics();
+		coralInfo = L"CPU, level " + std::to_wstring(m_p04_Explicit->GetGeneratorLevel()) +
+			L", seed " + std::to_wstring(m_p04_Explicit->GetGeneratorSeed()) +
+			(m_p04_Explicit->IsGeneratorBusy() ? L" (generating)" : L"") +
+			L"\n Triangles: " + std::to_wstring(m_p04_Explicit->GetUploadedTriangleCount()) + L" uploaded of " +
+			std::to_wstring(coralStatistics.triangleCount) +
+			L"\n Generation: " + std::to_wstring(coralStatistics.milliseconds) + L" ms, " +
+			std::to_wstring(coralStatistics.trianglesPerSecond / 1000000.0) + L" Mtri/s" +
+			L"\n Checksum: " + std::to_wstring(coralStatistics.checksum);
+	}
+
+	static const wchar_t* lodLevelNames[] = { L"full", L"simplified", L"impostor" };
+	std::wstring lodInfo = m_isLodEnabled ? L"on" : L"off";
+	lodInfo += L"\n Fish full/simplified/impostor: " +
+		std::to_wstring(m_p05_Explicit->GetFishLodCount(LodLevel::Full)) + L"/" +
+		std::to_wstring(m_p05_Explicit->GetFishLodCount(LodLevel::Simplified)) + L"/" +
+		std::to_wstring(m_p05_Explicit->GetFishLodCount(LodLevel::Impostor)) +
+		L"\n Coral (P04): " + lodLevelNames[static_cast<int>(m_p04_Explicit->GetLodLevel())] +
+		L", surfaces (P03): " + lodLevelNames[static_cast<int>(m_p03_Explicit->GetLodLevel(0))] + L"/" +
+		lodLevelNames[static_cast<int>(m_p03_Explicit->GetLodLevel(1))];
+	if (!m_lodReport.empty())
+	{
+		uint64_t triangles = 0, fullTriangles = 0, draws = 0, fullDraws = 0, switches = 0;
+		for (const LodReportRow& row : m_lodReport)
+		{
+			triangles += row.triangles;
+			fullTriangles += row.fullTriangles;
+			draws += row.draws;
+			fullDraws += row.fullDraws;
+			switches += row.switches;
+		}
+
+		size_t frames = m_lodReport.size();
+		lodInfo += L"\n Report, " + std::to_wstring(frames) + L" frames (lod_report.csv): " +
+			std::to_wstring(triangles / frames) + L" triangles, " + std::to_wstring(draws / frames) + L" draws per frame, " +
+			L"without LOD " + std::to_wstring(fullTriangles / frames) + L", " + std::to_wstring(fullDraws / frames) +
+			L"; " + std::to_wstring(switches) + L" switches";
+	}
+
+	std::wstring cullInfo = L"frustum " + std::wstring(m_isFrustumCullingEnabled ? L"on" : L"off") +
+		L", Hi-Z " + (m_isOcclusionCullingEnabled ? L"on" : L"off") +
+		L"\n Culled: " + std::to_wstring(m_frustumCulledCount) + L" outside the frustum, " +
+		std::to_wstring(m_occludedCount) + L" occluded, of " + std::to_wstring(m_cullVisible.size()) + L" objects";
+	for (const auto& result : m_cullBenchmark)
+	{
+		cullInfo += L"\n " + std::to_wstring(result.count) + L" spheres: scalar " +
+			std::to_wstring(result.scalarObjectsPerMicrosecond) + (SceneCuller::IsVectorised() ? L", SSE " : L", fallback ") +
+			std::to_wstring(result.simdObjectsPerMicrosecond) + L", Hi-Z " + std::to_wstring(result.hiZObjectsPerMicrosecond) + L" objects/us" +
+			(result.isConsistent ? L"" : L" (mismatch)");
+	}
+	if (m_cullBenchmarkInFlight) cullInfo += L"\n Benchmark running...";
+
+	std::wstring noiseInfo = std::wstring(m_p01_Implicit->IsNoiseVolumeEnabled() ? L"volume" : L"analytic") +
+		L"\n GPU draw: analytic " + std::to_wstring(m_p01_Implicit->GetAnalyticNoiseMilliseconds()) + L" ms, volume " +
+		std::to_wstring(m_p01_Implicit->GetVolumeNoiseMilliseconds()) + L" ms (" + std::to_wstring(m_p01_Implicit->GetNoiseVolumeBytes() / 1024) + L" KB)";
+
+	static const wchar_t* noiseVariantNames[] = { L"scalar", L"SSE", L"AVX2" };
+	for (const auto& result : m_noiseBenchmark)
+	{
+		noiseInfo += L"\n CPU " + std::to_wstring(result.samples) + L" points, samples/ns (noise, perlin, fBm):";
+		for (size_t v = 0; v < NOISE_VARIANT_COUNT; v++)
+		{
+			if (!result.isAvailable[v]) continue;
+			noiseInfo += std::wstring(L" ") + noiseVariantNames[v] + L" " + std::to_wstring(result.noisePerNanosecond[v]) + L"/" +
+				std::to_wstring(result.perlinPerNanosecond[v]) + L"/" + std::to_wstring(result.fbmPerNanosecond[v]);
+		}
+		noiseInfo += (result.variantDifference == 0.0f ? L"; variants identical" : L"; variants DIFFER") +
+			std::wstring(L", ") + std::to_wstring(result.libraryMismatchRate * 100.0f) + L"% off std::sin";
+	}
+	if (m_noiseBenchmarkInFlight) noiseInfo += L"\n CPU benchmark running...";
+
+	static const wchar_t* floorModeNames[] = { L"sphere traced", L"heightfield", L"tessellated mesh" };
+	std::wstring floorInfo = std::wstring(floorModeNames[m_p01_Implicit->GetFloorMode()]) +
+		L"\n Built in " + std::to_wstring(m_p01_Implicit->GetFloorBuildMilliseconds()) + L" ms, max error vs analytic " +
+		std::to_wstring(m_p01_Implicit->GetFloorInterpolationError()) +
+		L"\n Mesh: " + std::to_wstring(m_p01_Implicit->GetTerrainPatchCount()) + L" of " + std::to_wstring(m_p01_Implicit->GetTerrainLeafCount()) +
+		L" patches in view, selected in " + std::to_wstring(m_p01_Implicit->GetTerrainSelectMilliseconds()) + L" ms, GPU " +
+		std::to_wstring(m_p01_Implicit->GetTerrainMilliseconds()) + L" ms";
+
+	double clampedMilliseconds = m_p01_Implicit->IsNoiseVolumeEnabled() ? m_p01_Implicit->GetVolumeNoiseMilliseconds() :
+		m_p01_Implicit->GetAnalyticNoiseMilliseconds();
+	double unclampedMilliseconds = m_p01_Implicit->GetUnclampedMilliseconds();
+	std::wstring compositeInfo = std::wstring(m_p01_Implicit->IsSceneDepthEnabled() ? L"rays stop at raster depth" : L"rays run to MAX_DIST") +
+		L"\n GPU draw: " + std::to_wstring(clampedMilliseconds) + L" ms stopping, " + std::to_wstring(unclampedMilliseconds) + L" ms running on";
+	if (clampedMilliseconds > 0.0 && unclampedMilliseconds > 0.0)
+	{
+		compositeInfo += L" (" + std::to_wstring(static_cast<int>((1.0 - clampedMilliseconds / unclampedMilliseconds) * 100.0)) + L"% saved)";
+	}
+
+	double pixelPathMilliseconds = m_p01_Implicit->GetPixelPathMilliseconds();
+	double computePathMilliseconds = m_p01_Implicit->GetComputePathMilliseconds();
+	std::wstring marchInfo = std::wstring(m_p01_Implicit->IsComputePathEnabled() ? L"compute shader, 8x8 tiles" : L"pixel shader, full-screen triangle") +
+		L"\n GPU: pixel shader " + std::to_wstring(pixelPathMilliseconds) + L" ms, compute shader " + std::to_wstring(computePathMilliseconds) + L" ms";
+	if (pixelPathMilliseconds > 0.0 && computePathMilliseconds > 0.0)
+	{
+		marchInfo += L" (" + std::to_wstring(static_cast<int>((1.0 - computePathMilliseconds / pixelPathMilliseconds) * 100.0)) + L"% saved)";
+	}
+
+	std::wstring resolutionInfo = std::wstring(m_p01_Implicit->IsDynamicResolutionEnabled() ? L"on" : L"off") +
+		L", scale " + std::to_wstring(m_p01_Implicit->GetResolutionScale()) + L" (" +
+		std::to_wstring(static_cast<int>(m_p01_Implicit->GetRenderSize().x)) + L"x" + std::to_wstring(static_cast<int>(m_p01_Implicit->GetRenderSize().y)) +
+		L"), budget " + std::to_wstring(m_p01_Implicit->GetResolutionBudget()) + L" ms";
+
+	// The checkerboard against the full-rate path it replaces.
+	double fullPathMilliseconds = m_p01_Implicit->IsComputePathEnabled() ? computePathMilliseconds : pixelPathMilliseconds;
+	std::wstring checkerboardInfo = std::wstring(m_p01_Implicit->IsCheckerboardEnabled() ? L"on" : L"off") +
+		L"\n GPU: checkerboard " + std::to_wstring(m_p01_Implicit->GetCheckerboardMilliseconds()) + L" ms, full " +
+		std::to_wstring(fullPathMilliseconds) + L" ms";
+
+	std::wstring sphereTracingInfo = std::wstring(m_p01_Implicit->IsRelaxedMarchingEnabled() ? L"relaxed" : L"plain") +
+		L", " + std::to_wstring(m_p01_Implicit->GetMaxMarchingSteps()) + L" steps at most";
 
-	std::wstring guiHead2 = L"Debug info:\n\n ";
+	std::wstring coralKernelInfo = m_p01_Implicit->IsFastCoralEnabled() ? L"fast kernel" : L"formula";
 
-	std::wstring guiContext1 = L"\n\n F1 : Help\n\n F2 : Debug info\n\n F3 : Render only explicit geometry\n\n F4 : Enable wireframe mode\n\n F5 : Decrease tessellation factor\n\n F6 : Increase tessellation factor\n\n F7 : Decrease noise strength\n\n F8 : Increase noise strength\n\n F9 : Day theme\n\n F10 : Night theme\n\n\n ";
+	std::wstring plantGridInfo = std::wstring(m_p01_Implicit->IsPlantGridEnabled() ? L"grid" : L"loop") +
+		L", " + std::to_wstring(m_p01_Implicit->GetPlantStalkCount()) + L" stalks in " + std::to_wstring(m_p01_Implicit->GetPlantCellCount()) + L" cells";
 
-	std::wstring guiContext2 =	(fps > 0) ?
+	DirectX::XMUINT2 bubbleTiles = m_p01_Implicit->GetBubbleTiles();
+	std::wstring bubbleFieldInfo = (m_p01_Implicit->IsBubbleFieldEnabled() ?
+		L"field of " + std::to_wstring(m_p01_Implicit->GetBubbleCount()) + L", " + std::to_wstring(bubbleTiles.x) + L"x" +
+		std::to_wstring(bubbleTiles.y) + L" tiles listing " + std::to_wstring(m_p01_Implicit->GetTileBubbleCount()) :
+		std::wstring(L"two BubbleSDF"));
 
+	std::wstring sceneGraphInfo = std::to_wstring(m_sceneGraph.GetNodeCount()) + L" nodes, " +
+		std::to_wstring(m_sceneGraphUpdatedCount) + L" recomputed last update";
+	for (const auto& result : m_sceneGraphBenchmark)
+	{
+		sceneGraphInfo += L"\n " + std::to_wstring(result.nodeCount) + L" nodes, " + std::to_wstring(result.dirtyPerFrame) +
+			L" moving: dirty " + std::to_wstring(result.dirtyMilliseconds) + L" ms (" +
+			std::to_wstring(static_cast<uint32_t>(result.recomputedPerFrame)) + L" recomputed), all " +
+			std::to_wstring(result.fullMilliseconds) + L" ms, pointer tree " + std::to_wstring(result.pointerTreeMilliseconds) + L" ms" +
+			(result.isConsistent ? L"" : L" (mismatch)");
+	}
+	if (m_sceneGraphBenchmarkInFlight) sceneGraphInfo += L"\n Benchmark running...";
+
+	// Each page of the debug info starts with the frame rate and the camera.
+	std::wstring guiStatus = (fps > 0) ?
 		std::to_wstring(fps) + L" FPS" +
 		L"\n\n Camera position:\n [" +
 		std::to_wstring(m_camera->GetPosition().x) + L"," +
@@ -125,18 +437,66 @@ void SceneRenderer::Update(DX::StepTimer const& timer)
 		L"\n\n Noise strength: " + std::to_wstring(m_p03_Explicit->GetNoiseStrength())
 		: L" - FPS";
 
-	std::wstring guiText = L"Press 'F1' to view simulation controls";
-	if (m_showControls) guiText = guiHead1 + guiContext1;
-	if (m_isDebugMode && m_showControls) guiText = guiHead1 + guiContext1 + guiHead2 + guiContext2;
-	
+	std::wstring guiContext2[SCENE_DEBUG_PAGE_COUNT] = {
+		L"\n\n Noise path (P01): " + noiseInfo +
+		L"\n\n Floor (P01): " + floorInfo +
+		L"\n\n Compositing (P01): " + compositeInfo +
+		L"\n\n Ray marching (P01): " + marchInfo +
+		L"\n\n Dynamic resolution (P01): " + resolutionInfo +
+		L"\n\n Checkerboard (P01): " + checkerboardInfo,
+		L"\n\n Sphere tracing (P01): " + sphereTracingInfo +
+		L"\n\n Coral (P01): " + coralKernelInfo +
+		L"\n\n Kelp (P01): " + plantGridInfo +
+		L"\n\n Bubbles (P01): " + bubbleFieldInfo,
+		L"\n\n Vertex cache ACMR/ATVR (P02 as triangles, offline; drawn as points): " +
+		std::to_wstring(m_p02_Explicit->GetVertexCacheBefore().acmr) + L"/" + std::to_wstring(m_p02_Explicit->GetVertexCacheBefore().atvr) + L" -> " +
+		std::to_wstring(m_p02_Explicit->GetVertexCacheAfter().acmr) + L"/" + std::to_wstring(m_p02_Explicit->GetVertexCacheAfter().atvr) +
+		L"\n\n Grid resolution (P02): " + std::to_wstring(m_p02_Explicit->GetResolution()) +
+		(m_p02_Explicit->IsUsingWideIndices() ? L" (32-bit indices)" : L" (16-bit indices)") +
+		L"\n Grid build: " + std::to_wstring(m_p02_Explicit->GetBuildMilliseconds()) + L" ms, " +
+		std::to_wstring(m_p02_Explicit->GetGridBytes() / 1024) + L" KB" +
+		gridBenchmark +
+		L"\n\n Coral amplification (P04): " + coralInfo +
+		L"\n GPU draw: " + std::to_wstring(m_p04_Explicit->GetDrawGpuMilliseconds()) + L" ms" +
+		L"\n CPU reference: " + std::to_wstring(m_p04_Explicit->GetReferenceMilliseconds()) + L" ms",
+		L"\n\n Fish (P05): " + std::to_wstring(m_p05_Explicit->GetFishCount()) +
+		L"\n Boids step: " + std::to_wstring(m_p05_Explicit->GetSimulationMilliseconds()) + L" ms, " +
+		std::to_wstring(m_p05_Explicit->GetFishPerMillisecond()) + L" fish/ms" +
+		L"\n Fish expansion: " + fishInfo +
+		L"\n Bubbles GPU/CPU reference: " + std::to_wstring(m_p05_Explicit->GetGpuBubbleCount()) + L"/" +
+		std::to_wstring(m_p05_Explicit->GetReferenceBubbleCount()) +
+		L"\n Bubble update: " + std::to_wstring(m_p05_Explicit->GetParticleGpuMilliseconds()) + L" ms GPU, " +
+		std::to_wstring(m_p05_Explicit->GetBubbleReferenceMilliseconds()) + L" ms CPU" +
+		L"\n Bubble blending: " + bubbleBlending +
+		particleBenchmark,
+		L"\n\n Level of detail: " + lodInfo +
+		L"\n\n Culling: " + cullInfo +
+		L"\n\n Scene graph: " + sceneGraphInfo
+	};
+
+	// One page at a time, the debug info before the help.
+	std::wstring guiText = L"Press 'F1' to view simulation controls, 'F2' for debug info";
+	if (m_helpPage > 0)
+	{
+		guiText = L"Simulation Controls (" + std::to_wstring(m_helpPage) + L"/" + std::to_wstring(SCENE_HELP_PAGE_COUNT) + L"):\n" +
+			guiContext1[m_helpPage - 1];
+	}
+	if (m_debugPage > 0)
+	{
+		guiText = L"Debug info (" + std::to_wstring(m_debugPage) + L"/" + std::to_wstring(SCENE_DEBUG_PAGE_COUNT) + L"):\n\n " +
+			guiStatus + guiContext2[m_debugPage - 1];
+	}
+
+	// The layout box is the window, less the margin the text is drawn at.
+	Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
 	Microsoft::WRL::ComPtr<IDWriteTextLayout> textLayout;
 	DX::ThrowIfFailed(
 		m_deviceResources->GetDWriteFactory()->CreateTextLayout(
 			guiText.c_str(),
 			static_cast<uint32>(guiText.length()),
 			m_textFormat.Get(),
-			1000.0f, // Max width of the input text.
-			100.0f,  // Max height of the input text.
+			std::max(0.0f, logicalSize.Width - 2.0f * SCENE_OVERLAY_MARGIN), // Max width of the input text.
+			std::max(0.0f, logicalSize.Height - 2.0f * SCENE_OVERLAY_MARGIN), // Max height of the input text.
 			&textLayout
 		)
 	);
@@ -151,6 +511,26 @@ void SceneRenderer::Update(DX::StepTimer const& timer)
 
 	ProcessInput(timer);
 
+	// Swap in benchmarks finished on their workers.
+	if (m_cullBenchmarkReady)
+	{
+		m_cullBenchmark.swap(m_pendingCullBenchmark);
+		m_cullBenchmarkReady = false;
+		m_cullBenchmarkInFlight = false;
+	}
+	if (m_sceneGraphBenchmarkReady)
+	{
+		m_sceneGraphBenchmark.swap(m_pendingSceneGraphBenchmark);
+		m_sceneGraphBenchmarkReady = false;
+		m_sceneGraphBenchmarkInFlight = false;
+	}
+	if (m_noiseBenchmarkReady)
+	{
+		m_noiseBenchmark.swap(m_pendingNoiseBenchmark);
+		m_noiseBenchmarkReady = false;
+		m_noiseBenchmarkInFlight = false;
+	}
+
 	m_p01_Implicit->Update(timer);
 	m_p02_Explicit->Update(timer);
 	m_p03_Explicit->Update(timer);
@@ -167,27 +547,52 @@ void SceneRenderer::Render()
 	DirectX::XMMATRIX viewMatrix = DirectX::XMMatrixIdentity();
 	m_camera->GetViewMatrix(viewMatrix);
 
-	if (!m_isExplicitMode)
-	{
-		m_p01_Implicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
-		m_p01_Implicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
-		m_p01_Implicit->Render();
-	}
+	// Combined once per frame and stored transposed, ready for the constant buffers.
+	DirectX::XMStoreFloat4x4(&m_viewProjectionMatrix, DirectX::XMMatrixTranspose(viewMatrix * DirectX::XMLoadFloat4x4(&m_projectionMatrix)));
+
+	// Levels of detail are picked from the projected size seen from this camera.
+	DirectX::XMFLOAT3 cameraPosition = m_camera->GetPosition();
+	LodView lodView = { cameraPosition.x, cameraPosition.y, cameraPosition.z, m_lodPixelScale };
+	m_p03_Explicit->SetLodView(lodView);
+	m_p04_Explicit->SetLodView(lodView);
+	m_p05_Explicit->SetLodView(lodView);
+
+	// World matrices have to be in place before the view projection is combined with them.
+	UpdateSceneGraph();
+
+	// Culled pipelines skip their draws. The background (P01) is always drawn.
+	DirectX::XMFLOAT4X4 cullViewProjection;
+	DirectX::XMStoreFloat4x4(&cullViewProjection, viewMatrix * DirectX::XMLoadFloat4x4(&m_projectionMatrix));
+	CullObjects(cullViewProjection);
 
 	m_p02_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
 	m_p02_Explicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
-	m_p02_Explicit->Render();
+	if (IsCullOwnerVisible(SCENE_CULL_P02)) m_p02_Explicit->Render();
 
 	m_p03_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
 	m_p03_Explicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
-	m_p03_Explicit->Render();
+	if (IsCullOwnerVisible(SCENE_CULL_P03)) m_p03_Explicit->Render();
 
-	m_p04_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
+	m_p04_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix), m_viewProjectionMatrix);
 	m_p04_Explicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
-	m_p04_Explicit->Render();
+	if (IsCullOwnerVisible(SCENE_CULL_P04)) m_p04_Explicit->Render();
+
+	// This frame's depth becomes the occluder of a later one. It is taken before
+	// P01 writes SV_Depth from its fixed eye, which is not where the camera is.
+	if (m_isOcclusionCullingEnabled) m_hiZOcclusion->Capture(cullViewProjection);
 
-	m_p05_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
+	// The ray marcher stops at the depth of the opaque pipelines above and writes its
+	// own, which the fish and the blended bubbles of P05 are then tested against.
+	if (!m_isExplicitMode)
+	{
+		m_p01_Implicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix));
+		m_p01_Implicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
+		m_p01_Implicit->Render();
+	}
+
+	m_p05_Explicit->SetViewProjectionMatrixConstantBuffer(viewMatrix, DirectX::XMLoadFloat4x4(&m_projectionMatrix), m_viewProjectionMatrix);
 	m_p05_Explicit->SetCameraPositionConstantBuffer(m_camera->GetPosition());
+	m_p05_Explicit->SetVisibility(IsCullOwnerVisible(SCENE_CULL_SHOAL), IsCullOwnerVisible(SCENE_CULL_BUBBLES));
 	m_p05_Explicit->Render();
 
 	ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
@@ -198,8 +603,8 @@ void SceneRenderer::Render()
 
 	// Position on the bottom right corner
 	D2D1::Matrix3x2F screenTranslation = D2D1::Matrix3x2F::Translation(
-		20,// logicalSize.Width - m_textMetrics.layoutWidth - 10,
-		20 // m_textMetrics.height - 50
+		SCENE_OVERLAY_MARGIN,// logicalSize.Width - m_textMetrics.layoutWidth - 10,
+		SCENE_OVERLAY_MARGIN // m_textMetrics.height - 50
 	);
 
 	context->SetTransform(screenTranslation * m_deviceResources->GetOrientationTransform2D());
@@ -233,14 +638,22 @@ void SceneRenderer::ReleaseDeviceDependentResources()
 	m_p03_Explicit->ReleaseDeviceDependentResources();
 	m_p04_Explicit->ReleaseDeviceDependentResources();
 	m_p05_Explicit->ReleaseDeviceDependentResources();
+	m_hiZOcclusion->ReleaseDeviceDependentResources();
 
 }
 
 void SceneRenderer::ProcessInput(DX::StepTimer const& timer)
 {
-	if (IsKeyPressed(VirtualKey::F1))		m_showControls = !m_showControls;
-	if (IsKeyPressed(VirtualKey::F2))		m_isDebugMode = !m_isDebugMode;
+	if (IsKeyToggled(VirtualKey::F1))		m_helpPage = (m_helpPage + 1) % (SCENE_HELP_PAGE_COUNT + 1);
+	if (IsKeyToggled(VirtualKey::F2))		m_debugPage = (m_debugPage + 1) % (SCENE_DEBUG_PAGE_COUNT + 1);
 	if (IsKeyPressed(VirtualKey::F3))		m_isExplicitMode = !m_isExplicitMode;
+	if (IsKeyToggled(VirtualKey::L))		SetLodEnabled(!m_isLodEnabled);
+	if (IsKeyToggled(VirtualKey::P))		RunLodReport();
+	if (IsKeyToggled(VirtualKey::C))		m_isFrustumCullingEnabled = !m_isFrustumCullingEnabled;
+	if (IsKeyToggled(VirtualKey::H))		SetOcclusionCullingEnabled(!m_isOcclusionCullingEnabled);
+	if (IsKeyToggled(VirtualKey::V) && !m_cullBenchmarkInFlight)	RunCullBenchmarkAsync();
+	if (IsKeyToggled(VirtualKey::E) && !m_sceneGraphBenchmarkInFlight)	RunSceneGraphBenchmarkAsync();
+	if (IsKeyToggled(VirtualKey::Insert) && !m_noiseBenchmarkInFlight)	RunNoiseBenchmarkAsync();
 	if (IsKeyPressed(VirtualKey::W))		m_camera->MoveForward(10.0f * timer.GetElapsedSeconds());
 	if (IsKeyPressed(VirtualKey::S))		m_camera->MoveBackward(10.0f * timer.GetElapsedSeconds());
 	if (IsKeyPressed(VirtualKey::A))		m_camera->MoveLeft(10.0f * timer.GetElapsedSeconds());
@@ -261,4 +674,179 @@ bool SceneRenderer::IsKeyPressed(VirtualKey key)
 	if ((currentKeyState & keyDownState) == keyDownState) return true;
 	return false;
 
-}
\ No newline at end of file
+}
+
+// True only on the frame the key goes down, so actions do not repeat while held.
+bool SceneRenderer::IsKeyToggled(VirtualKey key)
+{
+	bool isDown = IsKeyPressed(key);
+	bool wasDown = m_keyWasDown[key];
+	m_keyWasDown[key] = isDown;
+
+	return isDown && !wasDown;
+}
+
+void SceneRenderer::SetLodEnabled(bool isEnabled)
+{
+	m_isLodEnabled = isEnabled;
+
+	m_p03_Explicit->SetLodEnabled(isEnabled);
+	m_p04_Explicit->SetLodEnabled(isEnabled);
+	m_p05_Explicit->SetLodEnabled(isEnabled);
+}
+
+// Replays the level of detail selection of the current scene along the standard
+// camera path and saves the triangles and draws of every frame to lod_report.csv
+// in the app's local folder.
+void SceneRenderer::RunLodReport()
+{
+	std::vector<LodObjectSet> sets;
+	sets.push_back(m_p03_Explicit->GetLodObjects());
+	sets.push_back(m_p04_Explicit->GetLodObjects());
+	sets.push_back(m_p05_Explicit->GetLodObjects());
+
+	m_lodReport = LodReport::Run(sets, m_lodPixelScale, SCENE_LOD_REPORT_FRAMES);
+
+	std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\lod_report.csv";
+	std::ofstream file(path);
+	LodReport::WriteCsv(file, m_lodReport);
+}
+
+// Tests every object's bounds against the frustum of this frame and, with occlusion
+// culling on, against the Hi-Z pyramid of an earlier frame's depth.
+void SceneRenderer::CullObjects(const DirectX::XMFLOAT4X4& viewProjection)
+{
+	size_t count = m_cullVisible.size();
+	m_frustumCulledCount = 0;
+	m_occludedCount = 0;
+
+	if (m_isFrustumCullingEnabled)
+	{
+		CullFrustum frustum = SceneCuller::ExtractFrustum(&viewProjection._11);
+		size_t visibleCount = SceneCuller::TestSimd(frustum, m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullRadius.data(),
+			count, m_cullVisible.data());
+		m_frustumCulledCount = count - visibleCount;
+	}
+	else
+	{
+		std::fill(m_cullVisible.begin(), m_cullVisible.end(), static_cast<uint8_t>(1));
+	}
+
+	// Readbacks are collected even while occlusion is off, so none is left pending.
+	m_hiZOcclusion->Update();
+	if (!m_isOcclusionCullingEnabled) return;
+
+	const HiZBuffer& pyramid = m_hiZOcclusion->GetPyramid();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		CullSphere sphere = { m_cullX[i], m_cullY[i], m_cullZ[i], m_cullRadius[i] };
+		if (m_cullVisible[i] && pyramid.IsOccluded(sphere))
+		{
+			m_cullVisible[i] = 0;
+			m_occludedCount++;
+		}
+	}
+}
+
+// An owner is drawn while any of its objects survived culling.
+bool SceneRenderer::IsCullOwnerVisible(int owner) const
+{
+	for (size_t i = 0; i < m_cullVisible.size(); i++)
+	{
+		if (SCENE_CULL_OBJECTS[i].owner == owner && m_cullVisible[i]) return true;
+	}
+
+	return false;
+}
+
+void SceneRenderer::SetOcclusionCullingEnabled(bool isEnabled)
+{
+	m_isOcclusionCullingEnabled = isEnabled;
+
+	// A pyramid left over from before would hide objects by long gone depth.
+	m_hiZOcclusion->Clear();
+}
+
+// Times the culling tests off the render thread; Update swaps the results in.
+void SceneRenderer::RunCullBenchmarkAsync()
+{
+	m_cullBenchmarkInFlight = true;
+
+	Concurrency::create_task([this]() {
+		m_pendingCullBenchmark.clear();
+		for (size_t count : SCENE_CULL_BENCHMARK_COUNTS)
+		{
+			m_pendingCullBenchmark.push_back(SceneCuller::Benchmark(count));
+		}
+		m_cullBenchmarkReady = true;
+		});
+}
+
+// Recomputes the world matrices that moved and hands them to their pipelines as
+// per-object model constants, and moves the culling bounds along with them.
+void SceneRenderer::UpdateSceneGraph()
+{
+	m_sceneGraphUpdatedCount = m_sceneGraph.Update();
+	if (m_sceneGraphUpdatedCount == 0) return;
+
+	if (m_sceneGraph.WasUpdated(SCENE_NODE_P02))
+	{
+		m_p02_Explicit->SetModelMatrix(DirectX::XMFLOAT4X4(m_sceneGraph.GetWorld(SCENE_NODE_P02).m));
+	}
+	if (m_sceneGraph.WasUpdated(SCENE_NODE_P03_SMALL))
+	{
+		m_p03_Explicit->SetSurfaceModelMatrix(0, DirectX::XMFLOAT4X4(m_sceneGraph.GetWorld(SCENE_NODE_P03_SMALL).m));
+	}
+	if (m_sceneGraph.WasUpdated(SCENE_NODE_P03_LARGE))
+	{
+		m_p03_Explicit->SetSurfaceModelMatrix(1, DirectX::XMFLOAT4X4(m_sceneGraph.GetWorld(SCENE_NODE_P03_LARGE).m));
+	}
+	if (m_sceneGraph.WasUpdated(SCENE_NODE_P04))
+	{
+		m_p04_Explicit->SetModelMatrix(DirectX::XMFLOAT4X4(m_sceneGraph.GetWorld(SCENE_NODE_P04).m));
+	}
+
+	for (size_t i = 0; i < ARRAYSIZE(SCENE_CULL_OBJECTS); i++)
+	{
+		const SceneCullObject& object = SCENE_CULL_OBJECTS[i];
+		if (!m_sceneGraph.WasUpdated(object.node)) continue;
+
+		float center[3] = { object.bounds.x, object.bounds.y, object.bounds.z };
+		float worldCenter[3];
+		SceneGraph::TransformSphere(m_sceneGraph.GetWorld(object.node), center, object.bounds.radius, worldCenter, m_cullRadius[i]);
+		m_cullX[i] = worldCenter[0];
+		m_cullY[i] = worldCenter[1];
+		m_cullZ[i] = worldCenter[2];
+	}
+}
+
+// Times the scene graph updates off the render thread; Update swaps the results in.
+void SceneRenderer::RunSceneGraphBenchmarkAsync()
+{
+	m_sceneGraphBenchmarkInFlight = true;
+
+	Concurrency::create_task([this]() {
+		m_pendingSceneGraphBenchmark.clear();
+		for (size_t count : SCENE_GRAPH_BENCHMARK_COUNTS)
+		{
+			m_pendingSceneGraphBenchmark.push_back(SceneGraph::Benchmark(count, count / SCENE_GRAPH_BENCHMARK_DIRTY_DIVISOR, SCENE_GRAPH_BENCHMARK_FRAMES));
+		}
+		m_sceneGraphBenchmarkReady = true;
+		});
+}
+
+// Times the CPU noise kernels off the render thread; Update swaps the results in.
+void SceneRenderer::RunNoiseBenchmarkAsync()
+{
+	m_noiseBenchmarkInFlight = true;
+
+	Concurrency::create_task([this]() {
+		m_pendingNoiseBenchmark.clear();
+		for (size_t count : SCENE_NOISE_BENCHMARK_COUNTS)
+		{
+			m_pendingNoiseBenchmark.push_back(NoiseKernels::Benchmark(count));
+		}
+		m_noiseBenchmarkReady = true;
+		});
+}
@@ -12,8 +12,16 @@
 #include "P05_Explicit.h"
 
 #include "Camera.h"
+#include "HiZOcclusion.h"
+#include "LodSelector.h"
+#include "NoiseKernels.h"
+#include "SceneCuller.h"
+#include "SceneGraph.h"
 
+#include <atomic>
+#include <map>
 #include <string>
+#include <vector>
 
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
@@ -33,6 +41,16 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 	private:
 		void ProcessInput(DX::StepTimer const& timer);
 		bool IsKeyPressed(VirtualKey key);
+		bool IsKeyToggled(VirtualKey key);
+		void SetLodEnabled(bool isEnabled);
+		void RunLodReport();
+		void CullObjects(const DirectX::XMFLOAT4X4& viewProjection);
+		bool IsCullOwnerVisible(int owner) const;
+		void SetOcclusionCullingEnabled(bool isEnabled);
+		void RunCullBenchmarkAsync();
+		void UpdateSceneGraph();
+		void RunSceneGraphBenchmarkAsync();
+		void RunNoiseBenchmarkAsync();
 
 	private:
 		// Cached pointer to device resources.
@@ -44,6 +62,41 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		std::unique_ptr<P05_Explicit>						m_p05_Explicit;
 		std::unique_ptr<Camera>								m_camera;
 		DirectX::XMFLOAT4X4									m_projectionMatrix;
+		DirectX::XMFLOAT4X4									m_viewProjectionMatrix;
+		float												m_lodPixelScale;
+		std::map<VirtualKey, bool>							m_keyWasDown;
+
+		// Last LOD report over the standard camera path.
+		std::vector<LodReportRow>							m_lodReport;
+
+		// Bounding spheres of the culled objects, one array per coordinate, and the
+		// result of this frame's tests.
+		std::unique_ptr<HiZOcclusion>						m_hiZOcclusion;
+		std::vector<float>									m_cullX;
+		std::vector<float>									m_cullY;
+		std::vector<float>									m_cullZ;
+		std::vector<float>									m_cullRadius;
+		std::vector<uint8_t>								m_cullVisible;
+		size_t												m_frustumCulledCount;
+		size_t												m_occludedCount;
+		std::vector<CullBenchmarkResult>					m_cullBenchmark;
+		std::vector<CullBenchmarkResult>					m_pendingCullBenchmark;
+		std::atomic<bool>									m_cullBenchmarkReady;
+		std::atomic<bool>									m_cullBenchmarkInFlight;
+
+		// Transform hierarchy of the explicit geometry.
+		SceneGraph											m_sceneGraph;
+		size_t												m_sceneGraphUpdatedCount;
+		std::vector<SceneGraphBenchmarkResult>				m_sceneGraphBenchmark;
+		std::vector<SceneGraphBenchmarkResult>				m_pendingSceneGraphBenchmark;
+		std::atomic<bool>									m_sceneGraphBenchmarkReady;
+		std::atomic<bool>									m_sceneGraphBenchmarkInFlight;
+
+		// Last run of the CPU noise kernels' benchmark.
+		std::vector<NoiseBenchmarkResult>					m_noiseBenchmark;
+		std::vector<NoiseBenchmarkResult>					m_pendingNoiseBenchmark;
+		std::atomic<bool>									m_noiseBenchmarkReady;
+		std::atomic<bool>									m_noiseBenchmarkInFlight;
 
 		// Resources related to text rendering.
 		Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock1>		m_stateBlock;
@@ -54,8 +107,11 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 
 		// Variables used with the rendering loop.
 		bool												m_isExplicitMode;
-		bool												m_isDebugMode;
-		bool												m_showControls;
+		uint32												m_helpPage;
+		uint32												m_debugPage;
+		bool												m_isLodEnabled;
+		bool												m_isFrustumCullingEnabled;
+		bool												m_isOcclusionCullingEnabled;
 	};
 }
 
@@ -3,11 +3,14 @@
 namespace _202219807_ACW_700119_D3D11_UWP_APP
 {
 	// Constant buffer used to send MVP and other matrices to the vertex shader.
+	// The combined matrices are appended so shaders declaring only the first three still match.
 	struct ModelViewProjectionConstantBuffer
 	{
 		DirectX::XMFLOAT4X4 model;
 		DirectX::XMFLOAT4X4 view;
 		DirectX::XMFLOAT4X4 projection;
+		DirectX::XMFLOAT4X4 viewProjection;
+		DirectX::XMFLOAT4X4 modelViewProjection;
 	};
 
 	struct CameraTrackingBuffer
@@ -41,12 +44,117 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		DirectX::XMFLOAT3 padding;
 	};
 
+	// Noise path of P01_Scene.hlsli: analytic, or one fetch from the NoiseVolume texture.
+	struct NoiseModeBuffer
+	{
+		uint32 useNoiseVolume;
+		float noiseVolumeScale;
+		DirectX::XMFLOAT2 padding;
+	};
+
+	// Whether the rays of P01_Scene.hlsli stop at the depth of the raster pipelines.
+	struct SceneDepthBuffer
+	{
+		uint32 useSceneDepth;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// Pixels the P01 ray marcher renders with dynamic resolution, and their scale
+	// from the screen on each axis.
+	struct RenderScaleBuffer
+	{
+		DirectX::XMFLOAT2 renderSize;
+		DirectX::XMFLOAT2 renderScale;
+	};
+
+	// Checkerboard rendering of the P01 ray marcher: the parity marched this frame,
+	// and the view and render size of the previous frame it reprojects into.
+	struct CheckerboardBuffer
+	{
+		DirectX::XMFLOAT4X4 previousView;
+		DirectX::XMFLOAT2 previousRenderSize;
+		uint32 isCheckerboard;
+		uint32 parity;
+		uint32 hasHistory;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// Sphere tracing of the P01 ray marcher: the step limit, the relaxation of the
+	// steps, the radius of a pixel's cone at distance one for the hit threshold,
+	// and the coral kernel.
+	struct MarchingBuffer
+	{
+		uint32 maxMarchingSteps;
+		float relaxation;
+		float pixelRadius;
+		uint32 useFastCoral;
+	};
+
+	// Grid of the P01 kelp: where its cells start on xz, how many there are, and
+	// whether ObjectsSDF takes the kelp through it (see PlantGrid.h).
+	struct PlantGridBuffer
+	{
+		DirectX::XMFLOAT2 origin;
+		uint32 columns;
+		uint32 rows;
+		uint32 usePlantGrid;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// Bubble field of P01: whether ObjectsSDF takes its bubbles in place of the
+	// two BubbleSDF, and the tiles of the screen they are binned into (see
+	// BubbleField.h).
+	struct BubbleFieldBuffer
+	{
+		uint32 useBubbleField;
+		uint32 columns;
+		uint32 rows;
+		float padding;
+	};
+
+	// Floor of P01_Scene.hlsli: sphere traced FloorSDF, the FloorHeightfield walk, or
+	// the depth of the tessellated mesh between terrainNear and terrainFar.
+	struct FloorHeightfieldBuffer
+	{
+		DirectX::XMFLOAT2 origin;
+		float cellSize;
+		float referenceY;
+		uint32 resolution;
+		uint32 levelCount;
+		uint32 lowOctaves;
+		uint32 floorMode;
+		float terrainNear;
+		float terrainFar;
+		DirectX::XMFLOAT2 padding;
+	};
+
+	// Hull and domain stages of the P01 floor mesh (see TerrainQuadtree.h).
+	struct TerrainTessellationBuffer
+	{
+		DirectX::XMFLOAT4X4 viewProjection;
+		DirectX::XMFLOAT3 eye;
+		float referenceY;
+		DirectX::XMFLOAT2 rootOrigin;
+		float tessellationDensity;
+		float minTessellation;
+		float maxTessellation;
+		DirectX::XMFLOAT3 padding;
+	};
+
 	struct LightBuffer 
 	{
 		DirectX::XMFLOAT3 color;
 		float depth;
 	};
 
+	// One pass of P04_CS.hlsl; model colours the triangles by world position.
+	struct AmplificationConstantBuffer
+	{
+		DirectX::XMFLOAT4X4 model;
+		uint32 triangleCount;
+		DirectX::XMFLOAT3 padding;
+	};
+
 	// Used to send per-vertex data to the vertex shader.
 	struct VertexPosition
 	{
@@ -65,4 +173,69 @@ namespace _202219807_ACW_700119_D3D11_UWP_APP
 		DirectX::XMFLOAT3 color;
 		DirectX::XMFLOAT3 normal;
 	};
+
+	// Used to pass subdivided coral triangles between compute passes.
+	// Structured buffers are tightly packed, so this matches the HLSL layout.
+	struct CoralVertex
+	{
+		DirectX::XMFLOAT3 pos;
+		DirectX::XMFLOAT3 normal;
+		DirectX::XMFLOAT4 color;
+	};
+
+	struct CoralTriangle
+	{
+		CoralVertex vertices[3];
+	};
+
+	// GPU bubble particle (P05), updated by the particle compute shaders and by
+	// the BubbleSimulation reference. Matches the HLSL structured buffer layout.
+	struct Particle
+	{
+		DirectX::XMFLOAT3 position;
+		float age;
+		DirectX::XMFLOAT3 velocity;
+		float lifetime;
+	};
+
+	// Per-frame emission and integration parameters of the particle compute passes.
+	struct ParticleConstantBuffer
+	{
+		float deltaTime;
+		uint32 emitCount;
+		uint32 frameIndex;
+		float padding;
+	};
+
+	// Written by CopyStructureCount with the length of an append/consume list.
+	struct ParticleCountBuffer
+	{
+		uint32 count;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// Bubble depth sort parameters: the merge being performed by the bitonic passes.
+	struct SortConstantBuffer
+	{
+		DirectX::XMFLOAT3 cameraPosition;
+		uint32 blockSize;
+		uint32 compareDistance;
+		DirectX::XMUINT3 padding;
+	};
+
+	// Billboard impostor parameters (Impostor_VS.hlsl).
+	struct ImpostorConstantBuffer
+	{
+		DirectX::XMFLOAT3 cameraPosition;
+		float radius;
+		uint32 cellCount;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// Sizes of the depth buffer and of the max-depth grid it is reduced to (HiZ_CS.hlsl).
+	struct HiZConstantBuffer
+	{
+		DirectX::XMUINT2 depthSize;
+		DirectX::XMUINT2 gridSize;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "pch.h"
+#include "TerrainQuadtree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float TerrainQuadtree::SplitDistance = 2.0f;
+const float TerrainQuadtree::TessellationDensity = 32.0f;
+const float TerrainQuadtree::MinTessellation = 2.0f;
+const float TerrainQuadtree::MaxTessellation = 64.0f;
+
+namespace
+{
+	// Edge midpoints closer than this count as this far, so the factor stays finite.
+	const float TERRAIN_MIN_EDGE_DISTANCE = 1.0e-3f;
+
+	// Cell offsets across each side, in the order of the TERRAIN_SIDE_ bits.
+	const int TERRAIN_SIDE_COLUMN[4] = { -1, 0, 1, 0 };
+	const int TERRAIN_SIDE_ROW[4] = { 0, -1, 0, 1 };
+}
+
+TerrainQuadtree::TerrainQuadtree() :
+	m_originX(0.0f),
+	m_originZ(0.0f),
+	m_rootSize(0.0f),
+	m_referenceY(0.0f),
+	m_eye(),
+	m_isSelected(false),
+	m_selectMilliseconds(0.0)
+{
+}
+
+void TerrainQuadtree::Build(const FloorHeightfield& heightfield)
+{
+	m_originX = heightfield.GetOriginX();
+	m_originZ = heightfield.GetOriginZ();
+	m_rootSize = heightfield.GetRegionSize();
+	m_referenceY = heightfield.GetReferenceY();
+
+	// A node of depth d covers one cell of the pyramid level with 2^d cells a side.
+	const uint32_t top = heightfield.GetLevelCount() - 1;
+	m_bounds.resize(MaxDepth + 1);
+	for (uint32_t depth = 0; depth <= MaxDepth; depth++)
+	{
+		uint32_t nodes = 1u << depth;
+		m_bounds[depth].resize(static_cast<size_t>(nodes) * nodes * 2);
+		for (uint32_t row = 0; row < nodes; row++)
+		{
+			for (uint32_t column = 0; column < nodes; column++)
+			{
+				float* bounds = &m_bounds[depth][(static_cast<size_t>(row) * nodes + column) * 2];
+				heightfield.GetSurfaceBounds(top - depth, column, row, bounds[0], bounds[1]);
+			}
+		}
+	}
+
+	m_leafDepths.assign(static_cast<size_t>(1) << (2 * MaxDepth), 0);
+	m_isSelected = false;
+}
+
+void TerrainQuadtree::Update(const float eye[3], const float viewProjection[16])
+{
+	if (m_bounds.empty()) return;
+
+	if (!m_isSelected || eye[0] != m_eye[0] || eye[1] != m_eye[1] || eye[2] != m_eye[2])
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::copy(eye, eye + 3, m_eye);
+		Select(0, 0, 0);
+		Balance();
+
+		m_leaves.clear();
+		m_leafSpheres.clear();
+		Collect(0, 0, 0);
+		m_isSelected = true;
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_selectMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	CullFrustum frustum = SceneCuller::ExtractFrustum(viewProjection);
+	m_patches.clear();
+	for (size_t i = 0; i < m_leaves.size(); i++)
+	{
+		if (SceneCuller::IsVisible(frustum, m_leafSpheres[i])) m_patches.push_back(m_leaves[i]);
+	}
+}
+
+void TerrainQuadtree::Select(uint32_t depth, uint32_t column, uint32_t row)
+{
+	float size = m_rootSize / static_cast<float>(1u << depth);
+	float minX = m_originX + column * size, minZ = m_originZ + row * size;
+	const float* bounds = &m_bounds[depth][(static_cast<size_t>(row) * (1u << depth) + column) * 2];
+
+	// Distance from the eye to the node's box.
+	float dx = std::max(std::max(minX - m_eye[0], m_eye[0] - (minX + size)), 0.0f);
+	float dy = std::max(std::max(bounds[0] - m_eye[1], m_eye[1] - bounds[1]), 0.0f);
+	float dz = std::max(std::max(minZ - m_eye[2], m_eye[2] - (minZ + size)), 0.0f);
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	if (depth < MaxDepth && distance < SplitDistance * size)
+	{
+		for (uint32_t child = 0; child < 4; child++)
+		{
+			Select(depth + 1, column * 2 + (child & 1), row * 2 + (child >> 1));
+		}
+		return;
+	}
+
+	// Mark the deepest level cells the leaf covers.
+	const uint32_t cells = 1u << MaxDepth;
+	uint32_t span = cells >> depth;
+	for (uint32_t r = row * span; r < (row + 1) * span; r++)
+	{
+		std::fill_n(m_leafDepths.begin() + static_cast<size_t>(r) * cells + column * span, span, static_cast<uint8_t>(depth));
+	}
+}
+
+// Splits any leaf with a neighbour more than one level deeper, until none is left.
+void TerrainQuadtree::Balance()
+{
+	const uint32_t cells = 1u << MaxDepth;
+	bool isChanged = true;
+	while (isChanged)
+	{
+		isChanged = false;
+		for (uint32_t row = 0; row < cells; row++)
+		{
+			for (uint32_t column = 0; column < cells; column++)
+			{
+				uint32_t depth = GetLeafDepth(column, row);
+				for (uint32_t side = 0; side < 4; side++)
+				{
+					int neighbourColumn = static_cast<int>(column) + TERRAIN_SIDE_COLUMN[side];
+					int neighbourRow = static_cast<int>(row) + TERRAIN_SIDE_ROW[side];
+					if (neighbourColumn < 0 || neighbourRow < 0 || neighbourColumn >= static_cast<int>(cells) || neighbourRow >= static_cast<int>(cells)) continue;
+					if (GetLeafDepth(neighbourColumn, neighbourRow) <= depth + 1) continue;
+
+					uint32_t span = cells >> depth;
+					uint32_t firstColumn = column / span * span, firstRow = row / span * span;
+					for (uint32_t r = firstRow; r < firstRow + span; r++)
+					{
+						std::fill_n(m_leafDepths.begin() + static_cast<size_t>(r) * cells + firstColumn, span, static_cast<uint8_t>(depth + 1));
+					}
+					isChanged = true;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void TerrainQuadtree::Collect(uint32_t depth, uint32_t column, uint32_t row)
+{
+	uint32_t span = (1u << MaxDepth) >> depth;
+	if (GetLeafDepth(column * span, row * span) != depth)
+	{
+		for (uint32_t child = 0; child < 4; child++)
+		{
+			Collect(depth + 1, column * 2 + (child & 1), row * 2 + (child >> 1));
+		}
+		return;
+	}
+
+	TerrainPatch patch = MakePatch(depth, column, row);
+	m_leaves.push_back(patch);
+
+	const float* bounds = &m_bounds[depth][(static_cast<size_t>(row) * (1u << depth) + column) * 2];
+	float half = patch.size * 0.5f, halfHeight = (bounds[1] - bounds[0]) * 0.5f;
+	CullSphere sphere = { patch.x + half, bounds[0] + halfHeight, patch.z + half, sqrtf(2.0f * half * half + halfHeight * halfHeight) };
+	m_leafSpheres.push_back(sphere);
+}
+
+TerrainPatch TerrainQuadtree::MakePatch(uint32_t depth, uint32_t column, uint32_t row) const
+{
+	const int cells = 1 << MaxDepth;
+	int span = cells >> depth;
+
+	TerrainPatch patch;
+	patch.size = m_rootSize / static_cast<float>(1u << depth);
+	patch.x = m_originX + column * patch.size;
+	patch.z = m_originZ + row * patch.size;
+	patch.coarserSides = 0;
+
+	// With the tree balanced, a coarser neighbour covers the whole side.
+	for (uint32_t side = 0; side < 4; side++)
+	{
+		int neighbourColumn = static_cast<int>(column) * span + (TERRAIN_SIDE_COLUMN[side] > 0 ? span : TERRAIN_SIDE_COLUMN[side]);
+		int neighbourRow = static_cast<int>(row) * span + (TERRAIN_SIDE_ROW[side] > 0 ? span : TERRAIN_SIDE_ROW[side]);
+		if (neighbourColumn < 0 || neighbourRow < 0 || neighbourColumn >= cells || neighbourRow >= cells) continue;
+		if (GetLeafDepth(neighbourColumn, neighbourRow) < depth) patch.coarserSides |= 1u << side;
+	}
+	return patch;
+}
+
+uint32_t TerrainQuadtree::GetLeafDepth(uint32_t column, uint32_t row) const
+{
+	return m_leafDepths[(static_cast<size_t>(row) << MaxDepth) + column];
+}
+
+float TerrainQuadtree::EdgeDistance(float x, float z) const
+{
+	float dx = x - m_eye[0], dy = m_referenceY - m_eye[1], dz = z - m_eye[2];
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+float TerrainQuadtree::EdgeTessellation(float length, float distance)
+{
+	float segments = length * TessellationDensity / std::max(distance, TERRAIN_MIN_EDGE_DISTANCE);
+	float tessellation = exp2f(ceilf(log2f(std::max(segments, 1.0f))));
+	return std::min(std::max(tessellation, MinTessellation), MaxTessellation);
+}
+
+void TerrainQuadtree::GetTessellation(const TerrainPatch& patch, float edges[4]) const
+{
+	for (uint32_t side = 0; side < 4; side++)
+	{
+		// Sides 0 and 2 run along z, sides 1 and 3 along x.
+		bool isAlongZ = (side & 1) == 0;
+		float across = (side < 2 ? 0.0f : patch.size) + (isAlongZ ? patch.x : patch.z);
+		float start = isAlongZ ? patch.z : patch.x;
+		float origin = isAlongZ ? m_originZ : m_originX;
+
+		float length = patch.size, middle = start + patch.size * 0.5f, scale = 1.0f;
+		if (patch.coarserSides & (1u << side))
+		{
+			// The neighbour's edge is the parent's, twice as long with its middle at this patch's corner.
+			length = patch.size * 2.0f;
+			middle = origin + floorf((start - origin) / length) * length + patch.size;
+			scale = 0.5f;
+		}
+
+		float distance = isAlongZ ? EdgeDistance(across, middle) : EdgeDistance(middle, across);
+		edges[side] = EdgeTessellation(length, distance) * scale;
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "FloorHeightfield.h"
+#include "SceneCuller.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// Chunks and levels of detail of the tessellated sea floor of P01.
+	//
+	// The region of the FloorHeightfield is the root of a quadtree. A node is split
+	// while the eye is closer to its bounds than SplitDistance times its size, and
+	// the leaves are then split further until neighbours differ by one level at
+	// most. Each leaf becomes one patch for the hull shader, which tessellates it
+	// by the distance of each edge from the eye, and the domain shader displaces
+	// the vertices with the heightfield of P01_Scene.hlsli.
+	//
+	// A patch edge next to a coarser neighbour takes half the tessellation of the
+	// neighbour's edge, so the vertices along both sides coincide and the mesh has
+	// no cracks.
+	//
+	// The node bounds come from the heightfield's min/max pyramid, which has a
+	// level for every depth of the tree. Leaves outside the frustum are culled.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	// Bits of TerrainPatch::coarserSides, in the edge order of SV_TessFactor for the
+	// quad domain with x = u and z = v.
+	const uint32_t TERRAIN_SIDE_NEGATIVE_X = 1;
+	const uint32_t TERRAIN_SIDE_NEGATIVE_Z = 2;
+	const uint32_t TERRAIN_SIDE_POSITIVE_X = 4;
+	const uint32_t TERRAIN_SIDE_POSITIVE_Z = 8;
+
+	// One control point, laid out as the vertex input of P01_VS02.hlsl.
+	struct TerrainPatch
+	{
+		float		x;
+		float		z;
+		float		size;
+		uint32_t	coarserSides;
+	};
+
+	class TerrainQuadtree
+	{
+	public:
+		// Deepest level, where a patch is 1 unit across, and the split rule.
+		static const uint32_t MaxDepth = 7;
+		static const float SplitDistance;
+
+		// Tessellation per edge: TessellationDensity segments per unit of edge at
+		// distance one, rounded up to a power of two within the limits.
+		static const float TessellationDensity;
+		static const float MinTessellation;
+		static const float MaxTessellation;
+
+		TerrainQuadtree();
+
+		// Takes the region and the node bounds from a built heightfield.
+		void Build(const FloorHeightfield& heightfield);
+
+		// Selects the leaves for the eye, which is only redone when the eye moves,
+		// and culls them against the view-projection (16 floats, row-vector order).
+		void Update(const float eye[3], const float viewProjection[16]);
+
+		// Leaves inside the frustum, and all leaves.
+		const std::vector<TerrainPatch>& GetPatches() const		{ return m_patches; }
+		const std::vector<TerrainPatch>& GetLeaves() const		{ return m_leaves; }
+		size_t GetMaxPatchCount() const							{ return static_cast<size_t>(1) << (2 * MaxDepth); }
+		double GetSelectMilliseconds() const					{ return m_selectMilliseconds; }
+
+		float GetOriginX() const								{ return m_originX; }
+		float GetOriginZ() const								{ return m_originZ; }
+		float GetRootSize() const								{ return m_rootSize; }
+		float GetReferenceY() const								{ return m_referenceY; }
+
+		// Tessellation of the four sides of a patch, as P01_HS.hlsl computes it.
+		void GetTessellation(const TerrainPatch& patch, float edges[4]) const;
+
+		// Tessellation of one edge from its length and the distance of its midpoint
+		// from the eye, taken at the reference depth of the heightfield.
+		static float EdgeTessellation(float length, float distance);
+
+	private:
+		void Select(uint32_t depth, uint32_t column, uint32_t row);
+		void Balance();
+		void Collect(uint32_t depth, uint32_t column, uint32_t row);
+		TerrainPatch MakePatch(uint32_t depth, uint32_t column, uint32_t row) const;
+		uint32_t GetLeafDepth(uint32_t column, uint32_t row) const;
+		float EdgeDistance(float x, float z) const;
+
+		float								m_originX;
+		float								m_originZ;
+		float								m_rootSize;
+		float								m_referenceY;
+		float								m_eye[3];
+		bool								m_isSelected;
+
+		// Lowest and highest surface y per node, one array per depth.
+		std::vector<std::vector<float>>		m_bounds;
+
+		// Depth of the leaf over each cell of the deepest level.
+		std::vector<uint8_t>				m_leafDepths;
+
+		std::vector<TerrainPatch>			m_leaves;
+		std::vector<TerrainPatch>			m_patches;
+		std::vector<CullSphere>				m_leafSpheres;
+		double								m_selectMilliseconds;
+	};
+}
@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "BoidsSimulation.h"
+#include "BubbleFieldCheck.h"
+#include "CheckerboardReconstructionCheck.h"
+#include "CoralGenerator.h"
+#include "CoralSubdivision.h"
+#include "FloorHeightfieldCheck.h"
+#include "GridGenerator.h"
+#include "MeshOptimizer.h"
+#include "NoiseKernels.h"
+#include "ParticleSorter.h"
+#include "ParticleStore.h"
+#include "PlantGridCheck.h"
+#include "ResolutionControllerCheck.h"
+#include "SceneCuller.h"
+#include "SceneGraph.h"
+#include "SceneMarcher.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+using namespace DirectX;
+
+// Prints the reports and timings of the platform-neutral modules, at the sizes
+// the app uses. Each section can be run on its own by naming it, e.g.
+// content_benchmarks mesh.
+
+namespace
+{
+	// Canvas extents of P01 with the start camera's projection at 16:9, and the
+	// radius of a pixel's cone on a 1080 pixel high screen.
+	const float BENCHMARK_CANVAS_WIDTH = 1.106f;
+	const float BENCHMARK_CANVAS_HEIGHT = 0.63f;
+	const float BENCHMARK_PIXEL_RADIUS = BENCHMARK_CANVAS_HEIGHT / 1080.0f;
+
+	// Time the P01 scene is frozen at, and the relaxation of the relaxed tracer.
+	const float BENCHMARK_SCENE_TIME = 10.0f;
+	const float BENCHMARK_RELAXATION = 1.3f;
+
+	const char* YesNo(bool value)
+	{
+		return value ? "yes" : "NO";
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// The three passes of the optimiser over latitude/longitude spheres in the
+	// row order P02 builds its grid in, as triangle lists.
+	void RunMesh()
+	{
+		std::printf("\nMesh optimiser, sphere triangle lists, vertex cache of 16\n");
+		for (uint32_t resolution : { 100u, 256u })
+		{
+			std::vector<MeshPosition> positions;
+			std::vector<uint32_t> indices;
+			for (uint32_t i = 0; i < resolution; i++)
+			{
+				for (uint32_t j = 0; j < resolution; j++)
+				{
+					float x = j * 6.2831853f / (resolution - 1);
+					float y = i * 3.1415927f / (resolution - 1);
+					positions.push_back({ sinf(y) * cosf(x), sinf(y) * sinf(x), cosf(y) });
+				}
+			}
+			for (uint32_t i = 0; i + 1 < resolution; i++)
+			{
+				for (uint32_t j = 0; j + 1 < resolution; j++)
+				{
+					uint32_t a = i * resolution + j;
+					uint32_t c = a + resolution;
+					indices.insert(indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+				}
+			}
+
+			VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+			auto start = std::chrono::steady_clock::now();
+			MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+			double cacheMilliseconds = MillisecondsSince(start);
+			VertexCacheStatistics cached = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+			start = std::chrono::steady_clock::now();
+			MeshOptimizer::OptimizeOverdraw(indices, positions);
+			double overdrawMilliseconds = MillisecondsSince(start);
+			VertexCacheStatistics sorted = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+			start = std::chrono::steady_clock::now();
+			MeshOptimizer::OptimizeVertexFetch(indices, positions.size());
+			double fetchMilliseconds = MillisecondsSince(start);
+
+			std::printf("  %ux%u: ACMR %.3f -> %.3f -> %.3f, ATVR %.3f -> %.3f -> %.3f; cache %.1f ms, overdraw %.1f ms, fetch %.1f ms\n",
+				resolution, resolution, before.acmr, cached.acmr, sorted.acmr, before.atvr, cached.atvr, sorted.atvr,
+				cacheMilliseconds, overdrawMilliseconds, fetchMilliseconds);
+		}
+	}
+
+	// The P02 grid's cache order, taken offline since P02 draws it as points, and
+	// the grid builds the Home key times in the app.
+	void RunGrid()
+	{
+		std::printf("\nP02 sphere grid as triangles, vertex cache of 16\n");
+		GridMesh mesh;
+		GridGenerator::BuildSphereGrid(100, mesh);
+		VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+		GridGenerator::OptimizeSphereGrid(mesh);
+		VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+		std::printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+
+		for (uint32_t resolution : { 100u, 1000u, 4000u })
+		{
+			GridBenchmarkResult result = GridGenerator::Benchmark(resolution);
+			std::printf("  %ux%u: %.2f ms, %.1f MB\n", resolution, resolution, result.milliseconds, result.bytes / (1024.0 * 1024.0));
+		}
+	}
+
+	void RunCoral()
+	{
+		std::printf("\nP04 coral generator, cube seed\n");
+		const VertexPositionColorNormal corners[] =
+		{
+			{ XMFLOAT3(-1, -1, -1), XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0) }, { XMFLOAT3(-1, -1, 1), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 0) },
+			{ XMFLOAT3(-1, 1, -1), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 0) }, { XMFLOAT3(-1, 1, 1), XMFLOAT3(0, 1, 1), XMFLOAT3(0, 0, 0) },
+			{ XMFLOAT3(1, -1, -1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 0) }, { XMFLOAT3(1, -1, 1), XMFLOAT3(1, 0, 1), XMFLOAT3(0, 0, 0) },
+			{ XMFLOAT3(1, 1, -1), XMFLOAT3(1, 1, 0), XMFLOAT3(0, 0, 0) }, { XMFLOAT3(1, 1, 1), XMFLOAT3(1, 1, 1), XMFLOAT3(0, 0, 0) },
+		};
+		const unsigned short indices[] =
+		{
+			0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 5, 0, 5, 4,
+			2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5,
+		};
+		std::vector<CoralTriangle> seed;
+		CoralSubdivision::BuildSeedTriangles(corners, indices, 36, XMFLOAT3(0, 0, 0), seed);
+		XMFLOAT4X4 world = {};
+		world._11 = world._22 = world._33 = world._44 = 1.0f;
+
+		std::vector<CoralTriangle> output;
+		for (uint32_t levels : { 6u, 8u, 10u })
+		{
+			CoralGeneratorStatistics statistics = CoralGenerator::Generate(seed, world, levels, 1, output);
+			std::printf("  level %u: %zu triangles in %.1f ms, %.1f M triangles/s\n", levels, statistics.triangleCount,
+				statistics.milliseconds, statistics.trianglesPerSecond / 1e6);
+		}
+	}
+
+	void RunBoids()
+	{
+		std::printf("\nP05 boids, fish updated per ms\n");
+		for (size_t count : { 10000u, 50000u })
+		{
+			std::printf("  %zu fish: %.1f\n", count, BoidsSimulation::Benchmark(count, 20));
+		}
+	}
+
+	void RunKernels()
+	{
+		std::printf("\nP05 particle kernels, ms per step (AVX2 %s)\n", YesNo(ParticleStore::IsVectorised()));
+		for (size_t count : { 1000u, 100000u, 1000000u })
+		{
+			ParticleBenchmarkResult result = ParticleStore::Benchmark(count, 20);
+			std::printf("  %zu: AoS %.3f, SoA %.3f\n", count, result.aosMilliseconds, result.soaMilliseconds);
+		}
+	}
+
+	void RunSorts()
+	{
+		std::printf("\nP05 depth sorts, ms\n");
+		for (size_t count : { 1000u, 100000u, 1000000u })
+		{
+			SortBenchmarkResult result = ParticleSorter::Benchmark(count);
+			std::printf("  %zu: radix %.3f, bitonic %.3f, std::sort %.3f, consistent %s\n", count, result.radixMilliseconds,
+				result.bitonicMilliseconds, result.stdSortMilliseconds, YesNo(result.isConsistent));
+		}
+	}
+
+	void RunCulling()
+	{
+		std::printf("\nCulling, spheres tested per microsecond (SIMD %s)\n", YesNo(SceneCuller::IsVectorised()));
+		for (size_t count : { 64u, 4096u, 1000000u })
+		{
+			CullBenchmarkResult result = SceneCuller::Benchmark(count);
+			std::printf("  %zu: scalar %.1f, SIMD %.1f, Hi-Z %.1f, consistent %s\n", count, result.scalarObjectsPerMicrosecond,
+				result.simdObjectsPerMicrosecond, result.hiZObjectsPerMicrosecond, YesNo(result.isConsistent));
+		}
+	}
+
+	void RunSceneGraph()
+	{
+		std::printf("\nScene graph, ms per frame with 1%% of nodes moving\n");
+		for (size_t count : { 10000u, 100000u })
+		{
+			SceneGraphBenchmarkResult result = SceneGraph::Benchmark(count, count / 100, 60);
+			std::printf("  %zu nodes: dirty flags %.3f, flat %.3f, pointer tree %.3f, consistent %s\n", count,
+				result.dirtyMilliseconds, result.fullMilliseconds, result.pointerTreeMilliseconds, YesNo(result.isConsistent));
+		}
+	}
+
+	void RunNoise()
+	{
+		const char* names[NOISE_VARIANT_COUNT] = { "scalar", "SSE", "AVX2" };
+		NoiseBenchmarkResult result = NoiseKernels::Benchmark(1000000);
+		std::printf("\nCPU noise, samples/ns (noise, perlin, fBm)\n");
+		for (size_t v = 0; v < NOISE_VARIANT_COUNT; v++)
+		{
+			if (!result.isAvailable[v]) continue;
+			std::printf("  %-6s %.3f, %.3f, %.4f\n", names[v], result.noisePerNanosecond[v], result.perlinPerNanosecond[v],
+				result.fbmPerNanosecond[v]);
+		}
+		std::printf("  variants identical %s, off the library sin on %.4f%% of samples\n", YesNo(result.variantDifference == 0.0f),
+			result.libraryMismatchRate * 100.0f);
+	}
+
+	void RunFloor()
+	{
+		FloorHeightfield floor;
+		double buildMilliseconds = floor.Build();
+		Tests::FloorStepReport report = Tests::MeasureFloorSteps(floor, 96, 54, BENCHMARK_CANVAS_WIDTH, BENCHMARK_CANVAS_HEIGHT);
+		std::printf("\nP01 floor, %u rays, pyramid built in %.1f ms\n", report.rays, buildMilliseconds);
+		std::printf("  steps per ray: sphere traced %.1f, heightfield %.1f (%.1f evaluations), consistent %s\n",
+			report.sphereStepsPerRay, report.heightfieldStepsPerRay, report.heightfieldEvaluationsPerRay, YesNo(report.isConsistent));
+	}
+
+	void RunResolution()
+	{
+		Tests::ResolutionCheckReport report = Tests::RunSyntheticResolution(8.0);
+		std::printf("\nP01 dynamic resolution, 8 ms budget, %u synthetic frames\n", report.frames);
+		std::printf("  settled in %u frames, again in %u; scale %.3f for %.3f, overshoot %.1f%%, stable %s\n", report.settleFrames,
+			report.resettleFrames, report.finalScale, report.expectedScale, report.maxOvershoot * 100.0, YesNo(report.isStable));
+	}
+
+	void RunCheckerboard()
+	{
+		std::printf("\nP01 checkerboard against full rendering, 320x180, 32 frames\n");
+		const char* names[] = { "still camera", "turning camera" };
+		const float turns[] = { 0.0f, 0.001f };
+		for (int i = 0; i < 2; i++)
+		{
+			Tests::CheckerboardErrorReport report = Tests::MeasureCheckerboardError(320, 180, 32, turns[i], 0.005f);
+			std::printf("  %s: RMSE %.4f (neighbours alone %.4f), PSNR %.1f dB, %.1f%% rejected\n", names[i], report.rmse,
+				report.spatialRmse, report.psnr, report.rejectedShare * 100.0);
+		}
+	}
+
+	// The relaxed marcher against the plain one, at the full step limit and a
+	// lower one, with the hit threshold of a screen pixel, and the fast coral
+	// kernel and the plant grid on their own.
+	void RunMarch()
+	{
+		std::vector<MarchSettings> settings = {
+			{ SceneMarcher::MaxMarchingSteps, BENCHMARK_RELAXATION, BENCHMARK_PIXEL_RADIUS, false, false },
+			{ 64, 1.0f, 0.0f, false, false },
+			{ 64, BENCHMARK_RELAXATION, BENCHMARK_PIXEL_RADIUS, false, false },
+			{ SceneMarcher::MaxMarchingSteps, 1.0f, 0.0f, true, false },
+			{ SceneMarcher::MaxMarchingSteps, 1.0f, 0.0f, false, true }
+		};
+		SceneMarcher marcher(BENCHMARK_SCENE_TIME);
+		std::vector<MarchStepReport> reports = marcher.Compare(96, 54, BENCHMARK_CANVAS_WIDTH, BENCHMARK_CANVAS_HEIGHT, settings);
+
+		std::printf("\nP01 sphere tracing, %u rays, against plain tracing with %u steps\n", reports.empty() ? 0 : reports[0].rays,
+			SceneMarcher::MaxMarchingSteps);
+		for (const MarchStepReport& report : reports)
+		{
+			std::printf("  %s %u%s%s: %.1f steps/ray (plain %.1f), %u out of steps, %.2f%% other objects, depth error %.4f, %.0f ms\n",
+				report.relaxation > 1.0f ? "relaxed" : "plain", report.maxSteps, report.isFastCoral ? ", fast coral" : "",
+				report.isPlantGrid ? ", plant grid" : "", report.stepsPerRay, report.baselineStepsPerRay, report.outOfSteps,
+				report.mismatchedShare * 100.0, report.depthError, report.milliseconds);
+		}
+
+		CoralKernelReport coral = SceneMarcher::CheckCoral(65536);
+		std::printf("\nP01 coral kernel, ns per call over %u points\n", coral.samples);
+		std::printf("  formula %.1f, fast %.1f, bounded %.1f; error %.2e, LOD shift %.2f, consistent %s\n", coral.formulaNanoseconds,
+			coral.fastNanoseconds, coral.boundedNanoseconds, coral.maxError, coral.maxLodShift, YesNo(coral.isConsistent));
+	}
+
+	void RunPlants()
+	{
+		Tests::PlantGridReport report = Tests::MeasurePlantGrid(4096, 2048, BENCHMARK_SCENE_TIME);
+		std::printf("\nP01 kelp, %u points\n", report.samples);
+		std::printf("  scene, %u stalks in %u cells: loop %.0f ns, grid %.0f ns, %.1f stalks per point\n", report.stalks,
+			report.cells, report.loopNanoseconds, report.gridNanoseconds, report.stalksPerSample);
+		std::printf("  forest, %u stalks: all %.0f ns, grid %.0f ns, %.1f stalks per point; consistent %s\n", report.forestStalks,
+			report.forestBruteNanoseconds, report.forestGridNanoseconds, report.forestStalksPerSample, YesNo(report.isConsistent));
+	}
+
+	void RunBubbles()
+	{
+		Tests::BubbleFieldReport report = Tests::MeasureBubbleField(1024, 300, 256, 144, BENCHMARK_CANVAS_WIDTH,
+			BENCHMARK_CANVAS_HEIGHT);
+		std::printf("\nP01 bubble field, %u bubbles over %u frames\n", report.bubbles, report.frames);
+		std::printf("  %u spawned, %u merged, %u popped; update %.3f ms, binning %.3f ms per frame\n", report.spawned,
+			report.merges, report.pops, report.updateMilliseconds, report.binMilliseconds);
+		std::printf("  %u rays: %.1f bubbles per tile ray (most %u), %.0f ns against %.0f ns over all; consistent %s\n",
+			report.rays, report.bubblesPerRay, report.maxPerTile, report.tileNanoseconds, report.bruteNanoseconds,
+			YesNo(report.isConsistent));
+	}
+
+	struct Section
+	{
+		const char*	name;
+		void		(*function)();
+	};
+
+	const Section BENCHMARK_SECTIONS[] =
+	{
+		{ "mesh", RunMesh },
+		{ "grid", RunGrid },
+		{ "coral", RunCoral },
+		{ "boids", RunBoids },
+		{ "kernels", RunKernels },
+		{ "sorts", RunSorts },
+		{ "culling", RunCulling },
+		{ "scene", RunSceneGraph },
+		{ "noise", RunNoise },
+		{ "floor", RunFloor },
+		{ "resolution", RunResolution },
+		{ "checkerboard", RunCheckerboard },
+		{ "march", RunMarch },
+		{ "plants", RunPlants },
+		{ "bubbles", RunBubbles },
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	for (const Section& section : BENCHMARK_SECTIONS)
+	{
+		bool isSelected = (argc == 1);
+		for (int i = 1; i < argc; i++)
+		{
+			isSelected = isSelected || (std::strcmp(argv[i], section.name) == 0);
+		}
+		if (isSelected)
+		{
+			section.function();
+			std::fflush(stdout);
+		}
+	}
+	return 0;
+}
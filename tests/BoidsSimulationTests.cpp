@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "BoidsSimulation.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	float Length(const BoidVector& v)
+	{
+		return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+}
+
+TEST(BoidsSimulation_SpeedsStayWithinLimits)
+{
+	BoidsSimulation simulation(BoidsSimulation::GetDefaultSettings(), 11);
+	simulation.Resize(2000);
+	CHECK(simulation.GetCount() == 2000);
+	for (int i = 0; i < 60; i++) simulation.Step(1.0f / 60.0f);
+
+	const BoidsSettings& settings = simulation.GetSettings();
+	bool isWithinLimits = true;
+	for (const BoidVector& v : simulation.GetVelocities())
+	{
+		float speed = Length(v);
+		isWithinLimits = isWithinLimits && std::isfinite(speed) &&
+			(speed >= settings.minSpeed - 1e-3f) && (speed <= settings.maxSpeed + 1e-3f);
+	}
+	CHECK(isWithinLimits);
+}
+
+// Each fish reads the previous state only, so however the update is split
+// between threads the result is the same.
+TEST(BoidsSimulation_SameSeedSameShoal)
+{
+	BoidsSimulation a(BoidsSimulation::GetDefaultSettings(), 5);
+	BoidsSimulation b(BoidsSimulation::GetDefaultSettings(), 5);
+	a.Resize(3000);
+	b.Resize(3000);
+	for (int i = 0; i < 30; i++)
+	{
+		a.Step(1.0f / 60.0f);
+		b.Step(1.0f / 60.0f);
+	}
+
+	bool isSame = true;
+	for (size_t i = 0; i < a.GetCount(); i++)
+	{
+		const BoidVector& p = a.GetPositions()[i];
+		const BoidVector& q = b.GetPositions()[i];
+		isSame = isSame && (p.x == q.x) && (p.y == q.y) && (p.z == q.z);
+	}
+	CHECK(isSame);
+}
+
+TEST(BoidsSimulation_FishStayNearBoundsAndOutOfObstacles)
+{
+	BoidsSettings settings = BoidsSimulation::GetDefaultSettings();
+	BoidsSimulation simulation(settings, 3);
+	simulation.SetObstacles({ { { 0.0f, 0.0f, 0.0f }, 4.0f } });
+	simulation.Resize(1000);
+	for (int i = 0; i < 600; i++) simulation.Step(1.0f / 60.0f);
+
+	// Bounds and obstacles steer rather than clamp, so allow a fish's reach at
+	// full speed before it turns.
+	const float slack = 3.0f;
+	size_t outside = 0;
+	size_t inside = 0;
+	for (const BoidVector& p : simulation.GetPositions())
+	{
+		if (p.x < settings.boundsMin.x - slack || p.x > settings.boundsMax.x + slack ||
+			p.y < settings.boundsMin.y - slack || p.y > settings.boundsMax.y + slack ||
+			p.z < settings.boundsMin.z - slack || p.z > settings.boundsMax.z + slack)
+		{
+			outside++;
+		}
+		if (Length(p) < 2.0f) inside++;
+	}
+	CHECK(outside == 0);
+	CHECK(inside < 10);
+
+	simulation.Resize(10);
+	CHECK(simulation.GetPositions().size() == 10);
+}
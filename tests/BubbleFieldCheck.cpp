@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "BubbleFieldCheck.h"
+#include "BubbleField.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Fixed eye of the ray marcher in P01_Scene.hlsli, and the turn of the second
+	// camera the bubbles are binned for.
+	const float BUBBLE_CHECK_EYE[3] = { -2.0f, -1.8f, 5.0f };
+	const float BUBBLE_CHECK_TURN = 0.6f;
+
+	// Largest relative change of volume a merge may make, from rounding.
+	const float BUBBLE_CHECK_MERGE_TOLERANCE = 1e-5f;
+
+	// End of a ray that meets no bubble.
+	const float BUBBLE_CHECK_FAR = 1e30f;
+
+	// Nearest hit of a ray from the eye on the bubbles, or the end of the ray.
+	float NearestHit(const float eye[3], const float direction[3], const Bubble* bubbles, size_t count, float end)
+	{
+		float nearest = end;
+		for (size_t i = 0; i < count; i++)
+		{
+			float ox = eye[0] - bubbles[i].x, oy = eye[1] - bubbles[i].y, oz = eye[2] - bubbles[i].z;
+			float b = ox * direction[0] + oy * direction[1] + oz * direction[2];
+			float c = ox * ox + oy * oy + oz * oz - bubbles[i].radius * bubbles[i].radius;
+			float discriminant = b * b - c;
+			if (discriminant < 0.0f) continue;
+			float root = sqrtf(discriminant);
+			float t = -b - root;
+			if (t < 0.0f) t = -b + root;
+			if (t >= 0.0f && t < nearest) nearest = t;
+		}
+		return nearest;
+	}
+}
+
+Tests::BubbleFieldReport Tests::MeasureBubbleField(uint32_t count, uint32_t frames, uint32_t width, uint32_t height,
+	float canvasWidth, float canvasHeight)
+{
+	BubbleFieldReport report = {};
+	report.bubbles = count;
+	report.frames = frames;
+
+	BubbleField field;
+	field.Reset(count, 5);
+
+	// The simulation, with every bubble kept between the vents and the surface
+	double updateMilliseconds = 0.0;
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		field.Update(1.0f / 60.0f);
+		auto end = std::chrono::high_resolution_clock::now();
+		updateMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+		for (const auto& bubble : field.GetBubbles())
+		{
+			if (!(bubble.y >= BubbleField::VentY && bubble.y + bubble.radius < BubbleField::PopY &&
+				bubble.radius >= BubbleField::MinRadius && bubble.radius <= BubbleField::MaxRadius))
+			{
+				report.strays++;
+			}
+		}
+	}
+	report.spawned = field.GetSpawned();
+	report.merges = field.GetMerges();
+	report.pops = field.GetPops();
+	report.maxMergeError = field.GetMaxMergeError();
+	if (frames > 0) report.updateMilliseconds = updateMilliseconds / frames;
+
+	uint32_t columns = (width + BubbleField::TileSize - 1) / BubbleField::TileSize;
+	uint32_t rows = (height + BubbleField::TileSize - 1) / BubbleField::TileSize;
+	float pixelRadius = canvasHeight / height;
+
+	std::mt19937 generator(17);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	uint64_t listed = 0;
+	double binMilliseconds = 0.0, bruteNanoseconds = 0.0, tileNanoseconds = 0.0;
+
+	// Looking down -z, then turned about y
+	for (uint32_t camera = 0; camera < 2; camera++)
+	{
+		float angle = camera * BUBBLE_CHECK_TURN;
+		float rotation[16] = {
+			cosf(angle), 0.0f, sinf(angle), 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			-sinf(angle), 0.0f, cosf(angle), 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+
+		auto binStart = std::chrono::high_resolution_clock::now();
+		field.Bin(BUBBLE_CHECK_EYE, rotation, canvasWidth, canvasHeight, columns, rows, pixelRadius);
+		auto binEnd = std::chrono::high_resolution_clock::now();
+		binMilliseconds += std::chrono::duration<double, std::milli>(binEnd - binStart).count();
+
+		for (const auto& tile : field.GetTiles())
+		{
+			report.maxPerTile = std::max(report.maxPerTile, tile.count);
+		}
+
+		// One ray through a random point of each pixel, from view into world space
+		uint32_t rays = width * height;
+		std::vector<float> directions(static_cast<size_t>(rays) * 3);
+		std::vector<uint32_t> tiles(rays);
+		for (uint32_t r = 0; r < rays; r++)
+		{
+			float canvasX = ((r % width + unit(generator)) / width * 2.0f - 1.0f) * canvasWidth;
+			float canvasY = (1.0f - (r / width + unit(generator)) / height * 2.0f) * canvasHeight;
+			float length = sqrtf(canvasX * canvasX + canvasY * canvasY + 1.0f);
+			float view[3] = { canvasX / length, canvasY / length, -1.0f / length };
+			float* direction = &directions[r * 3];
+			for (int j = 0; j < 3; j++)
+			{
+				direction[j] = view[0] * rotation[j * 4] + view[1] * rotation[j * 4 + 1] + view[2] * rotation[j * 4 + 2];
+			}
+			tiles[r] = field.GetTileIndex(canvasX, canvasY);
+			listed += field.GetTiles()[tiles[r]].count;
+		}
+
+		const std::vector<Bubble>& bubbles = field.GetBubbles();
+		std::vector<float> brute(rays), tiled(rays);
+		auto bruteStart = std::chrono::high_resolution_clock::now();
+		for (uint32_t r = 0; r < rays; r++)
+		{
+			brute[r] = NearestHit(BUBBLE_CHECK_EYE, &directions[r * 3], bubbles.data(), bubbles.size(), BUBBLE_CHECK_FAR);
+		}
+		auto tileStart = std::chrono::high_resolution_clock::now();
+		for (uint32_t r = 0; r < rays; r++)
+		{
+			const BubbleTile& tile = field.GetTiles()[tiles[r]];
+			tiled[r] = NearestHit(BUBBLE_CHECK_EYE, &directions[r * 3], field.GetTileBubbles().data() + tile.first, tile.count, BUBBLE_CHECK_FAR);
+		}
+		auto tileEnd = std::chrono::high_resolution_clock::now();
+		bruteNanoseconds += std::chrono::duration<double, std::nano>(tileStart - bruteStart).count();
+		tileNanoseconds += std::chrono::duration<double, std::nano>(tileEnd - tileStart).count();
+
+		// Every bubble the ray comes within the hit threshold of has to be listed
+		// in its tile, and the nearest hit has to be the same.
+		for (uint32_t r = 0; r < rays; r++)
+		{
+			if (brute[r] != tiled[r]) report.mismatchedHits++;
+
+			const float* direction = &directions[r * 3];
+			const BubbleTile& tile = field.GetTiles()[tiles[r]];
+			for (const auto& bubble : bubbles)
+			{
+				float cx = bubble.x - BUBBLE_CHECK_EYE[0], cy = bubble.y - BUBBLE_CHECK_EYE[1], cz = bubble.z - BUBBLE_CHECK_EYE[2];
+				float along = std::max(cx * direction[0] + cy * direction[1] + cz * direction[2], 0.0f);
+				float ox = cx - along * direction[0], oy = cy - along * direction[1], oz = cz - along * direction[2];
+				float threshold = bubble.radius + BubbleField::Epsilon + along * pixelRadius;
+				if (ox * ox + oy * oy + oz * oz >= threshold * threshold) continue;
+
+				bool isListed = false;
+				for (uint32_t i = tile.first; i < tile.first + tile.count && !isListed; i++)
+				{
+					const Bubble& candidate = field.GetTileBubbles()[i];
+					isListed = candidate.x == bubble.x && candidate.y == bubble.y && candidate.z == bubble.z && candidate.radius == bubble.radius;
+				}
+				if (!isListed) report.missed++;
+			}
+		}
+		report.rays += rays;
+	}
+
+	if (report.rays > 0)
+	{
+		report.binMilliseconds = binMilliseconds / 2.0;
+		report.bruteNanoseconds = bruteNanoseconds / report.rays;
+		report.tileNanoseconds = tileNanoseconds / report.rays;
+		report.bubblesPerRay = static_cast<double>(listed) / report.rays;
+	}
+
+	report.isConsistent = report.strays == 0 && report.missed == 0 && report.mismatchedHits == 0 &&
+		report.maxMergeError <= BUBBLE_CHECK_MERGE_TOLERANCE && report.merges > 0 && report.pops > 0;
+	return report;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Tests
+{
+	struct BubbleFieldReport
+	{
+		uint32_t	bubbles;
+		uint32_t	frames;
+		uint32_t	spawned;			// New bubbles at the vents, the first ones included.
+		uint32_t	merges;
+		uint32_t	pops;
+		float		maxMergeError;		// Largest relative change of volume in a merge.
+		uint32_t	strays;				// Bubble states outside the column from the vents to the surface.
+		double		updateMilliseconds;	// Per frame.
+		double		binMilliseconds;
+		uint32_t	rays;
+		uint32_t	missed;				// Bubbles within the hit threshold of a ray that its tile does not list.
+		uint32_t	mismatchedHits;		// Rays whose nearest bubble differs through the tile.
+		double		bubblesPerRay;		// Listed in the ray's tile, on average.
+		uint32_t	maxPerTile;
+		double		bruteNanoseconds;	// Per ray, nearest bubble of all.
+		double		tileNanoseconds;	// Per ray, nearest bubble of the tile.
+		bool		isConsistent;
+	};
+
+	// Runs count bubbles of a BubbleField for frames at 60 Hz, then bins them and
+	// casts rays through width x height pixels of the canvas, looking down -z and
+	// turned aside, comparing the tiles with all the bubbles.
+	BubbleFieldReport MeasureBubbleField(uint32_t count, uint32_t frames, uint32_t width, uint32_t height,
+		float canvasWidth, float canvasHeight);
+}
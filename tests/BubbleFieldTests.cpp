@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "BubbleField.h"
+#include "BubbleFieldCheck.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const float BUBBLE_TEST_CANVAS_WIDTH = 1.106f;
+	const float BUBBLE_TEST_CANVAS_HEIGHT = 0.63f;
+}
+
+TEST(BubbleField_CountIsKeptThroughMergesAndPops)
+{
+	BubbleField field;
+	field.Reset(512, 7);
+	CHECK(field.GetBubbles().size() == 512);
+	for (int frame = 0; frame < 600; frame++) field.Update(1.0f / 60.0f);
+
+	CHECK(field.GetBubbles().size() == 512);
+	CHECK(field.GetPops() > 0);
+	CHECK(field.GetSpawned() >= 512);
+	CHECK(field.GetMaxMergeError() < 1e-3f);
+
+	bool isInColumn = true;
+	for (const Bubble& bubble : field.GetBubbles())
+	{
+		isInColumn = isInColumn && (bubble.y >= BubbleField::VentY - BubbleField::MaxRadius) &&
+			(bubble.y <= BubbleField::PopY + BubbleField::MaxRadius) &&
+			(bubble.radius >= BubbleField::MinRadius * 0.999f) && (bubble.radius <= BubbleField::MaxRadius);
+	}
+	CHECK(isInColumn);
+}
+
+TEST(BubbleField_TilesCoverTheScreen)
+{
+	BubbleField field;
+	field.Reset(256, 3);
+	const float eye[3] = { -2.0f, -1.8f, 5.0f };
+	const float rotation[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	field.Bin(eye, rotation, BUBBLE_TEST_CANVAS_WIDTH, BUBBLE_TEST_CANVAS_HEIGHT, 8, 5, 0.0f);
+
+	CHECK(field.GetColumns() == 8 && field.GetRows() == 5);
+	CHECK(field.GetTiles().size() == 40);
+	CHECK(field.GetTileIndex(-BUBBLE_TEST_CANVAS_WIDTH * 0.99f, BUBBLE_TEST_CANVAS_HEIGHT * 0.99f) < 40);
+	CHECK(field.GetTileIndex(BUBBLE_TEST_CANVAS_WIDTH * 0.99f, -BUBBLE_TEST_CANVAS_HEIGHT * 0.99f) < 40);
+	CHECK(field.GetTileIndex(-BUBBLE_TEST_CANVAS_WIDTH * 0.99f, 0.0f) != field.GetTileIndex(BUBBLE_TEST_CANVAS_WIDTH * 0.99f, 0.0f));
+
+	size_t listed = 0;
+	for (const BubbleTile& tile : field.GetTiles())
+	{
+		CHECK(tile.first + tile.count <= field.GetTileBubbles().size());
+		listed += tile.count;
+	}
+	CHECK(listed == field.GetTileBubbles().size());
+}
+
+// Two seconds of 1024 bubbles, binned for the marcher's eye looking ahead and
+// turned aside, with a ray through every pixel of a small image. Every bubble a
+// ray comes within the hit threshold of is listed in its tile, so the nearest
+// hit through the tile is the nearest of all, while a ray tests far fewer
+// bubbles than the whole field. Bubbles merged and popped on the way, each
+// merge keeping the volume, and none left the column over the vents.
+TEST(BubbleField_TilesListEveryBubbleARayCanMeet)
+{
+	Tests::BubbleFieldReport report = Tests::MeasureBubbleField(1024, 120, 128, 72, BUBBLE_TEST_CANVAS_WIDTH,
+		BUBBLE_TEST_CANVAS_HEIGHT);
+	CHECK(report.rays == 2 * 128 * 72);
+	CHECK(report.missed == 0);
+	CHECK(report.mismatchedHits == 0);
+	CHECK(report.bubblesPerRay < report.bubbles / 16.0);
+	CHECK(report.merges > 0);
+	CHECK(report.pops > 0);
+	CHECK(report.maxMergeError <= 1e-5f);
+	CHECK(report.strays == 0);
+}
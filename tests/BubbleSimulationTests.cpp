@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "BubbleSimulation.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+TEST(BubbleSimulation_EmissionIsCappedByCapacity)
+{
+	BubbleSimulation simulation(100);
+	simulation.Step(1.0f / 60.0f, 64, 0);
+	CHECK(simulation.GetCount() == 64);
+	simulation.Step(1.0f / 60.0f, 64, 1);
+	CHECK(simulation.GetCount() == 100);
+
+	simulation.Reset();
+	CHECK(simulation.GetCount() == 0);
+}
+
+TEST(BubbleSimulation_EmissionIsDeterministic)
+{
+	Particle a = BubbleSimulation::EmitParticle(3, 42);
+	Particle b = BubbleSimulation::EmitParticle(3, 42);
+	Particle c = BubbleSimulation::EmitParticle(4, 42);
+	CHECK(a.position.x == b.position.x && a.position.y == b.position.y && a.lifetime == b.lifetime);
+	CHECK(a.position.x != c.position.x || a.position.z != c.position.z);
+}
+
+TEST(BubbleSimulation_BubblesRiseAndExpire)
+{
+	BubbleSimulation simulation(4096);
+	for (uint32_t frame = 0; frame < 600; frame++)
+	{
+		simulation.Step(1.0f / 60.0f, 16, frame);
+	}
+	CHECK(simulation.GetCount() > 0);
+	CHECK(simulation.GetCount() < 600 * 16);
+
+	const ParticleStore& particles = simulation.GetParticles();
+	bool isAlive = true;
+	bool isRising = true;
+	for (size_t i = 0; i < particles.GetCount(); i++)
+	{
+		isAlive = isAlive && (particles.GetAge()[i] < particles.GetLifetime()[i]) && (particles.GetY()[i] < 12.0f);
+		isRising = isRising && (particles.GetVelocityY()[i] > 0.0f);
+	}
+	CHECK(isAlive);
+	CHECK(isRising);
+}
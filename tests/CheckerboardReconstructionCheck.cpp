@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "CheckerboardReconstructionCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Canvas of P01, and where the floor and the background lie.
+	const float CHECKER_CANVAS_WIDTH = 1.11f;
+	const float CHECKER_CANVAS_HEIGHT = 0.63f;
+	const float CHECKER_FLOOR_Y = -2.0f;
+	const float CHECKER_BACKGROUND_DISTANCE = 100.0f;
+
+	const uint32_t CHECKER_BUBBLE_COUNT = 5;
+	const float CHECKER_BUBBLES[CHECKER_BUBBLE_COUNT][4] =
+	{
+		{ -1.5f, -1.5f, -6.0f, 0.6f },
+		{ 0.5f, -1.0f, -8.0f, 0.8f },
+		{ 2.0f, -1.8f, -5.0f, 0.4f },
+		{ -0.5f, -0.5f, -4.0f, 0.3f },
+		{ 3.0f, -0.8f, -9.0f, 0.7f },
+	};
+	const float CHECKER_RASTER_SPHERE[4] = { 1.0f, -0.8f, -4.5f, 0.6f };
+
+	struct SyntheticSample
+	{
+		float	color[3];
+		float	distance;
+		float	end;
+	};
+
+	float SphereDistance(const float direction[3], const float sphere[4], float rise)
+	{
+		float center[3] = { sphere[0], sphere[1] + rise, sphere[2] };
+		float b = direction[0] * center[0] + direction[1] * center[1] + direction[2] * center[2];
+		float c = center[0] * center[0] + center[1] * center[1] + center[2] * center[2] - sphere[3] * sphere[3];
+		float discriminant = b * b - c;
+		if (discriminant < 0.0f) return std::numeric_limits<float>::infinity();
+		float distance = b - std::sqrt(discriminant);
+		return distance > 0.0f ? distance : std::numeric_limits<float>::infinity();
+	}
+
+	// Colour and distance of the ray from the origin, and the raster object's distance.
+	SyntheticSample TraceSynthetic(const float direction[3], float rise)
+	{
+		SyntheticSample sample = { { 0.0f, 0.0f, 0.0f }, CHECKER_BACKGROUND_DISTANCE, std::numeric_limits<float>::infinity() };
+
+		// Water behind everything, darker downwards.
+		float up = 0.5f + 0.5f * direction[1];
+		sample.color[0] = 0.02f + 0.1f * up;
+		sample.color[1] = 0.1f + 0.2f * up;
+		sample.color[2] = 0.2f + 0.3f * up;
+
+		if (direction[1] < 0.0f)
+		{
+			float distance = CHECKER_FLOOR_Y / direction[1];
+			if (distance < sample.distance)
+			{
+				float x = direction[0] * distance;
+				float z = direction[2] * distance;
+				float pattern = 0.6f + 0.2f * std::sin(x * 3.0f) * std::sin(z * 3.0f);
+				float fog = std::min(distance / 30.0f, 1.0f);
+				for (int c = 0; c < 3; c++)
+				{
+					sample.color[c] = pattern * (1.0f - fog) + sample.color[c] * fog;
+				}
+				sample.distance = distance;
+			}
+		}
+
+		for (uint32_t i = 0; i < CHECKER_BUBBLE_COUNT; i++)
+		{
+			float distance = SphereDistance(direction, CHECKER_BUBBLES[i], rise);
+			if (distance < sample.distance)
+			{
+				float normal[3];
+				for (int c = 0; c < 3; c++)
+				{
+					float center = CHECKER_BUBBLES[i][c] + (c == 1 ? rise : 0.0f);
+					normal[c] = (direction[c] * distance - center) / CHECKER_BUBBLES[i][3];
+				}
+				sample.color[0] = 0.5f + 0.5f * normal[0];
+				sample.color[1] = 0.5f + 0.5f * normal[1];
+				sample.color[2] = 0.7f + 0.3f * normal[2];
+				sample.distance = distance;
+			}
+		}
+
+		sample.end = SphereDistance(direction, CHECKER_RASTER_SPHERE, 0.0f);
+		return sample;
+	}
+
+	// Unit direction in view space of the ray through a point of the image, as
+	// CheckerboardReconstruction computes it.
+	void ViewDirection(const CheckerboardView& view, uint32_t width, uint32_t height, float x, float y, float viewDirection[3])
+	{
+		viewDirection[0] = (x / width * 2.0f - 1.0f) * view.canvasWidth;
+		viewDirection[1] = (1.0f - y / height * 2.0f) * view.canvasHeight;
+		viewDirection[2] = -1.0f;
+		float length = std::sqrt(viewDirection[0] * viewDirection[0] + viewDirection[1] * viewDirection[1] + 1.0f);
+		for (int c = 0; c < 3; c++) viewDirection[c] /= length;
+	}
+}
+
+CheckerboardView Tests::SyntheticCheckerboardView(float yaw)
+{
+	float pitch = 0.1f * std::sin(yaw * 3.0f);
+	float cy = std::cos(yaw), sy = std::sin(yaw);
+	float cp = std::cos(pitch), sp = std::sin(pitch);
+
+	// Pitch after yaw, world to view.
+	CheckerboardView view = { { cy, 0.0f, -sy, sy * sp, cp, cy * sp, sy * cp, -sp, cy * cp },
+		CHECKER_CANVAS_WIDTH, CHECKER_CANVAS_HEIGHT };
+	return view;
+}
+
+void Tests::RenderSyntheticCheckerboard(uint32_t width, uint32_t height, const CheckerboardView& view, float rise, uint32_t parity,
+	CheckerboardImage& image, std::vector<float>& ends)
+{
+	image.width = width;
+	image.height = height;
+	image.colors.assign(width * height * 3, 0.0f);
+	image.distances.assign(width * height, 0.0f);
+	image.covered.assign(width * height, 0);
+	ends.assign(width * height, std::numeric_limits<float>::infinity());
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t pixel = y * width + x;
+
+			float viewDirection[3];
+			ViewDirection(view, width, height, x + 0.5f, y + 0.5f, viewDirection);
+			float direction[3];
+			for (int j = 0; j < 3; j++)
+			{
+				direction[j] = view.rotation[j] * viewDirection[0] + view.rotation[3 + j] * viewDirection[1] + view.rotation[6 + j] * viewDirection[2];
+			}
+
+			SyntheticSample sample = TraceSynthetic(direction, rise);
+			ends[pixel] = sample.end;
+			if (parity != 2 && ((x + y) & 1) != parity) continue;
+
+			if (sample.end <= sample.distance)
+			{
+				image.covered[pixel] = 1;
+				continue;
+			}
+			std::copy(sample.color, sample.color + 3, &image.colors[pixel * 3]);
+			image.distances[pixel] = sample.distance;
+		}
+	}
+}
+
+double Tests::CheckerboardSquaredError(const CheckerboardImage& a, const CheckerboardImage& b)
+{
+	double sum = 0.0;
+	for (size_t pixel = 0; pixel < a.covered.size(); pixel++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			double ca = a.covered[pixel] ? 0.0 : a.colors[pixel * 3 + c];
+			double cb = b.covered[pixel] ? 0.0 : b.colors[pixel * 3 + c];
+			sum += (ca - cb) * (ca - cb);
+		}
+	}
+	return sum;
+}
+
+Tests::CheckerboardErrorReport Tests::MeasureCheckerboardError(uint32_t width, uint32_t height, uint32_t frames,
+	float turnPerFrame, float risePerFrame)
+{
+	CheckerboardErrorReport report = { 0, 0.0, 0.0, 0.0, 0.0 };
+	if (frames < 2) return report;
+
+	CheckerboardImage full, traced, resolved, history, spatial;
+	CheckerboardImage noHistory = { 0, 0, {}, {}, {} };
+	CheckerboardView previousView = SyntheticCheckerboardView(0.0f);
+	std::vector<float> ends;
+	double squaredError = 0.0;
+	double spatialSquaredError = 0.0;
+	uint64_t rejected = 0;
+
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		uint32_t parity = frame & 1;
+		CheckerboardView view = SyntheticCheckerboardView(frame * turnPerFrame);
+		RenderSyntheticCheckerboard(width, height, view, frame * risePerFrame, parity, traced, ends);
+
+		rejected += CheckerboardReconstruction::Reconstruct(traced, parity, view, ends, frame == 0 ? noHistory : history, previousView, resolved);
+		CheckerboardReconstruction::Reconstruct(traced, parity, view, ends, noHistory, view, spatial);
+
+		if (frame > 0)
+		{
+			RenderSyntheticCheckerboard(width, height, view, frame * risePerFrame, 2, full, ends);
+			squaredError += CheckerboardSquaredError(resolved, full);
+			spatialSquaredError += CheckerboardSquaredError(spatial, full);
+		}
+		history = resolved;
+		previousView = view;
+	}
+
+	double samples = 3.0 * width * height * (frames - 1);
+	report.frames = frames - 1;
+	report.rmse = std::sqrt(squaredError / samples);
+	report.psnr = report.rmse > 0.0 ? 20.0 * std::log10(1.0 / report.rmse) : 99.0;
+	report.spatialRmse = std::sqrt(spatialSquaredError / samples);
+	report.rejectedShare = static_cast<double>(rejected) / (0.5 * width * height * (frames - 1));
+	return report;
+}
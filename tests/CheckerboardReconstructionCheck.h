@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CheckerboardReconstruction.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Tests
+{
+	// A synthetic scene for the checkerboard: a patterned floor, rising bubbles and
+	// one sphere standing in for a raster object, seen from the origin with the
+	// canvas of P01.
+
+	// The camera turned by yaw radians, nodding a little with it.
+	_202219807_ACW_700119_D3D11_UWP_APP::CheckerboardView SyntheticCheckerboardView(float yaw);
+
+	// Renders the pixels of one parity as the marcher would, or all of them for
+	// parity 2, with the bubbles risen by rise. ends receives the distance of the
+	// raster sphere along every ray.
+	void RenderSyntheticCheckerboard(uint32_t width, uint32_t height,
+		const _202219807_ACW_700119_D3D11_UWP_APP::CheckerboardView& view, float rise, uint32_t parity,
+		_202219807_ACW_700119_D3D11_UWP_APP::CheckerboardImage& image, std::vector<float>& ends);
+
+	// Squared colour difference summed over all pixels; covered pixels show black.
+	double CheckerboardSquaredError(const _202219807_ACW_700119_D3D11_UWP_APP::CheckerboardImage& a,
+		const _202219807_ACW_700119_D3D11_UWP_APP::CheckerboardImage& b);
+
+	struct CheckerboardErrorReport
+	{
+		uint32_t	frames;				// Frames reconstructed after the first.
+		double		rmse;				// Colour error against full rendering, over all pixels.
+		double		psnr;
+		double		spatialRmse;		// The same with the neighbour average alone, for comparison.
+		double		rejectedShare;		// Share of reconstructed pixels whose history was rejected.
+	};
+
+	// Renders frames of the scene fully and with checkerboarding, and compares the
+	// two. The camera turns by turnPerFrame radians and the bubbles rise by
+	// risePerFrame every frame.
+	CheckerboardErrorReport MeasureCheckerboardError(uint32_t width, uint32_t height, uint32_t frames,
+		float turnPerFrame, float risePerFrame);
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "CheckerboardReconstruction.h"
+#include "CheckerboardReconstructionCheck.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Image size and sequence length of the synthetic scene, and how fast the
+	// camera turns and the bubbles rise in it.
+	const uint32_t CHECKER_TEST_WIDTH = 320;
+	const uint32_t CHECKER_TEST_HEIGHT = 180;
+	const uint32_t CHECKER_TEST_FRAMES = 32;
+	const float CHECKER_TEST_TURN = 0.001f;
+	const float CHECKER_TEST_RISE = 0.005f;
+
+	const CheckerboardImage CHECKER_TEST_NO_HISTORY = { 0, 0, {}, {}, {} };
+
+	struct SequenceError
+	{
+		double	squaredError;			// Checkerboarded against full rendering, over all frames after the first.
+		double	spatialSquaredError;	// The same with the neighbours alone.
+		double	samples;
+	};
+
+	// Checkerboards the synthetic scene frame by frame, and compares every
+	// reconstructed frame, and the same frame filled from its neighbours alone,
+	// with the fully rendered one.
+	SequenceError RunSequence(float turnPerFrame, float risePerFrame)
+	{
+		SequenceError error = { 0.0, 0.0, 0.0 };
+		CheckerboardImage traced, resolved, spatial, full, history;
+		CheckerboardView previousView = Tests::SyntheticCheckerboardView(0.0f);
+		std::vector<float> ends;
+
+		for (uint32_t frame = 0; frame < CHECKER_TEST_FRAMES; frame++)
+		{
+			uint32_t parity = frame & 1;
+			CheckerboardView view = Tests::SyntheticCheckerboardView(frame * turnPerFrame);
+			Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, frame * risePerFrame, parity, traced, ends);
+			CheckerboardReconstruction::Reconstruct(traced, parity, view, ends, frame == 0 ? CHECKER_TEST_NO_HISTORY : history,
+				previousView, resolved);
+			CheckerboardReconstruction::Reconstruct(traced, parity, view, ends, CHECKER_TEST_NO_HISTORY, view, spatial);
+
+			if (frame > 0)
+			{
+				Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, frame * risePerFrame, 2, full, ends);
+				error.squaredError += Tests::CheckerboardSquaredError(resolved, full);
+				error.spatialSquaredError += Tests::CheckerboardSquaredError(spatial, full);
+				error.samples += 3.0 * CHECKER_TEST_WIDTH * CHECKER_TEST_HEIGHT;
+			}
+			history = resolved;
+			previousView = view;
+		}
+		return error;
+	}
+
+	double Psnr(double squaredError, double samples)
+	{
+		return 20.0 * std::log10(1.0 / std::sqrt(squaredError / samples));
+	}
+}
+
+// Traced pixels are kept as they are, and over a flat image with a still
+// camera the others are filled with the same colour.
+TEST(CheckerboardReconstruction_KeepsTracedPixels)
+{
+	const uint32_t width = 16;
+	const uint32_t height = 8;
+	const float color[3] = { 0.25f, 0.5f, 0.75f };
+	CheckerboardImage traced = { width, height, std::vector<float>(width * height * 3), std::vector<float>(width * height, 10.0f),
+		std::vector<uint8_t>(width * height, 0) };
+	for (size_t i = 0; i < traced.colors.size(); i++) traced.colors[i] = color[i % 3];
+
+	CheckerboardView view = { { 1, 0, 0, 0, 1, 0, 0, 0, 1 }, 1.0f, 0.5f };
+	CheckerboardImage resolved;
+	std::vector<float> ends(width * height, 50.0f);
+	CheckerboardReconstruction::Reconstruct(traced, 0, view, ends, traced, view, resolved);
+
+	CHECK(resolved.width == width && resolved.height == height);
+	bool isFlat = true;
+	for (size_t i = 0; i < resolved.colors.size(); i++) isFlat = isFlat && Tests::IsNear(resolved.colors[i], color[i % 3], 1e-6);
+	CHECK(isFlat);
+}
+
+// With the camera turning and the bubbles rising, the pixels marched this
+// frame come out of the reconstruction exactly as they went in.
+TEST(CheckerboardReconstruction_LeavesMarchedPixelsAlone)
+{
+	CheckerboardImage traced, resolved, history;
+	CheckerboardView previousView = Tests::SyntheticCheckerboardView(0.0f);
+	std::vector<float> ends;
+
+	bool isUnchanged = true;
+	for (uint32_t frame = 0; frame < 4; frame++)
+	{
+		uint32_t parity = frame & 1;
+		CheckerboardView view = Tests::SyntheticCheckerboardView(frame * CHECKER_TEST_TURN);
+		Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, frame * CHECKER_TEST_RISE, parity, traced, ends);
+		CheckerboardReconstruction::Reconstruct(traced, parity, view, ends, frame == 0 ? CHECKER_TEST_NO_HISTORY : history,
+			previousView, resolved);
+
+		for (uint32_t y = 0; y < CHECKER_TEST_HEIGHT; y++)
+		{
+			for (uint32_t x = (y + parity) & 1; x < CHECKER_TEST_WIDTH; x += 2)
+			{
+				uint32_t pixel = y * CHECKER_TEST_WIDTH + x;
+				isUnchanged = isUnchanged && resolved.covered[pixel] == traced.covered[pixel] &&
+					resolved.distances[pixel] == traced.distances[pixel] &&
+					std::equal(&traced.colors[pixel * 3], &traced.colors[pixel * 3 + 3], &resolved.colors[pixel * 3]);
+			}
+		}
+		history = resolved;
+		previousView = view;
+	}
+	CHECK(isUnchanged);
+}
+
+// A still camera over a still scene: the second frame takes the other half of
+// the pixels from the first, so all but the pixels along silhouettes, where
+// the history is clamped to the neighbours, match full rendering.
+TEST(CheckerboardReconstruction_StillCameraRebuildsTheFullImage)
+{
+	CheckerboardView view = Tests::SyntheticCheckerboardView(0.0f);
+	CheckerboardImage first, second, resolved, full;
+	std::vector<float> ends;
+	Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, 0.0f, 0, first, ends);
+	Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, 0.0f, 1, second, ends);
+	Tests::RenderSyntheticCheckerboard(CHECKER_TEST_WIDTH, CHECKER_TEST_HEIGHT, view, 0.0f, 2, full, ends);
+
+	CheckerboardImage history;
+	CheckerboardReconstruction::Reconstruct(first, 0, view, ends, CHECKER_TEST_NO_HISTORY, view, history);
+	CheckerboardReconstruction::Reconstruct(second, 1, view, ends, history, view, resolved);
+
+	uint32_t differing = 0;
+	for (size_t pixel = 0; pixel < full.covered.size(); pixel++)
+	{
+		bool isSame = resolved.covered[pixel] == full.covered[pixel];
+		for (int c = 0; c < 3 && isSame && !full.covered[pixel]; c++)
+		{
+			isSame = std::abs(resolved.colors[pixel * 3 + c] - full.colors[pixel * 3 + c]) <= 1.0e-5f;
+		}
+		if (!isSame) differing++;
+	}
+	CHECK(differing < full.covered.size() / 100);
+}
+
+// Bubbles rising before a still camera, and before one turning slowly: the
+// reconstructed frames are closer to full rendering than filling the missing
+// pixels from their neighbours alone.
+TEST(CheckerboardReconstruction_StillCameraBeatsNeighbours)
+{
+	SequenceError error = RunSequence(0.0f, CHECKER_TEST_RISE);
+	CHECK(error.squaredError < error.spatialSquaredError);
+	CHECK(Psnr(error.squaredError, error.samples) > 30.0);
+}
+
+TEST(CheckerboardReconstruction_TurningCameraBeatsNeighbours)
+{
+	SequenceError error = RunSequence(CHECKER_TEST_TURN, CHECKER_TEST_RISE);
+	CHECK(error.squaredError < error.spatialSquaredError);
+	CHECK(Psnr(error.squaredError, error.samples) > 25.0);
+}
@@ -0,0 +1,60 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "CoralGenerator.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+using namespace DirectX;
+
+namespace
+{
+	std::vector<CoralTriangle> MakeSeed()
+	{
+		const VertexPositionColorNormal vertices[] =
+		{
+			{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+			{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+			{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+			{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		};
+		const unsigned short indices[] = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
+
+		std::vector<CoralTriangle> seed;
+		CoralSubdivision::BuildSeedTriangles(vertices, indices, 12, XMFLOAT3(0.0f, 0.0f, 0.0f), seed);
+		return seed;
+	}
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m = {};
+		m._11 = m._22 = m._33 = m._44 = 1.0f;
+		return m;
+	}
+}
+
+TEST(CoralGenerator_SameSeedGivesSameCoral)
+{
+	std::vector<CoralTriangle> seed = MakeSeed();
+	std::vector<CoralTriangle> first;
+	std::vector<CoralTriangle> second;
+	std::vector<CoralTriangle> other;
+
+	CoralGeneratorStatistics a = CoralGenerator::Generate(seed, Identity(), 6, 1234, first);
+	CoralGeneratorStatistics b = CoralGenerator::Generate(seed, Identity(), 6, 1234, second);
+	CoralGeneratorStatistics c = CoralGenerator::Generate(seed, Identity(), 6, 4321, other);
+
+	CHECK(a.triangleCount == CoralSubdivision::GetTriangleCount(seed.size(), 6));
+	CHECK(first.size() == a.triangleCount);
+	CHECK(a.checksum == b.checksum);
+	CHECK(a.checksum == CoralGenerator::Checksum(first));
+	CHECK(c.checksum != a.checksum);
+}
+
+TEST(CoralGenerator_ZeroLevelsReturnsTheSeed)
+{
+	std::vector<CoralTriangle> seed = MakeSeed();
+	std::vector<CoralTriangle> output;
+	CoralGenerator::Generate(seed, Identity(), 0, 7, output);
+
+	CHECK(output.size() == seed.size());
+	CHECK(CoralGenerator::Checksum(output) == CoralGenerator::Checksum(seed));
+}
@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "CoralSubdivision.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+using namespace DirectX;
+
+namespace
+{
+	const VertexPositionColorNormal CORAL_TEST_VERTICES[] =
+	{
+		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) },
+	};
+
+	const unsigned short CORAL_TEST_INDICES[] = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
+
+	XMFLOAT4X4 Translation(float x, float y, float z)
+	{
+		XMFLOAT4X4 m = {};
+		m._11 = m._22 = m._33 = m._44 = 1.0f;
+		m._41 = x;
+		m._42 = y;
+		m._43 = z;
+		return m;
+	}
+
+	float Sign(float a)
+	{
+		return (a > 0.0f) ? 1.0f : ((a < 0.0f) ? -1.0f : 0.0f);
+	}
+}
+
+TEST(CoralSubdivision_TriangleCountTriplesPerLevel)
+{
+	CHECK(CoralSubdivision::GetTriangleCount(12, 0) == 12);
+	CHECK(CoralSubdivision::GetTriangleCount(12, 1) == 36);
+	CHECK(CoralSubdivision::GetTriangleCount(12, 5) == 12 * 243);
+
+	std::vector<CoralTriangle> seed;
+	CoralSubdivision::BuildSeedTriangles(CORAL_TEST_VERTICES, CORAL_TEST_INDICES, 12, XMFLOAT3(0.0f, 0.0f, 0.0f), seed);
+	CHECK(seed.size() == 4);
+
+	std::vector<CoralTriangle> output;
+	CoralSubdivision::Subdivide(seed, Translation(0.0f, 0.0f, 0.0f), 4, output);
+	CHECK(output.size() == CoralSubdivision::GetTriangleCount(seed.size(), 4));
+}
+
+// P04 used to move the cube in its vertex shader and colour it by where it
+// ended up. Moving the seed by the offset or placing it with the world matrix
+// must give the same colours, as the shaders take them from world space.
+TEST(CoralSubdivision_ColoursFollowWorldPosition)
+{
+	const XMFLOAT3 offset(-20.0f, -4.0f, -20.0f);
+
+	std::vector<CoralTriangle> moved;
+	CoralSubdivision::BuildSeedTriangles(CORAL_TEST_VERTICES, CORAL_TEST_INDICES, 12, offset, moved);
+	std::vector<CoralTriangle> placed;
+	CoralSubdivision::BuildSeedTriangles(CORAL_TEST_VERTICES, CORAL_TEST_INDICES, 12, XMFLOAT3(0.0f, 0.0f, 0.0f), placed);
+
+	std::vector<CoralTriangle> movedOutput;
+	CoralSubdivision::Subdivide(moved, Translation(0.0f, 0.0f, 0.0f), 3, movedOutput);
+	std::vector<CoralTriangle> placedOutput;
+	CoralSubdivision::Subdivide(placed, Translation(offset.x, offset.y, offset.z), 3, placedOutput);
+
+	CHECK(movedOutput.size() == placedOutput.size());
+	bool isSameColour = true;
+	bool isMovedByOffset = true;
+	for (size_t t = 0; t < movedOutput.size() && t < placedOutput.size(); t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			const CoralVertex& a = movedOutput[t].vertices[c];
+			const CoralVertex& b = placedOutput[t].vertices[c];
+			isSameColour = isSameColour && (a.color.x == b.color.x) && (a.color.y == b.color.y) &&
+				(a.color.z == b.color.z) && (a.color.w == b.color.w);
+			isMovedByOffset = isMovedByOffset && Tests::IsNear(a.pos.x, b.pos.x + offset.x, 1e-4) &&
+				Tests::IsNear(a.pos.y, b.pos.y + offset.y, 1e-4) && Tests::IsNear(a.pos.z, b.pos.z + offset.z, 1e-4);
+		}
+	}
+	CHECK(isSameColour);
+	CHECK(isMovedByOffset);
+
+	// All of the coral lies at negative x and y, so it is blue, as it was.
+	CHECK(movedOutput[0].vertices[0].color.x == 0.0f);
+	CHECK(movedOutput[0].vertices[0].color.y == 0.0f);
+	CHECK(movedOutput[0].vertices[0].color.z == 1.0f);
+}
+
+TEST(CoralSubdivision_SplitsAtMidpointsAndExtrudesCorners)
+{
+	std::vector<CoralTriangle> seed;
+	CoralSubdivision::BuildSeedTriangles(CORAL_TEST_VERTICES, CORAL_TEST_INDICES, 12, XMFLOAT3(0.0f, 0.0f, 0.0f), seed);
+
+	CoralTriangle flat[3];
+	CoralSubdivision::SubdivideTriangle(seed[0], Translation(0.5f, -3.0f, 0.0f), flat, 0.0f);
+
+	const XMFLOAT3& p0 = seed[0].vertices[0].pos;
+	const XMFLOAT3& p1 = seed[0].vertices[1].pos;
+	CHECK_NEAR(flat[0].vertices[1].pos.x, (p0.x + p1.x) / 2.0f, 1e-6);
+	CHECK_NEAR(flat[0].vertices[1].pos.y, (p0.y + p1.y) / 2.0f, 1e-6);
+	CHECK_NEAR(flat[0].vertices[0].pos.x, p0.x, 1e-6);
+	CHECK_NEAR(flat[1].vertices[1].pos.y, p1.y, 1e-6);
+
+	float expectedRed = (Sign(p0.x + 0.5f) + 1.0f) / 2.0f;
+	float expectedGreen = (Sign(p0.y - 3.0f) + 1.0f) / 2.0f;
+	CHECK(flat[2].vertices[2].color.x == expectedRed);
+	CHECK(flat[2].vertices[2].color.y == expectedGreen);
+
+	CoralTriangle extruded[3];
+	CoralSubdivision::SubdivideTriangle(seed[0], Translation(0.0f, 0.0f, 0.0f), extruded, 1.0f);
+	const XMFLOAT3& a = extruded[0].vertices[0].pos;
+	float moved = sqrtf((a.x - p0.x) * (a.x - p0.x) + (a.y - p0.y) * (a.y - p0.y) + (a.z - p0.z) * (a.z - p0.z));
+	CHECK_NEAR(moved, 1.0, 1e-5);
+}
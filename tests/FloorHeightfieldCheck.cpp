@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "FloorHeightfieldCheck.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Constants of the ray marcher in P01_Scene.hlsli.
+	const uint32_t FLOOR_MAX_MARCHING_STEPS = 255;
+	const float FLOOR_MIN_DIST = 0.1f;
+	const float FLOOR_MAX_DIST = 50.0f;
+	const float FLOOR_EYE[3] = { -2.0f, -1.8f, 5.0f };
+
+	// Distance an intersector hit may lie behind the sphere tracer's, which stops
+	// up to its epsilon short of the surface, and the largest vertical miss of a
+	// hit. A sphere tracer hit is only counted against the intersector if the ray
+	// really dips below the surface before, checked in FLOOR_CHECK_STEP increments:
+	// a grazing ray also stops the sphere tracer where it passes within epsilon.
+	const float FLOOR_LATE_TOLERANCE = 0.05f;
+	const float FLOOR_CHECK_STEP = 0.01f;
+	const float FLOOR_SURFACE_TOLERANCE = 0.01f;
+
+	void Point(const FloorRay& ray, float t, float p[3])
+	{
+		for (int i = 0; i < 3; i++) p[i] = ray.origin[i] + ray.direction[i] * t;
+	}
+
+	bool CrossesBefore(const FloorHeightfield& floor, const FloorRay& ray, float distance)
+	{
+		for (float t = FLOOR_MIN_DIST; t < distance; t += FLOOR_CHECK_STEP)
+		{
+			float p[3];
+			Point(ray, t, p);
+			if (p[1] <= floor.SurfaceY(p[0], p[2])) return true;
+		}
+		return false;
+	}
+}
+
+Tests::FloorStepReport Tests::MeasureFloorSteps(const FloorHeightfield& floor, uint32_t width, uint32_t height,
+	float canvasWidth, float canvasHeight)
+{
+	FloorStepReport report = {};
+	uint64_t sphereSteps = 0, heightfieldSteps = 0, heightfieldEvaluations = 0;
+
+	for (uint32_t row = 0; row < height; row++)
+	{
+		for (uint32_t column = 0; column < width; column++)
+		{
+			// Canvas coordinates at the pixel centre, as P01_VS.hlsl interpolates them.
+			float u = ((column + 0.5f) / width * 2.0f - 1.0f) * canvasWidth;
+			float v = (1.0f - (row + 0.5f) / height * 2.0f) * canvasHeight;
+			float length = sqrtf(u * u + v * v + 1.0f);
+			FloorRay ray = { { FLOOR_EYE[0], FLOOR_EYE[1], FLOOR_EYE[2] }, { u / length, v / length, -1.0f / length } };
+
+			FloorHit sphere = floor.SphereTrace(ray, FLOOR_MIN_DIST, FLOOR_MAX_DIST);
+			FloorHit walk = floor.Intersect(ray, FLOOR_MIN_DIST, FLOOR_MAX_DIST);
+			sphereSteps += sphere.steps;
+			heightfieldSteps += walk.steps;
+			heightfieldEvaluations += walk.evaluations;
+			report.rays++;
+
+			if (sphere.steps >= FLOOR_MAX_MARCHING_STEPS) report.sphereOutOfSteps++;
+			if (walk.isHit)
+			{
+				report.hits++;
+				float p[3];
+				Point(ray, walk.distance, p);
+				report.maxSurfaceError = std::max(report.maxSurfaceError, fabsf(p[1] - floor.SurfaceY(p[0], p[2])));
+			}
+			if (sphere.isHit && (!walk.isHit || walk.distance > sphere.distance + FLOOR_LATE_TOLERANCE) &&
+				CrossesBefore(floor, ray, walk.distance - FLOOR_LATE_TOLERANCE)) report.lateHits++;
+		}
+	}
+
+	if (report.rays > 0)
+	{
+		report.sphereStepsPerRay = static_cast<double>(sphereSteps) / report.rays;
+		report.heightfieldStepsPerRay = static_cast<double>(heightfieldSteps) / report.rays;
+		report.heightfieldEvaluationsPerRay = static_cast<double>(heightfieldEvaluations) / report.rays;
+	}
+	report.isConsistent = report.lateHits == 0 && report.maxSurfaceError <= FLOOR_SURFACE_TOLERANCE;
+	return report;
+}
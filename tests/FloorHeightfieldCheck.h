@@ -0,0 +1,28 @@
+#pragma once
+
+#include "FloorHeightfield.h"
+
+#include <cstdint>
+
+namespace Tests
+{
+	struct FloorStepReport
+	{
+		uint32_t	rays;
+		uint32_t	hits;					// Rays the heightfield intersector hit.
+		double		sphereStepsPerRay;
+		double		heightfieldStepsPerRay;
+		double		heightfieldEvaluationsPerRay;
+		uint32_t	sphereOutOfSteps;		// Rays the sphere tracer gave up on.
+		uint32_t	lateHits;				// Rays the intersector hit later than the ray crosses the surface, or missed.
+		float		maxSurfaceError;		// Largest height of an intersector hit above or below the surface.
+		bool		isConsistent;
+	};
+
+	// Casts a width x height grid of rays from the fixed P01 eye, looking down -z
+	// as with the start camera, through both methods of the floor. The canvas
+	// coordinates of P01_VS.hlsl reach +-canvasWidth and +-canvasHeight at the
+	// screen edges.
+	FloorStepReport MeasureFloorSteps(const _202219807_ACW_700119_D3D11_UWP_APP::FloorHeightfield& floor,
+		uint32_t width, uint32_t height, float canvasWidth, float canvasHeight);
+}
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "FloorHeightfieldCheck.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Canvas extents of P01 with the start camera's projection at 16:9.
+	const float FLOOR_TEST_CANVAS_WIDTH = 1.106f;
+	const float FLOOR_TEST_CANVAS_HEIGHT = 0.63f;
+
+	const FloorHeightfield& GetFloor()
+	{
+		static FloorHeightfield floor;
+		static bool isBuilt = false;
+		if (!isBuilt)
+		{
+			floor.Build();
+			isBuilt = true;
+		}
+		return floor;
+	}
+}
+
+// Each level of the pyramid bounds the four cells under it.
+TEST(FloorHeightfield_PyramidBoundsItsChildren)
+{
+	const FloorHeightfield& floor = GetFloor();
+	CHECK(floor.GetHeights().size() == static_cast<size_t>(FloorHeightfield::Resolution + 1) * (FloorHeightfield::Resolution + 1));
+	CHECK(floor.GetLevelCount() > 1);
+
+	bool isBounded = true;
+	for (uint32_t level = 1; level < floor.GetLevelCount(); level++)
+	{
+		uint32_t cells = FloorHeightfield::Resolution >> level;
+		for (uint32_t row = 0; row < cells; row += 7)
+		{
+			for (uint32_t column = 0; column < cells; column += 5)
+			{
+				float lowest, highest;
+				floor.GetSurfaceBounds(level, column, row, lowest, highest);
+				for (uint32_t child = 0; child < 4; child++)
+				{
+					float childLowest, childHighest;
+					floor.GetSurfaceBounds(level - 1, column * 2 + (child & 1), row * 2 + (child >> 1), childLowest, childHighest);
+					isBounded = isBounded && (lowest <= childLowest) && (highest >= childHighest);
+				}
+			}
+		}
+	}
+	CHECK(isBounded);
+}
+
+TEST(FloorHeightfield_IntersectionLandsOnTheSurface)
+{
+	const FloorHeightfield& floor = GetFloor();
+	FloorRay ray = { { -2.0f, -1.8f, 5.0f }, { 0.0f, -0.5f, -1.0f } };
+	float length = sqrtf(0.25f + 1.0f);
+	ray.direction[1] /= length;
+	ray.direction[2] /= length;
+
+	FloorHit hit = floor.Intersect(ray, 0.1f, 50.0f);
+	FloorHit traced = floor.SphereTrace(ray, 0.1f, 50.0f);
+	CHECK(hit.isHit);
+	CHECK(traced.isHit);
+	CHECK(hit.evaluations <= traced.evaluations);
+
+	float x = ray.origin[0] + ray.direction[0] * hit.distance;
+	float y = ray.origin[1] + ray.direction[1] * hit.distance;
+	float z = ray.origin[2] + ray.direction[2] * hit.distance;
+	CHECK_NEAR(y, floor.SurfaceY(x, z), 0.01);
+}
+
+// Over the rays of the P01 start camera the intersector finds every surface
+// crossing the sphere tracer does, lands on the surface, and evaluates it fewer
+// times than sphere tracing steps.
+TEST(FloorHeightfield_StepsFewerThanSphereTracing)
+{
+	Tests::FloorStepReport report = Tests::MeasureFloorSteps(GetFloor(), 96, 54, FLOOR_TEST_CANVAS_WIDTH, FLOOR_TEST_CANVAS_HEIGHT);
+	CHECK(report.rays == 96 * 54);
+	CHECK(report.hits > 0);
+	CHECK(report.lateHits == 0);
+	CHECK(report.maxSurfaceError <= 0.01f);
+	CHECK(report.heightfieldEvaluationsPerRay < report.sphereStepsPerRay);
+}
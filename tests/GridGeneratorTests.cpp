@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "GridGenerator.h"
+#include "MeshOptimizer.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+TEST(GridGenerator_CountsFollowResolution)
+{
+	for (uint32_t resolution : { 2u, 100u, 257u })
+	{
+		GridMesh mesh;
+		GridGenerator::BuildSphereGrid(resolution, mesh);
+		CHECK(mesh.vertices.size() == static_cast<size_t>(resolution) * resolution);
+		CHECK(mesh.indices.size() == static_cast<size_t>(resolution - 1) * (resolution - 1) * 6);
+
+		bool isInRange = true;
+		for (uint32_t index : mesh.indices) isInRange = isInRange && (index < mesh.vertices.size());
+		CHECK(isInRange);
+	}
+}
+
+TEST(GridGenerator_IndexWidthSwitchesAt16Bits)
+{
+	CHECK(!GridGenerator::RequiresWideIndices(0x10000));
+	CHECK(GridGenerator::RequiresWideIndices(0x10001));
+	CHECK(GridGenerator::GetIndexSize(256 * 256) == sizeof(uint16_t));
+	CHECK(GridGenerator::GetIndexSize(257 * 257) == sizeof(uint32_t));
+
+	GridMesh mesh;
+	GridGenerator::BuildSphereGrid(256, mesh);
+	std::vector<uint16_t> narrow = GridGenerator::NarrowIndices(mesh.indices);
+	bool isSame = (narrow.size() == mesh.indices.size());
+	for (size_t i = 0; isSame && i < narrow.size(); i++) isSame = (narrow[i] == mesh.indices[i]);
+	CHECK(isSame);
+	CHECK(GridGenerator::GetMemoryFootprint(mesh) ==
+		mesh.vertices.size() * sizeof(VertexPositionColor) + mesh.indices.size() * sizeof(uint16_t));
+}
+
+TEST(GridGenerator_OptimizedGridCachesBetter)
+{
+	GridMesh mesh;
+	GridGenerator::BuildSphereGrid(100, mesh);
+	float before = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+
+	GridGenerator::OptimizeSphereGrid(mesh);
+	CHECK(mesh.vertices.size() == 100 * 100);
+	CHECK(MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr < before);
+}
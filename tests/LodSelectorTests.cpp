@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "LodSelector.h"
+
+#include <sstream>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	const LodThresholds LOD_TEST_THRESHOLDS = { 100.0f, 20.0f, 0.1f };
+}
+
+TEST(LodSelector_SelectsByProjectedSize)
+{
+	CHECK(LodSelector::Select(500.0f, LodLevel::Impostor, LOD_TEST_THRESHOLDS) == LodLevel::Full);
+	CHECK(LodSelector::Select(50.0f, LodLevel::Full, LOD_TEST_THRESHOLDS) == LodLevel::Simplified);
+	CHECK(LodSelector::Select(5.0f, LodLevel::Full, LOD_TEST_THRESHOLDS) == LodLevel::Impostor);
+}
+
+// Inside the hysteresis band around a threshold the level stays put, whichever
+// side it came from.
+TEST(LodSelector_HysteresisPreventsPopping)
+{
+	CHECK(LodSelector::Select(95.0f, LodLevel::Full, LOD_TEST_THRESHOLDS) == LodLevel::Full);
+	CHECK(LodSelector::Select(105.0f, LodLevel::Simplified, LOD_TEST_THRESHOLDS) == LodLevel::Simplified);
+	CHECK(LodSelector::Select(89.0f, LodLevel::Full, LOD_TEST_THRESHOLDS) == LodLevel::Simplified);
+	CHECK(LodSelector::Select(111.0f, LodLevel::Simplified, LOD_TEST_THRESHOLDS) == LodLevel::Full);
+
+	LodSelector selector(LOD_TEST_THRESHOLDS);
+	selector.Resize(1);
+	float sizes[] = { 150.0f, 98.0f, 103.0f, 97.0f, 104.0f, 99.0f };
+	selector.BeginFrame();
+	selector.Update(0, sizes[0]);
+	size_t switchesBefore = selector.GetSwitchCount();
+	for (float size : sizes)
+	{
+		selector.BeginFrame();
+		selector.Update(0, size);
+	}
+	CHECK(selector.GetLevel(0) == LodLevel::Full);
+	CHECK(selector.GetSwitchCount() == switchesBefore);
+}
+
+TEST(LodSelector_ProjectedSizeFallsWithDistance)
+{
+	LodView view = { 0.0f, 0.0f, 0.0f, 1000.0f };
+	float near = LodSelector::ProjectedSize(view, 0.0f, 0.0f, -10.0f, 1.0f);
+	float far = LodSelector::ProjectedSize(view, 0.0f, 0.0f, -20.0f, 1.0f);
+	CHECK_NEAR(near, 200.0, 1e-3);
+	CHECK_NEAR(far, 100.0, 1e-3);
+	// Inside the sphere the size stays bounded.
+	CHECK_NEAR(LodSelector::ProjectedSize(view, 0.0f, 0.0f, 0.0f, 1.0f), 2000.0, 1e-3);
+}
+
+TEST(LodSelector_ReportSavesTrianglesAlongCameraPath)
+{
+	LodObjectSet set;
+	set.name = "test";
+	for (int i = 0; i < 64; i++)
+	{
+		set.spheres.push_back({ static_cast<float>(i % 8) * 10.0f - 40.0f, 0.0f, static_cast<float>(i / 8) * -10.0f, 1.0f });
+	}
+	set.thresholds = LOD_TEST_THRESHOLDS;
+	set.triangles[0] = 1000;
+	set.triangles[1] = 100;
+	set.triangles[2] = 2;
+	set.isInstanced = false;
+
+	std::vector<LodReportRow> rows = LodReport::Run({ set }, 1000.0f, 120);
+	CHECK(rows.size() == 120);
+	bool isBounded = true;
+	for (const LodReportRow& row : rows)
+	{
+		isBounded = isBounded && (row.triangles <= row.fullTriangles) && (row.fullTriangles == 64 * 1000) &&
+			(row.counts[0] + row.counts[1] + row.counts[2] == 64);
+	}
+	CHECK(isBounded);
+	CHECK(rows.back().triangles < rows.back().fullTriangles);
+
+	std::ostringstream csv;
+	LodReport::WriteCsv(csv, rows);
+	size_t lines = 0;
+	for (char c : csv.str()) if (c == '\n') lines++;
+	CHECK(lines == rows.size() + 1);
+}
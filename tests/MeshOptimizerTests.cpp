@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Latitude/longitude sphere in the row order P02 built it in.
+	void BuildSphere(uint32_t resolution, std::vector<uint32_t>& indices, std::vector<MeshPosition>& positions)
+	{
+		for (uint32_t i = 0; i < resolution; i++)
+		{
+			for (uint32_t j = 0; j < resolution; j++)
+			{
+				float x = j * 6.2831853f / (resolution - 1);
+				float y = i * 3.1415927f / (resolution - 1);
+				positions.push_back({ sinf(y) * cosf(x), sinf(y) * sinf(x), cosf(y) });
+			}
+		}
+
+		for (uint32_t i = 0; i < resolution - 1; i++)
+		{
+			for (uint32_t j = 0; j < resolution - 1; j++)
+			{
+				uint32_t a = i * resolution + j;
+				uint32_t c = a + resolution;
+				indices.insert(indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+			}
+		}
+	}
+
+	// Triangles rotated to start at their lowest index, which keeps the
+	// winding, and sorted, so two index buffers drawing the same triangles
+	// compare equal.
+	std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+TEST(MeshOptimizer_VertexCacheOrderLowersAcmr)
+{
+	std::vector<uint32_t> indices;
+	std::vector<MeshPosition> positions;
+	BuildSphere(100, indices, positions);
+
+	VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+	std::vector<uint32_t> optimized = indices;
+	MeshOptimizer::OptimizeVertexCache(optimized, positions.size());
+	VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(optimized, positions.size());
+
+	CHECK(CanonicalTriangles(optimized) == CanonicalTriangles(indices));
+	CHECK(after.acmr < before.acmr * 0.8f);
+	CHECK(after.atvr >= 1.0f);
+	CHECK(after.acmr >= 0.5f);
+}
+
+TEST(MeshOptimizer_OverdrawOrderKeepsTrianglesAndCacheGains)
+{
+	std::vector<uint32_t> indices;
+	std::vector<MeshPosition> positions;
+	BuildSphere(64, indices, positions);
+
+	std::vector<uint32_t> optimized = indices;
+	MeshOptimizer::OptimizeVertexCache(optimized, positions.size());
+	float cacheAcmr = MeshOptimizer::AnalyzeVertexCache(optimized, positions.size()).acmr;
+	MeshOptimizer::OptimizeOverdraw(optimized, positions, 1.05f);
+
+	CHECK(CanonicalTriangles(optimized) == CanonicalTriangles(indices));
+	CHECK(MeshOptimizer::AnalyzeVertexCache(optimized, positions.size()).acmr <= cacheAcmr * 1.05f + 1e-4f);
+}
+
+TEST(MeshOptimizer_VertexFetchRemapIsFirstUseOrder)
+{
+	std::vector<uint32_t> indices;
+	std::vector<MeshPosition> positions;
+	BuildSphere(32, indices, positions);
+	MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+
+	std::vector<uint32_t> original = indices;
+	std::vector<MeshPosition> vertices = positions;
+	std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices, vertices.size());
+	MeshOptimizer::RemapVertexBuffer(vertices, remap);
+
+	std::vector<uint32_t> sorted = remap;
+	std::sort(sorted.begin(), sorted.end());
+	bool isPermutation = true;
+	for (size_t i = 0; i < sorted.size(); i++) isPermutation = isPermutation && (sorted[i] == i);
+	CHECK(isPermutation);
+
+	bool isSameGeometry = true;
+	uint32_t nextNew = 0;
+	bool isFirstUseOrder = true;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		const MeshPosition& a = vertices[indices[i]];
+		const MeshPosition& b = positions[original[i]];
+		isSameGeometry = isSameGeometry && (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+		if (indices[i] == nextNew) nextNew++;
+		else isFirstUseOrder = isFirstUseOrder && (indices[i] < nextNew);
+	}
+	CHECK(isSameGeometry);
+	CHECK(isFirstUseOrder);
+}
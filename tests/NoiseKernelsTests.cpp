@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "NoiseKernels.h"
+
+#include <cmath>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+TEST(NoiseKernels_SinFollowsTheLibrary)
+{
+	float largest = 0.0f;
+	for (int i = -20000; i <= 20000; i++)
+	{
+		float x = i * 0.01f;
+		largest = std::max(largest, fabsf(NoiseKernels::Sin(x) - sinf(x)));
+	}
+	CHECK(largest < 1e-6f);
+}
+
+TEST(NoiseKernels_NoiseStaysInUnitRangeAndMatchesLattice)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	bool isInRange = true;
+	for (int i = 0; i < 10000; i++)
+	{
+		float n = NoiseKernels::Noise(coordinate(random), coordinate(random), coordinate(random));
+		isInRange = isInRange && (n >= 0.0f) && (n <= 1.0f);
+	}
+	CHECK(isInRange);
+
+	// At a lattice point noise() is the hash of its cell, n = x + 57y + 113z.
+	CHECK(NoiseKernels::Noise(2.0f, 3.0f, 4.0f) == NoiseKernels::Hash(2.0f + 57.0f * 3.0f + 113.0f * 4.0f));
+}
+
+// The batch variants keep the operation order of the scalar code, so each
+// gives the same bits on every sample, the tail included.
+TEST(NoiseKernels_VariantsAgreeBitForBit)
+{
+	const size_t count = 1003;
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+	std::vector<float> x(count), y(count), z(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = coordinate(random);
+		y[i] = coordinate(random);
+		z[i] = coordinate(random);
+	}
+
+	FbmParameters fbm = NoiseKernels::FloorFbm();
+	std::vector<float> noise(count), perlin(count), octaves(count);
+	NoiseKernels::Noise(x.data(), y.data(), z.data(), noise.data(), count, NoiseVariant::Scalar);
+	NoiseKernels::Perlin(x.data(), y.data(), perlin.data(), count, NoiseVariant::Scalar);
+	NoiseKernels::Fbm(x.data(), y.data(), z.data(), octaves.data(), count, fbm, NoiseVariant::Scalar);
+
+	bool isScalarSame = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		isScalarSame = isScalarSame && (noise[i] == NoiseKernels::Noise(x[i], y[i], z[i])) &&
+			(perlin[i] == NoiseKernels::Perlin(x[i], y[i])) && (octaves[i] == NoiseKernels::Fbm(x[i], y[i], z[i], fbm));
+	}
+	CHECK(isScalarSame);
+
+	CHECK(NoiseKernels::IsSupported(NoiseVariant::Scalar));
+	for (NoiseVariant variant : { NoiseVariant::Sse, NoiseVariant::Avx2 })
+	{
+		if (!NoiseKernels::IsSupported(variant)) continue;
+
+		std::vector<float> vectorNoise(count), vectorPerlin(count), vectorOctaves(count);
+		NoiseKernels::Noise(x.data(), y.data(), z.data(), vectorNoise.data(), count, variant);
+		NoiseKernels::Perlin(x.data(), y.data(), vectorPerlin.data(), count, variant);
+		NoiseKernels::Fbm(x.data(), y.data(), z.data(), vectorOctaves.data(), count, fbm, variant);
+		CHECK(vectorNoise == noise);
+		CHECK(vectorPerlin == perlin);
+		CHECK(vectorOctaves == octaves);
+	}
+}
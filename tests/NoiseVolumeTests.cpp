@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "NoiseKernels.h"
+#include "NoiseVolume.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// The volume P01 generates at startup: 64 cells a side, 16-bit texels.
+	const uint32_t VOLUME_SIZE = 64;
+	const uint32_t VOLUME_SAMPLES = 4096;
+
+	// Distance either side of a lattice plane at which the edges are sampled.
+	const float SEAM_DISTANCE = 1.0e-3f;
+
+	NoiseVolume MakeVolume()
+	{
+		NoiseVolume volume;
+		volume.Generate(VOLUME_SIZE);
+		return volume;
+	}
+}
+
+TEST(NoiseVolume_StoresOneTexelPerLatticePoint)
+{
+	NoiseVolume volume = MakeVolume();
+	CHECK(volume.GetSize() == VOLUME_SIZE);
+	CHECK(volume.GetBytes() == VOLUME_SIZE * VOLUME_SIZE * VOLUME_SIZE * sizeof(uint16_t));
+}
+
+// A point and the same point one tile along or back on each axis. Only the
+// rounding of the moved coordinate may tell them apart.
+TEST(NoiseVolume_RepeatsEveryTile)
+{
+	NoiseVolume volume = MakeVolume();
+	float size = static_cast<float>(VOLUME_SIZE);
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> inside(0.0f, size);
+
+	float periodError = 0.0f;
+	for (uint32_t i = 0; i < VOLUME_SAMPLES; i++)
+	{
+		float p[3] = { inside(random), inside(random), inside(random) };
+		float value = volume.Sample(p[0], p[1], p[2]);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (float offset : { size, -size })
+			{
+				float q[3] = { p[0], p[1], p[2] };
+				q[axis] += offset;
+				periodError = std::max(periodError, fabsf(value - volume.Sample(q[0], q[1], q[2])));
+			}
+		}
+	}
+	CHECK(periodError <= 1.0e-4f);
+}
+
+// Just inside the far edge of the tile against just past it, which wraps to the
+// start. The smoothstep is flat at lattice planes, so a continuous edge changes
+// no more than an interior plane does, while a broken one jumps by the
+// difference of two unrelated hashes.
+TEST(NoiseVolume_TileEdgesMeetWithoutSeams)
+{
+	NoiseVolume volume = MakeVolume();
+	float size = static_cast<float>(VOLUME_SIZE);
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> inside(0.0f, size);
+	std::uniform_int_distribution<uint32_t> plane(1, VOLUME_SIZE - 1);
+
+	float seamStep = 0.0f;
+	float interiorStep = 0.0f;
+	for (uint32_t i = 0; i < VOLUME_SAMPLES; i++)
+	{
+		float p[3] = { inside(random), inside(random), inside(random) };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float q[3] = { p[0], p[1], p[2] };
+			q[axis] = size - SEAM_DISTANCE;
+			float before = volume.Sample(q[0], q[1], q[2]);
+			q[axis] = size + SEAM_DISTANCE;
+			seamStep = std::max(seamStep, fabsf(before - volume.Sample(q[0], q[1], q[2])));
+
+			float interior = static_cast<float>(plane(random));
+			q[axis] = interior - SEAM_DISTANCE;
+			before = volume.Sample(q[0], q[1], q[2]);
+			q[axis] = interior + SEAM_DISTANCE;
+			interiorStep = std::max(interiorStep, fabsf(before - volume.Sample(q[0], q[1], q[2])));
+		}
+	}
+	CHECK(seamStep <= 1.0e-3f);
+	CHECK(seamStep <= interiorStep * 1.5f);
+}
+
+// Inside the first tile, short of the last cell of each axis which blends with
+// the wrapped first plane, the texture path is the analytic noise quantised to
+// 16 bits.
+TEST(NoiseVolume_MatchesAnalyticNoiseInFirstTile)
+{
+	NoiseVolume volume = MakeVolume();
+	std::mt19937 random(202219807);
+	std::uniform_real_distribution<float> unwrapped(0.0f, static_cast<float>(VOLUME_SIZE) - 1.0f);
+
+	float analyticError = 0.0f;
+	for (uint32_t i = 0; i < VOLUME_SAMPLES; i++)
+	{
+		float u[3] = { unwrapped(random), unwrapped(random), unwrapped(random) };
+		analyticError = std::max(analyticError, fabsf(volume.Sample(u[0], u[1], u[2]) - NoiseKernels::Noise(u[0], u[1], u[2])));
+	}
+	CHECK(analyticError < 0.01f);
+}
+
+TEST(NoiseVolume_SampleRepeatsEveryTile)
+{
+	NoiseVolume volume;
+	volume.Generate(16);
+	float a = volume.Sample(3.25f, 7.5f, 1.75f);
+	float b = volume.Sample(3.25f + 16.0f, 7.5f - 32.0f, 1.75f + 48.0f);
+	CHECK_NEAR(a, b, 1e-3);
+	CHECK(a >= 0.0f && a <= 1.0f);
+}
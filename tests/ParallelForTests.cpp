@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "ParallelFor.h"
+
+#include <atomic>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+// Every index is visited once, in ranges that do not overlap, for counts
+// below, at and above the number of ranges handed out.
+TEST(ParallelFor_CoversEveryIndexOnce)
+{
+	for (size_t count : { static_cast<size_t>(0), static_cast<size_t>(1), static_cast<size_t>(3),
+		static_cast<size_t>(97), static_cast<size_t>(100000) })
+	{
+		std::vector<std::atomic<int>> visits(count);
+		for (auto& v : visits) v = 0;
+		std::atomic<bool> isOrdered(true);
+
+		ParallelFor(count, [&](size_t begin, size_t end) {
+			if (begin >= end || end > count) isOrdered = false;
+			for (size_t i = begin; i < end; i++) visits[i]++;
+		});
+
+		bool isOnce = true;
+		for (auto& v : visits) isOnce = isOnce && (v == 1);
+		CHECK(isOnce);
+		CHECK(isOrdered);
+	}
+}
@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "ParticleSorter.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	std::vector<SortEntry> RandomKeys(size_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<float> x(count), y(count), z(count);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		for (size_t i = 0; i < count; i++)
+		{
+			x[i] = position(random);
+			y[i] = position(random);
+			z[i] = position(random);
+		}
+
+		std::vector<SortEntry> entries;
+		ParticleSorter::BuildKeys(x.data(), y.data(), z.data(), count, 0.0f, 5.0f, 10.0f, entries);
+		return entries;
+	}
+}
+
+TEST(ParticleSorter_DepthKeysOrderLikeDistances)
+{
+	bool isMonotonic = true;
+	float distances[] = { 0.0f, 0.001f, 0.5f, 1.0f, 10.0f, 1000.0f };
+	for (int i = 0; i + 1 < 6; i++)
+	{
+		uint32_t a = ParticleSorter::DepthKey(distances[i]);
+		uint32_t b = ParticleSorter::DepthKey(distances[i + 1]);
+		// Back to front: farther particles sort first, so their keys are lower.
+		isMonotonic = isMonotonic && (a > b);
+	}
+	CHECK(isMonotonic);
+	CHECK(ParticleSorter::DepthKey(0.0f) < ParticleSorter::PaddingKey());
+}
+
+TEST(ParticleSorter_RadixAndBitonicAgreeWithStdSort)
+{
+	for (size_t count : { static_cast<size_t>(1), static_cast<size_t>(1000), static_cast<size_t>(4097) })
+	{
+		std::vector<SortEntry> entries = RandomKeys(count, static_cast<uint32_t>(count));
+		std::vector<SortEntry> radix = entries;
+		std::vector<SortEntry> bitonic = entries;
+		std::vector<SortEntry> scratch;
+
+		ParticleSorter::RadixSort(radix, scratch);
+		ParticleSorter::BitonicSort(bitonic);
+		std::stable_sort(entries.begin(), entries.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+
+		CHECK(ParticleSorter::IsSorted(radix));
+		CHECK(ParticleSorter::IsSorted(bitonic));
+
+		bool isSameKeys = (radix.size() == entries.size());
+		for (size_t i = 0; isSameKeys && i < entries.size(); i++) isSameKeys = (radix[i].key == entries[i].key);
+		CHECK(isSameKeys);
+
+		// Bitonic sorts pad to a power of two with PaddingKey, which sorts last.
+		bool isBitonicPrefix = (bitonic.size() >= entries.size());
+		for (size_t i = 0; isBitonicPrefix && i < entries.size(); i++) isBitonicPrefix = (bitonic[i].key == entries[i].key);
+		CHECK(isBitonicPrefix);
+	}
+}
@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "ParticleStore.h"
+
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// 37 particles, so the vector kernels leave a scalar tail.
+	const size_t PARTICLE_TEST_COUNT = 37;
+
+	void Fill(ParticleStore& store)
+	{
+		for (size_t i = 0; i < PARTICLE_TEST_COUNT; i++)
+		{
+			float f = static_cast<float>(i);
+			store.Add(f * 0.5f - 9.0f, f * 0.25f, -f, 1.0f + f * 0.1f, -2.0f + f * 0.3f, 0.7f * f, 1.0f + f * 0.05f);
+		}
+	}
+}
+
+TEST(ParticleStore_ArraysAreAligned)
+{
+	ParticleStore store;
+	Fill(store);
+	CHECK(reinterpret_cast<uintptr_t>(store.GetX()) % 32 == 0);
+	CHECK(reinterpret_cast<uintptr_t>(store.GetVelocityZ()) % 32 == 0);
+	CHECK(reinterpret_cast<uintptr_t>(store.GetAge()) % 32 == 0);
+}
+
+// The vector kernels keep their multiplies and adds apart, so the results are
+// those of the plain loop to the bit, whichever path the CPU takes.
+TEST(ParticleStore_KernelsMatchScalarReference)
+{
+	ParticleStore store;
+	Fill(store);
+	const float deltaTime = 1.0f / 60.0f;
+	const float damping = 0.98f;
+	const ParticleBounds bounds = { -8.0f, -1.0f, -30.0f, 8.0f, 5.0f, 0.0f };
+
+	store.Integrate(deltaTime);
+	store.Damp(damping);
+	store.ApplyBounds(bounds);
+
+	bool isExact = true;
+	for (size_t i = 0; i < PARTICLE_TEST_COUNT; i++)
+	{
+		float f = static_cast<float>(i);
+		float x = f * 0.5f - 9.0f;
+		float vx = 1.0f + f * 0.1f;
+		x += vx * deltaTime;
+		vx *= damping;
+		if (x < bounds.minX) { x = bounds.minX; vx = fabsf(vx); }
+		else if (x > bounds.maxX) { x = bounds.maxX; vx = -fabsf(vx); }
+
+		isExact = isExact && (store.GetX()[i] == x) && (store.GetVelocityX()[i] == vx) && (store.GetAge()[i] == deltaTime);
+	}
+	CHECK(isExact);
+}
+
+TEST(ParticleStore_RemovalKeepsArraysPacked)
+{
+	ParticleStore store;
+	Fill(store);
+	store.Remove(0);
+	CHECK(store.GetCount() == PARTICLE_TEST_COUNT - 1);
+	// The last particle was swapped into the hole.
+	CHECK(store.GetX()[0] == (PARTICLE_TEST_COUNT - 1) * 0.5f - 9.0f);
+
+	// Lifetimes run from 1 to 2.8 seconds, so after 2 seconds those below 2 go.
+	for (int i = 0; i < 4; i++) store.Integrate(0.5f);
+	size_t removed = store.RemoveExpired();
+	CHECK(removed == 20);
+	CHECK(store.GetCount() == PARTICLE_TEST_COUNT - 1 - 20);
+	bool isAlive = true;
+	for (size_t i = 0; i < store.GetCount(); i++) isAlive = isAlive && (store.GetAge()[i] < store.GetLifetime()[i]);
+	CHECK(isAlive);
+}
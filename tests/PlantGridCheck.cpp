@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "PlantGridCheck.h"
+#include "PlantGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Where ObjectsSDF moves each of its three PlantsSDF on xz.
+	const float PLANT_CHECK_GROUP_OFFSETS[3][2] = { { 0.0f, 0.0f }, { 1.0f, -0.5f }, { -2.5f, -1.3f } };
+
+	// Farther than any stalk, to start the minimum of the loops from.
+	const float PLANT_CHECK_FAR = 1e10f;
+
+	// Largest difference of the instances from the loop, which turns its frame
+	// one step at a time where an instance turns once.
+	const float PLANT_CHECK_INSTANCE_TOLERANCE = 1e-4f;
+
+	// Stalks the grid evaluates at a point: those of its cell, none outside the grid.
+	uint32_t StalksAt(const PlantGrid& grid, const float p[3])
+	{
+		float x = (p[0] - grid.GetOriginX()) / PlantGrid::CellSize;
+		float z = (p[2] - grid.GetOriginZ()) / PlantGrid::CellSize;
+		if (x < 0.0f || z < 0.0f || x >= grid.GetColumns() || z >= grid.GetRows()) return 0;
+		return grid.GetCells()[static_cast<size_t>(z) * grid.GetColumns() + static_cast<size_t>(x)].count;
+	}
+}
+
+Tests::PlantGridReport Tests::MeasurePlantGrid(uint32_t samples, uint32_t forestStalks, float time)
+{
+	PlantGridReport report = {};
+	report.samples = samples;
+	report.forestStalks = forestStalks;
+
+	PlantGrid scene;
+	scene.Build(PlantGrid::ScenePlants());
+	report.stalks = static_cast<uint32_t>(scene.GetInstances().size());
+	report.cells = static_cast<uint32_t>(scene.GetCells().size());
+
+	PlantGrid forest;
+	forest.Build(PlantGrid::Forest(forestStalks, 7));
+
+	std::mt19937 generator(13);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Points in the slab over a grid, and a cell around it.
+	auto pointsOver = [&](const PlantGrid& grid, uint32_t& evaluated)
+	{
+		std::vector<float> points(static_cast<size_t>(samples) * 3);
+		evaluated = 0;
+		for (uint32_t s = 0; s < samples; s++)
+		{
+			float* p = &points[s * 3];
+			p[0] = grid.GetOriginX() - PlantGrid::CellSize + unit(generator) * (grid.GetColumns() + 2) * PlantGrid::CellSize;
+			p[1] = PlantGrid::SlabBottom + unit(generator) * (PlantGrid::SlabTop - PlantGrid::SlabBottom);
+			p[2] = grid.GetOriginZ() - PlantGrid::CellSize + unit(generator) * (grid.GetRows() + 2) * PlantGrid::CellSize;
+			evaluated += StalksAt(grid, p);
+		}
+		return points;
+	};
+
+	uint32_t sceneEvaluated, forestEvaluated;
+	std::vector<float> scenePoints = pointsOver(scene, sceneEvaluated);
+	std::vector<float> forestPoints = pointsOver(forest, forestEvaluated);
+
+	// Each way is timed over all points.
+	std::vector<float> loop(samples), grid(samples), forestBrute(samples), forestGrid(samples);
+	float material;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++)
+	{
+		const float* p = &scenePoints[s * 3];
+		loop[s] = PLANT_CHECK_FAR;
+		for (uint32_t group = 0; group < 3; group++)
+		{
+			float q[3] = { p[0] - PLANT_CHECK_GROUP_OFFSETS[group][0], p[1], p[2] - PLANT_CHECK_GROUP_OFFSETS[group][1] };
+			loop[s] = std::min(loop[s], PlantGrid::PlantsSDF(q, time));
+		}
+	}
+	auto loopEnd = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) grid[s] = scene.Distance(&scenePoints[s * 3], time, material);
+	auto gridEnd = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) forestBrute[s] = forest.BruteDistance(&forestPoints[s * 3], time, material);
+	auto forestBruteEnd = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) forestGrid[s] = forest.Distance(&forestPoints[s * 3], time, material);
+	auto forestGridEnd = std::chrono::high_resolution_clock::now();
+
+	if (samples > 0)
+	{
+		report.loopNanoseconds = std::chrono::duration<double, std::nano>(loopEnd - start).count() / samples;
+		report.gridNanoseconds = std::chrono::duration<double, std::nano>(gridEnd - loopEnd).count() / samples;
+		report.forestBruteNanoseconds = std::chrono::duration<double, std::nano>(forestBruteEnd - gridEnd).count() / samples;
+		report.forestGridNanoseconds = std::chrono::duration<double, std::nano>(forestGridEnd - forestBruteEnd).count() / samples;
+		report.stalksPerSample = static_cast<double>(sceneEvaluated) / samples;
+		report.forestStalksPerSample = static_cast<double>(forestEvaluated) / samples;
+	}
+
+	// The grid evaluates the same stalks in the same way, so it matches all of
+	// them, up to the bound, exactly.
+	for (uint32_t s = 0; s < samples; s++)
+	{
+		const float* p = &scenePoints[s * 3];
+		float brute = scene.BruteDistance(p, time, material);
+		report.maxInstanceError = std::max(report.maxInstanceError, fabsf(brute - loop[s]));
+		report.maxGridError = std::max(report.maxGridError, fabsf(grid[s] - std::min(brute, scene.GetBound(p))));
+
+		const float* q = &forestPoints[s * 3];
+		report.maxGridError = std::max(report.maxGridError, fabsf(forestGrid[s] - std::min(forestBrute[s], forest.GetBound(q))));
+	}
+
+	report.isConsistent = report.maxInstanceError <= PLANT_CHECK_INSTANCE_TOLERANCE && report.maxGridError == 0.0f;
+	return report;
+}
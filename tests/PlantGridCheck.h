@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Tests
+{
+	struct PlantGridReport
+	{
+		uint32_t	samples;
+		uint32_t	stalks;						// Of the scene.
+		uint32_t	cells;
+		double		stalksPerSample;			// Evaluated by the grid, on average.
+		double		loopNanoseconds;			// Per point, the three PlantsSDF of the shaders.
+		double		gridNanoseconds;
+		uint32_t	forestStalks;
+		double		forestBruteNanoseconds;		// Per point, every stalk of the forest.
+		double		forestGridNanoseconds;
+		double		forestStalksPerSample;
+		float		maxInstanceError;			// Of all the instances from the loop.
+		float		maxGridError;				// Of the grid from min(all the instances, bound).
+		bool		isConsistent;
+	};
+
+	// Compares a PlantGrid of the scene's stalks with the three PlantsSDF loops of
+	// the shaders, and grids of the scene and of a forest with all their stalks,
+	// at points in the slab, for accuracy and time per point.
+	PlantGridReport MeasurePlantGrid(uint32_t samples, uint32_t forestStalks, float time);
+}
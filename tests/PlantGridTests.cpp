@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "PlantGrid.h"
+#include "PlantGridCheck.h"
+
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+// Through the grid a point in the slab gets min(distance to every stalk, bound
+// of its cell), which is exact where the tracer is near a stalk and a shorter
+// step elsewhere.
+TEST(PlantGrid_GridMatchesBruteForce)
+{
+	PlantGrid grid;
+	grid.Build(PlantGrid::Forest(2048, 5));
+	CHECK(grid.GetColumns() > 1 && grid.GetRows() > 1);
+	CHECK(grid.GetCells().size() == static_cast<size_t>(grid.GetColumns()) * grid.GetRows());
+
+	std::mt19937 random(8);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	bool isExactOrBound = true;
+	bool isLowerBound = true;
+	for (int i = 0; i < 4000; i++)
+	{
+		float p[3] =
+		{
+			grid.GetOriginX() + unit(random) * grid.GetColumns() * PlantGrid::CellSize,
+			PlantGrid::SlabBottom + unit(random) * (PlantGrid::SlabTop - PlantGrid::SlabBottom),
+			grid.GetOriginZ() + unit(random) * grid.GetRows() * PlantGrid::CellSize
+		};
+		float material, bruteMaterial;
+		float distance = grid.Distance(p, 10.0f, material);
+		float brute = grid.BruteDistance(p, 10.0f, bruteMaterial);
+		isExactOrBound = isExactOrBound && (distance == std::min(brute, grid.GetBound(p)));
+		isLowerBound = isLowerBound && (distance <= brute);
+	}
+	CHECK(isExactOrBound);
+	CHECK(isLowerBound);
+}
+
+TEST(PlantGrid_CellsListTheirInstances)
+{
+	PlantGrid grid;
+	grid.Build(PlantGrid::ScenePlants());
+	CHECK(grid.GetInstances().size() == 72);
+
+	size_t listed = 0;
+	for (const PlantCell& cell : grid.GetCells())
+	{
+		CHECK(cell.first + cell.count <= grid.GetCellInstances().size());
+		listed += cell.count;
+	}
+	CHECK(listed == grid.GetCellInstances().size());
+	CHECK(listed >= grid.GetInstances().size());
+}
+
+// At points in the slab, the 72 instances give the distance of the three
+// PlantsSDF loops of the shaders, the grid of the scene and of a forest give
+// exactly min(distance to all their stalks, bound), and a point evaluates a
+// fraction of the stalks, a small one in the forest.
+TEST(PlantGrid_InstancesAndGridMatchTheShaders)
+{
+	Tests::PlantGridReport report = Tests::MeasurePlantGrid(4096, 2048, 10.0f);
+	CHECK(report.stalks == 72);
+	CHECK(report.maxInstanceError <= 1e-4f);
+	CHECK(report.maxGridError == 0.0f);
+	CHECK(report.stalksPerSample < report.stalks);
+	CHECK(report.forestStalksPerSample < report.forestStalks / 8.0);
+}
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "ResolutionControllerCheck.h"
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// At full resolution the marcher takes twice the budget, and the per-pixel
+	// part goes up by half after the first half of the frames.
+	const uint32_t RESOLUTION_CHECK_FRAMES = 600;
+	const double RESOLUTION_CHECK_FIXED = 0.125;
+	const double RESOLUTION_CHECK_FULL = 2.0;
+	const double RESOLUTION_CHECK_RAISE = 1.5;
+
+	// Frames before a time is read back, as with DX::GpuTimer, and the noise on it.
+	const uint32_t RESOLUTION_CHECK_LATENCY = 4;
+	const double RESOLUTION_CHECK_NOISE = 0.03;
+
+	// Frames each phase may take to settle; after that the time may exceed the
+	// budget by twice the tolerance at most.
+	const uint32_t RESOLUTION_CHECK_SETTLE_LIMIT = 120;
+}
+
+Tests::ResolutionCheckReport Tests::RunSyntheticResolution(double budgetMilliseconds)
+{
+	ResolutionCheckReport report = { RESOLUTION_CHECK_FRAMES, 0, 0, 0.0f, 0.0f, 0.0, false };
+
+	ResolutionController controller;
+	controller.Reset(budgetMilliseconds);
+
+	const double fixed = RESOLUTION_CHECK_FIXED * budgetMilliseconds;
+	const uint32_t half = RESOLUTION_CHECK_FRAMES / 2;
+	double perPixel = RESOLUTION_CHECK_FULL * budgetMilliseconds - fixed;
+
+	std::deque<double> pending;
+	std::vector<double> deviations(RESOLUTION_CHECK_FRAMES);
+	uint32_t seed = 12345u;
+
+	for (uint32_t frame = 0; frame < RESOLUTION_CHECK_FRAMES; frame++)
+	{
+		if (frame == half) perPixel *= RESOLUTION_CHECK_RAISE;
+
+		double scale = controller.GetScale();
+		double exact = fixed + perPixel * scale * scale;
+		deviations[frame] = (exact - budgetMilliseconds) / budgetMilliseconds;
+
+		// A small linear congruential generator keeps the noise reproducible.
+		seed = seed * 1664525u + 1013904223u;
+		double noise = (static_cast<double>(seed >> 8) / 16777216.0 * 2.0 - 1.0) * RESOLUTION_CHECK_NOISE;
+
+		pending.push_back(exact * (1.0 + noise));
+		if (pending.size() > RESOLUTION_CHECK_LATENCY)
+		{
+			controller.Update(pending.front());
+			pending.pop_front();
+		}
+	}
+
+	// Each phase settles when the noise-free time first comes within the tolerance;
+	// any overshoot after that counts.
+	uint32_t* settleFrames[2] = { &report.settleFrames, &report.resettleFrames };
+	bool isSettled = true;
+	for (uint32_t phase = 0; phase < 2; phase++)
+	{
+		uint32_t first = phase * half;
+		uint32_t frame = first;
+		while (frame < first + half && std::abs(deviations[frame]) > ResolutionController::Tolerance) frame++;
+
+		*settleFrames[phase] = frame - first;
+		isSettled = isSettled && frame < first + half;
+		for (; frame < first + half; frame++)
+		{
+			report.maxOvershoot = std::max(report.maxOvershoot, deviations[frame]);
+		}
+	}
+
+	report.finalScale = controller.GetScale();
+	double expectedArea = (budgetMilliseconds - fixed) / perPixel;
+	report.expectedScale = static_cast<float>(std::sqrt(std::min(std::max(expectedArea,
+		static_cast<double>(ResolutionController::MinScale) * ResolutionController::MinScale),
+		static_cast<double>(ResolutionController::MaxScale) * ResolutionController::MaxScale)));
+
+	report.isStable = isSettled &&
+		report.settleFrames <= RESOLUTION_CHECK_SETTLE_LIMIT && report.resettleFrames <= RESOLUTION_CHECK_SETTLE_LIMIT &&
+		report.maxOvershoot <= 2.0 * ResolutionController::Tolerance &&
+		std::abs(report.finalScale - report.expectedScale) <= 0.02f;
+	return report;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Tests
+{
+	struct ResolutionCheckReport
+	{
+		uint32_t	frames;				// Synthetic frames fed to the controller.
+		uint32_t	settleFrames;		// Frames until the time first came within Tolerance of the budget.
+		uint32_t	resettleFrames;		// The same after the per-pixel cost went up halfway.
+		float		finalScale;
+		float		expectedScale;		// Scale at which the cost model meets the budget at the end.
+		double		maxOvershoot;		// Largest time over the budget after settling, relative to it.
+		bool		isStable;
+	};
+
+	// Feeds a ResolutionController with frame times from a cost model, a fixed
+	// cost plus a cost per pixel that is raised by half after the first half of
+	// the frames. The times reach the controller a few frames late and with some
+	// noise, as the GPU timer's would.
+	ResolutionCheckReport RunSyntheticResolution(double budgetMilliseconds);
+}
@@ -0,0 +1,31 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "ResolutionController.h"
+#include "ResolutionControllerCheck.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+// Against P01's 8 ms budget, with frame times read back four frames late, the
+// controller comes within tolerance of the budget in two seconds at 60 Hz, and
+// again after the cost per pixel rises, without overshooting by more than twice
+// the tolerance, and ends at the scale where the cost model meets the budget.
+TEST(ResolutionController_SettlesOnSyntheticFrames)
+{
+	Tests::ResolutionCheckReport report = Tests::RunSyntheticResolution(8.0);
+	CHECK(report.settleFrames <= 120);
+	CHECK(report.resettleFrames <= 120);
+	CHECK(report.maxOvershoot <= 2.0 * ResolutionController::Tolerance);
+	CHECK_NEAR(report.finalScale, report.expectedScale, 0.02);
+}
+
+TEST(ResolutionController_ScaleStaysWithinLimits)
+{
+	ResolutionController controller;
+	controller.Reset(8.0);
+	for (int i = 0; i < 200; i++) controller.Update(100.0);
+	CHECK(controller.GetScale() == ResolutionController::MinScale);
+
+	for (int i = 0; i < 400; i++) controller.Update(0.5);
+	CHECK(controller.GetScale() == ResolutionController::MaxScale);
+	CHECK(controller.GetBudget() == 8.0);
+}
@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "SceneCuller.h"
+
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// With an identity view-projection the frustum is the clip volume itself:
+	// -1 to 1 in x and y, 0 to 1 in z.
+	const float CULL_TEST_IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+}
+
+TEST(SceneCuller_FrustumTestsSpheresAgainstPlanes)
+{
+	CullFrustum frustum = SceneCuller::ExtractFrustum(CULL_TEST_IDENTITY);
+
+	CHECK(SceneCuller::IsVisible(frustum, { 0.0f, 0.0f, 0.5f, 0.1f }));
+	CHECK(SceneCuller::IsVisible(frustum, { 1.05f, 0.0f, 0.5f, 0.1f }));
+	CHECK(!SceneCuller::IsVisible(frustum, { 1.2f, 0.0f, 0.5f, 0.1f }));
+	CHECK(!SceneCuller::IsVisible(frustum, { 0.0f, 0.0f, -0.5f, 0.1f }));
+	CHECK(!SceneCuller::IsVisible(frustum, { 0.0f, 0.0f, 1.5f, 0.1f }));
+	CHECK(!SceneCuller::IsVisible(frustum, { 0.0f, -3.0f, 0.5f, 1.0f }));
+}
+
+// 1001 spheres, so the vector path leaves a tail.
+TEST(SceneCuller_SimdMatchesScalar)
+{
+	const size_t count = 1001;
+	std::mt19937 random(37);
+	std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> size(0.01f, 0.5f);
+	std::vector<float> x(count), y(count), z(count), radius(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = position(random);
+		y[i] = position(random);
+		z[i] = position(random);
+		radius[i] = size(random);
+	}
+
+	CullFrustum frustum = SceneCuller::ExtractFrustum(CULL_TEST_IDENTITY);
+	std::vector<uint8_t> scalar(count), simd(count);
+	size_t scalarCount = SceneCuller::TestScalar(frustum, x.data(), y.data(), z.data(), radius.data(), count, scalar.data());
+	size_t simdCount = SceneCuller::TestSimd(frustum, x.data(), y.data(), z.data(), radius.data(), count, simd.data());
+
+	CHECK(scalarCount == simdCount);
+	CHECK(scalar == simd);
+	CHECK(scalarCount > 0 && scalarCount < count);
+}
+
+TEST(SceneCuller_HiZHidesSpheresBehindDepth)
+{
+	const uint32_t width = 64;
+	const uint32_t height = 36;
+	std::vector<float> depth(width * height, 1.0f);
+	// An occluder at depth 0.3 over the left half of the screen.
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width / 2; x++) depth[y * width + x] = 0.3f;
+	}
+
+	HiZBuffer hiZ;
+	CHECK(hiZ.IsEmpty());
+	hiZ.Build(depth.data(), width, height, CULL_TEST_IDENTITY);
+	CHECK(hiZ.GetWidth() == width && hiZ.GetHeight() == height);
+	CHECK(hiZ.GetLevelCount() == 7);
+
+	CHECK(hiZ.IsOccluded({ -0.5f, 0.0f, 0.8f, 0.1f }));
+	CHECK(!hiZ.IsOccluded({ -0.5f, 0.0f, 0.15f, 0.1f }));
+	CHECK(!hiZ.IsOccluded({ 0.5f, 0.0f, 0.8f, 0.1f }));
+	// Straddling the occluder's edge, part of it shows.
+	CHECK(!hiZ.IsOccluded({ 0.0f, 0.0f, 0.8f, 0.2f }));
+
+	hiZ.Clear();
+	CHECK(!hiZ.IsOccluded({ -0.5f, 0.0f, 0.8f, 0.1f }));
+}
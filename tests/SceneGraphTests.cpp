@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "SceneGraph.h"
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	SceneTransform Moved(float x, float y, float z)
+	{
+		SceneTransform transform = SceneGraph::Identity();
+		transform.position[0] = x;
+		transform.position[1] = y;
+		transform.position[2] = z;
+		return transform;
+	}
+
+	bool IsSame(const SceneMatrix& a, const SceneMatrix& b)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			if (!Tests::IsNear(a.m[i], b.m[i], 1e-5)) return false;
+		}
+		return true;
+	}
+}
+
+TEST(SceneGraph_WorldIsParentTimesLocal)
+{
+	SceneGraph graph;
+	SceneTransform rootLocal = Moved(10.0f, 0.0f, 0.0f);
+	rootLocal.rotation[1] = 1.0f;
+	rootLocal.scale[0] = rootLocal.scale[1] = rootLocal.scale[2] = 2.0f;
+	SceneNodeId root = graph.AddNode(SCENE_NO_PARENT, rootLocal);
+	SceneNodeId child = graph.AddNode(root, Moved(0.0f, 1.0f, -3.0f));
+	SceneNodeId grandchild = graph.AddNode(child, Moved(0.5f, 0.0f, 0.0f));
+
+	CHECK(graph.Update() == 3);
+	SceneMatrix expectedChild = SceneGraph::Multiply(SceneGraph::Compose(graph.GetLocal(child)), graph.GetWorld(root));
+	CHECK(IsSame(graph.GetWorld(child), expectedChild));
+	SceneMatrix expected = SceneGraph::Multiply(SceneGraph::Compose(graph.GetLocal(grandchild)), expectedChild);
+	CHECK(IsSame(graph.GetWorld(grandchild), expected));
+	CHECK(graph.GetParent(grandchild) == child);
+}
+
+TEST(SceneGraph_OnlyDirtyNodesAndTheirChildrenUpdate)
+{
+	SceneGraph graph;
+	SceneNodeId root = graph.AddNode(SCENE_NO_PARENT, SceneGraph::Identity());
+	SceneNodeId left = graph.AddNode(root, Moved(-1.0f, 0.0f, 0.0f));
+	SceneNodeId leftChild = graph.AddNode(left, Moved(0.0f, 1.0f, 0.0f));
+	SceneNodeId right = graph.AddNode(root, Moved(1.0f, 0.0f, 0.0f));
+	graph.Update();
+	CHECK(graph.Update() == 0);
+
+	graph.SetLocal(left, Moved(-2.0f, 0.0f, 0.0f));
+	CHECK(graph.Update() == 2);
+	CHECK(graph.WasUpdated(left));
+	CHECK(graph.WasUpdated(leftChild));
+	CHECK(!graph.WasUpdated(right));
+	CHECK(!graph.WasUpdated(root));
+	CHECK_NEAR(graph.GetWorld(leftChild).m[12], -2.0, 1e-6);
+	CHECK_NEAR(graph.GetWorld(leftChild).m[13], 1.0, 1e-6);
+
+	graph.Invalidate();
+	CHECK(graph.Update() == 4);
+}
+
+TEST(SceneGraph_SpheresScaleWithTheirNode)
+{
+	SceneTransform transform = Moved(1.0f, 2.0f, 3.0f);
+	transform.scale[0] = 1.0f;
+	transform.scale[1] = 3.0f;
+	transform.scale[2] = 2.0f;
+	const float center[3] = { 0.0f, 0.0f, 0.0f };
+	float worldCenter[3];
+	float worldRadius = 0.0f;
+	SceneGraph::TransformSphere(SceneGraph::Compose(transform), center, 0.5f, worldCenter, worldRadius);
+
+	CHECK_NEAR(worldCenter[0], 1.0, 1e-6);
+	CHECK_NEAR(worldCenter[1], 2.0, 1e-6);
+	CHECK_NEAR(worldCenter[2], 3.0, 1e-6);
+	CHECK_NEAR(worldRadius, 1.5, 1e-5);
+}
+
+TEST(SceneGraph_BenchmarkRunsAgree)
+{
+	SceneGraphBenchmarkResult result = SceneGraph::Benchmark(2000, 20, 10);
+	CHECK(result.isConsistent);
+	CHECK(result.nodeCount == 2000);
+	CHECK(result.recomputedPerFrame >= 20.0);
+	CHECK(result.recomputedPerFrame < 2000.0);
+}
@@ -0,0 +1,499 @@
+#include "pch.h"
+#include "SceneMarcher.h"
+#include "NoiseKernels.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+const float SceneMarcher::MinDistance = 0.1f;
+const float SceneMarcher::MaxDistance = 50.0f;
+const float SceneMarcher::Epsilon = 0.003f;
+const float SceneMarcher::CoralBoundRadius = 1.11f;
+const float SceneMarcher::CoralBoundStart = 1.3f;
+const float SceneMarcher::CoralLodFootprints[CoralLodCount] = { 0.006f, 0.008f, 0.012f, 0.024f };
+const uint32_t SceneMarcher::CoralLodIterations[CoralLodCount] = { 8, 5, 4, 3 };
+
+namespace
+{
+	// Fixed eye of the ray marcher in P01_Scene.hlsli.
+	const float MARCH_EYE[3] = { -2.0f, -1.8f, 5.0f };
+
+	// Material of the bubbles, which refract the ray instead of stopping it.
+	const float MARCH_BUBBLE_ID = 4.5f;
+
+	// Offset of EstimateNormal's tetrahedron.
+	const float MARCH_NORMAL_OFFSET = 0.0025f;
+
+	// Offsets of the two corals in ObjectsSDF.
+	const float MARCH_CORAL_OFFSETS[2][3] = { { -4.0f, -2.4f, 1.0f }, { -2.0f, -2.8f, -2.8f } };
+
+	// Half side of the cube CheckCoral samples, around the whole set, and the
+	// largest difference from the formula it allows. Orbits near the surface
+	// magnify the rounding of either over the iterations.
+	const float CORAL_SAMPLE_EXTENT = 1.6f;
+	const float CORAL_TOLERANCE = 0.002f;
+
+	float Frac(float x)
+	{
+		return x - floorf(x);
+	}
+
+	float Length(float x, float y, float z)
+	{
+		return sqrtf(x * x + y * y + z * z);
+	}
+
+	// p.xz = mul(p.xz, rot(a)), as in MathUtils.hlsli.
+	void Rotate(float& x, float& z, float a)
+	{
+		float c = cosf(a);
+		float s = sinf(a);
+		float rx = x * c - z * s;
+		z = x * s + z * c;
+		x = rx;
+	}
+
+	// min() of two float2 in MathUtils.hlsli, which keeps the second on a tie.
+	void Nearer(float distance, float id, float& nearest, float& nearestId)
+	{
+		if (distance < nearest)
+		{
+			nearest = distance;
+			nearestId = id;
+		}
+	}
+
+	// refract() of HLSL with a ratio of one, which only reflects a ray leaving
+	// through the surface.
+	void Refract(float d[3], const float n[3])
+	{
+		float cosine = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+		float k = 1.0f - (1.0f - cosine * cosine);
+		if (k < 0.0f) return;
+		float scale = cosine + sqrtf(k);
+		for (int i = 0; i < 3; i++) d[i] -= scale * n[i];
+	}
+
+	// A unit complex number to the twelfth power, by squaring.
+	void Power12(float& re, float& im)
+	{
+		float re2 = re * re - im * im, im2 = 2.0f * re * im;
+		float re4 = re2 * re2 - im2 * im2, im4 = 2.0f * re2 * im2;
+		float re8 = re4 * re4 - im4 * im4, im8 = 2.0f * re4 * im4;
+		re = re8 * re4 - im8 * im4;
+		im = re8 * im4 + im8 * re4;
+	}
+
+	struct RayResult
+	{
+		SceneHit	hit;
+		bool		isOutOfSteps;
+	};
+}
+
+SceneMarcher::SceneMarcher(float time) :
+	m_time(time)
+{
+	m_plants.Build(PlantGrid::ScenePlants());
+}
+
+MarchSettings SceneMarcher::PlainSettings()
+{
+	MarchSettings settings = { MaxMarchingSteps, 1.0f, 0.0f, false, false };
+	return settings;
+}
+
+float SceneMarcher::SurfaceSDF(float x, float z) const
+{
+	float surfaceHeight = 0.0f;
+	float amplitude = 0.2f;
+	float frequency = 0.6f;
+	for (int i = 0; i < 4; i++)
+	{
+		float a = NoiseKernels::Noise(x * frequency + (m_time + 1.0f) * 0.8f, z * frequency + (m_time + 1.0f) * 0.8f, 1.0f);
+		a -= NoiseKernels::Noise(x * frequency - 2.0f * m_time * 0.5f, z * frequency - 0.8f * m_time * 0.5f, 1.0f);
+		surfaceHeight += amplitude * a;
+		amplitude *= 0.8f;
+		frequency *= 3.0f;
+	}
+	return std::min(std::max(0.05f + surfaceHeight * 0.2f, 0.0f), 0.5f);
+}
+
+float SceneMarcher::FloorSDF(const float p[3]) const
+{
+	float terrainHeight = NoiseKernels::Fbm(p[0], p[1], p[2], NoiseKernels::FloorFbm());
+	return p[1] + (terrainHeight * 1.13f + 2.5f);
+}
+
+float SceneMarcher::BubbleSDF(const float p[3], float t) const
+{
+	float maxDepth = 4.2f;
+	float progress = powf(std::min(Frac(t * 0.01f) * 4.5f, 1.0f), 2.0f);
+	float depth = maxDepth * (0.8f - progress * progress);
+
+	float r = 0.01f + (0.09f - 0.01f) * progress;
+	float s = std::min(progress * 5.0f, 1.0f);
+	float d = 2.0f - s * s * (3.0f - 2.0f * s) * 0.3f;
+
+	float q[3] = {
+		p[0] + NoiseKernels::Noise(p[0] * 0.8f + t * 0.5f, p[1] * 0.8f, p[2] * 0.8f) * 0.2f,
+		p[1] + NoiseKernels::Noise(p[0] * 0.6f, p[1] * 0.6f + t * 0.5f, p[2] * 0.6f) * 0.2f,
+		p[2] + NoiseKernels::Noise(p[0] * 0.7f, p[1] * 0.7f, p[2] * 0.7f + t * 0.5f) * 0.2f
+	};
+
+	return Length(q[0] + d, q[1] + depth, q[2] - 1.0f + 0.2f * progress * sinf(progress * 10.0f)) - r;
+}
+
+float SceneMarcher::FormulaCoralSDF(const float p[3])
+{
+	float zn[3] = { p[0], p[1], p[2] };
+	float hit = 0.0f;
+	float n = 12.0f;
+	float d = 2.0f;
+	for (int i = 0; i < 12; i++)
+	{
+		float radius = Length(zn[0], zn[1], zn[2]);
+		if (radius > 2.0f)
+		{
+			hit = 0.5f * logf(radius) * radius / d;
+		}
+		else
+		{
+			float rado = powf(radius, 8.0f);
+			float theta = atan2f(sqrtf(zn[0] * zn[0] + zn[1] * zn[1]), zn[2]);
+			float phi = atan2f(zn[1], zn[0]);
+			d = powf(radius, 7.0f) * 7.0f * d + 1.0f;
+
+			float sint = sinf(theta * n);
+			zn[0] = rado * sint * cosf(phi * n) + p[0];
+			zn[1] = rado * sint * sinf(phi * n) + p[1];
+			zn[2] = rado * cosf(theta * n) + p[2];
+		}
+	}
+	return hit;
+}
+
+float SceneMarcher::FastCoralSDF(const float p[3], uint32_t iterations, bool isBounded)
+{
+	float r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+	if (isBounded && r2 > CoralBoundStart * CoralBoundStart)
+	{
+		return sqrtf(r2) - CoralBoundRadius;
+	}
+
+	float zn[3] = { p[0], p[1], p[2] };
+	float d = 2.0f;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		r2 = zn[0] * zn[0] + zn[1] * zn[1] + zn[2] * zn[2];
+		float radius = sqrtf(r2);
+		if (r2 > 4.0f)
+		{
+			return 0.5f * logf(radius) * radius / d;
+		}
+
+		float r4 = r2 * r2;
+		float r7 = r4 * r2 * radius;
+		float r8 = r7 * radius;
+		d = r7 * 7.0f * d + 1.0f;
+
+		// cos and sin of phi and theta, which atan2 gives as 0 at the origin
+		float xy = sqrtf(zn[0] * zn[0] + zn[1] * zn[1]);
+		float cosPhi = 1.0f, sinPhi = 0.0f;
+		if (xy > 0.0f)
+		{
+			cosPhi = zn[0] / xy;
+			sinPhi = zn[1] / xy;
+		}
+		float cosTheta = 1.0f, sinTheta = 0.0f;
+		if (radius > 0.0f)
+		{
+			cosTheta = zn[2] / radius;
+			sinTheta = xy / radius;
+		}
+		Power12(cosPhi, sinPhi);
+		Power12(cosTheta, sinTheta);
+
+		zn[0] = r8 * sinTheta * cosPhi + p[0];
+		zn[1] = r8 * sinTheta * sinPhi + p[1];
+		zn[2] = r8 * cosTheta + p[2];
+	}
+	return 0.0f;
+}
+
+uint32_t SceneMarcher::GetCoralIterations(float footprint)
+{
+	uint32_t iterations = CoralIterations;
+	for (uint32_t level = 0; level < CoralLodCount && footprint >= CoralLodFootprints[level]; level++)
+	{
+		iterations = CoralLodIterations[level];
+	}
+	return iterations;
+}
+
+CoralKernelReport SceneMarcher::CheckCoral(uint32_t samples)
+{
+	CoralKernelReport report = {};
+	report.samples = samples;
+
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> coordinate(-CORAL_SAMPLE_EXTENT, CORAL_SAMPLE_EXTENT);
+	std::vector<float> points(static_cast<size_t>(samples) * 3);
+	for (auto& value : points) value = coordinate(generator);
+
+	// Each kernel is timed over all points.
+	std::vector<float> formula(samples), fast(samples), bounded(samples);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) formula[s] = FormulaCoralSDF(&points[s * 3]);
+	auto formulaEnd = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) fast[s] = FastCoralSDF(&points[s * 3], CoralIterations, false);
+	auto fastEnd = std::chrono::high_resolution_clock::now();
+	for (uint32_t s = 0; s < samples; s++) bounded[s] = FastCoralSDF(&points[s * 3], CoralIterations, true);
+	auto boundedEnd = std::chrono::high_resolution_clock::now();
+
+	if (samples > 0)
+	{
+		report.formulaNanoseconds = std::chrono::duration<double, std::nano>(formulaEnd - start).count() / samples;
+		report.fastNanoseconds = std::chrono::duration<double, std::nano>(fastEnd - formulaEnd).count() / samples;
+		report.boundedNanoseconds = std::chrono::duration<double, std::nano>(boundedEnd - fastEnd).count() / samples;
+	}
+
+	for (uint32_t s = 0; s < samples; s++)
+	{
+		const float* p = &points[s * 3];
+		float radius = Length(p[0], p[1], p[2]);
+		if (formula[s] == 0.0f && radius > CoralBoundRadius) report.beyondBound++;
+
+		// The bounded kernel gives the formula's distance inside the sphere, and
+		// beyond it the sphere's, a lower bound of the true distance to the set.
+		report.maxError = std::max(report.maxError, fabsf(fast[s] - formula[s]));
+		if (radius <= CoralBoundStart)
+		{
+			report.maxError = std::max(report.maxError, fabsf(bounded[s] - formula[s]));
+		}
+
+		// Points outside the set that fewer iterations take as inside
+		for (uint32_t level = 0; level < CoralLodCount; level++)
+		{
+			if (formula[s] > 0.0f && FastCoralSDF(p, CoralLodIterations[level], false) == 0.0f)
+			{
+				report.maxLodShift = std::max(report.maxLodShift, formula[s] / CoralLodFootprints[level]);
+			}
+		}
+	}
+
+	report.isConsistent = report.maxError <= CORAL_TOLERANCE && report.beyondBound == 0 && report.maxLodShift <= 1.0f;
+	return report;
+}
+
+float SceneMarcher::ObjectsSDF(const float p[3], const MarchSettings& settings, float& id) const
+{
+	float pp[3] = { p[0], p[1], p[2] };
+	Rotate(pp[0], pp[2], -0.5f);
+
+	float t = m_time * 0.6f;
+	float water = -p[1] - SurfaceSDF(p[0], p[2]) +
+		(0.5f + 0.5f * (sinf(p[2] * 0.2f + t) + sinf((p[2] + p[0]) * 0.1f + t * 2.0f))) * 0.4f;
+
+	float plants0[3] = { p[0], p[1], p[2] };
+	float plants1[3] = { p[0] - 1.0f, p[1], p[2] + 0.5f };
+	float plants2[3] = { p[0] + 2.5f, p[1], p[2] + 1.3f };
+
+	float corals[2];
+	uint32_t coralIterations = CoralIterations;
+	if (settings.isFastCoral)
+	{
+		float footprint = Length(p[0] - MARCH_EYE[0], p[1] - MARCH_EYE[1], p[2] - MARCH_EYE[2]) * settings.pixelRadius;
+		coralIterations = GetCoralIterations(std::max(Epsilon, footprint));
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		float q[3] = { p[0] - MARCH_CORAL_OFFSETS[c][0], p[1] - MARCH_CORAL_OFFSETS[c][1], p[2] - MARCH_CORAL_OFFSETS[c][2] };
+		corals[c] = settings.isFastCoral ? FastCoralSDF(q, coralIterations, true) : FormulaCoralSDF(q);
+	}
+
+	// The nested min() of the shader, innermost first
+	float nearest = BubbleSDF(pp, m_time);
+	id = MARCH_BUBBLE_ID;
+	Nearer(BubbleSDF(pp, m_time - 0.8f), MARCH_BUBBLE_ID, nearest, id);
+	Nearer(corals[1], 6.5f, nearest, id);
+	if (settings.isPlantGrid)
+	{
+		Nearer(corals[0], 7.5f, nearest, id);
+		float material;
+		float plants = m_plants.Distance(p, m_time, material);
+		Nearer(plants, material, nearest, id);
+	}
+	else
+	{
+		Nearer(PlantGrid::PlantsSDF(plants2, m_time), 8.5f, nearest, id);
+		Nearer(corals[0], 7.5f, nearest, id);
+		Nearer(PlantGrid::PlantsSDF(plants1, m_time), 5.5f, nearest, id);
+		Nearer(PlantGrid::PlantsSDF(plants0, m_time), 5.5f, nearest, id);
+	}
+	Nearer(water, 1.5f, nearest, id);
+	return nearest;
+}
+
+float SceneMarcher::SceneSDF(const float p[3], const MarchSettings& settings, float& id) const
+{
+	float nearest = ObjectsSDF(p, settings, id);
+	Nearer(FloorSDF(p), 3.5f, nearest, id);
+	return nearest;
+}
+
+void SceneMarcher::EstimateNormal(const float p[3], const MarchSettings& settings, float n[3]) const
+{
+	static const float corners[4][3] = { { 1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+	n[0] = n[1] = n[2] = 0.0f;
+	for (int c = 0; c < 4; c++)
+	{
+		float q[3] = {
+			p[0] + corners[c][0] * MARCH_NORMAL_OFFSET,
+			p[1] + corners[c][1] * MARCH_NORMAL_OFFSET,
+			p[2] + corners[c][2] * MARCH_NORMAL_OFFSET
+		};
+		float id;
+		float d = SceneSDF(q, settings, id);
+		for (int i = 0; i < 3; i++) n[i] += corners[c][i] * MARCH_NORMAL_OFFSET * d;
+	}
+	float length = Length(n[0], n[1], n[2]);
+	for (int i = 0; i < 3; i++) n[i] /= length;
+}
+
+SceneHit SceneMarcher::March(const float origin[3], const float direction[3], float start, float end,
+	const MarchSettings& settings) const
+{
+	SceneHit hit = { 0, end, 0 };
+	float d[3] = { direction[0], direction[1], direction[2] };
+	float depth = start;
+	float outside = 1.0f;
+
+	float relaxation = settings.relaxation;
+	float previousRadius = 0.0f;
+	float stepLength = 0.0f;
+
+	while (hit.steps < settings.maxSteps)
+	{
+		float p[3] = { origin[0] + depth * d[0], origin[1] + depth * d[1], origin[2] + depth * d[2] };
+		float id;
+		float distance = SceneSDF(p, settings, id);
+		float radius = fabsf(distance);
+		hit.steps++;
+
+		// The spheres of this point and the last do not overlap, so step back
+		// to where the plain step would have ended
+		if (relaxation > 1.0f && radius + previousRadius < stepLength)
+		{
+			stepLength -= relaxation * stepLength;
+			relaxation = 1.0f;
+		}
+		else
+		{
+			if (distance < std::max(Epsilon, depth * settings.pixelRadius))
+			{
+				if (id == MARCH_BUBBLE_ID)
+				{
+					float n[3];
+					EstimateNormal(p, settings, n);
+					for (int i = 0; i < 3; i++) n[i] *= outside;
+					Refract(d, n);
+					outside = -outside;
+					previousRadius = 0.0f;
+					stepLength = 0.0f;
+					continue;
+				}
+				hit.id = static_cast<int>(id);
+				hit.distance = depth;
+				return hit;
+			}
+			stepLength = distance * relaxation;
+		}
+		previousRadius = radius;
+		depth += stepLength;
+		if (depth >= end) break;
+	}
+	return hit;
+}
+
+std::vector<MarchStepReport> SceneMarcher::Compare(uint32_t width, uint32_t height, float canvasWidth, float canvasHeight,
+	const std::vector<MarchSettings>& settings) const
+{
+	size_t rays = static_cast<size_t>(width) * height;
+	std::vector<std::vector<RayResult>> results(settings.size() + 1, std::vector<RayResult>(rays));
+	std::vector<double> milliseconds(settings.size() + 1);
+
+	for (size_t s = 0; s <= settings.size(); s++)
+	{
+		MarchSettings marchSettings = s == 0 ? PlainSettings() : settings[s - 1];
+		std::vector<RayResult>& result = results[s];
+
+		auto begin = std::chrono::high_resolution_clock::now();
+		ParallelFor(rays, [&](size_t first, size_t last)
+		{
+			for (size_t r = first; r < last; r++)
+			{
+				// Canvas coordinates at the pixel centre, as P01_VS.hlsl interpolates them.
+				uint32_t column = static_cast<uint32_t>(r % width);
+				uint32_t row = static_cast<uint32_t>(r / width);
+				float u = ((column + 0.5f) / width * 2.0f - 1.0f) * canvasWidth;
+				float v = (1.0f - (row + 0.5f) / height * 2.0f) * canvasHeight;
+				float length = sqrtf(u * u + v * v + 1.0f);
+				float direction[3] = { u / length, v / length, -1.0f / length };
+
+				result[r].hit = March(MARCH_EYE, direction, MinDistance, MaxDistance, marchSettings);
+				result[r].isOutOfSteps = result[r].hit.steps >= marchSettings.maxSteps;
+			}
+		});
+		milliseconds[s] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+	}
+
+	std::vector<MarchStepReport> reports;
+	const std::vector<RayResult>& baseline = results[0];
+	for (size_t s = 0; s < settings.size(); s++)
+	{
+		const std::vector<RayResult>& result = results[s + 1];
+		MarchStepReport report = {};
+		report.rays = static_cast<uint32_t>(rays);
+		report.maxSteps = settings[s].maxSteps;
+		report.relaxation = settings[s].relaxation;
+		report.isFastCoral = settings[s].isFastCoral;
+		report.isPlantGrid = settings[s].isPlantGrid;
+		report.milliseconds = milliseconds[s + 1];
+
+		uint64_t baselineSteps = 0, steps = 0;
+		uint32_t matched = 0;
+		for (size_t r = 0; r < rays; r++)
+		{
+			baselineSteps += baseline[r].hit.steps;
+			steps += result[r].hit.steps;
+			if (baseline[r].isOutOfSteps) report.baselineOutOfSteps++;
+			if (result[r].isOutOfSteps) report.outOfSteps++;
+
+			if (result[r].hit.id != baseline[r].hit.id)
+			{
+				report.mismatchedShare += 1.0;
+			}
+			else if (baseline[r].hit.id != 0)
+			{
+				report.depthError += fabs(result[r].hit.distance - baseline[r].hit.distance) / baseline[r].hit.distance;
+				matched++;
+			}
+		}
+
+		if (rays > 0)
+		{
+			report.baselineStepsPerRay = static_cast<double>(baselineSteps) / rays;
+			report.stepsPerRay = static_cast<double>(steps) / rays;
+			report.mismatchedShare /= rays;
+		}
+		if (matched > 0) report.depthError /= matched;
+		reports.push_back(report);
+	}
+	return reports;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "PlantGrid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace _202219807_ACW_700119_D3D11_UWP_APP
+{
+	// CPU version of SceneSDF and RayMarching from P01_Scene.hlsli, to compare the
+	// plain sphere tracer with the relaxed one the shaders can switch to. Only the
+	// tests and benchmarks use it, so it is not part of the app.
+	//
+	// Relaxed sphere tracing steps by relaxation times the distance. The step is
+	// only safe while the unbounding sphere of the new point overlaps the one of
+	// the previous: where the two radii add up to less than the step, a surface may
+	// lie in the gap, so the marcher goes back to where the plain step would have
+	// ended and carries on without relaxation.
+	//
+	// The hit threshold grows with the distance, as the radius of the cone a pixel
+	// covers, so rays stop as soon as the surface is within the pixel rather than
+	// within a fixed EPSILON. Far hits take fewer steps, near ones are unchanged.
+	//
+	// CoralSDF iterates a Mandelbulb-like formula: the radius to the power 8, and
+	// the angles times 12. The fast kernel computes the same without atan2, sin,
+	// cos or pow: the angles are multiplied by raising unit complex numbers to
+	// the twelfth power by squaring. It also stops at the first iteration that
+	// escapes, where the formula only repeated the same value. Beyond
+	// CoralBoundStart, it returns the distance to a sphere that holds the whole
+	// set, which is longer than the formula's estimate there. Fewer iterations
+	// grow the set, moving its surface outwards. The fast kernel drops
+	// iterations as long as that shift stays within the hit threshold at the
+	// point, so the coral seen is unchanged. CheckCoral measures all of this
+	// against the formula.
+	//
+	// The kelp can be evaluated through a PlantGrid instead of the loop of
+	// PlantsSDF, which gives the same surfaces with other step lengths.
+	//
+	// The floor is sphere traced with the rest, as with the floor mode of that
+	// name, and the noise is the analytic one (NoiseKernels). Changes to the
+	// distance functions should be made in both places.
+	//
+	// Only standard C++ is used here so the module builds and runs on any platform.
+
+	struct MarchSettings
+	{
+		uint32_t	maxSteps;
+		float		relaxation;		// 1 for plain sphere tracing.
+		float		pixelRadius;	// Radius of a pixel's cone at distance one, 0 for a fixed EPSILON.
+		bool		isFastCoral;	// The fast coral kernel instead of the formula.
+		bool		isPlantGrid;	// The kelp through the PlantGrid instead of PlantsSDF.
+	};
+
+	struct SceneHit
+	{
+		int			id;			// Material of ObjectsSDF, 0 for none.
+		float		distance;
+		uint32_t	steps;		// Distance evaluations, bubble refractions included.
+	};
+
+	struct MarchStepReport
+	{
+		uint32_t	rays;
+		uint32_t	maxSteps;
+		float		relaxation;
+		bool		isFastCoral;
+		bool		isPlantGrid;
+		double		baselineStepsPerRay;	// Plain sphere tracing with MaxMarchingSteps and Epsilon.
+		double		stepsPerRay;
+		uint32_t	baselineOutOfSteps;
+		uint32_t	outOfSteps;
+		double		mismatchedShare;		// Share of rays that hit another object than the baseline's.
+		double		depthError;				// Mean relative difference of the hit distance on the same object.
+		double		milliseconds;			// CPU time of the marcher compared, over all rays.
+	};
+
+	struct CoralKernelReport
+	{
+		uint32_t	samples;
+		double		formulaNanoseconds;		// Per call of the formula the shaders had.
+		double		fastNanoseconds;		// Trig-free with the bailout, all iterations.
+		double		boundedNanoseconds;		// With the bounding sphere as well.
+		float		maxError;				// Largest difference of the trig-free kernel from the formula.
+		uint32_t	beyondBound;			// Points of the set found outside the bounding sphere.
+		float		maxLodShift;			// Largest surface shift of a level of detail over its threshold; at most 1.
+		bool		isConsistent;
+	};
+
+	class SceneMarcher
+	{
+	public:
+		// Constants of the marcher in P01_Scene.hlsli.
+		static const uint32_t MaxMarchingSteps = 255;
+		static const float MinDistance;
+		static const float MaxDistance;
+		static const float Epsilon;
+
+		// Full iterations of CoralSDF, the radius of the sphere around the coral's
+		// set, and the distance from the centre beyond which the sphere is used.
+		static const uint32_t CoralIterations = 12;
+		static const float CoralBoundRadius;
+		static const float CoralBoundStart;
+
+		// Levels of detail of the coral: fewer iterations once the hit threshold
+		// reaches each footprint, thresholds ascending.
+		static const uint32_t CoralLodCount = 4;
+		static const float CoralLodFootprints[CoralLodCount];
+		static const uint32_t CoralLodIterations[CoralLodCount];
+
+		// The scene as it stands at a time, in seconds.
+		explicit SceneMarcher(float time);
+
+		// Distance to the scene and the material of the nearest object.
+		float SceneSDF(const float p[3], const MarchSettings& settings, float& id) const;
+
+		// Marches a ray from origin along a normalised direction, from start to end.
+		SceneHit March(const float origin[3], const float direction[3], float start, float end,
+			const MarchSettings& settings) const;
+
+		// The settings of the shaders before relaxation.
+		static MarchSettings PlainSettings();
+
+		// CoralSDF as the shaders had it, and the fast kernel with an iteration
+		// count, with or without the bounding sphere.
+		static float FormulaCoralSDF(const float p[3]);
+		static float FastCoralSDF(const float p[3], uint32_t iterations, bool isBounded);
+
+		// Iterations of the fast coral kernel for the hit threshold at a point.
+		static uint32_t GetCoralIterations(float footprint);
+
+		// Compares the fast coral kernel with the formula over random points
+		// around the coral, for accuracy and time per call.
+		static CoralKernelReport CheckCoral(uint32_t samples);
+
+		// Casts a width x height grid of rays from the fixed P01 eye, looking down -z
+		// as with the start camera, through the plain marcher and each of settings.
+		// The canvas coordinates reach +-canvasWidth and +-canvasHeight at the edges.
+		std::vector<MarchStepReport> Compare(uint32_t width, uint32_t height, float canvasWidth, float canvasHeight,
+			const std::vector<MarchSettings>& settings) const;
+
+	private:
+		float SurfaceSDF(float x, float z) const;
+		float FloorSDF(const float p[3]) const;
+		float BubbleSDF(const float p[3], float t) const;
+		float ObjectsSDF(const float p[3], const MarchSettings& settings, float& id) const;
+		void EstimateNormal(const float p[3], const MarchSettings& settings, float n[3]) const;
+
+		float		m_time;
+		PlantGrid	m_plants;
+	};
+}
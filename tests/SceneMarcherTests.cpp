@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "SceneMarcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// Canvas extents of P01 with the start camera's projection at 16:9, and the
+	// radius of a pixel's cone on a 1080 pixel high screen.
+	const float MARCH_TEST_CANVAS_WIDTH = 1.106f;
+	const float MARCH_TEST_CANVAS_HEIGHT = 0.63f;
+	const float MARCH_TEST_PIXEL_RADIUS = MARCH_TEST_CANVAS_HEIGHT / 1080.0f;
+	const float MARCH_TEST_TIME = 10.0f;
+}
+
+// Around the coral, the trig-free kernel stays within 0.002 of the formula,
+// nothing of the set lies outside the bounding sphere, and no level of detail
+// moves the surface by more than its hit threshold.
+TEST(SceneMarcher_FastCoralMatchesFormula)
+{
+	CoralKernelReport report = SceneMarcher::CheckCoral(16384);
+	CHECK(report.samples == 16384);
+	CHECK(report.maxError <= 0.002f);
+	CHECK(report.beyondBound == 0);
+	CHECK(report.maxLodShift <= 1.0f);
+
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> coordinate(-1.5f, 1.5f);
+	float largest = 0.0f;
+	for (int i = 0; i < 1000; i++)
+	{
+		float p[3] = { coordinate(random), coordinate(random), coordinate(random) };
+		float formula = SceneMarcher::FormulaCoralSDF(p);
+		float fast = SceneMarcher::FastCoralSDF(p, SceneMarcher::CoralIterations, false);
+		largest = std::max(largest, std::fabs(formula - fast));
+	}
+	CHECK(largest <= 0.002f);
+}
+
+TEST(SceneMarcher_CoralLevelsDropIterationsWithFootprint)
+{
+	CHECK(SceneMarcher::GetCoralIterations(0.0f) == SceneMarcher::CoralIterations);
+	uint32_t previous = SceneMarcher::CoralIterations;
+	for (uint32_t level = 0; level < SceneMarcher::CoralLodCount; level++)
+	{
+		uint32_t iterations = SceneMarcher::GetCoralIterations(SceneMarcher::CoralLodFootprints[level]);
+		CHECK(iterations <= previous);
+		CHECK(iterations == SceneMarcher::CoralLodIterations[level]);
+		previous = iterations;
+	}
+}
+
+// Over the rays of the P01 start camera, on a coarse grid, the relaxed tracer
+// with the pixel-cone threshold takes fewer steps than the plain one and sees
+// the same objects at the same depths, and neither the fast coral kernel nor
+// the plant grid changes what is hit.
+TEST(SceneMarcher_RelaxedTracingSavesStepsOnTheSameHits)
+{
+	std::vector<MarchSettings> settings = {
+		{ SceneMarcher::MaxMarchingSteps, 1.3f, MARCH_TEST_PIXEL_RADIUS, false, false },
+		{ SceneMarcher::MaxMarchingSteps, 1.0f, 0.0f, true, false },
+		{ SceneMarcher::MaxMarchingSteps, 1.0f, 0.0f, false, true }
+	};
+	SceneMarcher marcher(MARCH_TEST_TIME);
+	std::vector<MarchStepReport> reports = marcher.Compare(48, 27, MARCH_TEST_CANVAS_WIDTH, MARCH_TEST_CANVAS_HEIGHT, settings);
+
+	CHECK(reports.size() == settings.size());
+	if (reports.size() != settings.size()) return;
+
+	CHECK(reports[0].rays == 48 * 27);
+	CHECK(reports[0].stepsPerRay < reports[0].baselineStepsPerRay);
+	CHECK(reports[0].mismatchedShare < 0.02);
+	CHECK(reports[0].depthError < 0.01);
+	CHECK(reports[1].mismatchedShare < 0.02);
+	CHECK(reports[2].mismatchedShare < 0.02);
+	CHECK(reports[2].isPlantGrid);
+}
+
+TEST(SceneMarcher_PlainSettingsAreTheShaders)
+{
+	MarchSettings plain = SceneMarcher::PlainSettings();
+	CHECK(plain.maxSteps == SceneMarcher::MaxMarchingSteps);
+	CHECK(plain.relaxation == 1.0f);
+	CHECK(plain.pixelRadius == 0.0f);
+	CHECK(!plain.isFastCoral && !plain.isPlantGrid);
+
+	// A ray straight down from the eye meets the sea floor.
+	SceneMarcher marcher(MARCH_TEST_TIME);
+	const float origin[3] = { -2.0f, -1.8f, 5.0f };
+	const float down[3] = { 0.0f, -1.0f, 0.0f };
+	SceneHit hit = marcher.March(origin, down, SceneMarcher::MinDistance, SceneMarcher::MaxDistance, plain);
+	CHECK(hit.id != 0);
+	CHECK(hit.distance < SceneMarcher::MaxDistance);
+}
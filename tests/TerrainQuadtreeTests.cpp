@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "TestFramework.h"
+#include "TerrainQuadtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace _202219807_ACW_700119_D3D11_UWP_APP;
+
+namespace
+{
+	// The fixed eye of the P01 ray marcher, and a view-projection that keeps
+	// the whole sea floor within the clip volume.
+	const float TERRAIN_TEST_EYE[3] = { -2.0f, -1.8f, 5.0f };
+	const float TERRAIN_TEST_EVERYTHING[16] = { 0.001f, 0, 0, 0, 0, 0.001f, 0, 0, 0, 0, 0.001f, 0, 0, 0, 0.5f, 1 };
+
+	// Cells across each side of a patch, in the order of the TERRAIN_SIDE_ bits,
+	// and the side a neighbour sees of the shared edge.
+	const int TERRAIN_TEST_SIDE_COLUMN[4] = { -1, 0, 1, 0 };
+	const int TERRAIN_TEST_SIDE_ROW[4] = { 0, -1, 0, 1 };
+	const uint32_t TERRAIN_TEST_OPPOSITE_SIDE[4] = { 2, 3, 0, 1 };
+}
+
+TEST(TerrainQuadtree_LeavesTileTheFloor)
+{
+	FloorHeightfield floor;
+	floor.Build();
+	TerrainQuadtree quadtree;
+	quadtree.Build(floor);
+	quadtree.Update(TERRAIN_TEST_EYE, TERRAIN_TEST_EVERYTHING);
+
+	const std::vector<TerrainPatch>& leaves = quadtree.GetLeaves();
+	CHECK(leaves.size() > 1);
+	CHECK(leaves.size() <= quadtree.GetMaxPatchCount());
+	CHECK(quadtree.GetPatches().size() == leaves.size());
+
+	double area = 0.0;
+	for (const TerrainPatch& leaf : leaves) area += static_cast<double>(leaf.size) * leaf.size;
+	double rootArea = static_cast<double>(quadtree.GetRootSize()) * quadtree.GetRootSize();
+	CHECK_NEAR(area, rootArea, rootArea * 1e-5);
+
+}
+
+// Every leaf side against each leaf across it: both sides must place their
+// vertices the same distance apart, and neighbours differ by one level at most.
+TEST(TerrainQuadtree_NeighbouringSidesShareTheirVertices)
+{
+	FloorHeightfield floor;
+	floor.Build();
+	TerrainQuadtree quadtree;
+	quadtree.Build(floor);
+	quadtree.Update(TERRAIN_TEST_EYE, TERRAIN_TEST_EVERYTHING);
+	const std::vector<TerrainPatch>& leaves = quadtree.GetLeaves();
+
+	// The leaf over each cell of the deepest level.
+	const int cells = 1 << TerrainQuadtree::MaxDepth;
+	const float cellSize = quadtree.GetRootSize() / cells;
+	std::vector<int> owners(static_cast<size_t>(cells) * cells, -1);
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		int column = static_cast<int>((leaves[i].x - quadtree.GetOriginX()) / cellSize + 0.5f);
+		int row = static_cast<int>((leaves[i].z - quadtree.GetOriginZ()) / cellSize + 0.5f);
+		int span = static_cast<int>(leaves[i].size / cellSize + 0.5f);
+		for (int r = row; r < std::min(row + span, cells); r++)
+		{
+			for (int c = column; c < std::min(column + span, cells); c++) owners[static_cast<size_t>(r) * cells + c] = static_cast<int>(i);
+		}
+	}
+	CHECK(std::find(owners.begin(), owners.end(), -1) == owners.end());
+
+	uint32_t sharedSides = 0;
+	uint32_t mismatchedSides = 0;
+	float largestSizeRatio = 1.0f;
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		const TerrainPatch& leaf = leaves[i];
+		int column = static_cast<int>((leaf.x - quadtree.GetOriginX()) / cellSize + 0.5f);
+		int row = static_cast<int>((leaf.z - quadtree.GetOriginZ()) / cellSize + 0.5f);
+		int span = static_cast<int>(leaf.size / cellSize + 0.5f);
+		float edges[4];
+		quadtree.GetTessellation(leaf, edges);
+
+		for (uint32_t side = 0; side < 4; side++)
+		{
+			// The cells just outside the side, each neighbour counted once.
+			int last = -1;
+			for (int k = 0; k < span; k++)
+			{
+				bool isAlongZ = TERRAIN_TEST_SIDE_COLUMN[side] != 0;
+				int neighbourColumn = isAlongZ ? (TERRAIN_TEST_SIDE_COLUMN[side] < 0 ? column - 1 : column + span) : column + k;
+				int neighbourRow = isAlongZ ? row + k : (TERRAIN_TEST_SIDE_ROW[side] < 0 ? row - 1 : row + span);
+				if (neighbourColumn < 0 || neighbourRow < 0 || neighbourColumn >= cells || neighbourRow >= cells) break;
+
+				int owner = owners[static_cast<size_t>(neighbourRow) * cells + neighbourColumn];
+				if (owner < 0 || owner == last) continue;
+				last = owner;
+
+				const TerrainPatch& neighbour = leaves[owner];
+				float neighbourEdges[4];
+				quadtree.GetTessellation(neighbour, neighbourEdges);
+				sharedSides++;
+				if (leaf.size / edges[side] != neighbour.size / neighbourEdges[TERRAIN_TEST_OPPOSITE_SIDE[side]]) mismatchedSides++;
+				largestSizeRatio = std::max(largestSizeRatio, std::max(leaf.size / neighbour.size, neighbour.size / leaf.size));
+			}
+		}
+	}
+	CHECK(sharedSides > 0);
+	CHECK(mismatchedSides == 0);
+	CHECK(largestSizeRatio <= 2.0f);
+}
+
+TEST(TerrainQuadtree_PatchesNearTheEyeAreSmaller)
+{
+	FloorHeightfield floor;
+	floor.Build();
+	TerrainQuadtree quadtree;
+	quadtree.Build(floor);
+	quadtree.Update(TERRAIN_TEST_EYE, TERRAIN_TEST_EVERYTHING);
+
+	float nearest = 1e30f;
+	float nearestSize = 0.0f;
+	float farthest = 0.0f;
+	float farthestSize = 0.0f;
+	for (const TerrainPatch& leaf : quadtree.GetLeaves())
+	{
+		float dx = leaf.x + leaf.size * 0.5f - TERRAIN_TEST_EYE[0];
+		float dz = leaf.z + leaf.size * 0.5f - TERRAIN_TEST_EYE[2];
+		float distance = sqrtf(dx * dx + dz * dz);
+		if (distance < nearest) { nearest = distance; nearestSize = leaf.size; }
+		if (distance > farthest) { farthest = distance; farthestSize = leaf.size; }
+	}
+	CHECK(nearestSize < farthestSize);
+}
+
+TEST(TerrainQuadtree_TessellationIsPowerOfTwoWithinLimits)
+{
+	for (float distance : { 0.01f, 0.5f, 3.0f, 40.0f, 1000.0f })
+	{
+		float tessellation = TerrainQuadtree::EdgeTessellation(1.0f, distance);
+		CHECK(tessellation >= TerrainQuadtree::MinTessellation);
+		CHECK(tessellation <= TerrainQuadtree::MaxTessellation);
+		CHECK(exp2f(roundf(log2f(tessellation))) == tessellation);
+	}
+	CHECK(TerrainQuadtree::EdgeTessellation(1.0f, 1.0f) >= TerrainQuadtree::EdgeTessellation(1.0f, 10.0f));
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// A test is a function registered under a name by TEST. CHECK records a
+// failure and lets the test carry on, so one run lists every broken
+// expectation. Tests are named Module_What, and the runner takes a prefix to
+// run the tests of one module, which is how CMakeLists.txt hands them to ctest.
+
+namespace Tests
+{
+	typedef void (*TestFunction)();
+
+	struct TestCase
+	{
+		const char*		name;
+		TestFunction	function;
+	};
+
+	std::vector<TestCase>& GetTests();
+	void ReportFailure(const char* file, int line, const char* expression);
+
+	struct TestRegistration
+	{
+		TestRegistration(const char* name, TestFunction function)
+		{
+			GetTests().push_back({ name, function });
+		}
+	};
+
+	inline bool IsNear(double a, double b, double tolerance)
+	{
+		return std::fabs(a - b) <= tolerance;
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Tests::TestRegistration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) Tests::ReportFailure(__FILE__, __LINE__, #expression); } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { if (!Tests::IsNear((a), (b), (tolerance))) Tests::ReportFailure(__FILE__, __LINE__, #a " ~ " #b); } while (false)
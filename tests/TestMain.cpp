@@ -0,0 +1,50 @@
+#include "TestFramework.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	size_t g_failures = 0;
+}
+
+std::vector<Tests::TestCase>& Tests::GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void Tests::ReportFailure(const char* file, int line, const char* expression)
+{
+	std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+	g_failures++;
+}
+
+// Runs the tests whose names start with the first argument, or all of them.
+int main(int argc, char* argv[])
+{
+	const char* prefix = (argc > 1) ? argv[1] : "";
+	size_t run = 0;
+	size_t failed = 0;
+
+	for (const Tests::TestCase& test : Tests::GetTests())
+	{
+		if (std::strncmp(test.name, prefix, std::strlen(prefix)) != 0)
+		{
+			continue;
+		}
+
+		size_t failuresBefore = g_failures;
+		auto start = std::chrono::steady_clock::now();
+		test.function();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		bool isPassed = (g_failures == failuresBefore);
+		std::printf("%s %s (%.1f ms)\n", isPassed ? "PASS" : "FAIL", test.name, milliseconds);
+		run++;
+		if (!isPassed) failed++;
+	}
+
+	std::printf("%zu tests, %zu failed\n", run, failed);
+	return (run == 0 || failed > 0) ? 1 : 0;
+}
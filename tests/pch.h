@@ -0,0 +1,73 @@
+#pragma once
+
+// Stands in for the app's pch.h when the platform-neutral modules of Content
+// are built on their own. Only the DirectXMath storage types that
+// ShaderStructures.h lays out are declared here, none of the maths.
+
+#include <cstdint>
+#include <memory>
+
+namespace DirectX
+{
+	struct XMFLOAT2
+	{
+		float x, y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+	};
+
+	struct XMINT2
+	{
+		int32_t x, y;
+	};
+
+	struct XMUINT2
+	{
+		uint32_t x, y;
+	};
+
+	struct XMUINT3
+	{
+		uint32_t x, y, z;
+	};
+
+	struct XMUINT4
+	{
+		uint32_t x, y, z, w;
+	};
+}
+
+// Platform::uint32 of C++/CX, which ShaderStructures.h uses unqualified.
+typedef uint32_t uint32;